@@ -0,0 +1,361 @@
+#include "BenchReport.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace kcShaders {
+
+namespace {
+
+// Nearest-rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+std::string escapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+void addStats(std::map<std::string, double>& values, const std::string& prefix, const TimingStats& stats)
+{
+    values[prefix + ".count"] = stats.count;
+    values[prefix + ".min"] = stats.min;
+    values[prefix + ".avg"] = stats.avg;
+    values[prefix + ".p50"] = stats.p50;
+    values[prefix + ".p95"] = stats.p95;
+    values[prefix + ".p99"] = stats.p99;
+    values[prefix + ".max"] = stats.max;
+}
+
+/**
+ * Minimal JSON reader that keeps numbers only, keyed by their dotted path;
+ * strings, booleans and null are validated and skipped
+ */
+class JsonFlattener {
+public:
+    JsonFlattener(const std::string& text, std::map<std::string, double>& values)
+        : text_(text)
+        , pos_(0)
+        , values_(values)
+    {
+    }
+
+    bool parse()
+    {
+        if (!parseValue("")) {
+            return false;
+        }
+        skipSpace();
+        return pos_ == text_.size();
+    }
+
+    size_t position() const { return pos_; }
+
+private:
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            pos_++;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseString(std::string& out)
+    {
+        if (!consume('"')) {
+            return false;
+        }
+        out.clear();
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            if (text_[pos_] == '\\') {
+                pos_++;
+                if (pos_ >= text_.size()) return false;
+            }
+            out += text_[pos_++];
+        }
+        return consume('"');
+    }
+
+    bool parseValue(const std::string& key)
+    {
+        skipSpace();
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+
+        char c = text_[pos_];
+        if (c == '{') {
+            pos_++;
+            if (consume('}')) return true;
+            do {
+                std::string name;
+                if (!parseString(name) || !consume(':') || !parseValue(key.empty() ? name : key + "." + name)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            pos_++;
+            if (consume(']')) return true;
+            int index = 0;
+            do {
+                if (!parseValue(key + "." + std::to_string(index++))) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            std::string ignored;
+            return parseString(ignored);
+        }
+        for (const char* literal : {"true", "false", "null"}) {
+            size_t length = std::char_traits<char>::length(literal);
+            if (text_.compare(pos_, length, literal) == 0) {
+                pos_ += length;
+                return true;
+            }
+        }
+
+        const char* start = text_.c_str() + pos_;
+        char* end = nullptr;
+        double number = std::strtod(start, &end);
+        if (end == start) {
+            return false;
+        }
+        pos_ += static_cast<size_t>(end - start);
+        values_[key] = number;
+        return true;
+    }
+
+    const std::string& text_;
+    size_t pos_;
+    std::map<std::string, double>& values_;
+};
+
+bool endsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Frame and pass percentiles and micro-benchmark medians are compared;
+// averages, extremes and counters are informational
+bool isComparedMetric(const std::string& key)
+{
+    if (key.compare(0, 11, "benchmarks.") == 0) {
+        return endsWith(key, ".cpu_ms.p50");
+    }
+    if (key.compare(0, 6, "modes.") != 0) {
+        return false;
+    }
+    bool timing = key.find(".cpu_ms.") != std::string::npos ||
+                  key.find(".gpu_ms.") != std::string::npos ||
+                  key.find(".frame_ms.") != std::string::npos;
+    return timing && (endsWith(key, ".p50") || endsWith(key, ".p95") || endsWith(key, ".p99"));
+}
+
+} // namespace
+
+TimingStats TimingStats::fromSamples(std::vector<double> samples)
+{
+    TimingStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double t : samples) sum += t;
+
+    stats.count = static_cast<int>(samples.size());
+    stats.min = samples.front();
+    stats.avg = sum / samples.size();
+    stats.p50 = percentile(samples, 0.50);
+    stats.p95 = percentile(samples, 0.95);
+    stats.p99 = percentile(samples, 0.99);
+    stats.max = samples.back();
+    return stats;
+}
+
+std::string TimingStats::toJson() const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(6);  // Micro-benchmarks are in the microsecond range
+    out << "{\"count\": " << count << ", \"min\": " << min << ", \"avg\": " << avg
+        << ", \"p50\": " << p50 << ", \"p95\": " << p95 << ", \"p99\": " << p99
+        << ", \"max\": " << max << "}";
+    return out.str();
+}
+
+bool BenchReport::save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "[Bench] Failed to write report: " << path << "\n";
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(4);
+    file << "{\n";
+    file << "  \"version\": 1,\n";
+    file << "  \"scene\": \"" << escapeJson(scene) << "\",\n";
+    file << "  \"camera_path\": \"" << escapeJson(cameraPath) << "\",\n";
+    file << "  \"gl_renderer\": \"" << escapeJson(glRenderer) << "\",\n";
+    file << "  \"width\": " << width << ",\n";
+    file << "  \"height\": " << height << ",\n";
+    file << "  \"frames\": " << frames << ",\n";
+    file << "  \"warmup_frames\": " << warmupFrames << ",\n";
+    file << "  \"timestep\": " << timestep << ",\n";
+    file << "  \"modes\": {";
+
+    for (size_t m = 0; m < modes.size(); m++) {
+        const ModeResult& mode = modes[m];
+        file << (m == 0 ? "\n" : ",\n");
+        file << "    \"" << escapeJson(mode.name) << "\": {\n";
+        file << "      \"frames\": " << mode.frames << ",\n";
+        file << "      \"cpu_ms\": ";
+        file << mode.cpu.toJson();
+        file << ",\n      \"gpu_ms\": ";
+        file << mode.gpu.toJson();
+        file << ",\n      \"frame_ms\": ";
+        file << mode.frame.toJson();
+
+        file << ",\n      \"passes\": {";
+        for (size_t p = 0; p < mode.passes.size(); p++) {
+            const PassResult& pass = mode.passes[p];
+            file << (p == 0 ? "\n" : ",\n");
+            file << "        \"" << escapeJson(pass.name) << "\": {\"cpu_ms\": ";
+            file << pass.cpu.toJson();
+            file << ", \"gpu_ms\": ";
+            file << pass.gpu.toJson();
+            file << "}";
+        }
+        file << (mode.passes.empty() ? "},\n" : "\n      },\n");
+
+        file << "      \"counters\": {";
+        for (size_t c = 0; c < mode.counters.size(); c++) {
+            file << (c == 0 ? "" : ", ") << "\"" << escapeJson(mode.counters[c].first) << "\": "
+                 << mode.counters[c].second;
+        }
+        file << "}\n    }";
+    }
+
+    file << (modes.empty() ? "}\n" : "\n  }\n") << "}\n";
+
+    std::cout << "[Bench] Wrote report to " << path << "\n";
+    return true;
+}
+
+std::map<std::string, double> BenchReport::values() const
+{
+    std::map<std::string, double> result;
+    for (const ModeResult& mode : modes) {
+        std::string prefix = "modes." + mode.name;
+        result[prefix + ".frames"] = mode.frames;
+        addStats(result, prefix + ".cpu_ms", mode.cpu);
+        addStats(result, prefix + ".gpu_ms", mode.gpu);
+        addStats(result, prefix + ".frame_ms", mode.frame);
+        for (const PassResult& pass : mode.passes) {
+            addStats(result, prefix + ".passes." + pass.name + ".cpu_ms", pass.cpu);
+            addStats(result, prefix + ".passes." + pass.name + ".gpu_ms", pass.gpu);
+        }
+        for (const auto& [name, value] : mode.counters) {
+            result[prefix + ".counters." + name] = value;
+        }
+    }
+    return result;
+}
+
+bool loadReportValues(const std::string& path, std::map<std::string, double>& values)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "[Bench] Failed to open baseline: " << path << "\n";
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    values.clear();
+    JsonFlattener parser(text, values);
+    if (!parser.parse()) {
+        std::cerr << "[Bench] Invalid JSON in " << path << " near offset " << parser.position() << "\n";
+        return false;
+    }
+    return true;
+}
+
+int compareWithBaseline(const std::map<std::string, double>& current,
+                        const std::map<std::string, double>& baseline,
+                        double threshold, double minDeltaMs, std::ostream& out)
+{
+    int regressions = 0;
+    int improvements = 0;
+    int compared = 0;
+
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [key, value] : current) {
+        if (!isComparedMetric(key) || value < 0.0) {
+            continue;
+        }
+
+        auto it = baseline.find(key);
+        if (it == baseline.end() || it->second < 0.0) {
+            out << "  NEW        " << key << " = " << value << " ms\n";
+            continue;
+        }
+
+        compared++;
+        double base = it->second;
+        double delta = value - base;
+        double relative = base > 0.0 ? delta / base : 0.0;
+        if (std::abs(delta) < minDeltaMs || std::abs(relative) <= threshold) {
+            continue;
+        }
+
+        bool slower = delta > 0.0;
+        (slower ? regressions : improvements)++;
+        out << (slower ? "  REGRESSION " : "  improved   ") << key << ": " << base << " -> " << value
+            << " ms (" << std::showpos << relative * 100.0 << std::noshowpos << "%)\n";
+    }
+
+    for (const auto& [key, value] : baseline) {
+        if (isComparedMetric(key) && value >= 0.0 && current.find(key) == current.end()) {
+            out << "  MISSING    " << key << " (not measured in this run)\n";
+        }
+    }
+
+    out << compared << " metrics compared, " << regressions << " regressions, " << improvements
+        << " improvements (threshold " << threshold * 100.0 << "%, noise floor " << minDeltaMs << " ms)\n";
+    return regressions;
+}
+
+} // namespace kcShaders
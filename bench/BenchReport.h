@@ -0,0 +1,83 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kcShaders {
+
+/** Distribution of one timing series in milliseconds, -1 when empty */
+struct TimingStats {
+    int count = 0;
+    double min = -1.0;
+    double avg = -1.0;
+    double p50 = -1.0;
+    double p95 = -1.0;
+    double p99 = -1.0;
+    double max = -1.0;
+
+    static TimingStats fromSamples(std::vector<double> samples);
+
+    /** {"count": .., "min": .., ..., "max": ..} */
+    std::string toJson() const;
+};
+
+struct PassResult {
+    std::string name;  // Profiler scope name
+    TimingStats cpu;
+    TimingStats gpu;
+};
+
+struct ModeResult {
+    std::string name;
+    int frames = 0;
+    TimingStats cpu;       // begin_frame to end_frame on the CPU
+    TimingStats gpu;       // First to last GPU timestamp of the frame
+    TimingStats frame;     // Wall time between frame starts, includes the swap
+    std::vector<PassResult> passes;
+    std::vector<std::pair<std::string, double>> counters;  // PerfCounters per frame
+};
+
+/**
+ * BenchReport: Result of one kcShaders_bench run
+ *
+ * Saved as JSON. For comparisons a report is flattened into dotted keys
+ * ("modes.deferred.gpu_ms.p95"), so a baseline only needs the numbers, not
+ * the exact layout of the run that produced it.
+ */
+struct BenchReport {
+    std::string scene;
+    std::string cameraPath;
+    std::string glRenderer;
+    int width = 0;
+    int height = 0;
+    int frames = 0;
+    int warmupFrames = 0;
+    double timestep = 0.0;
+    std::vector<ModeResult> modes;
+
+    bool save(const std::string& path) const;
+
+    /** Numeric values by dotted key, as loadReportValues() returns them */
+    std::map<std::string, double> values() const;
+};
+
+/** Read the numbers of a saved report (or any JSON file) by dotted key */
+bool loadReportValues(const std::string& path, std::map<std::string, double>& values);
+
+/**
+ * Compare timings of a run against a baseline: frame and pass percentiles
+ * of bench reports ("modes.*") and medians of micro-benchmarks
+ * ("benchmarks.*")
+ * @param threshold Relative slowdown that counts as a regression (0.1 = 10%)
+ * @param minDeltaMs Smaller absolute differences are treated as noise
+ * @return Number of regressions; regressions, improvements and metrics
+ *         missing from either side are listed on `out`
+ */
+int compareWithBaseline(const std::map<std::string, double>& current,
+                        const std::map<std::string, double>& baseline,
+                        double threshold, double minDeltaMs, std::ostream& out);
+
+} // namespace kcShaders
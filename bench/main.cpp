@@ -0,0 +1,605 @@
+// kcShaders_bench: replays a camera path through every render mode and
+// writes frame time percentiles as JSON, optionally checked against a baseline.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "BenchReport.h"
+#include "graphics/RenderMode.h"
+#include "graphics/renderer.h"
+#include "graphics/Profiler.h"
+#include "graphics/PerfCounters.h"
+#include "scene/camera.h"
+#include "scene/camera_path.h"
+#include "scene/demo_scene.h"
+#ifdef ENABLE_USD_SUPPORT
+#include "loaders/usd_loader.h"
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace kcShaders;
+
+namespace {
+
+struct ModeInfo {
+    RenderMode mode;
+    const char* name;
+};
+
+const ModeInfo kModes[] = {
+    { RenderMode::ForwardRendering,  "forward" },
+    { RenderMode::DeferredRendering, "deferred" },
+    { RenderMode::Shadertoy,         "shadertoy" },
+    { RenderMode::RayTracing,        "raytracing" },
+};
+
+struct Options {
+    std::string scene = "demo";         // demo, primitives[:N] or a USD file
+    std::string cameraPath;             // Keyframe file, empty = orbit
+    std::string shaderDir = "../../src/shaders";
+    std::string output = "bench_report.json";
+    std::string baseline;
+    std::string countersOut;            // Periodic counter export, empty = off
+    int countersInterval = 60;          // Frames per exported counter snapshot
+    std::vector<std::string> modes;     // Empty = all
+    int width = 1280;
+    int height = 720;
+    int frames = 600;
+    int warmupFrames = 60;
+    double timestep = 1.0 / 60.0;
+    double threshold = 0.10;
+    double minDeltaMs = 0.05;
+    int rtBounces = 4;
+    int rtSamples = 1;
+    RayTracingPreset rtPreset = RayTracingPreset::Quality;
+    bool traversalStats = false;
+    int pointLights = 0;                // Extra grid lights for many-light runs
+    bool depthPrepass = false;          // Forward mode draws depth first, shades with GL_EQUAL
+    bool forwardSSAO = false;           // Forward mode SSAO from the pre-pass depth
+    bool tiledLighting = false;         // Deferred mode shades with TiledLightingPass
+    bool occlusionCulling = false;      // Deferred geometry pass culled against a Hi-Z pyramid
+    int ssaoDownsample = 2;             // Deferred SSAO resolution divisor
+    bool gtao = false;                  // Deferred AO from GTAOPass instead of SSAOPass
+    bool shadowCache = true;            // Deferred shadow cascades redrawn only when they change
+    int shadowAtlasBudget = 12;         // Deferred point/spot shadow views redrawn per frame, 0 = unlimited
+    bool hidden = false;
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: kcShaders_bench [options]\n"
+        "  --scene NAME          demo (default), primitives[:N] (N x N grid) or a .usd/.usda/.usdc file\n"
+        "  --camera FILE         Camera keyframes (time px py pz tx ty tz per line), default: orbit\n"
+        "  --modes LIST          Comma separated: forward,deferred,shadertoy,raytracing (default: all)\n"
+        "  --frames N            Measured frames per mode (default 600)\n"
+        "  --warmup N            Unmeasured frames per mode before measuring (default 60)\n"
+        "  --timestep SECONDS    Camera path time per frame (default 1/60)\n"
+        "  --size WxH            Render resolution (default 1280x720)\n"
+        "  --shaders DIR         Shader root directory (default ../../src/shaders)\n"
+        "  --rt-bounces N        Ray tracing max bounces (default 4)\n"
+        "  --rt-spp N            Ray tracing samples per pixel (default 1)\n"
+        "  --rt-preset NAME      quality (default), balanced or performance\n"
+        "  --rt-traversal-stats  Count rays and BVH nodes on the GPU\n"
+        "  --point-lights N      Add N point lights on a grid over the scene\n"
+        "  --depth-prepass       Forward mode draws a depth pre-pass and shades with an equal depth test\n"
+        "  --forward-ssao        Forward mode SSAO from the pre-pass depth (implies the pre-pass)\n"
+        "  --tiled-lighting      Deferred mode uses the compute tiled lighting pass\n"
+        "  --occlusion-culling   Deferred mode culls the geometry pass with two-phase Hi-Z occlusion culling\n"
+        "  --ssao-downsample N   Deferred SSAO resolution divisor: 1, 2 (default) or 4\n"
+        "  --gtao                Deferred mode uses the compute GTAO pass for AO\n"
+        "  --no-shadow-cache     Deferred mode redraws every shadow cascade and atlas tile every frame\n"
+        "  --shadow-budget N     Point/spot shadow views redrawn per frame (default 12, 0 = unlimited)\n"
+        "  --hidden              Do not show the window\n"
+        "  --out FILE            Report path (default bench_report.json)\n"
+        "  --counters-out FILE   Append summed counters every --counters-interval frames (.json, otherwise CSV)\n"
+        "  --counters-interval N Frames per counter snapshot (default 60)\n"
+        "  --baseline FILE       Compare with a previous report, exit code 1 on regression\n"
+        "  --threshold FRACTION  Relative slowdown flagged as regression (default 0.10)\n"
+        "  --min-delta MS        Ignore absolute differences below this (default 0.05)\n";
+}
+
+std::vector<std::string> splitList(const std::string& text)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "[Bench] Missing value for " << arg << "\n";
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            std::exit(0);
+        } else if (arg == "--rt-traversal-stats") {
+            options.traversalStats = true;
+        } else if (arg == "--depth-prepass") {
+            options.depthPrepass = true;
+        } else if (arg == "--forward-ssao") {
+            options.forwardSSAO = true;
+        } else if (arg == "--tiled-lighting") {
+            options.tiledLighting = true;
+        } else if (arg == "--occlusion-culling") {
+            options.occlusionCulling = true;
+        } else if (arg == "--gtao") {
+            options.gtao = true;
+        } else if (arg == "--no-shadow-cache") {
+            options.shadowCache = false;
+        } else if (arg == "--hidden") {
+            options.hidden = true;
+        } else {
+            const char* v = value();
+            if (!v) return false;
+
+            if (arg == "--scene") options.scene = v;
+            else if (arg == "--camera") options.cameraPath = v;
+            else if (arg == "--modes") options.modes = splitList(v);
+            else if (arg == "--frames") options.frames = std::max(1, std::atoi(v));
+            else if (arg == "--warmup") options.warmupFrames = std::max(0, std::atoi(v));
+            else if (arg == "--timestep") options.timestep = std::atof(v);
+            else if (arg == "--shaders") options.shaderDir = v;
+            else if (arg == "--rt-bounces") options.rtBounces = std::max(1, std::atoi(v));
+            else if (arg == "--rt-spp") options.rtSamples = std::max(1, std::atoi(v));
+            else if (arg == "--point-lights") options.pointLights = std::max(0, std::atoi(v));
+            else if (arg == "--shadow-budget") options.shadowAtlasBudget = std::max(0, std::atoi(v));
+            else if (arg == "--ssao-downsample") options.ssaoDownsample = std::max(1, std::atoi(v));
+            else if (arg == "--out") options.output = v;
+            else if (arg == "--counters-out") options.countersOut = v;
+            else if (arg == "--counters-interval") options.countersInterval = std::max(1, std::atoi(v));
+            else if (arg == "--baseline") options.baseline = v;
+            else if (arg == "--threshold") options.threshold = std::atof(v);
+            else if (arg == "--min-delta") options.minDeltaMs = std::atof(v);
+            else if (arg == "--size") {
+                if (std::sscanf(v, "%dx%d", &options.width, &options.height) != 2 ||
+                    options.width <= 0 || options.height <= 0) {
+                    std::cerr << "[Bench] Invalid size: " << v << "\n";
+                    return false;
+                }
+            } else if (arg == "--rt-preset") {
+                std::string preset = v;
+                if (preset == "quality") options.rtPreset = RayTracingPreset::Quality;
+                else if (preset == "balanced") options.rtPreset = RayTracingPreset::Balanced;
+                else if (preset == "performance") options.rtPreset = RayTracingPreset::Performance;
+                else {
+                    std::cerr << "[Bench] Unknown ray tracing preset: " << preset << "\n";
+                    return false;
+                }
+            } else {
+                std::cerr << "[Bench] Unknown option: " << arg << "\n";
+                printUsage();
+                return false;
+            }
+        }
+    }
+
+    for (const std::string& name : options.modes) {
+        bool known = std::any_of(std::begin(kModes), std::end(kModes),
+                                 [&](const ModeInfo& info) { return name == info.name; });
+        if (!known) {
+            std::cerr << "[Bench] Unknown mode: " << name << "\n";
+            return false;
+        }
+    }
+    if (options.timestep <= 0.0) {
+        std::cerr << "[Bench] Timestep must be positive\n";
+        return false;
+    }
+    return true;
+}
+
+// Scene and the orbit that frames it when no camera file is given
+Scene* loadScene(const Options& options, CameraPath& orbit)
+{
+    float duration = static_cast<float>(options.frames * options.timestep);
+
+    if (options.scene == "demo") {
+        orbit = CameraPath::CreateOrbit(glm::vec3(0.0f), 8.0f, 4.0f, duration);
+        Scene* scene = create_demo_scene();
+        add_point_light_grid(scene, options.pointLights, 10.0f);
+        return scene;
+    }
+
+    if (options.scene.compare(0, 10, "primitives") == 0) {
+        int grid = 8;
+        if (options.scene.size() > 11 && options.scene[10] == ':') {
+            grid = std::max(1, std::atoi(options.scene.c_str() + 11));
+        }
+        float extent = 2.5f * grid;
+        orbit = CameraPath::CreateOrbit(glm::vec3(0.0f), 0.75f * extent + 4.0f, 0.4f * extent + 3.0f, duration);
+        Scene* scene = create_primitive_scene(grid);
+        add_point_light_grid(scene, options.pointLights, extent);
+        return scene;
+    }
+
+#ifdef ENABLE_USD_SUPPORT
+    Scene* scene = new Scene();
+    UsdLoader loader;
+    if (!loader.LoadFromFile(options.scene, scene)) {
+        std::cerr << "[Bench] Failed to load USD file: " << loader.GetLastError() << "\n";
+        delete scene;
+        return nullptr;
+    }
+    // Same framing as the editor uses after loading a USD file
+    orbit = CameraPath::CreateOrbit(glm::vec3(0.0f), 7.0f, 5.0f, duration);
+    add_point_light_grid(scene, options.pointLights, 10.0f);
+    return scene;
+#else
+    std::cerr << "[Bench] Unknown scene '" << options.scene << "' (USD support not enabled)\n";
+    return nullptr;
+#endif
+}
+
+bool prepareMode(Renderer& renderer, RenderMode mode, Scene* scene, const Options& options)
+{
+    const std::string& dir = options.shaderDir;
+    switch (mode) {
+        case RenderMode::ForwardRendering:
+            if (!renderer.loadForwardShaders(
+                dir + "/forward/default.vert", dir + "/forward/default.frag",
+                dir + "/forward/depth.vert", dir + "/forward/depth.frag",
+                dir + "/deferred/ssao.vert", dir + "/deferred/ssao.frag",
+                dir + "/deferred/ssao_blur.vert", dir + "/deferred/ssao_blur.frag")) {
+                return false;
+            }
+            renderer.enableForwardDepthPrepass(options.depthPrepass);
+            renderer.enableForwardSSAO(options.forwardSSAO);
+            return true;
+
+        case RenderMode::DeferredRendering:
+            if (!renderer.loadDeferredShaders(
+                dir + "/deferred/geometry.vert", dir + "/deferred/geometry.frag",
+                dir + "/deferred/lighting.vert", dir + "/deferred/lighting.frag",
+                dir + "/deferred/ssao.vert", dir + "/deferred/ssao.frag",
+                dir + "/deferred/ssao_blur.vert", dir + "/deferred/ssao_blur.frag",
+                dir + "/deferred/shadow_map.vert", dir + "/deferred/shadow_map.frag",
+                dir + "/deferred/tiled_lighting.comp",
+                dir + "/deferred/gtao.comp",
+                dir + "/deferred/shadow_atlas.geom",
+                dir + "/deferred/occlusion.comp")) {
+                return false;
+            }
+            renderer.enableDeferredTiledLighting(options.tiledLighting);
+            renderer.enableDeferredOcclusionCulling(options.occlusionCulling);
+            renderer.setDeferredSSAODownsample(options.ssaoDownsample);
+            renderer.enableDeferredSSAO(true, options.gtao);
+            renderer.enableDeferredShadowCaching(options.shadowCache);
+            renderer.setDeferredShadowAtlasBudget(options.shadowAtlasBudget);
+            return true;
+
+        case RenderMode::Shadertoy:
+            return renderer.loadShadertoyShaders(dir + "/shadertoy/default.vert", dir + "/shadertoy/demo.frag");
+
+        case RenderMode::RayTracing:
+            if (!renderer.loadRayTracingShaders(dir + "/raytracing/default.comp",
+                                                dir + "/raytracing/display.vert",
+                                                dir + "/raytracing/display.frag",
+                                                dir + "/raytracing/adaptive_density.comp",
+                                                dir + "/raytracing/wavefront/",
+                                                dir + "/raytracing/denoise/",
+                                                dir + "/raytracing/reproject.comp")) {
+                return false;
+            }
+            renderer.setRayTracingParameters(options.rtBounces, options.rtSamples, options.rtPreset);
+            renderer.setRayTracingTraversalStats(options.traversalStats);
+            renderer.uploadRayTracingScene(scene);
+            return true;
+    }
+    return false;
+}
+
+void renderMode(Renderer& renderer, RenderMode mode, Scene* scene, Camera* camera)
+{
+    switch (mode) {
+        case RenderMode::ForwardRendering:  renderer.render_forward(scene, camera); break;
+        case RenderMode::DeferredRendering: renderer.render_deferred(scene, camera); break;
+        case RenderMode::Shadertoy:         renderer.render_shadertoy(); break;
+        case RenderMode::RayTracing:        renderer.render_raytracing(scene, camera); break;
+    }
+}
+
+/**
+ * Profiler frames of one mode, collected as they resolve because the
+ * profiler only keeps a short history
+ */
+class FrameCollector {
+public:
+    FrameCollector(uint64_t first, uint64_t last)
+        : last_(last)
+        , collected_(first)
+    {
+    }
+
+    void collect(const Profiler& profiler)
+    {
+        const std::deque<Profiler::FrameRecord>& frames = profiler.getFrames();
+        auto it = std::lower_bound(frames.begin(), frames.end(), collected_,
+                                   [](const Profiler::FrameRecord& frame, uint64_t index) { return frame.index < index; });
+        for (; it != frames.end() && it->index <= last_; ++it) {
+            cpu_.push_back(it->cpuMs);
+            if (it->gpuMs >= 0.0) {
+                gpu_.push_back(it->gpuMs);
+            }
+
+            // Scopes entered several times in a frame add up
+            std::map<std::string, std::pair<double, double>> totals;
+            for (const Profiler::Sample& sample : it->samples) {
+                auto& total = totals[sample.name];
+                total.first += sample.cpuMs;
+                total.second += sample.gpuMs >= 0.0 ? sample.gpuMs : 0.0;
+            }
+            for (const auto& [name, total] : totals) {
+                if (std::find(passOrder_.begin(), passOrder_.end(), name) == passOrder_.end()) {
+                    passOrder_.push_back(name);
+                }
+                passCpu_[name].push_back(total.first);
+                if (it->gpuMs >= 0.0) passGpu_[name].push_back(total.second);
+            }
+            collected_ = it->index + 1;
+        }
+    }
+
+    void fill(ModeResult& result) const
+    {
+        result.cpu = TimingStats::fromSamples(cpu_);
+        result.gpu = TimingStats::fromSamples(gpu_);
+        for (const std::string& name : passOrder_) {
+            PassResult pass;
+            pass.name = name;
+            pass.cpu = TimingStats::fromSamples(passCpu_.at(name));
+            auto gpu = passGpu_.find(name);
+            if (gpu != passGpu_.end()) {
+                pass.gpu = TimingStats::fromSamples(gpu->second);
+            }
+            result.passes.push_back(pass);
+        }
+    }
+
+private:
+    uint64_t last_;
+    uint64_t collected_;   // Next frame index to take
+    std::vector<double> cpu_;
+    std::vector<double> gpu_;
+    std::vector<std::string> passOrder_;  // First appearance
+    std::map<std::string, std::vector<double>> passCpu_;
+    std::map<std::string, std::vector<double>> passGpu_;
+};
+
+GLFWwindow* createWindow(const Options& options)
+{
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW\n";
+        return nullptr;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_VISIBLE, options.hidden ? GLFW_FALSE : GLFW_TRUE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "kcShaders_bench", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "Failed to create GLFW window\n";
+        glfwTerminate();
+        return nullptr;
+    }
+
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);  // Vsync off, frame times are not capped by the display
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD\n";
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return nullptr;
+    }
+
+    // Same state as the editor
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_CULL_FACE);
+    return window;
+}
+
+int runBenchmark(GLFWwindow* window, const Options& options)
+{
+    CameraPath path;
+    Scene* scene = loadScene(options, path);
+    if (!scene) {
+        return 2;
+    }
+    if (!options.cameraPath.empty() && !path.LoadFromFile(options.cameraPath)) {
+        delete scene;
+        return 2;
+    }
+
+    Renderer renderer(window, options.width, options.height);
+    if (!renderer.initialize()) {
+        std::cerr << "Failed to initialize renderer\n";
+        delete scene;
+        return 2;
+    }
+    renderer.resize_framebuffer(options.width, options.height);
+    Profiler* profiler = renderer.get_profiler();
+    if (!profiler || !profiler->isEnabled()) {
+        std::cerr << "[Bench] Profiler unavailable, only wall times are reported\n";
+    }
+
+    Camera camera(45.0f, static_cast<float>(options.width) / options.height, 0.1f, 100.0f);
+
+    // Covers every frame of every mode, warm-up included
+    if (!options.countersOut.empty()) {
+        PerfCounters::setPeriodicExport(options.countersOut, options.countersInterval);
+    }
+
+    BenchReport report;
+    report.scene = options.scene;
+    report.cameraPath = options.cameraPath.empty() ? "orbit" : options.cameraPath;
+    report.glRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    report.width = options.width;
+    report.height = options.height;
+    report.frames = options.frames;
+    report.warmupFrames = options.warmupFrames;
+    report.timestep = options.timestep;
+
+    std::cout << "[Bench] " << report.glRenderer << ", " << options.width << "x" << options.height
+              << ", " << options.frames << " frames per mode, path " << path.GetDuration() << "s\n";
+
+    uint64_t frameIndex = 0;  // Profiler frame index of the next begin_frame
+    for (const ModeInfo& info : kModes) {
+        if (!options.modes.empty() &&
+            std::find(options.modes.begin(), options.modes.end(), info.name) == options.modes.end()) {
+            continue;
+        }
+        if (glfwWindowShouldClose(window)) {
+            break;
+        }
+        if (!prepareMode(renderer, info.mode, scene, options)) {
+            std::cerr << "[Bench] Skipping " << info.name << ", shaders failed to load\n";
+            continue;
+        }
+
+        std::cout << "[Bench] Running " << info.name << "...\n";
+        FrameCollector collector(frameIndex + options.warmupFrames,
+                                 frameIndex + options.warmupFrames + options.frames - 1);
+        std::vector<double> wallTimes;
+        double lastStart = 0.0;
+
+        int totalFrames = options.warmupFrames + options.frames;
+        for (int i = 0; i < totalFrames; i++) {
+            // Fixed timestep: the camera is where the path says, however long frames take
+            int pathFrame = std::max(0, i - options.warmupFrames);
+            path.Apply(camera, static_cast<float>(pathFrame * options.timestep));
+
+            if (i == options.warmupFrames) {
+                PerfCounters::clearHistory();
+            }
+
+            double start = glfwGetTime();
+            if (i > options.warmupFrames) {
+                wallTimes.push_back((start - lastStart) * 1000.0);
+            }
+            lastStart = start;
+
+            renderer.begin_frame();
+            glfwPollEvents();
+            renderMode(renderer, info.mode, scene, &camera);
+
+            // Present the image like the editor's viewport would
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer.get_framebuffer());
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, renderer.get_fb_width(), renderer.get_fb_height(),
+                              0, 0, options.width, options.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glfwSwapBuffers(window);
+            renderer.end_frame();
+            frameIndex++;
+
+            if (profiler) {
+                collector.collect(*profiler);
+            }
+        }
+        double end = glfwGetTime();
+        wallTimes.push_back((end - lastStart) * 1000.0);
+
+        // Resolve the frames still in flight with one empty profiler frame
+        glFinish();
+        if (profiler && profiler->isEnabled()) {
+            profiler->beginFrame();
+            profiler->endFrame();
+            frameIndex++;
+            collector.collect(*profiler);
+        }
+
+        ModeResult result;
+        result.name = info.name;
+        result.frames = options.frames;
+        result.frame = TimingStats::fromSamples(wallTimes);
+        collector.fill(result);
+
+        PerfCounters::Snapshot counters = PerfCounters::aggregate(options.frames);
+        for (int c = 0; c < PerfCounters::kCount; c++) {
+            PerfCounter counter = static_cast<PerfCounter>(c);
+            result.counters.emplace_back(PerfCounters::name(counter), counters.perFrame(counter));
+        }
+        result.counters.emplace_back("rays_per_second", counters.raysPerSecond());
+
+        if (result.gpu.count < options.frames) {
+            std::cerr << "[Bench] " << info.name << ": GPU times for " << result.gpu.count << " of "
+                      << options.frames << " frames\n";
+        }
+        std::cout << "[Bench]   frame p50 " << result.frame.p50 << " ms, p99 " << result.frame.p99
+                  << " ms; gpu p50 " << result.gpu.p50 << " ms, p99 " << result.gpu.p99 << " ms\n";
+        report.modes.push_back(result);
+    }
+
+    renderer.shutdown();
+    delete scene;
+
+    if (report.modes.empty()) {
+        std::cerr << "[Bench] No mode was measured\n";
+        return 2;
+    }
+    if (!report.save(options.output)) {
+        return 2;
+    }
+
+    if (options.baseline.empty()) {
+        return 0;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!loadReportValues(options.baseline, baseline)) {
+        return 2;
+    }
+    std::cout << "[Bench] Comparing with " << options.baseline << "\n";
+    int regressions = compareWithBaseline(report.values(), baseline, options.threshold, options.minDeltaMs, std::cout);
+    return regressions > 0 ? 1 : 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    GLFWwindow* window = createWindow(options);
+    if (!window) {
+        return 2;
+    }
+
+    int result = runBenchmark(window, options);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return result;
+}
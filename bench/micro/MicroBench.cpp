@@ -0,0 +1,42 @@
+#include "MicroBench.h"
+
+#include <algorithm>
+
+namespace kcShaders {
+
+MicroResult runMicroBenchmark(const MicroBenchmark& benchmark, double minTimeMs, int repetitions)
+{
+    MicroResult result;
+    result.name = benchmark.name;
+
+    // Calibrate, the estimate aims a little past the minimum time
+    uint64_t iterations = 1;
+    const uint64_t maxIterations = uint64_t(1) << 30;
+    while (true) {
+        MicroState state(iterations);
+        benchmark.run(state);
+        double elapsed = state.elapsedMs();
+        if (elapsed >= minTimeMs || iterations >= maxIterations) {
+            break;
+        }
+        double scale = elapsed > 0.0 ? 1.2 * minTimeMs / elapsed : 10.0;
+        iterations = std::min(maxIterations, std::max(iterations * 2, static_cast<uint64_t>(iterations * scale)));
+    }
+
+    uint64_t items = 0;
+    result.iterations = iterations;
+    for (int r = 0; r < std::max(repetitions, 1); r++) {
+        MicroState state(iterations);
+        benchmark.run(state);
+        result.msPerIteration.push_back(state.elapsedMs() / iterations);
+        items = state.itemsPerIteration();
+    }
+
+    std::vector<double> sorted = result.msPerIteration;
+    std::sort(sorted.begin(), sorted.end());
+    double median = sorted[(sorted.size() - 1) / 2];
+    result.itemsPerSecond = median > 0.0 ? items / (median / 1000.0) : 0.0;
+    return result;
+}
+
+} // namespace kcShaders
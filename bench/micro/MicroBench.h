@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace kcShaders {
+
+/**
+ * MicroState: Iteration loop of one micro-benchmark run
+ *
+ * Only the loop is timed, setup before it is not:
+ *     while (state.keepRunning()) { ... }
+ */
+class MicroState {
+public:
+    explicit MicroState(uint64_t iterations)
+        : remaining_(iterations)
+        , iterations_(iterations)
+        , items_(0)
+        , started_(false)
+    {
+    }
+
+    bool keepRunning()
+    {
+        if (!started_) {
+            started_ = true;
+            start_ = std::chrono::steady_clock::now();
+        }
+        if (remaining_ == 0) {
+            stop_ = std::chrono::steady_clock::now();
+            return false;
+        }
+        remaining_--;
+        return true;
+    }
+
+    /** Work items (triangles, nodes, ...) handled per iteration, for items/s */
+    void setItemsPerIteration(uint64_t items) { items_ = items; }
+
+    uint64_t iterations() const { return iterations_; }
+    uint64_t itemsPerIteration() const { return items_; }
+    double elapsedMs() const { return std::chrono::duration<double, std::milli>(stop_ - start_).count(); }
+
+private:
+    uint64_t remaining_;
+    uint64_t iterations_;
+    uint64_t items_;
+    bool started_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point stop_;
+};
+
+/** Keep the compiler from discarding a result that is otherwise unused */
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+struct MicroBenchmark {
+    std::string name;                         // "group/variant"
+    std::function<void(MicroState&)> run;
+};
+
+struct MicroResult {
+    std::string name;
+    uint64_t iterations = 0;                  // Per repetition
+    std::vector<double> msPerIteration;       // One value per repetition
+    double itemsPerSecond = 0.0;              // At the median
+};
+
+/**
+ * Run a benchmark: the iteration count is doubled until one repetition takes
+ * at least `minTimeMs`, then `repetitions` runs of that count are timed
+ */
+MicroResult runMicroBenchmark(const MicroBenchmark& benchmark, double minTimeMs, int repetitions);
+
+} // namespace kcShaders
@@ -0,0 +1,40 @@
+#include "NullGL.h"
+
+#include <glad/glad.h>
+
+namespace kcShaders {
+
+namespace {
+
+GLuint nextName = 1;
+
+void APIENTRY genNames(GLsizei n, GLuint* names)
+{
+    for (GLsizei i = 0; i < n; i++) {
+        names[i] = nextName++;
+    }
+}
+
+void APIENTRY deleteNames(GLsizei, const GLuint*) {}
+void APIENTRY bindVertexArray(GLuint) {}
+void APIENTRY bindBuffer(GLenum, GLuint) {}
+void APIENTRY bufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+void APIENTRY enableVertexAttribArray(GLuint) {}
+void APIENTRY vertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+
+} // namespace
+
+void installNullGL()
+{
+    glad_glGenVertexArrays = genNames;
+    glad_glGenBuffers = genNames;
+    glad_glDeleteVertexArrays = deleteNames;
+    glad_glDeleteBuffers = deleteNames;
+    glad_glBindVertexArray = bindVertexArray;
+    glad_glBindBuffer = bindBuffer;
+    glad_glBufferData = bufferData;
+    glad_glEnableVertexAttribArray = enableVertexAttribArray;
+    glad_glVertexAttribPointer = vertexAttribPointer;
+}
+
+} // namespace kcShaders
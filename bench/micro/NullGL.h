@@ -0,0 +1,12 @@
+#pragma once
+
+namespace kcShaders {
+
+/**
+ * Point the GL entry points used by Mesh upload and release at no-ops, so
+ * scene code that uploads meshes on first use can run without a context.
+ * Generated names count up from 1. Only for CPU-side benchmarks.
+ */
+void installNullGL();
+
+} // namespace kcShaders
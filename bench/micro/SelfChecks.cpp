@@ -0,0 +1,370 @@
+#include "SelfChecks.h"
+#include "graphics/DenoiseFilter.h"
+#include "graphics/LightSampler.h"
+#include "graphics/SamplerTables.h"
+#include "scene/light.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+namespace kcShaders {
+
+namespace {
+
+float luminance(const glm::vec3& color)
+{
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// Probability that sampleLight() in light_sampling.glsl picks each entry:
+// slot j is chosen with 1/n, then keeps j with its probability or takes its alias
+std::vector<double> aliasSelectionProbabilities(const std::vector<GpuAliasEntry>& table)
+{
+    std::vector<double> probabilities(table.size(), 0.0);
+    double slot = 1.0 / table.size();
+    for (size_t j = 0; j < table.size(); j++) {
+        double keep = std::min(std::max(static_cast<double>(table[j].probability), 0.0), 1.0);
+        probabilities[j] += slot * keep;
+        probabilities[table[j].alias] += slot * (1.0 - keep);
+    }
+    return probabilities;
+}
+
+bool checkAliasTable(const std::vector<GpuAliasEntry>& table, const std::vector<double>& weights, std::ostream& log)
+{
+    if (table.size() != weights.size()) {
+        log << "table has " << table.size() << " entries, expected " << weights.size() << "\n";
+        return false;
+    }
+
+    double total = 0.0;
+    for (double weight : weights) {
+        total += weight;
+    }
+
+    bool ok = true;
+    std::vector<double> probabilities = aliasSelectionProbabilities(table);
+    for (size_t i = 0; i < table.size(); i++) {
+        double share = weights[i] / total;
+        double tolerance = 1e-6 + 1e-5 * share;
+        if (table[i].alias >= table.size()) {
+            log << "entry " << i << ": alias " << table[i].alias << " out of range\n";
+            ok = false;
+        }
+        if (std::abs(probabilities[i] - share) > tolerance) {
+            log << "entry " << i << ": sampled with " << probabilities[i] << ", power share " << share << "\n";
+            ok = false;
+        }
+        if (std::abs(table[i].pdf - share) > tolerance) {
+            log << "entry " << i << ": pdf " << table[i].pdf << ", power share " << share << "\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// One light of each type plus emissive triangles; the ambient light and the
+// disabled and black lights must be left out
+bool checkSceneLights(std::ostream& log)
+{
+    std::vector<std::unique_ptr<Light>> owned;
+    auto add = [&](Light* light, const glm::vec3& color, float intensity) {
+        light->color = color;
+        light->intensity = intensity;
+        owned.emplace_back(light);
+    };
+    add(new DirectionalLight(), glm::vec3(1.0f, 0.95f, 0.8f), 3.0f);
+    add(new PointLight(), glm::vec3(1.0f, 0.0f, 0.0f), 5.0f);
+    add(new SpotLight(), glm::vec3(0.2f, 0.4f, 1.0f), 20.0f);
+    add(new AreaLight(), glm::vec3(1.0f), 0.25f);
+    add(new AmbientLight(), glm::vec3(1.0f), 1.0f);
+    add(new PointLight(), glm::vec3(0.0f), 8.0f);
+    add(new PointLight(), glm::vec3(1.0f), 100.0f);
+    owned.back()->enabled = false;
+
+    std::vector<Light*> lights;
+    for (const std::unique_ptr<Light>& light : owned) {
+        lights.push_back(light.get());
+    }
+
+    // Two emissive triangles of area 0.5 and 2, one unlit triangle
+    std::vector<GpuVertex> vertices(6, GpuVertex{});
+    vertices[1].position = glm::vec3(1.0f, 0.0f, 0.0f);
+    vertices[2].position = glm::vec3(0.0f, 1.0f, 0.0f);
+    vertices[3].position = glm::vec3(0.0f, 0.0f, 1.0f);
+    vertices[4].position = glm::vec3(2.0f, 0.0f, 1.0f);
+    vertices[5].position = glm::vec3(0.0f, 2.0f, 1.0f);
+
+    std::vector<GpuMaterial> materials(3, GpuMaterial{});
+    materials[1].emissive = glm::vec3(1.0f, 0.5f, 0.25f);
+    materials[1].emissiveStrength = 4.0f;
+    materials[2].emissive = glm::vec3(0.1f);
+    materials[2].emissiveStrength = 50.0f;
+
+    std::vector<GpuTriangle> triangles = {
+        {0, 1, 2, 0},
+        {0, 1, 2, 1},
+        {3, 4, 5, 2},
+    };
+
+    std::vector<double> expected = {
+        luminance(glm::vec3(1.0f, 0.95f, 0.8f) * 3.0f),
+        luminance(glm::vec3(1.0f, 0.0f, 0.0f) * 5.0f),
+        luminance(glm::vec3(0.2f, 0.4f, 1.0f) * 20.0f),
+        luminance(glm::vec3(1.0f) * 0.25f),
+        luminance(glm::vec3(1.0f, 0.5f, 0.25f) * 4.0f) * 0.5,
+        luminance(glm::vec3(0.1f) * 50.0f) * 2.0,
+    };
+
+    LightSampler sampler;
+    sampler.build(lights, vertices, triangles, materials);
+
+    const std::vector<GpuLight>& built = sampler.getLights();
+    if (built.size() != expected.size()) {
+        log << built.size() << " lights collected, expected " << expected.size() << "\n";
+        return false;
+    }
+    if (built[4].type != GpuLightTriangle || built[4].index != 1 || built[5].index != 2) {
+        log << "emissive triangles not collected in order\n";
+        return false;
+    }
+
+    double total = 0.0;
+    for (double weight : expected) {
+        total += weight;
+    }
+    if (std::abs(sampler.getTotalWeight() - total) > 1e-5 * total) {
+        log << "total weight " << sampler.getTotalWeight() << ", expected " << total << "\n";
+        return false;
+    }
+    return checkAliasTable(sampler.getAliasTable(), expected, log);
+}
+
+uint32_t sobolPoint(const std::vector<uint32_t>& matrices, uint32_t index, int dimension)
+{
+    uint32_t result = 0;
+    for (int bit = 0; index != 0; index >>= 1, bit++) {
+        if (index & 1u) {
+            result ^= matrices[dimension * 32 + bit];
+        }
+    }
+    return result;
+}
+
+bool checkSobolDirections(std::ostream& log)
+{
+    std::vector<uint32_t> matrices = SamplerTables::sobolMatrices();
+    if (matrices.size() != SamplerTables::kSobolDimensions * 32) {
+        log << matrices.size() << " direction numbers, expected " << SamplerTables::kSobolDimensions * 32 << "\n";
+        return false;
+    }
+
+    // Dimension 0 is van der Corput; dimension 1 (x + 1, m = 1) is Pascal's triangle mod 2
+    const uint32_t dimension1[8] = {
+        0x80000000u, 0xC0000000u, 0xA0000000u, 0xF0000000u,
+        0x88000000u, 0xCC000000u, 0xAA000000u, 0xFF000000u,
+    };
+
+    bool ok = true;
+    for (int bit = 0; bit < 32; bit++) {
+        if (matrices[bit] != 1u << (31 - bit)) {
+            log << "dimension 0, bit " << bit << ": " << std::hex << matrices[bit] << std::dec << "\n";
+            ok = false;
+        }
+    }
+    for (int bit = 0; bit < 8; bit++) {
+        if (matrices[32 + bit] != dimension1[bit]) {
+            log << "dimension 1, bit " << bit << ": " << std::hex << matrices[32 + bit]
+                << ", expected " << dimension1[bit] << std::dec << "\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// (0,2)-sequence: every aligned block of 2^m points puts exactly one point in
+// each elementary interval of area 2^-m, for all 2^-k x 2^-(m-k) shapes. Owen
+// scrambling in sampler.glsl keeps this property, the tables must provide it.
+bool checkSobolStratification(std::ostream& log)
+{
+    std::vector<uint32_t> matrices = SamplerTables::sobolMatrices();
+    bool ok = true;
+    for (int m = 1; m <= 12; m++) {
+        uint32_t count = 1u << m;
+        for (uint32_t block : {0u, 1u, 37u}) {
+            for (int k = 0; k <= m; k++) {
+                std::vector<uint8_t> hits(count, 0);
+                for (uint32_t i = 0; i < count; i++) {
+                    uint32_t index = block * count + i;
+                    uint32_t x = k > 0 ? sobolPoint(matrices, index, 0) >> (32 - k) : 0u;
+                    uint32_t y = k < m ? sobolPoint(matrices, index, 1) >> (32 - (m - k)) : 0u;
+                    hits[(x << (m - k)) | y]++;
+                }
+                if (std::any_of(hits.begin(), hits.end(), [](uint8_t h) { return h != 1; })) {
+                    log << "points " << block * count << ".." << (block + 1) * count - 1 << ": not stratified in "
+                        << (1u << k) << " x " << (1u << (m - k)) << " intervals\n";
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+// Flat frame facing the camera at hit distance 5, white albedo so the filter
+// sees the radiance unchanged
+DenoiseFilter::Frame makeDenoiseFrame(int width, int height)
+{
+    size_t count = static_cast<size_t>(width) * height;
+    DenoiseFilter::Frame frame;
+    frame.width = width;
+    frame.height = height;
+    frame.color.assign(count, glm::vec3(1.0f));
+    frame.normalDepth.assign(count, glm::vec4(0.0f, 0.0f, 1.0f, 5.0f));
+    frame.albedo.assign(count, glm::vec3(1.0f));
+    frame.variance.assign(count, 0.0f);
+    return frame;
+}
+
+// Uniform noise in [0.5, 1.5] on one plane must be smoothed out without
+// shifting the mean
+bool checkDenoiseFlatRegion(std::ostream& log)
+{
+    const int width = 32;
+    const int height = 32;
+    DenoiseFilter::Frame frame = makeDenoiseFrame(width, height);
+    uint32_t state = 1u;
+    for (size_t i = 0; i < frame.color.size(); i++) {
+        state = state * 1664525u + 1013904223u;
+        frame.color[i] = glm::vec3(0.5f + (state >> 8) / 16777216.0f);
+        frame.variance[i] = 1.0f / 12.0f;
+    }
+
+    std::vector<glm::vec3> result = DenoiseFilter::filter(frame, DenoiseSettings{});
+
+    auto meanDeviation = [](const std::vector<glm::vec3>& image, double& mean) {
+        mean = 0.0;
+        for (const glm::vec3& color : image) {
+            mean += color.x;
+        }
+        mean /= image.size();
+        double squares = 0.0;
+        for (const glm::vec3& color : image) {
+            squares += (color.x - mean) * (color.x - mean);
+        }
+        return std::sqrt(squares / image.size());
+    };
+    double inputMean = 0.0;
+    double outputMean = 0.0;
+    double inputDeviation = meanDeviation(frame.color, inputMean);
+    double outputDeviation = meanDeviation(result, outputMean);
+
+    bool ok = true;
+    if (std::abs(outputMean - inputMean) > 0.02 * inputMean) {
+        log << "mean " << outputMean << " after filtering, " << inputMean << " before\n";
+        ok = false;
+    }
+    if (outputDeviation > 0.25 * inputDeviation) {
+        log << "standard deviation " << outputDeviation << " after filtering, " << inputDeviation << " before\n";
+        ok = false;
+    }
+    return ok;
+}
+
+// Two flat halves of radiance 0.25 and 4, `split` moves the right half to
+// another normal or hit distance. Every pixel must keep its own half's value.
+// The variance is high enough that the luminance stop alone would let the
+// halves mix, `withoutStop` turns the edge stop under test off to show it.
+bool checkDenoiseEdge(const char* stop, const std::function<void(glm::vec4&)>& split,
+                      const DenoiseSettings& withoutStop, std::ostream& log)
+{
+    const int width = 32;
+    const int height = 16;
+    const float left = 0.25f;
+    const float right = 4.0f;
+    DenoiseFilter::Frame frame = makeDenoiseFrame(width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = width / 2; x < width; x++) {
+            frame.color[y * width + x] = glm::vec3(right);
+            split(frame.normalDepth[y * width + x]);
+        }
+        for (int x = 0; x < width / 2; x++) {
+            frame.color[y * width + x] = glm::vec3(left);
+        }
+    }
+    frame.variance.assign(frame.variance.size(), 4.0f);
+
+    std::vector<glm::vec3> result = DenoiseFilter::filter(frame, DenoiseSettings{});
+
+    bool ok = true;
+    float worst = 0.0f;
+    int worstPixel = 0;
+    for (int i = 0; i < width * height; i++) {
+        float expected = i % width < width / 2 ? left : right;
+        float error = std::abs(result[i].x - expected) / expected;
+        if (error > worst) {
+            worst = error;
+            worstPixel = i;
+        }
+    }
+    if (worst > 0.01f) {
+        log << "pixel (" << worstPixel % width << ", " << worstPixel / width << ") filtered to "
+            << result[worstPixel].x << " across the " << stop << " edge\n";
+        ok = false;
+    }
+
+    int edgePixel = height / 2 * width + width / 2 - 1;
+    std::vector<glm::vec3> control = DenoiseFilter::filter(frame, withoutStop);
+    if (control[edgePixel].x < 1.1f * left) {
+        log << "halves do not mix without the " << stop << " stop, the frame does not test it\n";
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+std::vector<SelfCheck> createSelfChecks()
+{
+    std::vector<SelfCheck> checks;
+
+    checks.push_back({"light_sampler/scene_lights", checkSceneLights});
+
+    // Skewed powers over six orders of magnitude, zero weights must never be picked
+    checks.push_back({"light_sampler/skewed_weights", [](std::ostream& log) {
+        std::vector<float> weights = {1000.0f, 0.001f, 1.0f, 0.0f, 3.0f, 250.0f, 0.5f, 0.0f, 1.0f, 42.0f, 7.0f};
+        std::vector<double> expected(weights.begin(), weights.end());
+        return checkAliasTable(LightSampler::buildAliasTable(weights), expected, log);
+    }});
+
+    checks.push_back({"light_sampler/uniform_weights", [](std::ostream& log) {
+        std::vector<float> weights(37, 2.5f);
+        std::vector<double> expected(weights.begin(), weights.end());
+        return checkAliasTable(LightSampler::buildAliasTable(weights), expected, log);
+    }});
+
+    checks.push_back({"sobol/direction_numbers", checkSobolDirections});
+    checks.push_back({"sobol/stratification", checkSobolStratification});
+
+    checks.push_back({"denoise/flat_region", checkDenoiseFlatRegion});
+
+    checks.push_back({"denoise/depth_edge", [](std::ostream& log) {
+        DenoiseSettings withoutStop;
+        withoutStop.sigmaDepth = 1e6f;
+        return checkDenoiseEdge("depth", [](glm::vec4& normalDepth) { normalDepth.w = 50.0f; }, withoutStop, log);
+    }});
+
+    checks.push_back({"denoise/normal_edge", [](std::ostream& log) {
+        DenoiseSettings withoutStop;
+        withoutStop.sigmaNormal = 0.0f;
+        return checkDenoiseEdge("normal", [](glm::vec4& normalDepth) {
+            normalDepth = glm::vec4(1.0f, 0.0f, 0.0f, normalDepth.w);
+        }, withoutStop, log);
+    }});
+
+    return checks;
+}
+
+} // namespace kcShaders
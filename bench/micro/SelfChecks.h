@@ -0,0 +1,22 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace kcShaders {
+
+/**
+ * SelfCheck: Correctness check of CPU-built renderer data or of a CPU copy of
+ * a GPU kernel, run with kcShaders_microbench --check. Returns false and
+ * describes the mismatch on `log` when the result is wrong.
+ */
+struct SelfCheck {
+    std::string name;                          // "group/variant"
+    std::function<bool(std::ostream& log)> run;
+};
+
+std::vector<SelfCheck> createSelfChecks();
+
+} // namespace kcShaders
@@ -0,0 +1,392 @@
+// kcShaders_microbench: CPU hot paths on synthetic scenes, runs without a GPU.
+
+#include "MicroBench.h"
+#include "NullGL.h"
+#include "SelfChecks.h"
+#include "BenchReport.h"
+#include "graphics/BVH.h"
+#include "graphics/pipeline/RayTracingPipeline.h"
+#include "scene/scene.h"
+#include "scene/mesh.h"
+#include "scene/material.h"
+#include "scene/geometry.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace kcShaders;
+
+namespace {
+
+struct Options {
+    std::string filter;        // Substring of the benchmark name
+    std::string output;
+    std::string baseline;
+    double minTimeMs = 100.0;
+    int repetitions = 5;
+    double threshold = 0.10;
+    bool list = false;
+    bool check = false;
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: kcShaders_microbench [options]\n"
+        "  --filter TEXT         Run benchmarks whose name contains TEXT\n"
+        "  --list                List the benchmarks and exit\n"
+        "  --check               Run the correctness checks (with --filter) instead, exit code 1 on failure\n"
+        "  --min-time MS         Minimum time per repetition (default 100)\n"
+        "  --repetitions N       Timed repetitions per benchmark (default 5)\n"
+        "  --out FILE            Write the results as JSON\n"
+        "  --baseline FILE       Compare medians with a previous --out file, exit code 1 on regression\n"
+        "  --threshold FRACTION  Relative slowdown flagged as regression (default 0.10)\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            std::exit(0);
+        }
+        if (arg == "--list") {
+            options.list = true;
+            continue;
+        }
+        if (arg == "--check") {
+            options.check = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "[MicroBench] Missing value for " << arg << "\n";
+            return false;
+        }
+
+        const char* v = argv[++i];
+        if (arg == "--filter") options.filter = v;
+        else if (arg == "--min-time") options.minTimeMs = std::atof(v);
+        else if (arg == "--repetitions") options.repetitions = std::max(1, std::atoi(v));
+        else if (arg == "--out") options.output = v;
+        else if (arg == "--baseline") options.baseline = v;
+        else if (arg == "--threshold") options.threshold = std::atof(v);
+        else {
+            std::cerr << "[MicroBench] Unknown option: " << arg << "\n";
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+// `count` spheres of 2 * lat * lon triangles on a grid above a two-triangle ground plane
+std::unique_ptr<Scene> createSphereField(int count, int lat, int lon)
+{
+    auto scene = std::make_unique<Scene>();
+
+    SceneNode* ground = scene->createRoot();
+    ground->mesh = create_plane(40.0f, 40.0f, 1, 1);
+    ground->transform.position = glm::vec3(0.0f, 0.0f, -1.0f);
+    ground->material = Material::CreatePlastic(glm::vec3(0.6f));
+
+    int side = 1;
+    while (side * side < count) side++;
+    for (int i = 0; i < count; i++) {
+        SceneNode* node = scene->createRoot();
+        node->mesh = create_sphere(1.0f, lat, lon);
+        node->transform.position = glm::vec3((i % side) * 2.5f, (i / side) * 2.5f, 0.0f);
+        node->material = i % 2 ? Material::CreatePlastic(glm::vec3(0.8f, 0.2f, 0.2f))
+                               : Material::CreateMetal(glm::vec3(0.9f, 0.8f, 0.5f));
+    }
+    return scene;
+}
+
+// Flattened sphere field, the input of the BVH build
+struct FlatScene {
+    std::unique_ptr<Scene> scene;
+    std::vector<RenderItem> items;
+    std::vector<GpuVertex> vertices;
+    std::vector<GpuTriangle> triangles;
+    std::vector<GpuMaterial> materials;
+};
+
+std::shared_ptr<FlatScene> flattenSphereField(int count, int lat, int lon)
+{
+    auto flat = std::make_shared<FlatScene>();
+    flat->scene = createSphereField(count, lat, lon);
+    flat->scene->collectRenderItems(flat->items);
+    RayTracingPipeline::flattenRenderItems(flat->items, flat->vertices, flat->triangles, flat->materials);
+    return flat;
+}
+
+// One root with `width` children
+std::unique_ptr<Scene> createWideScene(int width)
+{
+    auto scene = std::make_unique<Scene>();
+    SceneNode* root = scene->createRoot();
+    for (int i = 0; i < width; i++) {
+        SceneNode* child = root->createChild();
+        child->mesh = create_cube(0.5f);
+        child->transform.position = glm::vec3(static_cast<float>(i % 64), static_cast<float>(i / 64), 0.0f);
+    }
+    return scene;
+}
+
+// A chain of `depth` nodes, each offset from its parent
+std::unique_ptr<Scene> createDeepScene(int depth)
+{
+    auto scene = std::make_unique<Scene>();
+    SceneNode* node = scene->createRoot();
+    for (int i = 0; i < depth; i++) {
+        node->mesh = create_cube(0.5f);
+        node->transform.position = glm::vec3(0.1f, 0.0f, 0.0f);
+        node->transform.rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.05f));
+        if (i + 1 < depth) {
+            node = node->createChild();
+        }
+    }
+    return scene;
+}
+
+// USD layout of an n x n quad grid, plus polygon corner counts 3..6 for the mixed case
+struct PolygonMesh {
+    std::vector<int> faceVertexCounts;
+    std::vector<int> faceVertexIndices;
+};
+
+PolygonMesh createQuadGrid(int n)
+{
+    PolygonMesh mesh;
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            int v = y * (n + 1) + x;
+            mesh.faceVertexCounts.push_back(4);
+            mesh.faceVertexIndices.insert(mesh.faceVertexIndices.end(), {v, v + 1, v + n + 2, v + n + 1});
+        }
+    }
+    return mesh;
+}
+
+PolygonMesh createMixedPolygons(int faces)
+{
+    PolygonMesh mesh;
+    int corner = 0;
+    for (int f = 0; f < faces; f++) {
+        int count = 3 + f % 4;
+        mesh.faceVertexCounts.push_back(count);
+        for (int i = 0; i < count; i++) {
+            mesh.faceVertexIndices.push_back(corner++);
+        }
+    }
+    return mesh;
+}
+
+std::vector<MicroBenchmark> createBenchmarks()
+{
+    std::vector<MicroBenchmark> benchmarks;
+
+    struct FieldSize { const char* label; int count, lat, lon; };
+    const FieldSize fields[] = {
+        { "1k",   1, 16,  32 },   //   1024 triangles
+        { "16k",  4, 32,  64 },   //  16384
+        { "131k", 8, 64, 128 },   // 131072
+    };
+    for (const FieldSize& size : fields) {
+        benchmarks.push_back({std::string("bvh_build/") + size.label, [size](MicroState& state) {
+            std::shared_ptr<FlatScene> flat = flattenSphereField(size.count, size.lat, size.lon);
+            state.setItemsPerIteration(flat->triangles.size());
+            while (state.keepRunning()) {
+                BVHBuilder builder;
+                builder.build(flat->vertices, flat->triangles);
+                doNotOptimize(builder.getNodes());
+            }
+        }});
+    }
+
+    benchmarks.push_back({"rt_flatten/131k", [](MicroState& state) {
+        std::shared_ptr<FlatScene> flat = flattenSphereField(8, 64, 128);
+        state.setItemsPerIteration(flat->triangles.size());
+        while (state.keepRunning()) {
+            std::vector<GpuVertex> vertices;
+            std::vector<GpuTriangle> triangles;
+            std::vector<GpuMaterial> materials;
+            RayTracingPipeline::flattenRenderItems(flat->items, vertices, triangles, materials);
+            doNotOptimize(triangles);
+        }
+    }});
+
+    benchmarks.push_back({"compute_tangents/sphere_64x128", [](MicroState& state) {
+        std::unique_ptr<Mesh> mesh(create_sphere(1.0f, 64, 128));
+        state.setItemsPerIteration(mesh->GetIndexCount() / 3);
+        while (state.keepRunning()) {
+            mesh->computeTangents();
+            doNotOptimize(mesh->GetVertex(0));
+        }
+    }});
+
+    benchmarks.push_back({"compute_normals/sphere_64x128", [](MicroState& state) {
+        std::unique_ptr<Mesh> mesh(create_sphere(1.0f, 64, 128));
+        std::vector<Vertex> vertices = mesh->GetVertices();
+        const std::vector<uint32_t>& indices = mesh->GetIndices();
+        state.setItemsPerIteration(indices.size() / 3);
+        while (state.keepRunning()) {
+            compute_normals(vertices, indices);
+            doNotOptimize(vertices);
+        }
+    }});
+
+    benchmarks.push_back({"collect_render_items/wide_4096", [](MicroState& state) {
+        std::unique_ptr<Scene> scene = createWideScene(4096);
+        state.setItemsPerIteration(4096);
+        while (state.keepRunning()) {
+            std::vector<RenderItem> items;
+            scene->collectRenderItems(items);
+            doNotOptimize(items);
+        }
+    }});
+
+    benchmarks.push_back({"collect_render_items/deep_256", [](MicroState& state) {
+        std::unique_ptr<Scene> scene = createDeepScene(256);
+        state.setItemsPerIteration(256);
+        while (state.keepRunning()) {
+            std::vector<RenderItem> items;
+            scene->collectRenderItems(items);
+            doNotOptimize(items);
+        }
+    }});
+
+    benchmarks.push_back({"triangulate/quads_256x256", [](MicroState& state) {
+        PolygonMesh mesh = createQuadGrid(256);
+        state.setItemsPerIteration(mesh.faceVertexCounts.size());
+        while (state.keepRunning()) {
+            std::vector<uint32_t> indices;
+            triangulate_polygons(mesh.faceVertexCounts.data(), mesh.faceVertexCounts.size(),
+                                 mesh.faceVertexIndices.data(), mesh.faceVertexIndices.size(), indices);
+            doNotOptimize(indices);
+        }
+    }});
+
+    benchmarks.push_back({"triangulate/mixed_face_varying_65536", [](MicroState& state) {
+        PolygonMesh mesh = createMixedPolygons(65536);
+        state.setItemsPerIteration(mesh.faceVertexCounts.size());
+        while (state.keepRunning()) {
+            std::vector<uint32_t> indices;
+            triangulate_polygons(mesh.faceVertexCounts.data(), mesh.faceVertexCounts.size(),
+                                 nullptr, mesh.faceVertexIndices.size(), indices);
+            doNotOptimize(indices);
+        }
+    }});
+
+    return benchmarks;
+}
+
+int runSelfChecks(const std::string& filter)
+{
+    int failures = 0;
+    for (const SelfCheck& check : createSelfChecks()) {
+        if (!filter.empty() && check.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        std::ostringstream log;
+        bool ok = check.run(log);
+        std::cout << (ok ? "[  OK  ] " : "[ FAIL ] ") << check.name << "\n" << log.str();
+        failures += ok ? 0 : 1;
+    }
+    std::cout << "[MicroBench] " << failures << " check(s) failed\n";
+    return failures;
+}
+
+bool writeResults(const std::string& path, const std::vector<MicroResult>& results)
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "[MicroBench] Failed to write " << path << "\n";
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(1);
+    file << "{\n  \"version\": 1,\n  \"benchmarks\": {";
+    for (size_t i = 0; i < results.size(); i++) {
+        const MicroResult& result = results[i];
+        file << (i == 0 ? "\n" : ",\n");
+        file << "    \"" << result.name << "\": {\"iterations\": " << result.iterations
+             << ", \"cpu_ms\": " << TimingStats::fromSamples(result.msPerIteration).toJson()
+             << ", \"items_per_second\": " << result.itemsPerSecond << "}";
+    }
+    file << (results.empty() ? "}\n" : "\n  }\n") << "}\n";
+
+    std::cout << "[MicroBench] Wrote " << path << "\n";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    // Scene::collectRenderItems uploads meshes on first use
+    installNullGL();
+
+    if (options.check) {
+        return runSelfChecks(options.filter) > 0 ? 1 : 0;
+    }
+
+    std::vector<MicroBenchmark> benchmarks = createBenchmarks();
+    if (options.list) {
+        for (const MicroBenchmark& benchmark : benchmarks) {
+            std::cout << benchmark.name << "\n";
+        }
+        return 0;
+    }
+
+    std::cout << std::left << std::setw(40) << "benchmark" << std::right << std::setw(12) << "iterations"
+              << std::setw(14) << "median us" << std::setw(14) << "min us" << std::setw(14) << "max us"
+              << std::setw(16) << "items/s" << "\n";
+
+    std::vector<MicroResult> results;
+    std::map<std::string, double> values;
+    for (const MicroBenchmark& benchmark : benchmarks) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        MicroResult result = runMicroBenchmark(benchmark, options.minTimeMs, options.repetitions);
+        TimingStats stats = TimingStats::fromSamples(result.msPerIteration);
+        std::cout << std::left << std::setw(40) << result.name << std::right << std::setw(12) << result.iterations
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(14) << stats.p50 * 1000.0 << std::setw(14) << stats.min * 1000.0
+                  << std::setw(14) << stats.max * 1000.0
+                  << std::setprecision(0) << std::setw(16) << result.itemsPerSecond << "\n";
+
+        values["benchmarks." + result.name + ".cpu_ms.p50"] = stats.p50;
+        results.push_back(std::move(result));
+    }
+
+    if (!options.output.empty() && !writeResults(options.output, results)) {
+        return 2;
+    }
+    if (options.baseline.empty()) {
+        return 0;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!loadReportValues(options.baseline, baseline)) {
+        return 2;
+    }
+    std::cout << "[MicroBench] Comparing with " << options.baseline << "\n";
+    int regressions = compareWithBaseline(values, baseline, options.threshold, 0.0, std::cout);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+#include "DenoiseFilter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace kcShaders {
+
+namespace {
+
+// Must match denoise_common.glsl and atrous.comp
+constexpr float kAlbedoEpsilon = 0.01f;
+const float kKernel[3] = {1.0f, 2.0f / 3.0f, 1.0f / 6.0f};
+const float kGaussian[2] = {0.5f, 0.25f};
+
+} // namespace
+
+float DenoiseFilter::luminance(const glm::vec3& color)
+{
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+glm::vec3 DenoiseFilter::demodulate(const glm::vec3& color, const glm::vec3& albedo)
+{
+    return color / glm::max(albedo, glm::vec3(kAlbedoEpsilon));
+}
+
+glm::vec3 DenoiseFilter::remodulate(const glm::vec3& illumination, const glm::vec3& albedo)
+{
+    return illumination * glm::max(albedo, glm::vec3(kAlbedoEpsilon));
+}
+
+std::vector<glm::vec3> DenoiseFilter::filter(const Frame& frame, const DenoiseSettings& settings)
+{
+    size_t count = static_cast<size_t>(frame.width) * frame.height;
+    std::vector<glm::vec4> current(count);
+    std::vector<glm::vec4> next(count);
+
+    // Sky pixels are neither demodulated nor filtered
+    for (size_t i = 0; i < count; i++) {
+        bool sky = frame.normalDepth[i].w <= 0.0f;
+        glm::vec3 illumination = sky ? frame.color[i] : demodulate(frame.color[i], frame.albedo[i]);
+        float scale = 1.0f;
+        if (!sky) {
+            float radianceLum = luminance(frame.color[i]);
+            scale = radianceLum > 0.0f ? luminance(illumination) / radianceLum : 1.0f;
+        }
+        current[i] = glm::vec4(illumination, sky ? 0.0f : frame.variance[i] * scale * scale);
+    }
+
+    for (int i = 0; i < std::max(settings.iterations, 1); i++) {
+        atrousIteration(frame, current, 1 << i, settings, next);
+        current.swap(next);
+    }
+
+    std::vector<glm::vec3> result(count);
+    for (size_t i = 0; i < count; i++) {
+        bool sky = frame.normalDepth[i].w <= 0.0f;
+        glm::vec3 illumination(current[i]);
+        result[i] = sky ? illumination : remodulate(illumination, frame.albedo[i]);
+    }
+    return result;
+}
+
+void DenoiseFilter::atrousIteration(const Frame& frame, const std::vector<glm::vec4>& input,
+                                    int stepSize, const DenoiseSettings& settings,
+                                    std::vector<glm::vec4>& output)
+{
+    const int width = frame.width;
+    const int height = frame.height;
+    output.resize(input.size());
+
+    for (int py = 0; py < height; py++) {
+        for (int px = 0; px < width; px++) {
+            int p = py * width + px;
+            const glm::vec4& center = input[p];
+            const glm::vec4& normalDepth = frame.normalDepth[p];
+
+            if (normalDepth.w <= 0.0f) {
+                output[p] = center;
+                continue;
+            }
+
+            // 3x3 Gaussian of the variance for the luminance edge stop
+            float variance = 0.0f;
+            for (int y = -1; y <= 1; y++) {
+                for (int x = -1; x <= 1; x++) {
+                    int qx = std::clamp(px + x, 0, width - 1);
+                    int qy = std::clamp(py + y, 0, height - 1);
+                    variance += kGaussian[std::abs(x)] * kGaussian[std::abs(y)] * input[qy * width + qx].w;
+                }
+            }
+
+            float centerLum = luminance(glm::vec3(center));
+            float lumScale = settings.sigmaLuminance * std::sqrt(std::max(variance, 0.0f)) + 1e-10f;
+
+            glm::vec3 colorSum(center);
+            float varianceSum = center.w;
+            float weightSum = 1.0f;
+
+            for (int y = -2; y <= 2; y++) {
+                for (int x = -2; x <= 2; x++) {
+                    if (x == 0 && y == 0) continue;
+
+                    int qx = px + x * stepSize;
+                    int qy = py + y * stepSize;
+                    if (qx < 0 || qy < 0 || qx >= width || qy >= height) continue;
+
+                    int q = qy * width + qx;
+                    const glm::vec4& sampleNormalDepth = frame.normalDepth[q];
+                    if (sampleNormalDepth.w <= 0.0f) continue;
+                    const glm::vec4& value = input[q];
+
+                    float distanceScale = settings.sigmaDepth * 0.02f * normalDepth.w * stepSize *
+                                          std::sqrt(float(x * x + y * y));
+                    float wDepth = std::exp(-std::abs(normalDepth.w - sampleNormalDepth.w) / (distanceScale + 1e-4f));
+                    float wNormal = std::pow(std::max(glm::dot(glm::vec3(normalDepth), glm::vec3(sampleNormalDepth)), 0.0f),
+                                             settings.sigmaNormal);
+                    float wLum = std::exp(-std::abs(centerLum - luminance(glm::vec3(value))) / lumScale);
+
+                    float w = kKernel[std::abs(x)] * kKernel[std::abs(y)] * wDepth * wNormal * wLum;
+                    colorSum += w * glm::vec3(value);
+                    varianceSum += w * w * value.w;
+                    weightSum += w;
+                }
+            }
+
+            output[p] = glm::vec4(colorSum / weightSum, varianceSum / (weightSum * weightSum));
+        }
+    }
+}
+
+} // namespace kcShaders
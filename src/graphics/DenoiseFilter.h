@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace kcShaders {
+
+// Denoiser parameters, shared by DenoisePass and the CPU filter
+struct DenoiseSettings {
+    int iterations = 4;             // A-trous iterations, tap spacing doubles each time
+    float sigmaLuminance = 4.0f;    // Luminance edge stop in standard deviations
+    float sigmaNormal = 128.0f;     // Normal edge stop exponent
+    float sigmaDepth = 1.0f;        // Depth edge stop, relative to the pixel's depth
+    float alphaMin = 0.2f;          // Minimum weight of the new frame in the temporal blend
+};
+
+/**
+ * DenoiseFilter: CPU version of the ray tracing denoiser's spatial filter
+ *
+ * Runs the same edge-aware a-trous wavelet iterations as
+ * raytracing/denoise/atrous.comp, so the filter can be checked headless
+ * against known images without a GL context (the denoise checks of
+ * kcShaders_microbench --check). Keep both in sync.
+ */
+class DenoiseFilter {
+public:
+    // One frame of filter input, all buffers row-major width * height
+    struct Frame {
+        int width = 0;
+        int height = 0;
+        std::vector<glm::vec3> color;        // Linear radiance
+        std::vector<glm::vec4> normalDepth;  // World normal, hit distance (0 = sky)
+        std::vector<glm::vec3> albedo;
+        std::vector<float> variance;         // Luminance variance of color
+    };
+
+    /**
+     * Filter a frame: demodulate the albedo, run settings.iterations a-trous
+     * iterations and remodulate
+     * @return Filtered linear radiance
+     */
+    static std::vector<glm::vec3> filter(const Frame& frame, const DenoiseSettings& settings);
+
+    /**
+     * One a-trous iteration on demodulated illumination (rgb) and variance (a)
+     * @param stepSize Tap spacing in pixels (1, 2, 4, ...)
+     */
+    static void atrousIteration(const Frame& frame, const std::vector<glm::vec4>& input,
+                                int stepSize, const DenoiseSettings& settings,
+                                std::vector<glm::vec4>& output);
+
+    static float luminance(const glm::vec3& color);
+    static glm::vec3 demodulate(const glm::vec3& color, const glm::vec3& albedo);
+    static glm::vec3 remodulate(const glm::vec3& illumination, const glm::vec3& albedo);
+};
+
+} // namespace kcShaders
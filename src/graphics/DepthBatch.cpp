@@ -0,0 +1,79 @@
+#include "DepthBatch.h"
+#include "ShaderProgram.h"
+#include "../scene/mesh.h"
+#include <algorithm>
+
+namespace kcShaders {
+
+DepthBatch::~DepthBatch()
+{
+    release();
+}
+
+void DepthBatch::release()
+{
+    if (texture_ != 0) {
+        glDeleteTextures(1, &texture_);
+        texture_ = 0;
+    }
+    if (buffer_ != 0) {
+        glDeleteBuffers(1, &buffer_);
+        buffer_ = 0;
+    }
+    capacity_ = 0;
+}
+
+void DepthBatch::draw(ShaderProgram* shader, int textureUnit)
+{
+    if (instances_.empty() || !shader) {
+        return;
+    }
+
+    // Instances of one mesh become one contiguous run of matrices
+    std::stable_sort(instances_.begin(), instances_.end(), [](const Instance& a, const Instance& b) {
+        return a.mesh < b.mesh;
+    });
+    matrices_.clear();
+    for (const Instance& instance : instances_) {
+        matrices_.push_back(instance.modelMatrix);
+    }
+
+    if (buffer_ == 0) {
+        glGenBuffers(1, &buffer_);
+        glGenTextures(1, &texture_);
+    }
+
+    // Grow in powers of two so a slowly growing scene does not reallocate
+    // every frame
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer_);
+    if (matrices_.size() > capacity_) {
+        capacity_ = std::max<size_t>(capacity_, 64);
+        while (capacity_ < matrices_.size()) {
+            capacity_ *= 2;
+        }
+        glBufferData(GL_TEXTURE_BUFFER, capacity_ * sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, matrices_.size() * sizeof(glm::mat4), matrices_.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, texture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer_);
+    shader->setInt("instanceTransforms", textureUnit);
+
+    size_t first = 0;
+    while (first < instances_.size()) {
+        size_t last = first + 1;
+        while (last < instances_.size() && instances_[last].mesh == instances_[first].mesh) {
+            ++last;
+        }
+
+        shader->setInt("instanceOffset", static_cast<int>(first));
+        instances_[first].mesh->drawDepth(static_cast<int>(last - first));
+        first = last;
+    }
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+} // namespace kcShaders
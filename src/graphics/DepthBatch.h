@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace kcShaders {
+
+class Mesh;
+class ShaderProgram;
+
+/**
+ * DepthBatch: Instanced depth-only drawing for shadow passes
+ *
+ * Collects (mesh, model matrix) pairs and draws every mesh once with all of
+ * its instances, from the mesh's position-only stream. The matrices go to a
+ * texture buffer that the DEPTH_INSTANCED permutation of shadow_map.vert
+ * reads with texelFetch (four RGBA32F texels per matrix); a texture buffer
+ * works in the vertex stage of every GL 3.3+ context, storage buffers do not.
+ */
+class DepthBatch {
+public:
+    DepthBatch() = default;
+    ~DepthBatch();
+
+    DepthBatch(const DepthBatch&) = delete;
+    DepthBatch& operator=(const DepthBatch&) = delete;
+
+    void clear() { instances_.clear(); }
+    void add(const Mesh* mesh, const glm::mat4& modelMatrix) { instances_.push_back({mesh, modelMatrix}); }
+    bool empty() const { return instances_.empty(); }
+
+    /**
+     * @brief Upload the matrices and issue one instanced draw per mesh
+     * @param shader Depth shader, already using a DEPTH_INSTANCED permutation
+     * @param textureUnit Unit for the instanceTransforms texture buffer
+     */
+    void draw(ShaderProgram* shader, int textureUnit = 0);
+
+    /**
+     * @brief Delete the GPU buffers (needs a current GL context)
+     */
+    void release();
+
+private:
+    struct Instance {
+        const Mesh* mesh;
+        glm::mat4 modelMatrix;
+    };
+
+    std::vector<Instance> instances_;
+    std::vector<glm::mat4> matrices_;   // Upload staging, grouped by mesh
+    GLuint buffer_ = 0;
+    GLuint texture_ = 0;
+    size_t capacity_ = 0;               // Matrices the buffer holds
+};
+
+} // namespace kcShaders
@@ -0,0 +1,55 @@
+#include "Frustum.h"
+
+namespace kcShaders {
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection)
+{
+    // Rows of the matrix; plane i/2 is row 3 plus or minus row i/2
+    glm::mat4 rows = glm::transpose(viewProjection);
+
+    Frustum frustum;
+    for (int i = 0; i < 6; ++i) {
+        glm::vec4 plane = rows[3] + ((i & 1) ? -rows[i / 2] : rows[i / 2]);
+        frustum.planes[i] = plane / glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (const glm::vec4& plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+    for (const glm::vec4& plane : planes) {
+        // Corner furthest along the plane normal
+        glm::vec3 corner(plane.x >= 0.0f ? boxMax.x : boxMin.x,
+                         plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                         plane.z >= 0.0f ? boxMax.z : boxMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void transformBounds(const glm::mat4& matrix, const glm::vec3& localMin, const glm::vec3& localMax,
+                     glm::vec3& outMin, glm::vec3& outMax)
+{
+    glm::vec3 center = glm::vec3(matrix * glm::vec4((localMin + localMax) * 0.5f, 1.0f));
+    glm::vec3 halfExtent = (localMax - localMin) * 0.5f;
+    glm::vec3 extent(0.0f);
+    for (int axis = 0; axis < 3; ++axis) {
+        extent += glm::abs(glm::vec3(matrix[axis])) * halfExtent[axis];
+    }
+    outMin = center - extent;
+    outMax = center + extent;
+}
+
+} // namespace kcShaders
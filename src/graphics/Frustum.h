@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace kcShaders {
+
+/**
+ * Frustum: The six planes of a view-projection matrix, for culling bounds
+ *
+ * Planes point inwards and are normalized, so distances are in world units.
+ */
+struct Frustum {
+    glm::vec4 planes[6];  // Left, right, bottom, top, near, far
+
+    /**
+     * @brief Extract the planes of a (view-)projection matrix (Gribb/Hartmann)
+     */
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+
+    /**
+     * @brief Conservative box test: false only if the box is fully outside one plane
+     */
+    bool intersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+};
+
+/**
+ * @brief Axis-aligned bounds of a box after transforming it by a matrix
+ */
+void transformBounds(const glm::mat4& matrix, const glm::vec3& localMin, const glm::vec3& localMax,
+                     glm::vec3& outMin, glm::vec3& outMax);
+
+} // namespace kcShaders
@@ -0,0 +1,160 @@
+#include "LightSampler.h"
+#include "../scene/light.h"
+#include <cmath>
+
+namespace kcShaders {
+
+namespace {
+
+float luminance(const glm::vec3& color)
+{
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+} // namespace
+
+float LightSampler::triangleWeight(const GpuMaterial& material, float area)
+{
+    return luminance(material.emissive * material.emissiveStrength) * area;
+}
+
+void LightSampler::build(const std::vector<Light*>& lights,
+                         const std::vector<GpuVertex>& vertices,
+                         const std::vector<GpuTriangle>& triangles,
+                         const std::vector<GpuMaterial>& materials)
+{
+    lights_.clear();
+    std::vector<float> weights;
+
+    for (Light* light : lights) {
+        if (!light || !light->enabled) continue;
+
+        GpuLight gpuLight = {};
+        gpuLight.radiance = light->color * light->intensity;
+
+        switch (light->GetType()) {
+            case LightType::Directional: {
+                auto* directional = static_cast<DirectionalLight*>(light);
+                gpuLight.type = GpuLightDirectional;
+                gpuLight.direction = glm::normalize(directional->direction);
+                break;
+            }
+            case LightType::Point: {
+                auto* point = static_cast<PointLight*>(light);
+                gpuLight.type = GpuLightPoint;
+                gpuLight.position = point->position;
+                break;
+            }
+            case LightType::Spot: {
+                auto* spot = static_cast<SpotLight*>(light);
+                gpuLight.type = GpuLightSpot;
+                gpuLight.position = spot->position;
+                gpuLight.direction = glm::normalize(spot->direction);
+                gpuLight.cosInner = std::cos(glm::radians(spot->innerConeAngle));
+                gpuLight.cosOuter = std::cos(glm::radians(spot->outerConeAngle));
+                break;
+            }
+            case LightType::Area: {
+                auto* rect = static_cast<AreaLight*>(light);
+                glm::vec3 normal = glm::normalize(rect->normal);
+                glm::vec3 tangent = glm::normalize(rect->tangent);
+                gpuLight.type = GpuLightArea;
+                gpuLight.position = rect->position;
+                gpuLight.direction = normal;
+                gpuLight.index = rect->twoSided ? 1u : 0u;
+                gpuLight.tangent = tangent * rect->width;
+                gpuLight.bitangent = glm::normalize(glm::cross(normal, tangent)) * rect->height;
+                gpuLight.area = rect->width * rect->height;
+                break;
+            }
+            default:
+                continue;  // Ambient light has no position to sample
+        }
+
+        float weight = luminance(gpuLight.radiance);
+        if (weight <= 0.0f) continue;
+        lights_.push_back(gpuLight);
+        weights.push_back(weight);
+    }
+
+    // Emissive geometry, the shader reads the radiance from the material
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const GpuTriangle& tri = triangles[i];
+        const GpuMaterial& material = materials[tri.materialId];
+        if (material.emissiveStrength <= 0.0f) continue;
+
+        const glm::vec3& p0 = vertices[tri.v0].position;
+        const glm::vec3& p1 = vertices[tri.v1].position;
+        const glm::vec3& p2 = vertices[tri.v2].position;
+        float area = 0.5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+
+        float weight = triangleWeight(material, area);
+        if (weight <= 0.0f) continue;
+
+        GpuLight gpuLight = {};
+        gpuLight.type = GpuLightTriangle;
+        gpuLight.index = static_cast<uint32_t>(i);
+        gpuLight.area = area;
+        lights_.push_back(gpuLight);
+        weights.push_back(weight);
+    }
+
+    totalWeight_ = 0.0f;
+    for (float weight : weights) {
+        totalWeight_ += weight;
+    }
+    aliasTable_ = buildAliasTable(weights);
+}
+
+std::vector<GpuAliasEntry> LightSampler::buildAliasTable(const std::vector<float>& weights)
+{
+    size_t count = weights.size();
+    std::vector<GpuAliasEntry> table(count);
+
+    double total = 0.0;
+    for (float weight : weights) {
+        total += weight;
+    }
+    if (count == 0 || total <= 0.0) {
+        return table;
+    }
+
+    // Scaled so the average slot holds exactly 1
+    std::vector<double> scaled(count);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < count; i++) {
+        table[i].pdf = static_cast<float>(weights[i] / total);
+        table[i].alias = static_cast<uint32_t>(i);
+        scaled[i] = weights[i] / total * count;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    // Fill every underfull slot with the remainder of an overfull one
+    while (!small.empty() && !large.empty()) {
+        uint32_t less = small.back();
+        uint32_t more = large.back();
+        small.pop_back();
+
+        table[less].probability = static_cast<float>(scaled[less]);
+        table[less].alias = more;
+
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+
+    // Leftovers are 1 up to rounding
+    for (uint32_t i : large) {
+        table[i].probability = 1.0f;
+    }
+    for (uint32_t i : small) {
+        table[i].probability = 1.0f;
+    }
+
+    return table;
+}
+
+} // namespace kcShaders
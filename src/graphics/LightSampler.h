@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "BVH.h"
+
+namespace kcShaders {
+
+class Light;
+
+// Light types, must match light_sampling.glsl
+enum GpuLightType : uint32_t {
+    GpuLightDirectional = 0,
+    GpuLightPoint = 1,
+    GpuLightSpot = 2,
+    GpuLightArea = 3,
+    GpuLightTriangle = 4
+};
+
+// GPU-friendly light data (std430 layout compatible)
+struct GpuLight {
+    glm::vec3 position;    // Point/spot position, area light center
+    uint32_t type;         // GpuLightType
+    glm::vec3 direction;   // Direction light travels (directional/spot), area light normal
+    uint32_t index;        // Triangle index for emissive triangles, two-sided flag for area lights
+    glm::vec3 radiance;    // color * intensity (emissive triangles read their material)
+    float cosInner;        // Spot cone
+    glm::vec3 tangent;     // Area light width axis, scaled by the width
+    float cosOuter;
+    glm::vec3 bitangent;   // Area light height axis, scaled by the height
+    float area;            // Emitting area (area lights and triangles)
+};
+
+// One alias table slot (Vose's method): keep light i with `probability`,
+// otherwise take `alias`. `pdf` is the selection probability of light i.
+struct GpuAliasEntry {
+    float probability;
+    uint32_t alias;
+    float pdf;
+    uint32_t _pad0;
+};
+
+/**
+ * LightSampler: Builds the light list and power-weighted alias table for
+ * next-event estimation in the ray tracer
+ *
+ * Scene lights (Directional/Point/Spot/Area, Ambient is skipped) and every
+ * emissive triangle become one light each. Lights are picked in O(1) with
+ * probability proportional to their weight: luminance of color * intensity
+ * for analytic lights, emitted luminance * area for triangles. Any positive
+ * weight keeps the estimator unbiased, the weights only steer the variance.
+ */
+class LightSampler {
+public:
+    /**
+     * Collect the lights of a scene
+     * @param triangles Triangles in their final (BVH) order, indices refer to it
+     */
+    void build(const std::vector<Light*>& lights,
+               const std::vector<GpuVertex>& vertices,
+               const std::vector<GpuTriangle>& triangles,
+               const std::vector<GpuMaterial>& materials);
+
+    const std::vector<GpuLight>& getLights() const { return lights_; }
+    const std::vector<GpuAliasEntry>& getAliasTable() const { return aliasTable_; }
+
+    /** Sum of all light weights, the shader turns triangle weights into pdfs with it */
+    float getTotalWeight() const { return totalWeight_; }
+
+    /** Weight of an emissive triangle, mirrored by triangleLightWeight() in GLSL */
+    static float triangleWeight(const GpuMaterial& material, float area);
+
+    /** Build an alias table for arbitrary non-negative weights */
+    static std::vector<GpuAliasEntry> buildAliasTable(const std::vector<float>& weights);
+
+private:
+    std::vector<GpuLight> lights_;
+    std::vector<GpuAliasEntry> aliasTable_;
+    float totalWeight_ = 0.0f;
+};
+
+} // namespace kcShaders
@@ -1,5 +1,6 @@
 #include "MaterialBinder.h"
 #include "ShaderProgram.h"
+#include "PerfCounters.h"
 #include "../scene/material.h"
 #include <glm/glm.hpp>
 
@@ -15,14 +16,6 @@ void MaterialBinder::bind(ShaderProgram& shader, const Material* material) {
         shader.setVec3("material.emissive", glm::vec3(0.0f));
         shader.setFloat("material.emissiveStrength", 0.0f);
         shader.setFloat("material.opacity", 1.0f);
-        
-        // Set "no texture" flags
-        shader.setBool("hasAlbedoMap", false);
-        shader.setBool("hasMetallicMap", false);
-        shader.setBool("hasRoughnessMap", false);
-        shader.setBool("hasNormalMap", false);
-        shader.setBool("hasAOMap", false);
-        shader.setBool("hasEmissiveMap", false);
         return;
     }
     
@@ -35,67 +28,92 @@ void MaterialBinder::bind(ShaderProgram& shader, const Material* material) {
     shader.setFloat("material.emissiveStrength", material->emissiveStrength);
     shader.setFloat("material.opacity", material->opacity);
     
+    // Texture presence is selected through the shader permutation, see permutation()
+    
     // Bind albedo texture
     if (material->albedoMap != 0) {
         glActiveTexture(GL_TEXTURE0 + TextureUnit::Albedo);
         glBindTexture(GL_TEXTURE_2D, material->albedoMap);
+        PerfCounters::add(PerfCounter::TextureBinds);
         shader.setInt("albedoMap", TextureUnit::Albedo);
-        shader.setBool("hasAlbedoMap", true);
-    } else {
-        shader.setBool("hasAlbedoMap", false);
     }
     
     // Bind metallic texture
     if (material->metallicMap != 0) {
         glActiveTexture(GL_TEXTURE0 + TextureUnit::Metallic);
         glBindTexture(GL_TEXTURE_2D, material->metallicMap);
+        PerfCounters::add(PerfCounter::TextureBinds);
         shader.setInt("metallicMap", TextureUnit::Metallic);
-        shader.setBool("hasMetallicMap", true);
-    } else {
-        shader.setBool("hasMetallicMap", false);
     }
     
     // Bind roughness texture
     if (material->roughnessMap != 0) {
         glActiveTexture(GL_TEXTURE0 + TextureUnit::Roughness);
         glBindTexture(GL_TEXTURE_2D, material->roughnessMap);
+        PerfCounters::add(PerfCounter::TextureBinds);
         shader.setInt("roughnessMap", TextureUnit::Roughness);
-        shader.setBool("hasRoughnessMap", true);
-    } else {
-        shader.setBool("hasRoughnessMap", false);
     }
     
     // Bind normal map
     if (material->normalMap != 0) {
         glActiveTexture(GL_TEXTURE0 + TextureUnit::Normal);
         glBindTexture(GL_TEXTURE_2D, material->normalMap);
+        PerfCounters::add(PerfCounter::TextureBinds);
         shader.setInt("normalMap", TextureUnit::Normal);
-        shader.setBool("hasNormalMap", true);
-    } else {
-        shader.setBool("hasNormalMap", false);
     }
     
     // Bind AO texture
     if (material->aoMap != 0) {
         glActiveTexture(GL_TEXTURE0 + TextureUnit::AO);
         glBindTexture(GL_TEXTURE_2D, material->aoMap);
+        PerfCounters::add(PerfCounter::TextureBinds);
         shader.setInt("aoMap", TextureUnit::AO);
-        shader.setBool("hasAOMap", true);
-    } else {
-        shader.setBool("hasAOMap", false);
     }
     
     // Bind emissive texture
     if (material->emissiveMap != 0) {
         glActiveTexture(GL_TEXTURE0 + TextureUnit::Emissive);
         glBindTexture(GL_TEXTURE_2D, material->emissiveMap);
+        PerfCounters::add(PerfCounter::TextureBinds);
         shader.setInt("emissiveMap", TextureUnit::Emissive);
-        shader.setBool("hasEmissiveMap", true);
-    } else {
-        shader.setBool("hasEmissiveMap", false);
     }
 }
 
+uint32_t MaterialBinder::textureMask(const Material* material) {
+    if (!material) {
+        return 0;
+    }
+    
+    uint32_t mask = 0;
+    if (material->albedoMap != 0)    mask |= 1u << TextureUnit::Albedo;
+    if (material->metallicMap != 0)  mask |= 1u << TextureUnit::Metallic;
+    if (material->roughnessMap != 0) mask |= 1u << TextureUnit::Roughness;
+    if (material->normalMap != 0)    mask |= 1u << TextureUnit::Normal;
+    if (material->aoMap != 0)        mask |= 1u << TextureUnit::AO;
+    if (material->emissiveMap != 0)  mask |= 1u << TextureUnit::Emissive;
+    return mask;
+}
+
+ShaderDefines MaterialBinder::permutation(uint32_t textureMask) {
+    // Indexed by TextureUnit, keeps the define order (and so the cache key) stable
+    static const char* const defines[] = {
+        "HAS_ALBEDO_MAP",
+        "HAS_METALLIC_MAP",
+        "HAS_ROUGHNESS_MAP",
+        "HAS_NORMAL_MAP",
+        "HAS_AO_MAP",
+        "HAS_EMISSIVE_MAP"
+    };
+    
+    ShaderDefines result;
+    for (int i = 0; i <= TextureUnit::Emissive; ++i) {
+        if (textureMask & (1u << i)) {
+            result.emplace_back(defines[i], "");
+        }
+    }
+    return result;
+}
+
 void MaterialBinder::unbindTextures() {
     for (int i = 0; i <= TextureUnit::Emissive; ++i) {
         glActiveTexture(GL_TEXTURE0 + i);
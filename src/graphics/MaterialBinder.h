@@ -1,6 +1,8 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <cstdint>
+#include "ShaderPreprocessor.h"
 
 namespace kcShaders {
 
@@ -26,6 +28,18 @@ public:
      */
     static void bind(ShaderProgram& shader, const Material* material);
     
+    /**
+     * Bitmask of the texture maps a material provides (bit i = TextureUnit i).
+     * Sort draws by this to minimize permutation switches.
+     */
+    static uint32_t textureMask(const Material* material);
+    
+    /**
+     * Shader permutation for a texture mask: HAS_ALBEDO_MAP, HAS_METALLIC_MAP,
+     * HAS_ROUGHNESS_MAP, HAS_NORMAL_MAP, HAS_AO_MAP, HAS_EMISSIVE_MAP
+     */
+    static ShaderDefines permutation(uint32_t textureMask);
+    
     /**
      * Unbind all texture units (cleanup after rendering)
      */
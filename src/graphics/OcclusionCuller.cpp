@@ -0,0 +1,244 @@
+#include "OcclusionCuller.h"
+#include "Frustum.h"
+#include "ShaderProgram.h"
+#include "../scene/scene.h"
+#include "../scene/mesh.h"
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace kcShaders {
+
+namespace {
+
+// Must match local_size in occlusion.comp
+constexpr int kCullGroupSize = 64;
+constexpr int kHiZGroupSize = 8;
+
+int nextPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value) {
+        result *= 2;
+    }
+    return result;
+}
+
+void dispatchImage(ShaderProgram* shader, int width, int height)
+{
+    GLint loc = shader->uniformLocation("uResolution");
+    if (loc >= 0) {
+        glUniform2i(loc, width, height);
+    }
+    glDispatchCompute((width + kHiZGroupSize - 1) / kHiZGroupSize, (height + kHiZGroupSize - 1) / kHiZGroupSize, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+} // namespace
+
+OcclusionCuller::~OcclusionCuller()
+{
+    release();
+}
+
+void OcclusionCuller::release()
+{
+    GLuint buffers[] = {objectBuffer_, commandBuffer_, visibilityBuffer_};
+    if (objectBuffer_ != 0) {
+        glDeleteBuffers(3, buffers);
+    }
+    objectBuffer_ = commandBuffer_ = visibilityBuffer_ = 0;
+    capacity_ = 0;
+    meshes_.clear();
+
+    if (hizTexture_ != 0) {
+        glDeleteTextures(1, &hizTexture_);
+        hizTexture_ = 0;
+    }
+    depthWidth_ = depthHeight_ = 0;
+    historyValid_ = false;
+}
+
+void OcclusionCuller::prepare(const std::vector<RenderItem>& items)
+{
+    bounds_.clear();
+    bool meshesChanged = meshes_.size() != items.size();
+    for (size_t i = 0; i < items.size(); ++i) {
+        const Mesh* mesh = items[i].mesh;
+        ObjectBounds object{glm::vec4(0.0f), glm::vec4(0.0f)};
+        if (mesh) {
+            glm::vec3 boundsMin, boundsMax;
+            transformBounds(items[i].modelMatrix, mesh->GetBoundsMin(), mesh->GetBoundsMax(), boundsMin, boundsMax);
+            object.boundsMin = glm::vec4(boundsMin, 0.0f);
+            object.boundsMax = glm::vec4(boundsMax, 0.0f);
+        }
+        bounds_.push_back(object);
+        meshesChanged = meshesChanged || meshes_[i] != mesh;
+    }
+
+    if (bounds_.empty()) {
+        return;
+    }
+
+    // Grow in powers of two; new buffers need their commands written again
+    if (bounds_.size() > capacity_) {
+        capacity_ = std::max<size_t>(capacity_, 64);
+        while (capacity_ < bounds_.size()) {
+            capacity_ *= 2;
+        }
+
+        if (objectBuffer_ == 0) {
+            GLuint buffers[3];
+            glGenBuffers(3, buffers);
+            objectBuffer_ = buffers[0];
+            commandBuffer_ = buffers[1];
+            visibilityBuffer_ = buffers[2];
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity_ * sizeof(ObjectBounds), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity_ * kCommandStride, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibilityBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity_ * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+        meshesChanged = true;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bounds_.size() * sizeof(ObjectBounds), bounds_.data());
+
+    // Only instanceCount changes from frame to frame, the cull shader writes it
+    if (meshesChanged) {
+        meshes_.clear();
+        std::vector<GLuint> commands(items.size() * 5, 0);
+        for (size_t i = 0; i < items.size(); ++i) {
+            const Mesh* mesh = items[i].mesh;
+            meshes_.push_back(mesh);
+            if (mesh) {
+                commands[i * 5] = mesh->GetIndexCount() > 0 ? mesh->GetIndexCount() : mesh->GetVertexCount();
+            }
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer_);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commands.size() * sizeof(GLuint), commands.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void OcclusionCuller::cullFirstPhase(const glm::mat4& viewProjection)
+{
+    cull(viewProjection, false);
+}
+
+void OcclusionCuller::cullSecondPhase(const glm::mat4& viewProjection)
+{
+    cull(viewProjection, true);
+}
+
+void OcclusionCuller::cull(const glm::mat4& viewProjection, bool secondPhase)
+{
+    if (!shader_ || bounds_.empty()) {
+        return;
+    }
+
+    if (secondPhase) {
+        shader_->usePermutation({{"SECOND_PHASE", ""}});
+    } else {
+        shader_->usePermutation({});
+    }
+
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+    GLint loc = shader_->uniformLocation("frustumPlanes");
+    if (loc >= 0) {
+        glUniform4fv(loc, 6, glm::value_ptr(frustum.planes[0]));
+    }
+
+    // Phase 1 without history is a plain frustum test
+    bool useHiZ = hizTexture_ != 0 && (secondPhase || historyValid_);
+    shader_->setInt("objectCount", static_cast<int>(bounds_.size()));
+    shader_->setInt("hizLevels", useHiZ ? hizLevels_ : 0);
+    shader_->setMat4("hizViewProjection", hizViewProjection_);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, useHiZ ? hizTexture_ : 0);
+    shader_->setInt("hizTexture", 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kObjectBinding, objectBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kCommandBinding, commandBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kVisibilityBinding, visibilityBuffer_);
+
+    GLuint groups = static_cast<GLuint>((bounds_.size() + kCullGroupSize - 1) / kCullGroupSize);
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OcclusionCuller::createHiZ(int width, int height)
+{
+    if (hizTexture_ != 0) {
+        glDeleteTextures(1, &hizTexture_);
+    }
+
+    // Power-of-two mips halve exactly, so every texel of a level covers the
+    // same screen area and uv -> texel is a plain floor
+    depthWidth_ = width;
+    depthHeight_ = height;
+    hizWidth_ = nextPowerOfTwo((width + 1) / 2);
+    hizHeight_ = nextPowerOfTwo((height + 1) / 2);
+    hizLevels_ = 1;
+    while ((std::max(hizWidth_, hizHeight_) >> hizLevels_) > 0) {
+        ++hizLevels_;
+    }
+
+    glGenTextures(1, &hizTexture_);
+    glBindTexture(GL_TEXTURE_2D, hizTexture_);
+    glTexStorage2D(GL_TEXTURE_2D, hizLevels_, GL_R32F, hizWidth_, hizHeight_);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, hizLevels_ > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, hizLevels_ - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OcclusionCuller::buildHiZ(GLuint depthTexture, int width, int height, const glm::mat4& viewProjection)
+{
+    if (!shader_ || depthTexture == 0 || width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (hizTexture_ == 0 || width != depthWidth_ || height != depthHeight_) {
+        createHiZ(width, height);
+    }
+
+    shader_->usePermutation({{"HIZ_COPY", ""}});
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    shader_->setInt("GDepth", 0);
+    GLint loc = shader_->uniformLocation("depthSize");
+    if (loc >= 0) {
+        glUniform2i(loc, width, height);
+    }
+    glBindImageTexture(0, hizTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    dispatchImage(shader_, hizWidth_, hizHeight_);
+
+    shader_->usePermutation({{"HIZ_REDUCE", ""}});
+    for (int level = 1; level < hizLevels_; ++level) {
+        int w = std::max(hizWidth_ >> level, 1);
+        int h = std::max(hizHeight_ >> level, 1);
+        glBindImageTexture(0, hizTexture_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glBindImageTexture(1, hizTexture_, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        dispatchImage(shader_, w, h);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+
+    hizViewProjection_ = viewProjection;
+    historyValid_ = true;
+}
+
+void OcclusionCuller::bindCommands(bool bind) const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, bind ? commandBuffer_ : 0);
+}
+
+} // namespace kcShaders
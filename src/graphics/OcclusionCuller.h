@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace kcShaders {
+
+class Mesh;
+class ShaderProgram;
+struct RenderItem;
+
+/**
+ * OcclusionCuller: Two-phase GPU occlusion culling against a Hi-Z pyramid
+ *
+ * Every frame the world bounds of the render items go to a storage buffer
+ * and occlusion.comp writes the instanceCount of one indirect draw command
+ * per item:
+ *   1. cullFirstPhase: frustum test, plus a test against the pyramid of the
+ *      previous frame (reprojected through the camera it was built with)
+ *   2. the caller draws the commands, then buildHiZ reduces that depth
+ *   3. cullSecondPhase: items phase 1 rejected are tested again against the
+ *      new pyramid, so anything phase 1 missed appears in the same frame
+ *   4. the caller draws the commands again
+ * The pyramid of step 2 is kept as the history of the next frame. Nothing is
+ * read back; the CPU still issues one indirect draw per item and phase.
+ */
+class OcclusionCuller {
+public:
+    static constexpr GLuint kObjectBinding = 15;      // Storage buffer bindings, see occlusion.comp
+    static constexpr GLuint kCommandBinding = 16;
+    static constexpr GLuint kVisibilityBinding = 17;
+
+    OcclusionCuller() = default;
+    ~OcclusionCuller();
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    void setShader(ShaderProgram* shader) { shader_ = shader; }
+    bool isReady() const { return shader_ != nullptr; }
+
+    /**
+     * @brief Upload the world bounds of the items; commands are rebuilt when
+     * the item meshes change
+     */
+    void prepare(const std::vector<RenderItem>& items);
+
+    void cullFirstPhase(const glm::mat4& viewProjection);
+    void cullSecondPhase(const glm::mat4& viewProjection);
+
+    /**
+     * @brief Build the pyramid from a depth texture rendered with viewProjection
+     */
+    void buildHiZ(GLuint depthTexture, int width, int height, const glm::mat4& viewProjection);
+
+    /**
+     * @brief Bind the command buffer to GL_DRAW_INDIRECT_BUFFER
+     * @param bind false unbinds it again
+     */
+    void bindCommands(bool bind) const;
+
+    /**
+     * @brief Offset of the command of item index in the command buffer
+     */
+    static GLintptr commandOffset(size_t index) { return static_cast<GLintptr>(index * kCommandStride); }
+
+    /**
+     * @brief Forget the pyramid, e.g. after frames the culler did not see
+     */
+    void invalidate() { historyValid_ = false; }
+
+    /**
+     * @brief Delete the GPU resources (needs a current GL context)
+     */
+    void release();
+
+private:
+    static constexpr size_t kCommandStride = 5 * sizeof(GLuint);
+
+    struct ObjectBounds {
+        glm::vec4 boundsMin;
+        glm::vec4 boundsMax;
+    };
+
+    void cull(const glm::mat4& viewProjection, bool secondPhase);
+    void createHiZ(int width, int height);
+
+    ShaderProgram* shader_ = nullptr;
+
+    std::vector<const Mesh*> meshes_;       // Meshes the commands were built for
+    std::vector<ObjectBounds> bounds_;      // Upload staging
+    GLuint objectBuffer_ = 0;
+    GLuint commandBuffer_ = 0;
+    GLuint visibilityBuffer_ = 0;
+    size_t capacity_ = 0;                   // Objects the buffers hold
+
+    GLuint hizTexture_ = 0;
+    int depthWidth_ = 0;                    // Depth size the pyramid was made for
+    int depthHeight_ = 0;
+    int hizWidth_ = 0;                      // Mip 0 size, powers of two
+    int hizHeight_ = 0;
+    int hizLevels_ = 0;
+    glm::mat4 hizViewProjection_{1.0f};
+    bool historyValid_ = false;
+};
+
+} // namespace kcShaders
@@ -0,0 +1,309 @@
+#include "PerfCounters.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace kcShaders {
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;  // Guards the block list and everything below
+
+    // Blocks outlive their threads so counts of finished threads are kept
+    std::vector<std::unique_ptr<PerfCounters::ThreadBlock>> blocks;
+    std::vector<std::vector<uint64_t>> collected;  // Last values read per block
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastFrame = start;
+    uint64_t frameIndex = 0;
+    std::deque<PerfCounters::Snapshot> history;
+
+    std::string exportPath;
+    int exportInterval = 0;
+    PerfCounters::Snapshot exportTotal;  // Running sum of the current interval, any length
+    uint64_t exportedCount = 0;          // Snapshots written since setPeriodicExport
+};
+
+PerfCounters::Snapshot emptySum()
+{
+    PerfCounters::Snapshot sum;
+    sum.frames = 0;
+    return sum;
+}
+
+void accumulate(PerfCounters::Snapshot& sum, const PerfCounters::Snapshot& snapshot)
+{
+    sum.frame = snapshot.frame;
+    sum.timeMs = snapshot.timeMs;
+    sum.frames += snapshot.frames;
+    sum.frameMs += snapshot.frameMs;
+    for (int c = 0; c < PerfCounters::kCount; c++) {
+        sum.values[c] += snapshot.values[c];
+    }
+}
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+bool isJsonPath(const std::string& path)
+{
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+}
+
+void writeCsvHeader(std::ostream& out)
+{
+    out << "frame,frames,time_ms,frame_ms";
+    for (int i = 0; i < PerfCounters::kCount; i++) {
+        out << "," << PerfCounters::name(static_cast<PerfCounter>(i));
+    }
+    out << ",rays_per_second\n";
+}
+
+void writeCsvRow(std::ostream& out, const PerfCounters::Snapshot& snapshot)
+{
+    out << snapshot.frame << "," << snapshot.frames << "," << snapshot.timeMs << "," << snapshot.frameMs;
+    for (uint64_t value : snapshot.values) {
+        out << "," << value;
+    }
+    out << "," << snapshot.raysPerSecond() << "\n";
+}
+
+// Closes the snapshot array, appendJson writes over it
+const char kJsonTrailer[] = "\n  ]\n}\n";
+
+void writeJsonSnapshot(std::ostream& out, const PerfCounters::Snapshot& snapshot)
+{
+    out << "    {\"frame\": " << snapshot.frame << ", \"frames\": " << snapshot.frames
+        << ", \"time_ms\": " << snapshot.timeMs << ", \"frame_ms\": " << snapshot.frameMs;
+    for (int i = 0; i < PerfCounters::kCount; i++) {
+        out << ", \"" << PerfCounters::name(static_cast<PerfCounter>(i)) << "\": " << snapshot.values[i];
+    }
+    out << ", \"rays_per_second\": " << snapshot.raysPerSecond() << "}";
+}
+
+template <typename Container>
+bool writeJson(const std::string& path, const Container& snapshots)
+{
+    // Binary, so the trailer has the same length on every platform
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\n  \"snapshots\": [";
+    bool first = true;
+    for (const PerfCounters::Snapshot& snapshot : snapshots) {
+        file << (first ? "\n" : ",\n");
+        first = false;
+        writeJsonSnapshot(file, snapshot);
+    }
+    file << kJsonTrailer;
+    return true;
+}
+
+// Add a snapshot to a non-empty file written by writeJson, in place of its trailer
+bool appendJson(const std::string& path, const PerfCounters::Snapshot& snapshot)
+{
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.seekp(-static_cast<std::streamoff>(sizeof(kJsonTrailer) - 1), std::ios::end);
+    file << std::fixed << std::setprecision(3) << ",\n";
+    writeJsonSnapshot(file, snapshot);
+    file << kJsonTrailer;
+    return static_cast<bool>(file);
+}
+
+// Sum of the newest `frames` snapshots, registry locked by the caller
+PerfCounters::Snapshot aggregateLocked(const Registry& reg, int frames)
+{
+    PerfCounters::Snapshot sum = emptySum();
+    int count = std::min(frames, static_cast<int>(reg.history.size()));
+    for (int i = static_cast<int>(reg.history.size()) - count; i < static_cast<int>(reg.history.size()); i++) {
+        accumulate(sum, reg.history[i]);
+    }
+    return sum;
+}
+
+} // namespace
+
+double PerfCounters::Snapshot::perFrame(PerfCounter counter) const
+{
+    return frames > 0 ? static_cast<double>(values[static_cast<int>(counter)]) / frames : 0.0;
+}
+
+double PerfCounters::Snapshot::raysPerSecond() const
+{
+    return frameMs > 0.0 ? values[static_cast<int>(PerfCounter::RaysTraced)] / (frameMs / 1000.0) : 0.0;
+}
+
+const char* PerfCounters::name(PerfCounter counter)
+{
+    switch (counter) {
+        case PerfCounter::DrawCalls:       return "draw_calls";
+        case PerfCounter::Triangles:       return "triangles";
+        case PerfCounter::StateChanges:    return "state_changes";
+        case PerfCounter::UniformUploads:  return "uniform_uploads";
+        case PerfCounter::TextureBinds:    return "texture_binds";
+        case PerfCounter::RaySamples:      return "ray_samples";
+        case PerfCounter::RaysTraced:      return "rays_traced";
+        case PerfCounter::BvhNodesVisited: return "bvh_nodes_visited";
+        case PerfCounter::TileLightOverflows: return "tile_light_overflows";
+        default:                           return "unknown";
+    }
+}
+
+PerfCounters::ThreadBlock* PerfCounters::registerThread()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    reg.blocks.push_back(std::make_unique<ThreadBlock>());
+    local_ = reg.blocks.back().get();
+    reg.collected.emplace_back(kCount, 0);
+    return local_;
+}
+
+void PerfCounters::endFrame()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    auto now = std::chrono::steady_clock::now();
+    Snapshot snapshot;
+    snapshot.frame = reg.frameIndex++;
+    snapshot.timeMs = std::chrono::duration<double, std::milli>(now - reg.start).count();
+    snapshot.frameMs = std::chrono::duration<double, std::milli>(now - reg.lastFrame).count();
+    reg.lastFrame = now;
+
+    for (size_t b = 0; b < reg.blocks.size(); b++) {
+        for (int c = 0; c < kCount; c++) {
+            uint64_t value = reg.blocks[b]->values[c].load(std::memory_order_relaxed);
+            snapshot.values[c] += value - reg.collected[b][c];
+            reg.collected[b][c] = value;
+        }
+    }
+
+    reg.history.push_back(snapshot);
+    while (reg.history.size() > static_cast<size_t>(kHistoryFrames)) {
+        reg.history.pop_front();
+    }
+
+    // Periodic export, summed as frames close since the history is shorter
+    // than long intervals
+    if (reg.exportInterval <= 0) {
+        return;
+    }
+    accumulate(reg.exportTotal, snapshot);
+    if (reg.exportTotal.frames < static_cast<uint64_t>(reg.exportInterval)) {
+        return;
+    }
+    Snapshot interval = reg.exportTotal;
+    reg.exportTotal = emptySum();
+    bool first = reg.exportedCount++ == 0;
+
+    // Only the new interval is written, the file grows but memory does not
+    bool written;
+    if (isJsonPath(reg.exportPath)) {
+        written = first ? writeJson(reg.exportPath, std::vector<Snapshot>{interval})
+                        : appendJson(reg.exportPath, interval);
+    } else {
+        std::ofstream file(reg.exportPath, std::ios::app);
+        written = file.is_open();
+        if (written) {
+            if (first) {
+                writeCsvHeader(file);
+            }
+            file << std::fixed << std::setprecision(3);
+            writeCsvRow(file, interval);
+        }
+    }
+
+    if (!written) {
+        std::cerr << "[PerfCounters] Failed to write " << reg.exportPath << ", periodic export stopped\n";
+        reg.exportInterval = 0;
+    }
+}
+
+PerfCounters::Snapshot PerfCounters::lastFrame()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.history.empty() ? Snapshot() : reg.history.back();
+}
+
+std::deque<PerfCounters::Snapshot> PerfCounters::history()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.history;
+}
+
+PerfCounters::Snapshot PerfCounters::aggregate(int frames)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return aggregateLocked(reg, frames);
+}
+
+bool PerfCounters::exportHistory(const std::string& path)
+{
+    std::deque<Snapshot> snapshots = history();
+
+    bool written;
+    if (isJsonPath(path)) {
+        written = writeJson(path, snapshots);
+    } else {
+        std::ofstream file(path);
+        written = file.is_open();
+        if (written) {
+            writeCsvHeader(file);
+            file << std::fixed << std::setprecision(3);
+            for (const Snapshot& snapshot : snapshots) {
+                writeCsvRow(file, snapshot);
+            }
+        }
+    }
+
+    if (!written) {
+        std::cerr << "[PerfCounters] Failed to write " << path << "\n";
+        return false;
+    }
+    std::cout << "[PerfCounters] Wrote " << snapshots.size() << " frames to " << path << "\n";
+    return true;
+}
+
+void PerfCounters::setPeriodicExport(const std::string& path, int intervalFrames)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.exportPath = path;
+    reg.exportInterval = path.empty() ? 0 : std::max(intervalFrames, 0);
+    reg.exportTotal = emptySum();
+    reg.exportedCount = 0;
+
+    // CSV rows are appended, start from an empty file
+    if (reg.exportInterval > 0 && !isJsonPath(path)) {
+        std::ofstream truncate(path, std::ios::trunc);
+    }
+}
+
+void PerfCounters::clearHistory()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.history.clear();
+}
+
+} // namespace kcShaders
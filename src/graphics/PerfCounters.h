@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+namespace kcShaders {
+
+// Counted events, names in PerfCounters::name()
+enum class PerfCounter : int {
+    DrawCalls = 0,      // Mesh::draw
+    Triangles,          // Triangles submitted by Mesh::draw
+    StateChanges,       // Program binds (ShaderProgram::use) and VAO binds
+    UniformUploads,     // ShaderProgram::set* that reached an active uniform
+    TextureBinds,       // Material textures bound by MaterialBinder
+    RaySamples,         // Camera samples traced by the ray tracing pipeline
+    RaysTraced,         // BVH traversals (closest and any hit), GPU counted
+    BvhNodesVisited,    // GPU counted, see RayTracingPipeline::setTraversalStats
+    TileLightOverflows, // Tiles that dropped lights over the tiled lighting limit, GPU counted
+    Count
+};
+
+/**
+ * PerfCounters: Process-wide event counters with per-frame snapshots
+ *
+ * add() only touches a block owned by the calling thread (relaxed atomic
+ * load and store, no read-modify-write, no lock), so the hooks in draw and
+ * uniform paths cost a few instructions. endFrame() runs on the render
+ * thread, sums the deltas of all thread blocks into a Snapshot and keeps a
+ * ring of them. GPU counters arrive a few frames late, when their readback
+ * completes, and are attributed to the frame that collects them.
+ *
+ * For headless regression checks the snapshots can be exported as CSV or
+ * JSON, once or periodically (aggregated per interval).
+ */
+class PerfCounters {
+public:
+    static constexpr int kCount = static_cast<int>(PerfCounter::Count);
+    static constexpr int kHistoryFrames = 600;
+
+    struct Snapshot {
+        uint64_t frame = 0;
+        uint64_t frames = 1;         // Frames summed into this snapshot
+        double timeMs = 0.0;         // End of the (last) frame since the first snapshot
+        double frameMs = 0.0;        // Wall time of the covered frames
+        uint64_t values[kCount] = {};
+
+        double perFrame(PerfCounter counter) const;
+        double raysPerSecond() const;
+    };
+
+    // Counters written by one thread, owned by the registry
+    struct ThreadBlock {
+        std::atomic<uint64_t> values[kCount] = {};
+    };
+
+    static void add(PerfCounter counter, uint64_t amount = 1)
+    {
+        ThreadBlock* block = local_ ? local_ : registerThread();
+        std::atomic<uint64_t>& value = block->values[static_cast<int>(counter)];
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    static const char* name(PerfCounter counter);
+
+    /** Close the current frame, call once per frame on the render thread */
+    static void endFrame();
+
+    /** Counters of the last closed frame */
+    static Snapshot lastFrame();
+
+    /** Closed frames, oldest first */
+    static std::deque<Snapshot> history();
+
+    /** Sum of the last `frames` closed frames */
+    static Snapshot aggregate(int frames);
+
+    /**
+     * Write the frame history, the format follows the extension (.json,
+     * otherwise CSV)
+     */
+    static bool exportHistory(const std::string& path);
+
+    /**
+     * Write one aggregated snapshot every `intervalFrames` frames, summed as
+     * frames close, so intervals may be longer than the history
+     * @param path CSV rows are appended; in a .json file each snapshot is
+     *             inserted before the closing brackets, so it stays valid
+     * @param intervalFrames 0 stops the export
+     */
+    static void setPeriodicExport(const std::string& path, int intervalFrames);
+
+    /** Forget the history, running totals stay */
+    static void clearHistory();
+
+private:
+    static ThreadBlock* registerThread();
+
+    static inline thread_local ThreadBlock* local_ = nullptr;
+};
+
+} // namespace kcShaders
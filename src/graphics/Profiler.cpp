@@ -0,0 +1,352 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+namespace kcShaders {
+
+namespace {
+
+// Nearest-rank percentile, sorts the values
+double percentile(std::vector<double>& values, double p)
+{
+    if (values.empty()) {
+        return -1.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+    return values[std::min(std::max<size_t>(rank, 1), values.size()) - 1];
+}
+
+std::string escapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+struct ScopeTimes {
+    std::vector<double> cpu;
+    std::vector<double> gpu;
+};
+
+void fillStats(Profiler::ScopeStats& stats, ScopeTimes& times)
+{
+    stats.count = static_cast<int>(times.cpu.size());
+    stats.cpuMin = times.cpu.empty() ? -1.0 : *std::min_element(times.cpu.begin(), times.cpu.end());
+    stats.gpuMin = times.gpu.empty() ? -1.0 : *std::min_element(times.gpu.begin(), times.gpu.end());
+
+    double cpuSum = 0.0;
+    double gpuSum = 0.0;
+    for (double t : times.cpu) cpuSum += t;
+    for (double t : times.gpu) gpuSum += t;
+    stats.cpuAvg = times.cpu.empty() ? -1.0 : cpuSum / times.cpu.size();
+    stats.gpuAvg = times.gpu.empty() ? -1.0 : gpuSum / times.gpu.size();
+
+    stats.cpuP99 = percentile(times.cpu, 0.99);
+    stats.gpuP99 = percentile(times.gpu, 0.99);
+}
+
+} // namespace
+
+Profiler::Profiler()
+    : epoch_(std::chrono::steady_clock::now())
+    , frameIndex_(0)
+    , current_(-1)
+    , enabled_(true)
+    , initialized_(false)
+{
+}
+
+Profiler::~Profiler()
+{
+    cleanup();
+}
+
+bool Profiler::initialize()
+{
+    if (initialized_) {
+        return true;
+    }
+
+    queries_.assign(kFramesInFlight * kQueriesPerSlot, 0);
+    glGenQueries(static_cast<GLsizei>(queries_.size()), queries_.data());
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "[Profiler] Failed to create timer queries, profiling disabled\n";
+        glDeleteQueries(static_cast<GLsizei>(queries_.size()), queries_.data());
+        queries_.clear();
+        return false;
+    }
+
+    initialized_ = true;
+    return true;
+}
+
+void Profiler::cleanup()
+{
+    if (!queries_.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(queries_.size()), queries_.data());
+        queries_.clear();
+    }
+    for (FrameSlot& slot : slots_) {
+        slot = FrameSlot();
+    }
+    openScopes_.clear();
+    current_ = -1;
+    initialized_ = false;
+}
+
+double Profiler::nowMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch_).count();
+}
+
+void Profiler::beginFrame()
+{
+    if (!isEnabled()) {
+        return;
+    }
+    if (current_ >= 0) {
+        endFrame();  // Previous frame was never closed
+    }
+
+    resolvePending();
+
+    // Still in flight after kFramesInFlight frames: keep its CPU times only
+    int slotIndex = static_cast<int>(frameIndex_ % kFramesInFlight);
+    if (slots_[slotIndex].pending) {
+        resolve(slotIndex, true);
+    }
+
+    FrameSlot& slot = slots_[slotIndex];
+    slot.record = FrameRecord();
+    slot.record.index = frameIndex_;
+    slot.record.cpuStartMs = nowMs();
+    slot.sampleQuery.clear();
+    glGetInteger64v(GL_TIMESTAMP, &slot.gpuSync);
+    glQueryCounter(query(slotIndex, 0), GL_TIMESTAMP);
+    slot.queryCount = 2;  // 0 and 1 are the frame begin and end
+
+    openScopes_.clear();
+    current_ = slotIndex;
+}
+
+void Profiler::endFrame()
+{
+    if (current_ < 0) {
+        return;
+    }
+
+    while (!openScopes_.empty()) {
+        std::cerr << "[Profiler] Scope left open: " << slots_[current_].record.samples[openScopes_.back()].name << "\n";
+        endScope(openScopes_.back());
+    }
+
+    FrameSlot& slot = slots_[current_];
+    slot.record.cpuMs = nowMs() - slot.record.cpuStartMs;
+    glQueryCounter(query(current_, 1), GL_TIMESTAMP);
+    slot.pending = true;
+
+    current_ = -1;
+    frameIndex_++;
+}
+
+int Profiler::beginScope(const char* name)
+{
+    if (current_ < 0 || !enabled_) {
+        return -1;
+    }
+
+    FrameSlot& slot = slots_[current_];
+    Sample sample;
+    sample.name = name;
+    sample.depth = static_cast<int>(openScopes_.size());
+    sample.cpuStartMs = nowMs();
+    sample.cpuMs = 0.0;
+    sample.gpuStartMs = 0.0;
+    sample.gpuMs = -1.0;
+
+    if (slot.queryCount + 2 <= kQueriesPerSlot) {
+        slot.sampleQuery.push_back(slot.queryCount);
+        glQueryCounter(query(current_, slot.queryCount), GL_TIMESTAMP);
+        slot.queryCount += 2;
+    } else {
+        slot.sampleQuery.push_back(-1);
+    }
+
+    int scope = static_cast<int>(slot.record.samples.size());
+    slot.record.samples.push_back(std::move(sample));
+    openScopes_.push_back(scope);
+    return scope;
+}
+
+void Profiler::endScope(int scope)
+{
+    if (current_ < 0) {
+        return;
+    }
+    if (openScopes_.empty() || openScopes_.back() != scope) {
+        std::cerr << "[Profiler] Scopes closed out of order\n";
+        return;
+    }
+
+    FrameSlot& slot = slots_[current_];
+    Sample& sample = slot.record.samples[scope];
+    sample.cpuMs = nowMs() - sample.cpuStartMs;
+    if (slot.sampleQuery[scope] >= 0) {
+        glQueryCounter(query(current_, slot.sampleQuery[scope] + 1), GL_TIMESTAMP);
+    }
+    openScopes_.pop_back();
+}
+
+bool Profiler::resolve(int slotIndex, bool discardGpu)
+{
+    FrameSlot& slot = slots_[slotIndex];
+
+    if (!discardGpu) {
+        // The frame end is the last query of the frame
+        GLint available = 0;
+        glGetQueryObjectiv(query(slotIndex, 1), GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+
+        std::vector<GLuint64> timestamps(slot.queryCount);
+        for (int i = 0; i < slot.queryCount; i++) {
+            glGetQueryObjectui64v(query(slotIndex, i), GL_QUERY_RESULT, &timestamps[i]);
+        }
+
+        // GPU timestamps mapped onto the CPU timeline through the frame start sync point
+        auto toCpuMs = [&](GLuint64 timestamp) {
+            return slot.record.cpuStartMs + static_cast<double>(static_cast<GLint64>(timestamp) - slot.gpuSync) / 1.0e6;
+        };
+
+        slot.record.gpuStartMs = toCpuMs(timestamps[0]);
+        slot.record.gpuMs = static_cast<double>(timestamps[1] - timestamps[0]) / 1.0e6;
+        for (size_t i = 0; i < slot.record.samples.size(); i++) {
+            int first = slot.sampleQuery[i];
+            if (first < 0) continue;
+            Sample& sample = slot.record.samples[i];
+            sample.gpuStartMs = toCpuMs(timestamps[first]);
+            sample.gpuMs = static_cast<double>(timestamps[first + 1] - timestamps[first]) / 1.0e6;
+        }
+    }
+
+    frames_.push_back(std::move(slot.record));
+    while (frames_.size() > static_cast<size_t>(kHistoryFrames)) {
+        frames_.pop_front();
+    }
+
+    slot.record = FrameRecord();
+    slot.pending = false;
+    return true;
+}
+
+void Profiler::resolvePending()
+{
+    // Oldest first, so records stay in frame order
+    for (int i = 0; i < kFramesInFlight; i++) {
+        int slotIndex = static_cast<int>((frameIndex_ + i) % kFramesInFlight);
+        if (slots_[slotIndex].pending && !resolve(slotIndex, false)) {
+            break;
+        }
+    }
+}
+
+std::vector<Profiler::ScopeStats> Profiler::computeStatistics() const
+{
+    std::vector<ScopeStats> result;
+    if (frames_.empty()) {
+        return result;
+    }
+
+    ScopeTimes frameTimes;
+    std::map<std::pair<std::string, int>, ScopeTimes> scopeTimes;
+    for (const FrameRecord& frame : frames_) {
+        frameTimes.cpu.push_back(frame.cpuMs);
+        if (frame.gpuMs >= 0.0) frameTimes.gpu.push_back(frame.gpuMs);
+
+        // Scopes entered several times in a frame add up
+        std::map<std::pair<std::string, int>, std::pair<double, double>> totals;
+        for (const Sample& sample : frame.samples) {
+            auto& total = totals[{sample.name, sample.depth}];
+            total.first += sample.cpuMs;
+            total.second += sample.gpuMs >= 0.0 ? sample.gpuMs : 0.0;
+        }
+        for (const auto& [key, total] : totals) {
+            ScopeTimes& times = scopeTimes[key];
+            times.cpu.push_back(total.first);
+            if (frame.gpuMs >= 0.0) times.gpu.push_back(total.second);
+        }
+    }
+
+    ScopeStats frameStats;
+    frameStats.name = "Frame";
+    frameStats.depth = -1;
+    fillStats(frameStats, frameTimes);
+    result.push_back(frameStats);
+
+    for (const Sample& sample : frames_.back().samples) {
+        auto it = scopeTimes.find({sample.name, sample.depth});
+        if (it == scopeTimes.end()) continue;
+
+        ScopeStats stats;
+        stats.name = sample.name;
+        stats.depth = sample.depth;
+        fillStats(stats, it->second);
+        result.push_back(stats);
+        scopeTimes.erase(it);  // Listed once
+    }
+
+    return result;
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "[Profiler] Failed to write trace: " << path << "\n";
+        return false;
+    }
+
+    // Trace event format: timestamps and durations in microseconds
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    auto writeEvent = [&](const std::string& name, int track, double startMs, double durationMs, uint64_t frame) {
+        file << ",\n{\"name\":\"" << escapeJson(name) << "\",\"cat\":\"" << (track == 1 ? "cpu" : "gpu")
+             << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track
+             << ",\"ts\":" << startMs * 1000.0 << ",\"dur\":" << durationMs * 1000.0
+             << ",\"args\":{\"frame\":" << frame << "}}";
+    };
+
+    for (const FrameRecord& frame : frames_) {
+        writeEvent("Frame", 1, frame.cpuStartMs, frame.cpuMs, frame.index);
+        if (frame.gpuMs >= 0.0) {
+            writeEvent("Frame", 2, frame.gpuStartMs, frame.gpuMs, frame.index);
+        }
+        for (const Sample& sample : frame.samples) {
+            writeEvent(sample.name, 1, sample.cpuStartMs, sample.cpuMs, frame.index);
+            if (sample.gpuMs >= 0.0) {
+                writeEvent(sample.name, 2, sample.gpuStartMs, sample.gpuMs, frame.index);
+            }
+        }
+    }
+
+    file << "\n]}\n";
+
+    std::cout << "[Profiler] Wrote " << frames_.size() << " frames to " << path << "\n";
+    return true;
+}
+
+} // namespace kcShaders
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace kcShaders {
+
+/**
+ * Profiler: CPU and GPU timing of named, nestable scopes per frame
+ *
+ * Every scope records CPU time with a steady clock and GPU time with a pair
+ * of GL_TIMESTAMP queries. Timestamps (unlike GL_TIME_ELAPSED) may nest, so
+ * pipeline scopes can enclose pass scopes and the ray tracer's own budget
+ * query. Query sets rotate over kFramesInFlight frames and are only read
+ * once their results are available, so profiling never stalls the CPU; a
+ * frame whose queries are still pending when its set is reused loses its
+ * GPU times.
+ *
+ * Resolved frames are kept in a ring of kHistoryFrames records for rolling
+ * statistics and Chrome trace export (chrome://tracing, Perfetto).
+ */
+class Profiler {
+public:
+    static constexpr int kFramesInFlight = 4;
+    static constexpr int kHistoryFrames = 300;
+    static constexpr int kMaxScopes = 64;  // Per frame, further scopes are CPU-only
+    static constexpr int kQueriesPerSlot = (kMaxScopes + 1) * 2;
+
+    struct Sample {
+        std::string name;
+        int depth;            // Nesting level, 0 = directly inside the frame
+        double cpuStartMs;    // Relative to profiler creation
+        double cpuMs;
+        double gpuStartMs;    // On the CPU timeline, estimated at frame start
+        double gpuMs;         // < 0 if not measured
+    };
+
+    struct FrameRecord {
+        uint64_t index = 0;
+        double cpuStartMs = 0.0;
+        double cpuMs = 0.0;
+        double gpuStartMs = 0.0;
+        double gpuMs = -1.0;  // First to last GPU timestamp of the frame
+        std::vector<Sample> samples;
+    };
+
+    /** Rolling statistics of one scope over the recorded frames */
+    struct ScopeStats {
+        std::string name;
+        int depth;
+        int count;
+        double cpuMin, cpuAvg, cpuP99;
+        double gpuMin, gpuAvg, gpuP99;  // < 0 if never measured
+    };
+
+    Profiler();
+    ~Profiler();
+
+    // Non-copyable
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    /** Create the query objects, requires a current GL context */
+    bool initialize();
+    void cleanup();
+
+    void setEnabled(bool enable) { enabled_ = enable; }
+    bool isEnabled() const { return enabled_ && initialized_; }
+
+    void beginFrame();
+    void endFrame();
+
+    /**
+     * Open a scope, scopes must be closed in reverse order
+     * @return Handle for endScope, -1 when not profiling
+     */
+    int beginScope(const char* name);
+    void endScope(int scope);
+
+    /** Resolved frames, oldest first */
+    const std::deque<FrameRecord>& getFrames() const { return frames_; }
+
+    /**
+     * Min/avg/p99 per scope (name and depth) over the recorded frames, in
+     * the order of the most recent frame; the whole frame comes first as
+     * "Frame" with depth -1
+     */
+    std::vector<ScopeStats> computeStatistics() const;
+
+    /** Write the recorded frames as Chrome trace event JSON */
+    bool exportChromeTrace(const std::string& path) const;
+
+    /** Drop all recorded frames */
+    void clearHistory() { frames_.clear(); }
+
+private:
+    struct FrameSlot {
+        FrameRecord record;
+        GLint64 gpuSync = 0;   // GL_TIMESTAMP at cpuStartMs
+        int queryCount = 0;    // Queries issued, pairs per timed scope plus the frame pair
+        std::vector<int> sampleQuery;  // First query of each sample, -1 = CPU-only
+        bool pending = false;
+    };
+
+    double nowMs() const;
+    bool resolve(int slot, bool discardGpu);
+    GLuint query(int slot, int index) const { return queries_[slot * kQueriesPerSlot + index]; }
+    void resolvePending();
+
+    std::chrono::steady_clock::time_point epoch_;
+    FrameSlot slots_[kFramesInFlight];
+    std::vector<GLuint> queries_;  // kFramesInFlight sets of kQueriesPerSlot
+    std::vector<int> openScopes_;
+    std::deque<FrameRecord> frames_;
+    uint64_t frameIndex_;
+    int current_;           // Slot being recorded, -1 outside a frame
+    bool enabled_;
+    bool initialized_;
+};
+
+/**
+ * ProfileScope: RAII scope, does nothing when the profiler is null or disabled
+ */
+class ProfileScope {
+public:
+    ProfileScope(Profiler* profiler, const char* name)
+        : profiler_(profiler)
+        , scope_(profiler ? profiler->beginScope(name) : -1)
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (profiler_ && scope_ >= 0) {
+            profiler_->endScope(scope_);
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler* profiler_;
+    int scope_;
+};
+
+} // namespace kcShaders
@@ -6,6 +6,8 @@ namespace kcShaders {
 class Scene;
 class Camera;
 class GBuffer;
+class Profiler;
+class RenderTargetPool;
 
 /**
  * RenderContext: Unified context passed to all render passes
@@ -27,6 +29,12 @@ struct RenderContext {
     float deltaTime = 0.0f;
     float totalTime = 0.0f;
     
+    // Per-pass CPU/GPU timing, optional (ProfileScope accepts null)
+    Profiler* profiler = nullptr;
+    
+    // Shared intermediate render targets, see RenderTargetPool
+    RenderTargetPool* targetPool = nullptr;
+    
     // Validation
     bool isValid() const {
         return scene != nullptr && camera != nullptr && 
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace kcShaders {
+
+// Rendering mode enumeration, shared by the editor and the benchmark
+enum class RenderMode {
+    ForwardRendering,
+    DeferredRendering,
+    Shadertoy,
+    RayTracing
+};
+
+} // namespace kcShaders
@@ -33,6 +33,11 @@ public:
      * Cleanup resources
      */
     virtual void cleanup() {}
+    
+    /**
+     * Name shown in the profiler
+     */
+    virtual const char* getName() const { return "RenderPass"; }
 };
 
 } // namespace kcShaders
@@ -0,0 +1,140 @@
+#include "RenderTargetPool.h"
+#include <algorithm>
+
+namespace kcShaders {
+
+namespace {
+
+size_t bytesPerTexel(GLenum internalFormat)
+{
+    switch (internalFormat) {
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+        case GL_R16F:
+            return 2;
+        case GL_RGBA16F:
+        case GL_RG32F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4;   // RGBA8, RG16(F), R32F, R11F_G11F_B10F, depth formats
+    }
+}
+
+} // namespace
+
+RenderTargetPool::~RenderTargetPool()
+{
+    clear();
+}
+
+int RenderTargetPool::bucketed(int size)
+{
+    size = std::max(size, 1);
+    return (size + kBucketSize - 1) / kBucketSize * kBucketSize;
+}
+
+GLuint RenderTargetPool::createTexture(const RenderTargetDesc& desc)
+{
+    GLenum minFilter = desc.filter;
+    if (desc.levels > 1) {
+        minFilter = desc.filter == GL_LINEAR ? GL_LINEAR_MIPMAP_NEAREST : GL_NEAREST_MIPMAP_NEAREST;
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, desc.levels, desc.internalFormat, desc.width, desc.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, desc.levels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+GLuint RenderTargetPool::acquire(const RenderTargetDesc& desc)
+{
+    if (desc.width <= 0 || desc.height <= 0 || desc.levels <= 0) {
+        return 0;
+    }
+
+    for (Entry& entry : entries_) {
+        if (!entry.inUse && entry.desc == desc) {
+            entry.inUse = true;
+            return entry.texture;
+        }
+    }
+
+    Entry entry;
+    entry.texture = createTexture(desc);
+    entry.desc = desc;
+    entry.inUse = true;
+    entries_.push_back(entry);
+    return entry.texture;
+}
+
+void RenderTargetPool::release(GLuint texture)
+{
+    if (texture == 0) {
+        return;
+    }
+
+    for (Entry& entry : entries_) {
+        if (entry.texture == texture) {
+            entry.inUse = false;
+            entry.lastUsed = frame_;
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::endFrame()
+{
+    ++frame_;
+    eraseFree(kIdleFrames);
+}
+
+void RenderTargetPool::trim()
+{
+    eraseFree(0);
+}
+
+void RenderTargetPool::eraseFree(uint64_t idleFrames)
+{
+    auto idle = [&](const Entry& entry) {
+        return !entry.inUse && frame_ - entry.lastUsed >= idleFrames;
+    };
+    for (Entry& entry : entries_) {
+        if (idle(entry)) {
+            glDeleteTextures(1, &entry.texture);
+        }
+    }
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(), idle), entries_.end());
+}
+
+void RenderTargetPool::clear()
+{
+    for (Entry& entry : entries_) {
+        glDeleteTextures(1, &entry.texture);
+    }
+    entries_.clear();
+}
+
+size_t RenderTargetPool::allocatedBytes() const
+{
+    size_t bytes = 0;
+    for (const Entry& entry : entries_) {
+        for (int level = 0; level < entry.desc.levels; ++level) {
+            size_t w = static_cast<size_t>(std::max(entry.desc.width >> level, 1));
+            size_t h = static_cast<size_t>(std::max(entry.desc.height >> level, 1));
+            bytes += w * h * bytesPerTexel(entry.desc.internalFormat);
+        }
+    }
+    return bytes;
+}
+
+} // namespace kcShaders
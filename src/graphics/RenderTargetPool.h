@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace kcShaders {
+
+/**
+ * RenderTargetDesc: Format and size of a pooled 2D texture
+ *
+ * Textures are immutable (glTexStorage2D) with clamp-to-edge wrapping; a
+ * GL_NEAREST filter becomes GL_NEAREST_MIPMAP_NEAREST for mip chains.
+ */
+struct RenderTargetDesc {
+    GLenum internalFormat = GL_RGBA8;
+    int width = 0;
+    int height = 0;
+    int levels = 1;
+    GLenum filter = GL_NEAREST;
+
+    bool operator==(const RenderTargetDesc& other) const {
+        return internalFormat == other.internalFormat && width == other.width && height == other.height &&
+               levels == other.levels && filter == other.filter;
+    }
+    bool operator!=(const RenderTargetDesc& other) const { return !(*this == other); }
+};
+
+/**
+ * RenderTargetPool: Shared 2D render targets, reused by format and size
+ *
+ * Passes acquire their intermediate textures at the start of execute() and
+ * release them at the end, so targets whose lifetimes do not overlap (within
+ * a frame, or in pipelines that never run in the same frame) share one
+ * allocation. Targets that must outlive a pass (its output) are simply held
+ * until the size changes. Released textures that stay unused for
+ * kIdleFrames frames are deleted.
+ *
+ * Sizes are matched exactly; bucketed() rounds a size up for targets that
+ * are rendered through a sub-rect viewport (the renderer's output).
+ */
+class RenderTargetPool {
+public:
+    static constexpr int kBucketSize = 128;         // Granularity of bucketed sizes, in pixels
+    static constexpr uint64_t kIdleFrames = 120;    // Frames a released texture is kept for reuse
+
+    RenderTargetPool() = default;
+    ~RenderTargetPool();
+
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    /**
+     * @brief Round a size up to a multiple of kBucketSize
+     */
+    static int bucketed(int size);
+
+    /**
+     * @brief Get a free texture matching desc, creating one if there is none
+     * @return Texture name, owned by the pool until released
+     */
+    GLuint acquire(const RenderTargetDesc& desc);
+
+    /**
+     * @brief Return a texture for reuse; its contents are undefined afterwards
+     */
+    void release(GLuint texture);
+
+    /**
+     * @brief Advance the frame counter and delete textures idle for kIdleFrames
+     */
+    void endFrame();
+
+    /**
+     * @brief Delete every released texture now, e.g. once a resize has settled
+     */
+    void trim();
+
+    /**
+     * @brief Delete all textures, including acquired ones (needs a current GL context)
+     */
+    void clear();
+
+    size_t textureCount() const { return entries_.size(); }
+    size_t allocatedBytes() const;
+
+private:
+    struct Entry {
+        GLuint texture = 0;
+        RenderTargetDesc desc;
+        bool inUse = false;
+        uint64_t lastUsed = 0;   // Frame of the last release
+    };
+
+    static GLuint createTexture(const RenderTargetDesc& desc);
+    void eraseFree(uint64_t idleFrames);
+
+    std::vector<Entry> entries_;
+    uint64_t frame_ = 0;
+};
+
+} // namespace kcShaders
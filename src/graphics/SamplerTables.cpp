@@ -0,0 +1,178 @@
+#include "SamplerTables.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace kcShaders {
+
+namespace {
+
+// Primitive polynomial degree s, coefficients a and initial direction numbers m
+// for the dimensions after the first (new-joe-kuo-6.21201); dimension 1 is
+// van der Corput. The first two dimensions form a (0,2)-sequence.
+struct SobolPolynomial {
+    uint32_t s;
+    uint32_t a;
+    uint32_t m[3];
+};
+
+const SobolPolynomial kSobolPolynomials[SamplerTables::kSobolDimensions - 1] = {
+    {1, 0, {1, 0, 0}},
+};
+
+constexpr float kBlueNoiseSigma = 1.9f;
+
+// Energy of a binary pattern under a toroidal Gaussian filter, updated
+// incrementally as points are added and removed
+class EnergyField {
+public:
+    explicit EnergyField(int size)
+        : size_(size)
+        , kernel_(size * size)
+        , energy_(size * size, 0.0f)
+    {
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int dx = std::min(x, size - x);
+                int dy = std::min(y, size - y);
+                kernel_[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * kBlueNoiseSigma * kBlueNoiseSigma));
+            }
+        }
+    }
+
+    void splat(int index, float sign)
+    {
+        int px = index % size_;
+        int py = index / size_;
+        for (int y = 0; y < size_; y++) {
+            int ky = (y - py + size_) % size_;
+            for (int x = 0; x < size_; x++) {
+                int kx = (x - px + size_) % size_;
+                energy_[y * size_ + x] += sign * kernel_[ky * size_ + kx];
+            }
+        }
+    }
+
+    // Tightest cluster (value true) or largest void (value false)
+    int extreme(const std::vector<bool>& pattern, bool value) const
+    {
+        int best = -1;
+        for (int i = 0; i < static_cast<int>(pattern.size()); i++) {
+            if (pattern[i] != value) continue;
+            if (best < 0 || (value ? energy_[i] > energy_[best] : energy_[i] < energy_[best])) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+private:
+    int size_;
+    std::vector<float> kernel_;
+    std::vector<float> energy_;
+};
+
+} // namespace
+
+std::vector<uint32_t> SamplerTables::sobolMatrices()
+{
+    std::vector<uint32_t> matrices(kSobolDimensions * 32);
+
+    for (int bit = 0; bit < 32; bit++) {
+        matrices[bit] = 1u << (31 - bit);
+    }
+
+    for (int d = 1; d < kSobolDimensions; d++) {
+        const SobolPolynomial& poly = kSobolPolynomials[d - 1];
+        uint32_t* v = &matrices[d * 32];
+        for (uint32_t i = 0; i < 32; i++) {
+            if (i < poly.s) {
+                v[i] = poly.m[i] << (31 - i);
+                continue;
+            }
+            v[i] = v[i - poly.s] ^ (v[i - poly.s] >> poly.s);
+            for (uint32_t k = 1; k < poly.s; k++) {
+                if ((poly.a >> (poly.s - 1 - k)) & 1u) {
+                    v[i] ^= v[i - k];
+                }
+            }
+        }
+    }
+
+    return matrices;
+}
+
+std::vector<float> SamplerTables::blueNoise()
+{
+    const int size = kBlueNoiseSize;
+    const int count = size * size;
+
+    // Initial binary pattern: ~10% random points relaxed until stable
+    std::vector<bool> pattern(count, false);
+    EnergyField field(size);
+    std::mt19937 rng(1);
+    int ones = count / 10;
+    for (int placed = 0; placed < ones;) {
+        int index = static_cast<int>(rng() % count);
+        if (!pattern[index]) {
+            pattern[index] = true;
+            field.splat(index, 1.0f);
+            placed++;
+        }
+    }
+
+    for (int iteration = 0; iteration < count; iteration++) {
+        int cluster = field.extreme(pattern, true);
+        pattern[cluster] = false;
+        field.splat(cluster, -1.0f);
+
+        int gap = field.extreme(pattern, false);
+        pattern[gap] = true;
+        field.splat(gap, 1.0f);
+        if (gap == cluster) {
+            break;
+        }
+    }
+
+    std::vector<int> rank(count, 0);
+
+    // Phase 1: rank the initial points by removing tightest clusters
+    {
+        std::vector<bool> prototype = pattern;
+        EnergyField removal = field;
+        for (int r = ones - 1; r >= 0; r--) {
+            int cluster = removal.extreme(prototype, true);
+            prototype[cluster] = false;
+            removal.splat(cluster, -1.0f);
+            rank[cluster] = r;
+        }
+    }
+
+    // Phase 2/3: fill the largest voids until every pixel is ranked
+    for (int r = ones; r < count; r++) {
+        int gap = field.extreme(pattern, false);
+        pattern[gap] = true;
+        field.splat(gap, 1.0f);
+        rank[gap] = r;
+    }
+
+    std::vector<float> noise(count);
+    for (int i = 0; i < count; i++) {
+        noise[i] = (rank[i] + 0.5f) / count;
+    }
+    return noise;
+}
+
+std::vector<uint32_t> SamplerTables::pack()
+{
+    std::vector<uint32_t> sobol = sobolMatrices();
+    std::vector<float> noise = blueNoise();
+
+    std::vector<uint32_t> data(sobol.size() + noise.size());
+    std::copy(sobol.begin(), sobol.end(), data.begin());
+    std::memcpy(data.data() + sobol.size(), noise.data(), noise.size() * sizeof(float));
+    return data;
+}
+
+} // namespace kcShaders
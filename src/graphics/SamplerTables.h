@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace kcShaders {
+
+/**
+ * SamplerTables: Precomputed data for the ray tracer's sampler (sampler.glsl)
+ *
+ * Uploaded once as a single SSBO: the Sobol generator matrices followed by a
+ * tileable blue noise mask. Layout must match the SamplerTables block in
+ * sampler.glsl.
+ */
+class SamplerTables {
+public:
+    static constexpr int kSobolDimensions = 2;
+    static constexpr int kBlueNoiseSize = 64;
+
+    /**
+     * Sobol direction numbers, 32 per dimension (Joe & Kuo primitive
+     * polynomials). Point i of dimension d is the XOR of the entries of d
+     * selected by the set bits of i.
+     */
+    static std::vector<uint32_t> sobolMatrices();
+
+    /**
+     * Blue noise ranks built with Ulichney's void-and-cluster method,
+     * normalized to (0, 1), row-major, tiles seamlessly
+     */
+    static std::vector<float> blueNoise();
+
+    /** Both tables packed in the SSBO layout */
+    static std::vector<uint32_t> pack();
+};
+
+} // namespace kcShaders
@@ -0,0 +1,591 @@
+#include "ShaderCompileService.h"
+#include "ShaderProgram.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unordered_set>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile (not part of the glad profile)
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+namespace kcShaders {
+
+namespace {
+
+// How long the watcher waits for a notification before looking at watch list
+// changes again; only the polling fallback scans the files this often
+constexpr int kPollIntervalMs = 250;
+
+// Editors often save in several steps (truncate, write, rename), wait for the
+// burst of notifications to settle before reading the files
+constexpr int kSettleMs = 50;
+
+std::vector<std::string> watchedDirectories(const std::vector<std::vector<std::string>>& programs)
+{
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> dirs;
+    for (const auto& files : programs) {
+        for (const auto& file : files) {
+            std::string dir = std::filesystem::path(file).parent_path().string();
+            if (dir.empty()) {
+                dir = ".";
+            }
+            if (seen.insert(dir).second) {
+                dirs.push_back(dir);
+            }
+        }
+    }
+    return dirs;
+}
+
+} // namespace
+
+ShaderCompileService::ShaderCompileService()
+{
+}
+
+ShaderCompileService::~ShaderCompileService()
+{
+    shutdown();
+}
+
+bool ShaderCompileService::initialize()
+{
+    // Let the driver compile and link on its own threads when supported
+    GLint numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    const char* threadsEntryPoint = nullptr;
+    for (GLint i = 0; i < numExtensions; ++i) {
+        const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (!name) continue;
+        if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0) {
+            threadsEntryPoint = "glMaxShaderCompilerThreadsKHR";
+            break;
+        }
+        if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0) {
+            threadsEntryPoint = "glMaxShaderCompilerThreadsARB";
+        }
+    }
+
+    if (threadsEntryPoint) {
+        auto maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+            glfwGetProcAddress(threadsEntryPoint));
+        if (maxShaderCompilerThreads) {
+            // 0xFFFFFFFF lets the implementation pick the thread count
+            maxShaderCompilerThreads(0xFFFFFFFFu);
+        }
+        parallelCompile_ = true;
+    }
+    std::cout << "[ShaderCompileService] Parallel shader compile: "
+              << (parallelCompile_ ? "enabled" : "not supported") << "\n";
+
+#if defined(__linux__)
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        std::cerr << "[ShaderCompileService] inotify unavailable, falling back to polling\n";
+    }
+#endif
+
+    running_ = true;
+    worker_ = std::thread(&ShaderCompileService::workerLoop, this);
+    return true;
+}
+
+void ShaderCompileService::shutdown()
+{
+    if (running_) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        wake_.notify_all();
+    }
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+
+#if defined(__linux__)
+    if (inotifyFd_ >= 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+    dirWatches_.clear();
+#elif defined(_WIN32)
+    for (auto& entry : dirHandles_) {
+        FindCloseChangeNotification(static_cast<HANDLE>(entry.second));
+    }
+    dirHandles_.clear();
+#endif
+
+    for (auto& pending : pending_) {
+        deletePending(pending);
+    }
+    pending_.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.clear();
+    watches_.clear();
+}
+
+void ShaderCompileService::watch(const std::string& key,
+                                 std::vector<ShaderStageFile> stages,
+                                 LinkedCallback onLinked,
+                                 SourceTransform transform,
+                                 PermutationList permutations)
+{
+    // Expand once up front to learn which include files to watch
+    Watch entry;
+    ShaderSources sources;
+    if (!expandStages(stages, nullptr, sources, entry.files)) {
+        entry.files.clear();
+        for (const auto& stage : stages) {
+            entry.files.push_back(stage.path);
+        }
+    }
+    for (const auto& file : entry.files) {
+        entry.modTimes.push_back(modTime(file));
+    }
+    entry.stages = std::move(stages);
+    entry.onLinked = std::move(onLinked);
+    entry.transform = std::move(transform);
+    entry.permutations = std::move(permutations);
+
+    // Replacing an entry resets latestSerial, so results still in flight for
+    // the previous registration are dropped when they complete
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        watches_[key] = std::move(entry);
+        watchesChanged_ = true;
+    }
+    wake_.notify_all();
+}
+
+void ShaderCompileService::watch(const std::string& key,
+                                 std::vector<ShaderStageFile> stages,
+                                 std::unique_ptr<ShaderProgram>& target,
+                                 SourceTransform transform)
+{
+    watch(
+        key,
+        std::move(stages),
+        [&target](GLuint program, const std::string& permutation, const ShaderSources& sources) {
+            if (target) {
+                target->adoptProgram(program, permutation, &sources);
+            } else {
+                glDeleteProgram(program);
+            }
+        },
+        std::move(transform),
+        [&target]() {
+            return target ? target->permutationKeys() : std::vector<std::string>();
+        }
+    );
+}
+
+void ShaderCompileService::unwatch(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    watches_.erase(key);
+    watchesChanged_ = true;
+}
+
+void ShaderCompileService::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    watches_.clear();
+    watchesChanged_ = true;
+}
+
+void ShaderCompileService::update()
+{
+    std::vector<PreparedProgram> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready.swap(ready_);
+    }
+
+    // Hand over finished programs, the rest are checked again next frame.
+    // Programs submitted below are first looked at by the next update(): without
+    // parallel compile there is no completion query, and asking for the link
+    // status in the call that submitted them would block on the link
+    for (size_t i = 0; i < pending_.size();) {
+        if (!isComplete(pending_[i])) {
+            ++i;
+            continue;
+        }
+        finish(pending_[i]);
+        pending_.erase(pending_.begin() + i);
+    }
+
+    for (auto& prepared : ready) {
+        submit(prepared);
+    }
+}
+
+void ShaderCompileService::workerLoop()
+{
+    while (running_) {
+        bool changed = waitForChanges();
+        if (!running_) {
+            break;
+        }
+        if (changed) {
+            scanForChanges();
+        }
+    }
+}
+
+bool ShaderCompileService::waitForChanges()
+{
+    bool syncDirectories = false;
+    std::vector<std::vector<std::string>> programs;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (watchesChanged_) {
+            watchesChanged_ = false;
+            syncDirectories = true;
+            for (const auto& entry : watches_) {
+                programs.push_back(entry.second.files);
+            }
+        }
+    }
+
+#if defined(__linux__)
+    if (inotifyFd_ >= 0) {
+        if (syncDirectories) {
+            std::vector<std::string> dirs = watchedDirectories(programs);
+            std::unordered_set<std::string> wanted(dirs.begin(), dirs.end());
+            for (auto it = dirWatches_.begin(); it != dirWatches_.end();) {
+                if (wanted.count(it->first) == 0) {
+                    inotify_rm_watch(inotifyFd_, it->second);
+                    it = dirWatches_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            for (const auto& dir : dirs) {
+                if (dirWatches_.count(dir) != 0) continue;
+                int wd = inotify_add_watch(inotifyFd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd < 0) {
+                    std::cerr << "[ShaderCompileService] Failed to watch directory: " << dir << "\n";
+                    continue;
+                }
+                dirWatches_[dir] = wd;
+            }
+        }
+
+        // Events only say that something changed, the scan below works out what
+        char buffer[4096];
+        pollfd pfd{inotifyFd_, POLLIN, 0};
+        if (poll(&pfd, 1, kPollIntervalMs) <= 0) {
+            return false;
+        }
+        do {
+            while (read(inotifyFd_, buffer, sizeof(buffer)) > 0) {}
+        } while (poll(&pfd, 1, kSettleMs) > 0);
+        return true;
+    }
+#elif defined(_WIN32)
+    if (syncDirectories) {
+        std::vector<std::string> dirs = watchedDirectories(programs);
+        std::unordered_set<std::string> wanted(dirs.begin(), dirs.end());
+        for (auto it = dirHandles_.begin(); it != dirHandles_.end();) {
+            if (wanted.count(it->first) == 0) {
+                FindCloseChangeNotification(static_cast<HANDLE>(it->second));
+                it = dirHandles_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (const auto& dir : dirs) {
+            if (dirHandles_.count(dir) != 0) continue;
+            HANDLE handle = FindFirstChangeNotificationA(
+                dir.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+            if (handle == INVALID_HANDLE_VALUE) {
+                std::cerr << "[ShaderCompileService] Failed to watch directory: " << dir << "\n";
+                continue;
+            }
+            dirHandles_[dir] = handle;
+        }
+    }
+
+    if (!dirHandles_.empty() && dirHandles_.size() <= MAXIMUM_WAIT_OBJECTS) {
+        std::vector<HANDLE> handles;
+        for (const auto& entry : dirHandles_) {
+            handles.push_back(static_cast<HANDLE>(entry.second));
+        }
+
+        DWORD count = static_cast<DWORD>(handles.size());
+        DWORD result = WaitForMultipleObjects(count, handles.data(), FALSE, kPollIntervalMs);
+        if (result >= WAIT_OBJECT_0 + count) {
+            return false;
+        }
+        do {
+            FindNextChangeNotification(handles[result - WAIT_OBJECT_0]);
+            result = WaitForMultipleObjects(count, handles.data(), FALSE, kSettleMs);
+        } while (result < WAIT_OBJECT_0 + count);
+        return true;
+    }
+#endif
+
+    // No notification mechanism, fall back to polling modification times
+    (void)syncDirectories;
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait_for(lock, std::chrono::milliseconds(kPollIntervalMs), [this] { return !running_; });
+    return true;
+}
+
+void ShaderCompileService::scanForChanges()
+{
+    struct Candidate {
+        std::string key;
+        std::vector<ShaderStageFile> stages;
+        std::vector<std::string> files;
+        std::vector<std::filesystem::file_time_type> modTimes;
+        SourceTransform transform;
+    };
+
+    // Snapshot under the lock, touch the file system outside of it
+    std::vector<Candidate> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& entry : watches_) {
+            candidates.push_back({entry.first, entry.second.stages, entry.second.files,
+                                  entry.second.modTimes, entry.second.transform});
+        }
+    }
+
+    bool filesChanged = false;
+    for (auto& candidate : candidates) {
+        bool changed = false;
+        for (size_t i = 0; i < candidate.files.size(); ++i) {
+            auto time = modTime(candidate.files[i]);
+            if (time != std::filesystem::file_time_type::min() && time != candidate.modTimes[i]) {
+                changed = true;
+                break;
+            }
+        }
+        if (!changed) {
+            continue;
+        }
+
+        // Probably mid-save if this fails, the next notification retries
+        auto sources = std::make_shared<ShaderSources>();
+        std::vector<std::string> files;
+        if (!expandStages(candidate.stages, candidate.transform, *sources, files)) {
+            continue;
+        }
+
+        // The include set may have changed with the edit
+        std::vector<std::filesystem::file_time_type> modTimes;
+        for (const auto& file : files) {
+            modTimes.push_back(modTime(file));
+        }
+
+        PreparedProgram prepared;
+        prepared.key = candidate.key;
+        prepared.sources = std::move(sources);
+        for (const auto& stage : candidate.stages) {
+            prepared.labels.push_back(stage.path);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = watches_.find(candidate.key);
+        if (it == watches_.end() || it->second.modTimes != candidate.modTimes) {
+            continue;  // Re-watched or removed while reading
+        }
+        filesChanged = filesChanged || it->second.files != files;
+        it->second.files = std::move(files);
+        it->second.modTimes = std::move(modTimes);
+        prepared.serial = nextSerial_++;
+        it->second.latestSerial = prepared.serial;
+        ready_.push_back(std::move(prepared));
+    }
+
+    if (filesChanged) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        watchesChanged_ = true;
+    }
+}
+
+void ShaderCompileService::submit(PreparedProgram& prepared)
+{
+    PermutationList permutations;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = watches_.find(prepared.key);
+        if (it == watches_.end() || it->second.latestSerial != prepared.serial) {
+            return;  // Superseded before it was submitted
+        }
+        permutations = it->second.permutations;
+    }
+
+    std::vector<std::string> keys;
+    if (permutations) {
+        keys = permutations();
+    }
+    if (keys.empty()) {
+        keys.push_back("");
+    }
+
+    std::cout << "[ShaderCompileService] Shader file changed, recompiling " << prepared.key;
+    if (keys.size() > 1) {
+        std::cout << " (" << keys.size() << " permutations)";
+    }
+    std::cout << "\n";
+
+    auto labels = std::make_shared<std::vector<std::string>>(std::move(prepared.labels));
+    for (const auto& permutation : keys) {
+        PendingProgram pending;
+        pending.key = prepared.key;
+        pending.serial = prepared.serial;
+        pending.permutation = permutation;
+        pending.program = glCreateProgram();
+        pending.sources = prepared.sources;
+        pending.labels = labels;
+
+        for (const auto& stage : *prepared.sources) {
+            std::string source = ShaderPreprocessor::injectDefines(stage.second, permutation);
+            const char* sourcePtr = source.c_str();
+            GLuint shader = glCreateShader(stage.first);
+            glShaderSource(shader, 1, &sourcePtr, nullptr);
+            glCompileShader(shader);
+            glAttachShader(pending.program, shader);
+            pending.shaders.push_back(shader);
+        }
+
+        // No status query here: that would block until the driver is done, which
+        // is exactly what the parallel compile path avoids
+        glLinkProgram(pending.program);
+        pending_.push_back(std::move(pending));
+    }
+}
+
+bool ShaderCompileService::isComplete(const PendingProgram& pending) const
+{
+    if (!parallelCompile_) {
+        return true;
+    }
+
+    GLint done = GL_FALSE;
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+void ShaderCompileService::finish(PendingProgram& pending)
+{
+    LinkedCallback onLinked;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = watches_.find(pending.key);
+        if (it != watches_.end() && it->second.latestSerial == pending.serial) {
+            onLinked = it->second.onLinked;
+        }
+    }
+
+    // Superseded by a newer edit or no longer watched
+    if (!onLinked) {
+        deletePending(pending);
+        return;
+    }
+
+    GLint success = GL_FALSE;
+    glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        for (size_t i = 0; i < pending.shaders.size(); ++i) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(pending.shaders[i], GL_COMPILE_STATUS, &compiled);
+            if (!compiled) {
+                glGetShaderInfoLog(pending.shaders[i], 512, nullptr, infoLog);
+                std::cerr << "Shader compilation failed (" << (*pending.labels)[i] << "):\n" << infoLog << std::endl;
+            }
+        }
+        glGetProgramInfoLog(pending.program, 512, nullptr, infoLog);
+        std::cerr << "Shader program linking failed:\n" << infoLog << std::endl;
+        std::cerr << "[ShaderCompileService] Keeping previous program for " << pending.key << "\n";
+        deletePending(pending);
+        return;
+    }
+
+    for (GLuint shader : pending.shaders) {
+        glDetachShader(pending.program, shader);
+        glDeleteShader(shader);
+    }
+    pending.shaders.clear();
+
+    GLuint program = pending.program;
+    pending.program = 0;
+    onLinked(program, pending.permutation, *pending.sources);
+    std::cout << "[ShaderCompileService] " << pending.key << " reloaded successfully\n";
+}
+
+void ShaderCompileService::deletePending(PendingProgram& pending)
+{
+    for (GLuint shader : pending.shaders) {
+        glDeleteShader(shader);
+    }
+    pending.shaders.clear();
+
+    if (pending.program != 0) {
+        glDeleteProgram(pending.program);
+        pending.program = 0;
+    }
+}
+
+bool ShaderCompileService::expandStages(const std::vector<ShaderStageFile>& stages, const SourceTransform& transform,
+                                        ShaderSources& sources, std::vector<std::string>& files)
+{
+    sources.clear();
+    files.clear();
+    for (const auto& stage : stages) {
+        std::string source;
+        std::vector<std::string> stageFiles;
+        if (!ShaderPreprocessor::expandIncludes(stage.path, source, &stageFiles)) {
+            return false;
+        }
+        if (transform) {
+            source = transform(stage.type, source);
+        }
+        sources.emplace_back(stage.type, std::move(source));
+        files.insert(files.end(), stageFiles.begin(), stageFiles.end());
+    }
+
+    // Shared includes only need one watch entry
+    std::unordered_set<std::string> seen;
+    files.erase(std::remove_if(files.begin(), files.end(),
+                               [&seen](const std::string& file) { return !seen.insert(file).second; }),
+                files.end());
+    return true;
+}
+
+std::filesystem::file_time_type ShaderCompileService::modTime(const std::string& path)
+{
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type::min() : time;
+}
+
+} // namespace kcShaders
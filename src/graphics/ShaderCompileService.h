@@ -0,0 +1,189 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "ShaderPreprocessor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace kcShaders {
+
+class ShaderProgram;
+
+/**
+ * @brief One stage of a watched shader program
+ */
+struct ShaderStageFile {
+    GLenum type;       // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER, ...
+    std::string path;
+};
+
+/**
+ * @brief Background shader hot-reload service
+ *
+ * A worker thread waits for file system notifications (inotify on Linux,
+ * change notifications on Windows, mtime polling elsewhere), re-reads and
+ * preprocesses the changed sources off the render thread and queues them.
+ * Files pulled in through #include are watched along with the stage files.
+ * update() then submits the queued programs to the driver without querying
+ * their status and looks at them again from the next update() on; with
+ * GL_KHR_parallel_shader_compile the driver compiles them on its own threads
+ * and the program is only handed over once GL_COMPLETION_STATUS_KHR reports
+ * completion. File timestamps are only scanned after a notification, or
+ * periodically on the polling fallback. The old program stays live
+ * until the new one has linked successfully, so a broken edit never stalls
+ * or blanks a frame.
+ *
+ * All GL calls happen inside update(), which must run on the thread that owns
+ * the context.
+ */
+class ShaderCompileService {
+public:
+    /** Called on the worker thread for every stage source before submission */
+    using SourceTransform = std::function<std::string(GLenum type, const std::string& source)>;
+
+    /**
+     * Receives ownership of a freshly linked program (render thread), together
+     * with the permutation it was built for and the expanded stage sources
+     */
+    using LinkedCallback = std::function<void(GLuint program, const std::string& permutation,
+                                              const ShaderSources& sources)>;
+
+    /** Permutation keys to rebuild on change, queried on the render thread */
+    using PermutationList = std::function<std::vector<std::string>()>;
+
+    ShaderCompileService();
+    ~ShaderCompileService();
+
+    // Non-copyable
+    ShaderCompileService(const ShaderCompileService&) = delete;
+    ShaderCompileService& operator=(const ShaderCompileService&) = delete;
+
+    /**
+     * @brief Enable driver-side parallel compilation and start the watcher thread
+     * @return true if the watcher thread is running
+     */
+    bool initialize();
+
+    /**
+     * @brief Stop the watcher and delete programs still being compiled
+     */
+    void shutdown();
+
+    /**
+     * @brief Watch the files of a program and rebuild it whenever one changes
+     * @param key Unique name, re-watching an existing key replaces it
+     * @param stages Shader stages making up the program
+     * @param onLinked Receives the new program after a successful link
+     * @param transform Optional source rewrite applied before compilation
+     * @param permutations Define blocks to build, defaults to the plain program
+     */
+    void watch(const std::string& key,
+               std::vector<ShaderStageFile> stages,
+               LinkedCallback onLinked,
+               SourceTransform transform = nullptr,
+               PermutationList permutations = nullptr);
+
+    /**
+     * @brief Watch the files of a ShaderProgram and rebuild all of its cached
+     *        permutations in place; nothing is adopted while target is empty
+     */
+    void watch(const std::string& key,
+               std::vector<ShaderStageFile> stages,
+               std::unique_ptr<ShaderProgram>& target,
+               SourceTransform transform = nullptr);
+
+    /**
+     * @brief Stop watching a program, pending results for it are dropped
+     */
+    void unwatch(const std::string& key);
+
+    /**
+     * @brief Stop watching every program
+     */
+    void clear();
+
+    /**
+     * @brief Submit queued sources and hand over finished programs (render thread)
+     */
+    void update();
+
+    /**
+     * @brief Whether GL_KHR/ARB_parallel_shader_compile is available
+     */
+    bool hasParallelCompile() const { return parallelCompile_; }
+
+private:
+    struct Watch {
+        std::vector<ShaderStageFile> stages;
+        std::vector<std::string> files;  // Stage files and their includes
+        std::vector<std::filesystem::file_time_type> modTimes;
+        LinkedCallback onLinked;
+        SourceTransform transform;
+        PermutationList permutations;
+        uint64_t latestSerial = 0;
+    };
+
+    // Sources read and transformed by the worker, waiting for submission
+    struct PreparedProgram {
+        std::string key;
+        uint64_t serial;
+        std::shared_ptr<ShaderSources> sources;
+        std::vector<std::string> labels;
+    };
+
+    // Program submitted to the driver, waiting for completion
+    struct PendingProgram {
+        std::string key;
+        uint64_t serial;
+        std::string permutation;
+        GLuint program;
+        std::vector<GLuint> shaders;
+        std::shared_ptr<ShaderSources> sources;
+        std::shared_ptr<std::vector<std::string>> labels;
+    };
+
+    void workerLoop();
+    bool waitForChanges();  // false if no notification arrived, nothing to scan
+    void scanForChanges();
+    void submit(PreparedProgram& prepared);
+    bool isComplete(const PendingProgram& pending) const;
+    void finish(PendingProgram& pending);
+    void deletePending(PendingProgram& pending);
+
+    static bool expandStages(const std::vector<ShaderStageFile>& stages, const SourceTransform& transform,
+                             ShaderSources& sources, std::vector<std::string>& files);
+    static std::filesystem::file_time_type modTime(const std::string& path);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::unordered_map<std::string, Watch> watches_;
+    std::vector<PreparedProgram> ready_;
+    uint64_t nextSerial_ = 1;
+    bool watchesChanged_ = false;
+
+    // Render thread only
+    std::vector<PendingProgram> pending_;
+    bool parallelCompile_ = false;
+
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+#if defined(__linux__)
+    int inotifyFd_ = -1;
+    std::unordered_map<std::string, int> dirWatches_;
+#elif defined(_WIN32)
+    std::unordered_map<std::string, void*> dirHandles_;
+#endif
+};
+
+} // namespace kcShaders
@@ -0,0 +1,182 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+namespace kcShaders {
+
+namespace {
+
+// Guards against include cycles through differently spelled paths
+constexpr int kMaxIncludeDepth = 32;
+
+struct IncludeState {
+    std::vector<std::string> files;
+    std::unordered_set<std::string> included;
+};
+
+bool readFile(const std::string& path, std::string& out)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+std::string normalizePath(const std::filesystem::path& path)
+{
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path.lexically_normal().string() : canonical.string();
+}
+
+// Parse `#include "name"` (or <name>), returns false for any other line
+bool parseInclude(const std::string& line, std::string& name)
+{
+    size_t pos = line.find_first_not_of(" \t");
+    if (pos == std::string::npos || line.compare(pos, 8, "#include") != 0) {
+        return false;
+    }
+
+    size_t open = line.find_first_of("\"<", pos + 8);
+    if (open == std::string::npos) {
+        return false;
+    }
+
+    char closeChar = line[open] == '"' ? '"' : '>';
+    size_t close = line.find(closeChar, open + 1);
+    if (close == std::string::npos) {
+        return false;
+    }
+
+    name = line.substr(open + 1, close - open - 1);
+    return true;
+}
+
+bool expand(const std::string& source, const std::filesystem::path& baseDir, int fileIndex,
+            IncludeState& state, std::string& out, int depth)
+{
+    if (depth > kMaxIncludeDepth) {
+        std::cerr << "[ShaderPreprocessor] Include depth limit reached in " << state.files[fileIndex] << "\n";
+        return false;
+    }
+
+    std::istringstream stream(source);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(stream, line)) {
+        ++lineNumber;
+
+        std::string name;
+        if (!parseInclude(line, name)) {
+            out += line;
+            out += '\n';
+            continue;
+        }
+
+        std::filesystem::path includePath = baseDir / name;
+        if (state.included.insert(normalizePath(includePath)).second) {
+            std::string includeSource;
+            if (!readFile(includePath.string(), includeSource)) {
+                std::cerr << "[ShaderPreprocessor] Failed to open include: " << includePath.string()
+                          << " (" << state.files[fileIndex] << ":" << lineNumber << ")\n";
+                return false;
+            }
+
+            int includeIndex = static_cast<int>(state.files.size());
+            state.files.push_back(includePath.string());
+            out += "#line 1 " + std::to_string(includeIndex) + "\n";
+            if (!expand(includeSource, includePath.parent_path(), includeIndex, state, out, depth + 1)) {
+                return false;
+            }
+        }
+
+        // Resume the including file's numbering
+        out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool ShaderPreprocessor::expandIncludes(const std::string& path, std::string& out, std::vector<std::string>* files)
+{
+    std::string source;
+    if (!readFile(path, source)) {
+        std::cerr << "Failed to open shader file: " << path << std::endl;
+        return false;
+    }
+
+    IncludeState state;
+    state.files.push_back(path);
+    state.included.insert(normalizePath(path));
+
+    out.clear();
+    bool success = expand(source, std::filesystem::path(path).parent_path(), 0, state, out, 0);
+    if (files) {
+        *files = std::move(state.files);
+    }
+    return success;
+}
+
+bool ShaderPreprocessor::expandIncludesFromSource(const std::string& source, const std::string& baseDir,
+                                                  std::string& out, std::vector<std::string>* files)
+{
+    IncludeState state;
+    state.files.push_back("<source>");
+
+    out.clear();
+    bool success = expand(source, baseDir, 0, state, out, 0);
+    if (files) {
+        *files = std::move(state.files);
+    }
+    return success;
+}
+
+std::string ShaderPreprocessor::permutationKey(const ShaderDefines& defines)
+{
+    std::string key;
+    for (const auto& define : defines) {
+        key += "#define " + define.first;
+        if (!define.second.empty()) {
+            key += " " + define.second;
+        }
+        key += "\n";
+    }
+    return key;
+}
+
+std::string ShaderPreprocessor::injectDefines(const std::string& source, const std::string& defineBlock)
+{
+    if (defineBlock.empty()) {
+        return source;
+    }
+
+    // Defines must follow #version, which has to stay the first statement
+    size_t versionPos = source.find("#version");
+    if (versionPos == std::string::npos) {
+        return defineBlock + "#line 1 0\n" + source;
+    }
+
+    size_t lineEnd = source.find('\n', versionPos);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + defineBlock;
+    }
+
+    int nextLine = static_cast<int>(std::count(source.begin(), source.begin() + lineEnd, '\n')) + 2;
+    return source.substr(0, lineEnd + 1) + defineBlock +
+           "#line " + std::to_string(nextLine) + " 0\n" +
+           source.substr(lineEnd + 1);
+}
+
+} // namespace kcShaders
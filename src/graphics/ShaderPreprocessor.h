@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kcShaders {
+
+/** Preprocessor defines injected into a shader, e.g. {"USE_SSAO", "1"} */
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+/** Per-stage sources of one program, after include expansion */
+using ShaderSources = std::vector<std::pair<GLenum, std::string>>;
+
+/**
+ * ShaderPreprocessor: #include expansion and #define injection for GLSL
+ *
+ * `#include "file"` is resolved relative to the including file and every file
+ * is pasted at most once per stage, so shared headers need no include guards.
+ * `#line` directives keep compiler messages pointing at the original line;
+ * their source-string number is the index into the returned file list.
+ */
+class ShaderPreprocessor {
+public:
+    /**
+     * Read a shader file and expand its includes
+     * @param files Receives every file that contributed, the root file first
+     */
+    static bool expandIncludes(const std::string& path, std::string& out,
+                               std::vector<std::string>* files = nullptr);
+
+    /**
+     * Expand the includes of in-memory source
+     * @param baseDir Directory relative includes are resolved against
+     */
+    static bool expandIncludesFromSource(const std::string& source, const std::string& baseDir,
+                                         std::string& out, std::vector<std::string>* files = nullptr);
+
+    /**
+     * Build the block of #define lines for a permutation; it doubles as the
+     * cache key, so callers should list defines in a stable order
+     */
+    static std::string permutationKey(const ShaderDefines& defines);
+
+    /**
+     * Insert a define block right after the #version line
+     */
+    static std::string injectDefines(const std::string& source, const std::string& defineBlock);
+};
+
+} // namespace kcShaders
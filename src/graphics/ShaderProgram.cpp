@@ -1,97 +1,184 @@
 #include "ShaderProgram.h"
-#include <fstream>
-#include <sstream>
+#include "PerfCounters.h"
 #include <iostream>
+#include <tuple>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace kcShaders {
 
 ShaderProgram::~ShaderProgram() {
-    if (program_ != 0) {
-        glDeleteProgram(program_);
-    }
+    deletePermutations();
 }
 
 bool ShaderProgram::loadFromFiles(const std::string& vertPath, const std::string& fragPath, const std::string& geomPath) {
-    GLuint vertShader = 0, fragShader = 0, geomShader = 0;
+    ShaderSources sources;
+    std::vector<std::string> labels;
     
-    if (!compileShader(vertShader, GL_VERTEX_SHADER, vertPath)) {
-        return false;
-    }
+    const std::pair<GLenum, const std::string*> stages[] = {
+        {GL_VERTEX_SHADER, &vertPath},
+        {GL_FRAGMENT_SHADER, &fragPath},
+        {GL_GEOMETRY_SHADER, &geomPath}
+    };
     
-    if (!compileShader(fragShader, GL_FRAGMENT_SHADER, fragPath)) {
-        glDeleteShader(vertShader);
-        return false;
+    for (const auto& stage : stages) {
+        if (stage.second->empty()) {
+            if (stage.first == GL_GEOMETRY_SHADER) continue;  // Optional stage
+            std::cerr << "Failed to open shader file: (empty path)" << std::endl;
+            return false;
+        }
+        
+        std::string source;
+        if (!ShaderPreprocessor::expandIncludes(*stage.second, source)) {
+            return false;
+        }
+        sources.emplace_back(stage.first, std::move(source));
+        labels.push_back(*stage.second);
     }
     
-    if (!geomPath.empty()) {
-        if (!compileShader(geomShader, GL_GEOMETRY_SHADER, geomPath)) {
-            glDeleteShader(vertShader);
-            glDeleteShader(fragShader);
+    return loadSources(std::move(sources), std::move(labels));
+}
+
+bool ShaderProgram::loadFromSource(const std::string& vertSource, const std::string& fragSource, const std::string& geomSource) {
+    ShaderSources sources;
+    std::vector<std::string> labels;
+    
+    const std::tuple<GLenum, const std::string*, const char*> stages[] = {
+        {GL_VERTEX_SHADER, &vertSource, "vertex"},
+        {GL_FRAGMENT_SHADER, &fragSource, "fragment"},
+        {GL_GEOMETRY_SHADER, &geomSource, "geometry"}
+    };
+    
+    for (const auto& stage : stages) {
+        if (std::get<0>(stage) == GL_GEOMETRY_SHADER && std::get<1>(stage)->empty()) {
+            continue;
+        }
+        
+        // In-memory sources resolve includes against the working directory
+        std::string source;
+        if (!ShaderPreprocessor::expandIncludesFromSource(*std::get<1>(stage), "", source)) {
             return false;
         }
+        sources.emplace_back(std::get<0>(stage), std::move(source));
+        labels.push_back(std::get<2>(stage));
+    }
+    
+    return loadSources(std::move(sources), std::move(labels));
+}
+
+bool ShaderProgram::loadComputeFromFile(const std::string& path) {
+    std::string source;
+    if (!ShaderPreprocessor::expandIncludes(path, source)) {
+        return false;
     }
     
-    bool success = linkProgram(vertShader, fragShader, geomShader);
+    ShaderSources sources;
+    sources.emplace_back(GL_COMPUTE_SHADER, std::move(source));
+    return loadSources(std::move(sources), {path});
+}
+
+GLuint ShaderProgram::loadComputeProgram(const std::string& path, const std::string& defineBlock) {
+    std::string source;
+    if (!ShaderPreprocessor::expandIncludes(path, source)) {
+        return 0;
+    }
     
-    glDeleteShader(vertShader);
-    glDeleteShader(fragShader);
-    if (geomShader != 0) {
-        glDeleteShader(geomShader);
+    GLuint shader = 0;
+    if (!compileShaderFromSource(shader, GL_COMPUTE_SHADER, ShaderPreprocessor::injectDefines(source, defineBlock), path)) {
+        return 0;
     }
     
-    return success;
+    GLuint program = linkProgram({shader});
+    glDeleteShader(shader);
+    return program;
 }
 
-bool ShaderProgram::loadFromSource(const std::string& vertSource, const std::string& fragSource, const std::string& geomSource) {
-    GLuint vertShader = 0, fragShader = 0, geomShader = 0;
+void ShaderProgram::adoptProgram(GLuint program, const std::string& permutation, const ShaderSources* sources) {
+    if (sources) {
+        sources_ = *sources;
+        
+        // Variants that failed against the old code get another chance
+        for (auto it = permutations_.begin(); it != permutations_.end();) {
+            if (it->second.program == 0 && &it->second != current_) {
+                it = permutations_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
     
-    if (!compileShaderFromSource(vertShader, GL_VERTEX_SHADER, vertSource, "vertex")) {
-        return false;
+    Permutation& target = permutations_[permutation];
+    if (target.program != 0) {
+        glDeleteProgram(target.program);
     }
+    target.program = program;
+    target.locationCache.clear();
     
-    if (!compileShaderFromSource(fragShader, GL_FRAGMENT_SHADER, fragSource, "fragment")) {
-        glDeleteShader(vertShader);
-        return false;
+    if (!current_) {
+        current_ = &target;
     }
+}
+
+void ShaderProgram::use() const {
+    glUseProgram(id());
+    PerfCounters::add(PerfCounter::StateChanges);
+}
+
+bool ShaderProgram::usePermutation(const ShaderDefines& defines) {
+    std::string key = ShaderPreprocessor::permutationKey(defines);
     
-    if (!geomSource.empty()) {
-        if (!compileShaderFromSource(geomShader, GL_GEOMETRY_SHADER, geomSource, "geometry")) {
-            glDeleteShader(vertShader);
-            glDeleteShader(fragShader);
-            return false;
+    auto it = permutations_.find(key);
+    if (it == permutations_.end()) {
+        // First use: compile now and cache, failures included so they are not retried every frame
+        Permutation permutation;
+        if (!sources_.empty()) {
+            permutation.program = buildProgram(sources_, labels_, key);
         }
+        it = permutations_.emplace(key, std::move(permutation)).first;
     }
     
-    bool success = linkProgram(vertShader, fragShader, geomShader);
-    
-    glDeleteShader(vertShader);
-    glDeleteShader(fragShader);
-    if (geomShader != 0) {
-        glDeleteShader(geomShader);
+    if (it->second.program == 0) {
+        auto fallback = permutations_.find("");
+        current_ = fallback != permutations_.end() ? &fallback->second : nullptr;
+        use();
+        return false;
     }
     
-    return success;
+    current_ = &it->second;
+    use();
+    return true;
 }
 
-void ShaderProgram::use() const {
-    glUseProgram(program_);
+std::vector<std::string> ShaderProgram::permutationKeys() const {
+    std::vector<std::string> keys;
+    for (const auto& entry : permutations_) {
+        if (entry.second.program != 0) {
+            keys.push_back(entry.first);
+        }
+    }
+    return keys;
 }
 
 GLint ShaderProgram::uniformLocation(const std::string& name) {
-    auto it = locationCache_.find(name);
-    if (it != locationCache_.end()) {
+    if (!current_) {
+        return -1;
+    }
+    
+    auto it = current_->locationCache.find(name);
+    if (it != current_->locationCache.end()) {
         return it->second;
     }
     
-    GLint loc = glGetUniformLocation(program_, name.c_str());
-    locationCache_[name] = loc;
+    GLint loc = glGetUniformLocation(current_->program, name.c_str());
+    current_->locationCache[name] = loc;
     return loc;
 }
 
 void ShaderProgram::setInt(const std::string& name, int value) {
     GLint loc = uniformLocation(name);
-    if (loc >= 0) glUniform1i(loc, value);
+    if (loc >= 0) {
+        glUniform1i(loc, value);
+        PerfCounters::add(PerfCounter::UniformUploads);
+    }
 }
 
 void ShaderProgram::setBool(const std::string& name, bool value) {
@@ -100,52 +187,81 @@ void ShaderProgram::setBool(const std::string& name, bool value) {
 
 void ShaderProgram::setFloat(const std::string& name, float value) {
     GLint loc = uniformLocation(name);
-    if (loc >= 0) glUniform1f(loc, value);
+    if (loc >= 0) {
+        glUniform1f(loc, value);
+        PerfCounters::add(PerfCounter::UniformUploads);
+    }
+}
+
+void ShaderProgram::setVec2(const std::string& name, const glm::vec2& value) {
+    GLint loc = uniformLocation(name);
+    if (loc >= 0) {
+        glUniform2fv(loc, 1, glm::value_ptr(value));
+        PerfCounters::add(PerfCounter::UniformUploads);
+    }
 }
 
 void ShaderProgram::setVec3(const std::string& name, const glm::vec3& value) {
     GLint loc = uniformLocation(name);
-    if (loc >= 0) glUniform3fv(loc, 1, glm::value_ptr(value));
+    if (loc >= 0) {
+        glUniform3fv(loc, 1, glm::value_ptr(value));
+        PerfCounters::add(PerfCounter::UniformUploads);
+    }
 }
 
 void ShaderProgram::setVec4(const std::string& name, const glm::vec4& value) {
     GLint loc = uniformLocation(name);
-    if (loc >= 0) glUniform4fv(loc, 1, glm::value_ptr(value));
+    if (loc >= 0) {
+        glUniform4fv(loc, 1, glm::value_ptr(value));
+        PerfCounters::add(PerfCounter::UniformUploads);
+    }
 }
 
 void ShaderProgram::setMat4(const std::string& name, const glm::mat4& value) {
     GLint loc = uniformLocation(name);
-    if (loc >= 0) glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(value));
+    if (loc >= 0) {
+        glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(value));
+        PerfCounters::add(PerfCounter::UniformUploads);
+    }
 }
 
-bool ShaderProgram::compileShader(GLuint& shader, GLenum type, const std::string& path) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open shader file: " << path << std::endl;
+bool ShaderProgram::loadSources(ShaderSources sources, std::vector<std::string> labels) {
+    GLuint program = buildProgram(sources, labels, "");
+    if (program == 0) {
         return false;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string sourceStr = buffer.str();
-    const char* source = sourceStr.c_str();
+    deletePermutations();
+    sources_ = std::move(sources);
+    labels_ = std::move(labels);
     
-    shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
-    glCompileShader(shader);
+    Permutation& permutation = permutations_[""];
+    permutation.program = program;
+    current_ = &permutation;
+    return true;
+}
+
+GLuint ShaderProgram::buildProgram(const ShaderSources& sources, const std::vector<std::string>& labels, const std::string& permutation) {
+    std::vector<GLuint> shaders;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        GLuint shader = 0;
+        std::string source = ShaderPreprocessor::injectDefines(sources[i].second, permutation);
+        if (!compileShaderFromSource(shader, sources[i].first, source, labels[i])) {
+            for (GLuint compiled : shaders) {
+                glDeleteShader(compiled);
+            }
+            return 0;
+        }
+        shaders.push_back(shader);
+    }
     
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << "Shader compilation failed (" << path << "):\n" << infoLog << std::endl;
+    GLuint program = linkProgram(shaders);
+    
+    for (GLuint shader : shaders) {
         glDeleteShader(shader);
-        shader = 0;
-        return false;
     }
     
-    return true;
+    return program;
 }
 
 bool ShaderProgram::compileShaderFromSource(GLuint& shader, GLenum type, const std::string& source, const std::string& label) {
@@ -169,28 +285,35 @@ bool ShaderProgram::compileShaderFromSource(GLuint& shader, GLenum type, const s
     return true;
 }
 
-bool ShaderProgram::linkProgram(GLuint vertShader, GLuint fragShader, GLuint geomShader) {
-    program_ = glCreateProgram();
-    glAttachShader(program_, vertShader);
-    glAttachShader(program_, fragShader);
-    if (geomShader != 0) {
-        glAttachShader(program_, geomShader);
+GLuint ShaderProgram::linkProgram(const std::vector<GLuint>& shaders) {
+    GLuint program = glCreateProgram();
+    for (GLuint shader : shaders) {
+        glAttachShader(program, shader);
     }
     
-    glLinkProgram(program_);
+    glLinkProgram(program);
     
     GLint success;
-    glGetProgramiv(program_, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if (!success) {
         char infoLog[512];
-        glGetProgramInfoLog(program_, 512, nullptr, infoLog);
+        glGetProgramInfoLog(program, 512, nullptr, infoLog);
         std::cerr << "Shader program linking failed:\n" << infoLog << std::endl;
-        glDeleteProgram(program_);
-        program_ = 0;
-        return false;
+        glDeleteProgram(program);
+        return 0;
     }
     
-    return true;
+    return program;
+}
+
+void ShaderProgram::deletePermutations() {
+    for (auto& entry : permutations_) {
+        if (entry.second.program != 0) {
+            glDeleteProgram(entry.second.program);
+        }
+    }
+    permutations_.clear();
+    current_ = nullptr;
 }
 
 } // namespace kcShaders
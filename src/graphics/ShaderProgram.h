@@ -2,8 +2,10 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "ShaderPreprocessor.h"
 
 namespace kcShaders {
 
@@ -16,34 +18,67 @@ public:
     ShaderProgram(const ShaderProgram&) = delete;
     ShaderProgram& operator=(const ShaderProgram&) = delete;
 
-    // Load and compile shaders
+    // Load and compile shaders (#include directives are expanded)
     bool loadFromFiles(const std::string& vertPath, const std::string& fragPath, const std::string& geomPath = "");
     bool loadFromSource(const std::string& vertSource, const std::string& fragSource, const std::string& geomSource = "");
     
+    // Load a compute program; permutations and uniform setters work as for
+    // the graphics stages
+    bool loadComputeFromFile(const std::string& path);
+    
+    // Build a standalone compute program from a file (includes expanded, the
+    // define block injected after #version). Returns 0 on failure; the caller
+    // owns the program.
+    static GLuint loadComputeProgram(const std::string& path, const std::string& defineBlock = "");
+
+    // Take ownership of an already linked program for a permutation, replacing
+    // the current one. New sources (if given) are used for later permutations.
+    void adoptProgram(GLuint program, const std::string& permutation = "", const ShaderSources* sources = nullptr);
+
     // Use this shader program
     void use() const;
-    
-    // Get uniform location (cached)
+
+    // Select and use a compile-time permutation; each define set is compiled
+    // once on first use and cached. Falls back to the default permutation if
+    // the variant fails to compile.
+    bool usePermutation(const ShaderDefines& defines);
+
+    // Keys of all permutations compiled so far ("" is the default)
+    std::vector<std::string> permutationKeys() const;
+
+    // Get uniform location (cached per permutation)
     GLint uniformLocation(const std::string& name);
-    
+
     // Uniform setters
     void setInt(const std::string& name, int value);
     void setBool(const std::string& name, bool value);
     void setFloat(const std::string& name, float value);
+    void setVec2(const std::string& name, const glm::vec2& value);
     void setVec3(const std::string& name, const glm::vec3& value);
     void setVec4(const std::string& name, const glm::vec4& value);
     void setMat4(const std::string& name, const glm::mat4& value);
-    
-    GLuint id() const { return program_; }
-    bool isValid() const { return program_ != 0; }
+
+    GLuint id() const { return current_ ? current_->program : 0; }
+    bool isValid() const { return id() != 0; }
 
 private:
-    bool compileShader(GLuint& shader, GLenum type, const std::string& path);
-    bool compileShaderFromSource(GLuint& shader, GLenum type, const std::string& source, const std::string& label = "shader");
-    bool linkProgram(GLuint vertShader, GLuint fragShader, GLuint geomShader = 0);
-    
-    GLuint program_ = 0;
-    std::unordered_map<std::string, GLint> locationCache_;
+    struct Permutation {
+        GLuint program = 0;
+        std::unordered_map<std::string, GLint> locationCache;
+    };
+
+    bool loadSources(ShaderSources sources, std::vector<std::string> labels);
+    GLuint buildProgram(const ShaderSources& sources, const std::vector<std::string>& labels, const std::string& permutation);
+    static bool compileShaderFromSource(GLuint& shader, GLenum type, const std::string& source, const std::string& label = "shader");
+    static GLuint linkProgram(const std::vector<GLuint>& shaders);
+    void deletePermutations();
+
+    // Stage sources with includes expanded, before define injection
+    ShaderSources sources_;
+    std::vector<std::string> labels_;
+
+    std::unordered_map<std::string, Permutation> permutations_;
+    Permutation* current_ = nullptr;
 };
 
 } // namespace kcShaders
@@ -0,0 +1,133 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+
+namespace kcShaders {
+
+namespace {
+
+int roundUpPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+ShadowAtlas::ShadowAtlas(int size, int minTileSize)
+    : size_(roundUpPowerOfTwo(std::max(size, 1)))
+    , minTileSize_(std::min(roundUpPowerOfTwo(std::max(minTileSize, 1)), size_))
+{
+    clear();
+}
+
+void ShadowAtlas::clear()
+{
+    nodes_.clear();
+    nodes_.push_back({0, 0, size_, -1, -1, NodeState::Free});
+    freeArea_ = static_cast<int64_t>(size_) * size_;
+}
+
+int ShadowAtlas::findFreeNode(int node, int size) const
+{
+    // Smallest free node in this subtree that is at least size large
+    const Node& current = nodes_[node];
+    if (current.size < size || current.state == NodeState::Used) {
+        return -1;
+    }
+    if (current.state == NodeState::Free) {
+        return node;
+    }
+
+    int best = -1;
+    for (int i = 0; i < 4; ++i) {
+        int candidate = findFreeNode(current.firstChild + i, size);
+        if (candidate >= 0 && (best < 0 || nodes_[candidate].size < nodes_[best].size)) {
+            best = candidate;
+            if (nodes_[best].size == size) {
+                break;  // Exact fit, nothing smaller exists
+            }
+        }
+    }
+    return best;
+}
+
+void ShadowAtlas::split(int node)
+{
+    // Children outlive merges, so a node is only ever expanded once
+    if (nodes_[node].firstChild < 0) {
+        int half = nodes_[node].size / 2;
+        int x = nodes_[node].x;
+        int y = nodes_[node].y;
+        int firstChild = static_cast<int>(nodes_.size());
+        nodes_.push_back({x, y, half, node, -1, NodeState::Free});
+        nodes_.push_back({x + half, y, half, node, -1, NodeState::Free});
+        nodes_.push_back({x, y + half, half, node, -1, NodeState::Free});
+        nodes_.push_back({x + half, y + half, half, node, -1, NodeState::Free});
+        nodes_[node].firstChild = firstChild;
+    } else {
+        for (int i = 0; i < 4; ++i) {
+            nodes_[nodes_[node].firstChild + i].state = NodeState::Free;
+        }
+    }
+    nodes_[node].state = NodeState::Split;
+}
+
+bool ShadowAtlas::allocate(int size, Tile& tile)
+{
+    size = std::min(std::max(roundUpPowerOfTwo(std::max(size, 1)), minTileSize_), size_);
+
+    int node = findFreeNode(0, size);
+    if (node < 0) {
+        return false;
+    }
+
+    // Split down to the requested size, always continuing in the first quadrant
+    while (nodes_[node].size > size) {
+        split(node);
+        node = nodes_[node].firstChild;
+    }
+
+    nodes_[node].state = NodeState::Used;
+    freeArea_ -= static_cast<int64_t>(size) * size;
+
+    tile.x = nodes_[node].x;
+    tile.y = nodes_[node].y;
+    tile.size = size;
+    tile.node = node;
+    return true;
+}
+
+void ShadowAtlas::release(Tile& tile)
+{
+    if (!tile.isValid() || tile.node >= static_cast<int>(nodes_.size()) ||
+        nodes_[tile.node].state != NodeState::Used) {
+        tile = Tile();
+        return;
+    }
+
+    int node = tile.node;
+    nodes_[node].state = NodeState::Free;
+    freeArea_ += static_cast<int64_t>(tile.size) * tile.size;
+    tile = Tile();
+
+    // Merge parents whose four children are all free again
+    int parent = nodes_[node].parent;
+    while (parent >= 0) {
+        int firstChild = nodes_[parent].firstChild;
+        bool allFree = true;
+        for (int i = 0; i < 4; ++i) {
+            allFree = allFree && nodes_[firstChild + i].state == NodeState::Free;
+        }
+        if (!allFree) {
+            break;
+        }
+
+        nodes_[parent].state = NodeState::Free;
+        parent = nodes_[parent].parent;
+    }
+}
+
+} // namespace kcShaders
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace kcShaders {
+
+/**
+ * ShadowAtlas: Quadtree allocator for square tiles of a shadow atlas
+ *
+ * Tile sizes are powers of two between the minimum tile size and the atlas
+ * size. A request takes the smallest free node that fits and splits it into
+ * quadrants until it has the requested size, so tiles of one size cluster
+ * together instead of fragmenting large free nodes. Freed siblings merge
+ * back into their parent. CPU only, the texture belongs to ShadowAtlasPass.
+ */
+class ShadowAtlas {
+public:
+    struct Tile {
+        int x = 0;
+        int y = 0;
+        int size = 0;
+        int node = -1;    // Quadtree node, -1 = not allocated
+
+        bool isValid() const { return node >= 0; }
+    };
+
+    /**
+     * @param size Atlas width and height in texels (power of two)
+     * @param minTileSize Smallest tile handed out (power of two)
+     */
+    explicit ShadowAtlas(int size = 4096, int minTileSize = 128);
+
+    /**
+     * @brief Allocate a tile
+     * @param size Requested size, rounded up to a power of two within the atlas limits
+     * @param tile Receives the tile on success
+     * @return false if no free node is large enough
+     */
+    bool allocate(int size, Tile& tile);
+
+    /**
+     * @brief Return a tile to the atlas and invalidate it
+     */
+    void release(Tile& tile);
+
+    /**
+     * @brief Free every tile
+     */
+    void clear();
+
+    int getSize() const { return size_; }
+    int getMinTileSize() const { return minTileSize_; }
+
+    /**
+     * @brief Texels not covered by allocated tiles
+     */
+    int64_t getFreeArea() const { return freeArea_; }
+
+private:
+    enum class NodeState : uint8_t {
+        Free,       // Whole node available
+        Split,      // Divided into four children
+        Used        // Handed out as a tile
+    };
+
+    struct Node {
+        int x;
+        int y;
+        int size;
+        int parent;
+        int firstChild;     // Children are allocated as four consecutive nodes, -1 = never split
+        NodeState state;
+    };
+
+    int findFreeNode(int node, int size) const;
+    void split(int node);
+
+    int size_;
+    int minTileSize_;
+    int64_t freeArea_;
+    std::vector<Node> nodes_;
+};
+
+} // namespace kcShaders
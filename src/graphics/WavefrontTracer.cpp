@@ -0,0 +1,325 @@
+#include "WavefrontTracer.h"
+#include "ShaderProgram.h"
+#include "ShaderCompileService.h"
+#include <iostream>
+#include <utility>
+
+namespace kcShaders {
+
+namespace {
+
+// Must match wavefront.glsl
+constexpr GLuint kGroupSize = 256;
+constexpr GLuint kQueueRaysA = 0;
+constexpr GLuint kQueueRaysB = 1;
+constexpr GLuint kQueueSorted = 2;
+constexpr GLuint kQueueDiffuse = 3;
+constexpr GLuint kQueueMetal = 4;
+constexpr GLuint kQueueShadow = 5;
+constexpr GLuint kItemQueueCount = 5;          // Queues stored in queueItems
+constexpr GLuint kResetOctants = 0x80000000u;  // queue_args.comp resetMask bit
+
+constexpr GLsizeiptr kPathStateSize = 80;      // std430 size of PathState
+constexpr GLsizeiptr kShadowRaySize = 48;      // std430 size of ShadowRay
+constexpr GLsizeiptr kCounterSize = (6 + 8 + 8) * sizeof(GLuint);
+constexpr GLsizeiptr kArgsSize = 6 * 4 * sizeof(GLuint);
+
+constexpr GLbitfield kStageBarrier = GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT;
+
+struct KernelSource {
+    const char* name;
+    const char* file;
+    const char* defines;
+};
+
+// Both shading kernels are permutations of shade.comp
+const KernelSource kKernelSources[WavefrontTracer::KernelCount] = {
+    {"Generate", "generate.comp", ""},
+    {"Sort", "sort.comp", ""},
+    {"Extend", "extend.comp", ""},
+    {"ShadeDiffuse", "shade.comp", "#define SHADE_DIFFUSE\n"},
+    {"ShadeMetal", "shade.comp", "#define SHADE_METAL\n"},
+    {"Shadow", "shadow.comp", ""},
+    {"QueueArgs", "queue_args.comp", ""},
+    {"Resolve", "resolve.comp", ""},
+};
+
+class DebugGroup {
+public:
+    explicit DebugGroup(const char* name)
+    {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    }
+    ~DebugGroup()
+    {
+        glPopDebugGroup();
+    }
+};
+
+} // namespace
+
+WavefrontTracer::WavefrontTracer()
+    : programs_{}
+    , pathBuffer_(0)
+    , queueBuffer_(0)
+    , counterBuffer_(0)
+    , argsBuffer_(0)
+    , shadowRayBuffer_(0)
+    , capacity_(0)
+    , sortByOctant_(false)
+{
+}
+
+WavefrontTracer::~WavefrontTracer()
+{
+    cleanup();
+}
+
+bool WavefrontTracer::loadShaders(const std::string& directory)
+{
+    GLuint programs[KernelCount] = {};
+    for (int i = 0; i < KernelCount; ++i) {
+        programs[i] = ShaderProgram::loadComputeProgram(directory + kKernelSources[i].file,
+                                                        kKernelSources[i].defines + defines_);
+        if (programs[i] == 0) {
+            std::cerr << "[WavefrontTracer] Failed to load " << kKernelSources[i].name << " kernel\n";
+            for (int j = 0; j < i; ++j) {
+                glDeleteProgram(programs[j]);
+            }
+            return false;
+        }
+    }
+
+    for (int i = 0; i < KernelCount; ++i) {
+        if (programs_[i] != 0) {
+            glDeleteProgram(programs_[i]);
+        }
+        programs_[i] = programs[i];
+    }
+    return true;
+}
+
+void WavefrontTracer::watchShaders(ShaderCompileService& service, const std::string& directory,
+                                   std::function<void()> onReload)
+{
+    for (int i = 0; i < KernelCount; ++i) {
+        // The shading permutations share a file, each gets its own watch
+        std::string defines = kKernelSources[i].defines;
+        service.watch(
+            std::string("WavefrontTracer/") + kKernelSources[i].name,
+            {{GL_COMPUTE_SHADER, directory + kKernelSources[i].file}},
+            [this, i, defines, onReload](GLuint program, const std::string& permutation, const ShaderSources&) {
+                // Built for defines that changed while it compiled
+                if (permutation != defines + defines_) {
+                    glDeleteProgram(program);
+                    return;
+                }
+                if (programs_[i] != 0) {
+                    glDeleteProgram(programs_[i]);
+                }
+                programs_[i] = program;
+                if (onReload) {
+                    onReload();
+                }
+            },
+            nullptr,
+            [this, defines]() { return std::vector<std::string>{defines + defines_}; }
+        );
+    }
+}
+
+bool WavefrontTracer::isReady() const
+{
+    for (GLuint program : programs_) {
+        if (program == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void WavefrontTracer::cleanup()
+{
+    for (GLuint& program : programs_) {
+        if (program != 0) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    GLuint buffers[] = {pathBuffer_, queueBuffer_, counterBuffer_, argsBuffer_, shadowRayBuffer_};
+    if (pathBuffer_ != 0) {
+        glDeleteBuffers(5, buffers);
+    }
+    pathBuffer_ = queueBuffer_ = counterBuffer_ = argsBuffer_ = shadowRayBuffer_ = 0;
+    capacity_ = 0;
+}
+
+void WavefrontTracer::ensureCapacity(GLuint capacity)
+{
+    if (pathBuffer_ == 0) {
+        glGenBuffers(1, &pathBuffer_);
+        glGenBuffers(1, &queueBuffer_);
+        glGenBuffers(1, &counterBuffer_);
+        glGenBuffers(1, &argsBuffer_);
+        glGenBuffers(1, &shadowRayBuffer_);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, kCounterSize, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, argsBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, kArgsSize, nullptr, GL_DYNAMIC_COPY);
+    }
+
+    // Only grows, changing samples per pixel back and forth never reallocates
+    if (capacity > capacity_) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, pathBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, kPathStateSize * capacity, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, queueBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * kItemQueueCount * capacity, nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, shadowRayBuffer_);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, kShadowRaySize * capacity, nullptr, GL_DYNAMIC_COPY);
+        capacity_ = capacity;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void WavefrontTracer::setUint(Kernel kernel, const char* name, GLuint value)
+{
+    GLint loc = glGetUniformLocation(programs_[kernel], name);
+    if (loc >= 0) glProgramUniform1ui(programs_[kernel], loc, value);
+}
+
+void WavefrontTracer::setInt(Kernel kernel, const char* name, int value)
+{
+    GLint loc = glGetUniformLocation(programs_[kernel], name);
+    if (loc >= 0) glProgramUniform1i(programs_[kernel], loc, value);
+}
+
+void WavefrontTracer::updateQueueArgs(GLuint resetMask)
+{
+    setUint(QueueArgs, "resetMask", resetMask);
+    glUseProgram(programs_[QueueArgs]);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(kStageBarrier);
+}
+
+void WavefrontTracer::dispatchQueue(Kernel kernel, GLuint queue)
+{
+    glUseProgram(programs_[kernel]);
+    glDispatchComputeIndirect(static_cast<GLintptr>(queue) * 4 * sizeof(GLuint));
+}
+
+void WavefrontTracer::traceTile(int x, int y, int width, int height, int samplesPerPixel, int maxBounces)
+{
+    if (!isReady() || width <= 0 || height <= 0) {
+        return;
+    }
+
+    GLuint pathCount = static_cast<GLuint>(width * height * samplesPerPixel);
+    ensureCapacity(pathCount);
+
+    DebugGroup tileGroup("Wavefront");
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, pathBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, queueBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, counterBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, argsBuffer_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, shadowRayBuffer_);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, argsBuffer_);
+
+    // Set every tile, hot-reloaded kernels start with defaults
+    for (GLuint program : programs_) {
+        GLint loc = glGetUniformLocation(program, "queueCapacity");
+        if (loc >= 0) glProgramUniform1ui(program, loc, capacity_);
+        loc = glGetUniformLocation(program, "tileOffset");
+        if (loc >= 0) glProgramUniform2i(program, loc, x, y);
+        loc = glGetUniformLocation(program, "tileSize");
+        if (loc >= 0) glProgramUniform2i(program, loc, width, height);
+    }
+
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer_);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Camera rays for every pixel and sample of the tile
+    {
+        DebugGroup group("Generate");
+        setInt(Generate, "samplesPerPixel", samplesPerPixel);
+        setUint(Generate, "outputQueue", kQueueRaysA);
+
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glUseProgram(programs_[Generate]);
+        glDispatchCompute((pathCount + kGroupSize - 1) / kGroupSize, 1, 1);
+        glMemoryBarrier(kStageBarrier);
+    }
+
+    GLuint rayQueue = kQueueRaysA;
+    GLuint nextQueue = kQueueRaysB;
+    for (int bounce = 0; bounce < maxBounces; ++bounce) {
+        // Arguments for this bounce's rays; empty the queues it appends to
+        updateQueueArgs((1u << kQueueDiffuse) | (1u << kQueueMetal) | (1u << kQueueShadow) |
+                        (1u << nextQueue) | kResetOctants);
+
+        GLuint traceQueue = rayQueue;
+        if (sortByOctant_) {
+            DebugGroup group("Sort");
+            setUint(Sort, "inputQueue", rayQueue);
+            for (int phase = 0; phase < 3; ++phase) {
+                setInt(Sort, "sortPhase", phase);
+                if (phase == 1) {
+                    glUseProgram(programs_[Sort]);
+                    glDispatchCompute(1, 1, 1);
+                } else {
+                    dispatchQueue(Sort, rayQueue);
+                }
+                glMemoryBarrier(kStageBarrier);
+            }
+            traceQueue = kQueueSorted;
+            updateQueueArgs(0);
+        }
+
+        {
+            DebugGroup group("Extend");
+            setUint(Extend, "inputQueue", traceQueue);
+            dispatchQueue(Extend, traceQueue);
+            glMemoryBarrier(kStageBarrier);
+            updateQueueArgs(0);
+        }
+
+        {
+            DebugGroup group("Shade");
+            setInt(ShadeDiffuse, "maxBounces", maxBounces);
+            setInt(ShadeMetal, "maxBounces", maxBounces);
+            setUint(ShadeDiffuse, "outputQueue", nextQueue);
+            setUint(ShadeMetal, "outputQueue", nextQueue);
+            dispatchQueue(ShadeDiffuse, kQueueDiffuse);
+            dispatchQueue(ShadeMetal, kQueueMetal);
+            glMemoryBarrier(kStageBarrier);
+            updateQueueArgs(0);
+        }
+
+        {
+            DebugGroup group("Shadow");
+            dispatchQueue(Shadow, kQueueShadow);
+            glMemoryBarrier(kStageBarrier);
+        }
+
+        std::swap(rayQueue, nextQueue);
+    }
+
+    // Average the samples and accumulate
+    {
+        DebugGroup group("Resolve");
+        setInt(Resolve, "samplesPerPixel", samplesPerPixel);
+        glUseProgram(programs_[Resolve]);
+        glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+    }
+    
+    // The next tile reuses the path buffers
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+} // namespace kcShaders
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <functional>
+#include <string>
+
+namespace kcShaders {
+
+class ShaderCompileService;
+
+/**
+ * WavefrontTracer: Path tracing split into one compute kernel per stage
+ *
+ * Instead of looping over bounces inside a single thread (the megakernel in
+ * default.comp), every bounce runs extend (closest hit), shade (one kernel per
+ * material class) and shadow (any hit) over compacted ray queues in SSBOs.
+ * Kernels append survivors with atomic counters aggregated per work group,
+ * so terminated paths leave no idle lanes behind, and queue_args.comp turns
+ * the counters into glDispatchComputeIndirect arguments without a CPU
+ * readback. Rays can optionally be sorted by direction octant before
+ * traversal. Each stage is wrapped in a debug group for GPU profilers.
+ *
+ * SSBO bindings (after the scene buffers 1-4):
+ *   5: path states, 6: queue items, 7: queue counters,
+ *   8: indirect dispatch arguments, 9: shadow rays
+ * The accumulation images are the ones bound by RayTracingPipeline.
+ */
+class WavefrontTracer {
+public:
+    enum Kernel {
+        Generate = 0,
+        Sort,
+        Extend,
+        ShadeDiffuse,
+        ShadeMetal,
+        Shadow,
+        QueueArgs,
+        Resolve,
+        KernelCount
+    };
+
+    WavefrontTracer();
+    ~WavefrontTracer();
+
+    // Non-copyable
+    WavefrontTracer(const WavefrontTracer&) = delete;
+    WavefrontTracer& operator=(const WavefrontTracer&) = delete;
+
+    /**
+     * Load all kernels from a directory (generate.comp, extend.comp, ...)
+     * @return true if every kernel compiled, otherwise the old set is kept
+     */
+    bool loadShaders(const std::string& directory);
+
+    /**
+     * Rebuild kernels in the background when their files change
+     * @param onReload Called on the render thread after a kernel was replaced
+     */
+    void watchShaders(ShaderCompileService& service, const std::string& directory,
+                      std::function<void()> onReload);
+
+    bool isReady() const;
+    
+    /**
+     * Defines added to every kernel (e.g. the accumulation format), takes
+     * effect on the next load or reload
+     */
+    void setDefines(const std::string& defines) { defines_ = defines; }
+
+    /** Raw program of a stage, for uniforms shared with the megakernel */
+    GLuint program(Kernel kernel) const { return programs_[kernel]; }
+
+    void setSortByOctant(bool enable) { sortByOctant_ = enable; }
+    bool getSortByOctant() const { return sortByOctant_; }
+
+    /**
+     * Trace one tile to completion and accumulate it into the bound images
+     */
+    void traceTile(int x, int y, int width, int height, int samplesPerPixel, int maxBounces);
+
+    void cleanup();
+
+private:
+    void ensureCapacity(GLuint capacity);
+    void updateQueueArgs(GLuint resetMask);
+    void dispatchQueue(Kernel kernel, GLuint queue);
+    void setUint(Kernel kernel, const char* name, GLuint value);
+    void setInt(Kernel kernel, const char* name, int value);
+
+    GLuint programs_[KernelCount];
+
+    GLuint pathBuffer_;
+    GLuint queueBuffer_;
+    GLuint counterBuffer_;
+    GLuint argsBuffer_;
+    GLuint shadowRayBuffer_;
+    GLuint capacity_;         // Paths per tile the buffers hold
+    std::string defines_;
+
+    bool sortByOctant_;
+};
+
+} // namespace kcShaders
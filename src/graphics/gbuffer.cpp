@@ -1,11 +1,12 @@
 #include "gbuffer.h"
+#include "RenderTargetPool.h"
 
 #include <iostream>
 
 namespace kcShaders {
 
 GBuffer::GBuffer()
-    : FBO_(0), albedoTexture_(0), normalTexture_(0), positionTexture_(0),
+    : pool_(nullptr), FBO_(0), albedoTexture_(0), normalTexture_(0),
       materialTexture_(0), depthTexture_(0), width_(0), height_(0)
 {
 }
@@ -15,65 +16,47 @@ GBuffer::~GBuffer()
     deleteBuffers();
 }
 
-bool GBuffer::initialize(int width, int height)
+bool GBuffer::initialize(int width, int height, RenderTargetPool* pool)
 {
-    width_ = width;
-    height_ = height;
+    pool_ = pool;
     
     // Create FBO
     glGenFramebuffers(1, &FBO_);
-    glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
+    if (!attachTargets(width, height)) {
+        deleteBuffers();
+        return false;
+    }
+    return true;
+}
+
+bool GBuffer::attachTargets(int width, int height)
+{
+    width_ = width;
+    height_ = height;
     
-    // Create textures
-    // Albedo (RGB)
-    glGenTextures(1, &albedoTexture_);
-    glBindTexture(GL_TEXTURE_2D, albedoTexture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture_, 0);
+    // Albedo (RGB) + AO (A)
+    albedoTexture_ = pool_->acquire({GL_RGBA8, width, height});
+    // Normal (RG - octahedral encoded, 16-bit unorm)
+    normalTexture_ = pool_->acquire({GL_RG16, width, height});
+    // Material (RG - metallic, roughness)
+    materialTexture_ = pool_->acquire({GL_RG8, width, height});
+    // Depth texture, sampled by SSAO and lighting to reconstruct position
+    depthTexture_ = pool_->acquire({GL_DEPTH_COMPONENT32F, width, height});
     
-    // Normal (RGB)
-    glGenTextures(1, &normalTexture_);
-    glBindTexture(GL_TEXTURE_2D, normalTexture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture_, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture_, 0);
-    
-    // Position (RGB)
-    glGenTextures(1, &positionTexture_);
-    glBindTexture(GL_TEXTURE_2D, positionTexture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, positionTexture_, 0);
-    
-    // Material (RGBA - metallic, roughness, AO, unused)
-    glGenTextures(1, &materialTexture_);
-    glBindTexture(GL_TEXTURE_2D, materialTexture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, materialTexture_, 0);
-    
-    // Depth texture
-    glGenTextures(1, &depthTexture_);
-    glBindTexture(GL_TEXTURE_2D, depthTexture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, materialTexture_, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture_, 0);
     
     // Tell OpenGL which color attachments we'll use for rendering
-    unsigned int attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-    glDrawBuffers(4, attachments);
+    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(3, attachments);
     
     // Check framebuffer completeness
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         std::cerr << "GBuffer is not complete!" << std::endl;
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        deleteBuffers();
         return false;
     }
     
@@ -90,7 +73,7 @@ void GBuffer::bind()
 void GBuffer::bindForReading()
 {
     // Only bind textures to texture units; do not touch framebuffer binding here.
-    // Match actual uniform locations: Albedo:0 Material:1 Normal:2 Position:3
+    // Match actual uniform locations: Albedo:0 Material:1 Normal:2 Depth:3
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, albedoTexture_);
     
@@ -101,7 +84,7 @@ void GBuffer::bindForReading()
     glBindTexture(GL_TEXTURE_2D, normalTexture_);
     
     glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, positionTexture_);
+    glBindTexture(GL_TEXTURE_2D, depthTexture_);
 }
 
 void GBuffer::unbind()
@@ -115,20 +98,35 @@ void GBuffer::resize(int width, int height)
         return;
     }
     
-    deleteBuffers();
-    initialize(width, height);
+    releaseTargets();
+    attachTargets(width, height);
+}
+
+void GBuffer::releaseTargets()
+{
+    // Detach first, the pool may hand the textures to another pass
+    if (FBO_) {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO_);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, 0, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, 0, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    
+    if (pool_) {
+        pool_->release(albedoTexture_);
+        pool_->release(normalTexture_);
+        pool_->release(materialTexture_);
+        pool_->release(depthTexture_);
+    }
+    albedoTexture_ = normalTexture_ = materialTexture_ = depthTexture_ = 0;
 }
 
 void GBuffer::deleteBuffers()
 {
-    if (albedoTexture_) glDeleteTextures(1, &albedoTexture_);
-    if (normalTexture_) glDeleteTextures(1, &normalTexture_);
-    if (positionTexture_) glDeleteTextures(1, &positionTexture_);
-    if (materialTexture_) glDeleteTextures(1, &materialTexture_);
-    if (depthTexture_) glDeleteTextures(1, &depthTexture_);
+    releaseTargets();
     if (FBO_) glDeleteFramebuffers(1, &FBO_);
-    
-    albedoTexture_ = normalTexture_ = positionTexture_ = materialTexture_ = depthTexture_ = 0;
     FBO_ = 0;
 }
 
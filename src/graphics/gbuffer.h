@@ -4,12 +4,23 @@
 
 namespace kcShaders {
 
+class RenderTargetPool;
+
+/**
+ * GBuffer: Thin deferred geometry targets
+ *
+ * Albedo RGBA8 (AO in alpha), octahedral normal RG16, metallic/roughness RG8
+ * and a 32-bit float depth texture. Position is not stored, readers rebuild
+ * it from depth with the inverse projection (see shaders/common/gbuffer.glsl).
+ * The textures come from the renderer's RenderTargetPool, the FBO is kept
+ * across resizes.
+ */
 class GBuffer {
 public:
     GBuffer();
     ~GBuffer();
     
-    bool initialize(int width, int height);
+    bool initialize(int width, int height, RenderTargetPool* pool);
     void resize(int width, int height);
     void bind();
     void bindForReading();
@@ -17,20 +28,22 @@ public:
     
     GLuint getAlbedoTexture() const { return albedoTexture_; }
     GLuint getNormalTexture() const { return normalTexture_; }
-    GLuint getPositionTexture() const { return positionTexture_; }
     GLuint getMaterialTexture() const { return materialTexture_; }
+    GLuint getDepthTexture() const { return depthTexture_; }
     
     int getWidth() const { return width_; }
     int getHeight() const { return height_; }
     
 private:
+    bool attachTargets(int width, int height);
+    void releaseTargets();
     void deleteBuffers();
     
 private:
+    RenderTargetPool* pool_;
     GLuint FBO_;
     GLuint albedoTexture_;
     GLuint normalTexture_;
-    GLuint positionTexture_;
     GLuint materialTexture_;
     GLuint depthTexture_;
     
@@ -0,0 +1,327 @@
+#include "DenoisePass.h"
+#include "../ShaderProgram.h"
+#include "../ShaderCompileService.h"
+#include "../RenderTargetPool.h"
+#include "../Profiler.h"
+#include "../../scene/camera.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace kcShaders {
+
+namespace {
+
+constexpr GLuint kGroupSize = 16;             // Must match local_size in the kernels
+constexpr float kMaxHistoryLength = 32.0f;
+
+const char* const kKernelFiles[DenoisePass::KernelCount] = {
+    "temporal.comp",
+    "atrous.comp",
+};
+
+GLuint acquireCleared(RenderTargetPool& pool, GLenum internalFormat, int width, int height)
+{
+    GLuint texture = pool.acquire({internalFormat, width, height});
+    
+    // Pooled contents are undefined; zero depth reads as sky until the ray
+    // tracer reaches a pixel
+    const float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearTexImage(texture, 0, GL_RGBA, GL_FLOAT, zero);
+    return texture;
+}
+
+void bindSampler(GLuint program, const char* name, GLuint unit, GLuint texture)
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glProgramUniform1i(program, loc, static_cast<GLint>(unit));
+}
+
+void setInt(GLuint program, const char* name, int value)
+{
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glProgramUniform1i(program, loc, value);
+}
+
+void setFloat(GLuint program, const char* name, float value)
+{
+    GLint loc = glGetUniformLocation(program, name);
+    if (loc >= 0) glProgramUniform1f(program, loc, value);
+}
+
+} // namespace
+
+DenoisePass::DenoisePass(int width, int height)
+    : programs_{}
+    , width_(width)
+    , height_(height)
+    , accumulationTexture_(0)
+    , momentTexture_(0)
+    , outputTexture_(0)
+    , outputFormat_(GL_RGBA32F)
+    , pool_(nullptr)
+    , targetWidth_(0)
+    , targetHeight_(0)
+    , normalDepthTexture_(0)
+    , previousNormalDepthTexture_(0)
+    , albedoTexture_(0)
+    , historyTextures_{}
+    , historyMomentTextures_{}
+    , historyIndex_(0)
+    , historyValid_(false)
+    , previousViewProjection_(1.0f)
+    , previousCameraPosition_(0.0f)
+{
+}
+
+DenoisePass::~DenoisePass()
+{
+    cleanup();
+}
+
+void DenoisePass::setup()
+{
+    // Images come from the pool, see acquireTargets()
+}
+
+void DenoisePass::resize(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+}
+
+void DenoisePass::acquireTargets(RenderTargetPool* pool)
+{
+    if (pool == pool_ && normalDepthTexture_ != 0 && width_ == targetWidth_ && height_ == targetHeight_) {
+        return;
+    }
+    
+    releaseTargets();
+    pool_ = pool;
+    targetWidth_ = width_;
+    targetHeight_ = height_;
+    if (!pool_) {
+        return;
+    }
+    
+    normalDepthTexture_ = acquireCleared(*pool_, GL_RGBA16F, width_, height_);
+    previousNormalDepthTexture_ = acquireCleared(*pool_, GL_RGBA16F, width_, height_);
+    albedoTexture_ = acquireCleared(*pool_, GL_RGBA8, width_, height_);
+    for (int i = 0; i < 2; ++i) {
+        historyTextures_[i] = acquireCleared(*pool_, GL_RGBA16F, width_, height_);
+        historyMomentTextures_[i] = acquireCleared(*pool_, GL_RGBA32F, width_, height_);
+    }
+    
+    historyValid_ = false;
+}
+
+void DenoisePass::releaseTargets()
+{
+    // The ray tracing kernels write the features through units 4 and 5
+    glBindImageTexture(4, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(5, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    
+    GLuint* textures[7] = {&normalDepthTexture_, &previousNormalDepthTexture_, &albedoTexture_,
+                           &historyTextures_[0], &historyTextures_[1],
+                           &historyMomentTextures_[0], &historyMomentTextures_[1]};
+    for (GLuint* texture : textures) {
+        if (pool_) {
+            pool_->release(*texture);
+        }
+        *texture = 0;
+    }
+}
+
+bool DenoisePass::loadShaders(const std::string& directory)
+{
+    GLuint programs[KernelCount] = {};
+    for (int i = 0; i < KernelCount; ++i) {
+        programs[i] = ShaderProgram::loadComputeProgram(directory + kKernelFiles[i]);
+        if (programs[i] == 0) {
+            std::cerr << "[DenoisePass] Failed to load " << kKernelFiles[i] << "\n";
+            for (int j = 0; j < i; ++j) {
+                glDeleteProgram(programs[j]);
+            }
+            return false;
+        }
+    }
+    
+    for (int i = 0; i < KernelCount; ++i) {
+        if (programs_[i] != 0) {
+            glDeleteProgram(programs_[i]);
+        }
+        programs_[i] = programs[i];
+    }
+    historyValid_ = false;
+    return true;
+}
+
+void DenoisePass::watchShaders(ShaderCompileService& service, const std::string& directory)
+{
+    for (int i = 0; i < KernelCount; ++i) {
+        service.watch(
+            std::string("DenoisePass/") + kKernelFiles[i],
+            {{GL_COMPUTE_SHADER, directory + kKernelFiles[i]}},
+            [this, i](GLuint program, const std::string&, const ShaderSources&) {
+                if (programs_[i] != 0) {
+                    glDeleteProgram(programs_[i]);
+                }
+                programs_[i] = program;
+                historyValid_ = false;
+            }
+        );
+    }
+}
+
+bool DenoisePass::isReady() const
+{
+    return programs_[Temporal] != 0 && programs_[Atrous] != 0 && normalDepthTexture_ != 0;
+}
+
+void DenoisePass::setTargets(GLuint accumulation, GLuint moment, GLuint output, GLenum outputFormat)
+{
+    accumulationTexture_ = accumulation;
+    momentTexture_ = moment;
+    outputTexture_ = output;
+    outputFormat_ = outputFormat;
+}
+
+void DenoisePass::bindFeatureImages()
+{
+    glBindImageTexture(4, normalDepthTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindImageTexture(5, albedoTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+}
+
+glm::mat4 DenoisePass::viewProjection(const Camera& camera, float aspect)
+{
+    // Same basis as the camera rays in default.comp
+    glm::vec3 position = camera.GetPosition();
+    glm::vec3 front = camera.GetFront();
+    glm::vec3 right = camera.GetRight();
+    glm::vec3 up = glm::cross(right, front);
+    float halfHeight = std::tan(glm::radians(camera.GetFov()) * 0.5f);
+    float halfWidth = aspect * halfHeight;
+    
+    // Rows: x and y scaled by the image plane extent, w = view depth
+    glm::vec4 rowX(right / halfWidth, -glm::dot(right, position) / halfWidth);
+    glm::vec4 rowY(up / halfHeight, -glm::dot(up, position) / halfHeight);
+    glm::vec4 rowW(front, -glm::dot(front, position));
+    return glm::transpose(glm::mat4(rowX, rowY, rowW, rowW));
+}
+
+void DenoisePass::execute(RenderContext& ctx)
+{
+    if (!isReady() || !ctx.camera || accumulationTexture_ == 0 || outputTexture_ == 0 ||
+        normalDepthTexture_ == 0) {
+        return;
+    }
+    
+    const int current = historyIndex_;
+    const int previous = 1 - current;
+    const GLuint groupsX = (width_ + kGroupSize - 1) / kGroupSize;
+    const GLuint groupsY = (height_ + kGroupSize - 1) / kGroupSize;
+    const float resolution[3] = {(float)width_, (float)height_, 0.0f};
+    
+    // A-trous ping-pong, variance in alpha
+    const GLuint filterTextures[2] = {
+        pool_->acquire({GL_RGBA16F, width_, height_}),
+        pool_->acquire({GL_RGBA16F, width_, height_}),
+    };
+    
+    // The ray tracer wrote accumulation and features through image stores
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    
+    // === Temporal reprojection and variance ===
+    {
+        ProfileScope scope(ctx.profiler, "Temporal");
+        GLuint temporal = programs_[Temporal];
+        glUseProgram(temporal);
+        glProgramUniform3fv(temporal, glGetUniformLocation(temporal, "iResolution"), 1, resolution);
+        glProgramUniformMatrix4fv(temporal, glGetUniformLocation(temporal, "previousViewProjection"),
+                                  1, GL_FALSE, glm::value_ptr(previousViewProjection_));
+        glProgramUniform3fv(temporal, glGetUniformLocation(temporal, "previousCameraPosition"),
+                            1, glm::value_ptr(previousCameraPosition_));
+        setInt(temporal, "historyValid", historyValid_ ? 1 : 0);
+        setFloat(temporal, "alphaMin", settings_.alphaMin);
+        setFloat(temporal, "maxHistoryLength", kMaxHistoryLength);
+        
+        bindSampler(temporal, "accumulationTexture", 0, accumulationTexture_);
+        bindSampler(temporal, "momentTexture", 1, momentTexture_);
+        bindSampler(temporal, "normalDepthTexture", 2, normalDepthTexture_);
+        bindSampler(temporal, "albedoTexture", 3, albedoTexture_);
+        bindSampler(temporal, "previousNormalDepthTexture", 4, previousNormalDepthTexture_);
+        bindSampler(temporal, "historyTexture", 5, historyTextures_[previous]);
+        bindSampler(temporal, "historyMomentsTexture", 6, historyMomentTextures_[previous]);
+        
+        glBindImageTexture(0, filterTextures[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glBindImageTexture(1, historyMomentTextures_[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glDispatchCompute(groupsX, groupsY, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    
+    // === A-trous iterations, the last one writes the display image ===
+    {
+        ProfileScope scope(ctx.profiler, "A-Trous");
+        GLuint atrous = programs_[Atrous];
+        glUseProgram(atrous);
+        glProgramUniform3fv(atrous, glGetUniformLocation(atrous, "iResolution"), 1, resolution);
+        setFloat(atrous, "sigmaLuminance", settings_.sigmaLuminance);
+        setFloat(atrous, "sigmaNormal", settings_.sigmaNormal);
+        setFloat(atrous, "sigmaDepth", settings_.sigmaDepth);
+        bindSampler(atrous, "normalDepthTexture", 1, normalDepthTexture_);
+        bindSampler(atrous, "albedoTexture", 2, albedoTexture_);
+        
+        glBindImageTexture(1, historyTextures_[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glBindImageTexture(2, outputTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, outputFormat_);
+        
+        int iterations = std::max(settings_.iterations, 1);
+        for (int i = 0; i < iterations; ++i) {
+            bindSampler(atrous, "filterInput", 0, filterTextures[i % 2]);
+            glBindImageTexture(0, filterTextures[(i + 1) % 2], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+            setInt(atrous, "stepSize", 1 << i);
+            setInt(atrous, "writeHistory", i == 0 ? 1 : 0);
+            setInt(atrous, "finalIteration", i == iterations - 1 ? 1 : 0);
+            glDispatchCompute(groupsX, groupsY, 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        }
+    }
+    
+    // Features of this frame become the reference for the next reprojection
+    glCopyImageSubData(normalDepthTexture_, GL_TEXTURE_2D, 0, 0, 0, 0,
+                       previousNormalDepthTexture_, GL_TEXTURE_2D, 0, 0, 0, 0,
+                       width_, height_, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    
+    // Unbind before the ping-pong images go back to the pool
+    for (int unit = 6; unit >= 0; --unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    for (GLuint unit = 0; unit < 3; ++unit) {
+        glBindImageTexture(unit, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    }
+    glUseProgram(0);
+    pool_->release(filterTextures[0]);
+    pool_->release(filterTextures[1]);
+    
+    previousViewProjection_ = viewProjection(*ctx.camera, (float)width_ / (float)height_);
+    previousCameraPosition_ = ctx.camera->GetPosition();
+    historyIndex_ = previous;
+    historyValid_ = true;
+}
+
+void DenoisePass::cleanup()
+{
+    releaseTargets();
+    for (GLuint& program : programs_) {
+        if (program != 0) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+}
+
+} // namespace kcShaders
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include "../DenoiseFilter.h"
+#include <glad/glad.h>
+#include <functional>
+#include <string>
+#include <glm/glm.hpp>
+
+namespace kcShaders {
+
+class Camera;
+class RenderTargetPool;
+class ShaderCompileService;
+
+/**
+ * DenoisePass: Edge-aware spatiotemporal denoiser for the ray traced image
+ *
+ * Follows spatiotemporal variance-guided filtering (SVGF). The ray tracing
+ * kernels write primary-hit features (normal, hit distance, albedo, see
+ * denoise_features.glsl); temporal.comp reprojects last frame's history with
+ * the previous camera, rejects disoccluded taps by normal and depth, blends
+ * in the accumulated color and estimates its luminance variance; atrous.comp
+ * then runs a few a-trous wavelet iterations whose edge stops use those
+ * features and the variance. Filtering happens on illumination (color
+ * divided by albedo), so texture detail survives.
+ *
+ * Inputs are the pipeline's accumulation and moment images, the result is
+ * written to its output image. The feature and history images are held from
+ * the render target pool, the a-trous ping-pong images only for execute().
+ * DenoiseFilter is the CPU version of the spatial filter.
+ */
+class DenoisePass : public RenderPass {
+public:
+    enum Kernel {
+        Temporal = 0,
+        Atrous,
+        KernelCount
+    };
+
+    DenoisePass(int width, int height);
+    ~DenoisePass() override;
+
+    void setup() override;
+    void execute(RenderContext& ctx) override;
+    void resize(int width, int height) override;
+    void cleanup() override;
+    const char* getName() const override { return "Denoise"; }
+
+    /**
+     * @brief Load temporal.comp and atrous.comp from a directory
+     * @return true if both compiled, otherwise the old programs are kept
+     */
+    bool loadShaders(const std::string& directory);
+
+    /**
+     * @brief Rebuild the kernels in the background when their files change
+     */
+    void watchShaders(ShaderCompileService& service, const std::string& directory);
+
+    bool isReady() const;
+
+    /** Raw program of a kernel, for the camera uniforms shared with the ray tracer */
+    GLuint program(Kernel kernel) const { return programs_[kernel]; }
+
+    /**
+     * @brief Hold the feature and history images from the pool at the current
+     *        size; reacquired, and the history dropped, when the size or the
+     *        pool changes. Call before bindFeatureImages().
+     */
+    void acquireTargets(RenderTargetPool* pool);
+
+    /**
+     * @brief Images the denoiser reads and writes, owned by the pipeline
+     * @param accumulation RGBA32F running mean (A: passes)
+     * @param moment R32F mean of squared luminance
+     * @param output Display image
+     * @param outputFormat Internal format of the display image
+     */
+    void setTargets(GLuint accumulation, GLuint moment, GLuint output, GLenum outputFormat);
+
+    /** Bind the feature images for the ray tracing kernels (image units 4 and 5) */
+    void bindFeatureImages();
+
+    /** Drop the temporal history, e.g. after the denoiser was off for a while */
+    void resetHistory() { historyValid_ = false; }
+
+    void setSettings(const DenoiseSettings& settings) { settings_ = settings; }
+    const DenoiseSettings& getSettings() const { return settings_; }
+
+    /**
+     * @brief View-projection matching the ray tracer's camera model
+     *        (clip.xy / clip.w in [-1, 1] across the image)
+     */
+    static glm::mat4 viewProjection(const Camera& camera, float aspect);
+
+private:
+    void releaseTargets();
+
+    GLuint programs_[KernelCount];
+    int width_;
+    int height_;
+    DenoiseSettings settings_;
+
+    // Targets owned by RayTracingPipeline
+    GLuint accumulationTexture_;
+    GLuint momentTexture_;
+    GLuint outputTexture_;
+    GLenum outputFormat_;
+
+    // Images below come from pool_, held at targetWidth_ x targetHeight_
+    RenderTargetPool* pool_;
+    int targetWidth_;
+    int targetHeight_;
+
+    // Features written by the ray tracer, previous frame's copy for reprojection
+    GLuint normalDepthTexture_;
+    GLuint previousNormalDepthTexture_;
+    GLuint albedoTexture_;
+
+    // Ping-ponged per frame, indexed by historyIndex_ (current) and its complement
+    GLuint historyTextures_[2];       // Demodulated illumination after one iteration
+    GLuint historyMomentTextures_[2]; // Luminance moments, history length
+
+    int historyIndex_;
+    bool historyValid_;
+    glm::mat4 previousViewProjection_;
+    glm::vec3 previousCameraPosition_;
+};
+
+} // namespace kcShaders
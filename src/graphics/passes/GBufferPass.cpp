@@ -5,6 +5,7 @@
 #include "../../scene/scene.h"
 #include "../../scene/camera.h"
 #include "../../scene/mesh.h"
+#include <algorithm>
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -31,36 +32,80 @@ void GBufferPass::execute(RenderContext& ctx) {
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // Enable depth test
+    // Enable depth test, disable blending: the targets hold data (GAlbedo.a is AO)
     glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
     
-    // Use geometry shader
-    geometryShader_->use();
-    
-    // Set view and projection matrices
-    geometryShader_->setMat4("uView", ctx.camera->GetViewMatrix());
-    geometryShader_->setMat4("uProjection", ctx.camera->GetProjectionMatrix());
-    
-    // Collect render items
+    // Collect render items, grouped by material permutation
     std::vector<RenderItem> items;
     ctx.scene->collectRenderItems(items);
+    std::stable_sort(items.begin(), items.end(), [](const RenderItem& a, const RenderItem& b) {
+        return MaterialBinder::textureMask(a.material) < MaterialBinder::textureMask(b.material);
+    });
+    
+    if (occlusionCulling_ && culler_.isReady()) {
+        glm::mat4 viewProjection = ctx.camera->GetProjectionMatrix() * ctx.camera->GetViewMatrix();
+        culler_.prepare(items);
+        
+        // Phase 1: what last frame's depth does not hide
+        culler_.cullFirstPhase(viewProjection);
+        drawItems(ctx, items, true);
+        
+        // Phase 2: what this frame's depth so far does not hide, minus phase 1
+        culler_.buildHiZ(gbuffer_->getDepthTexture(), ctx.viewportWidth, ctx.viewportHeight, viewProjection);
+        culler_.cullSecondPhase(viewProjection);
+        drawItems(ctx, items, true);
+    } else {
+        drawItems(ctx, items, false);
+    }
     
-    // Render all meshes
-    for (const auto& item : items) {
+    // Unbind G-Buffer
+    gbuffer_->unbind();
+}
+
+void GBufferPass::drawItems(RenderContext& ctx, const std::vector<RenderItem>& items, bool indirect) {
+    if (indirect) {
+        culler_.bindCommands(true);
+    }
+    
+    uint32_t currentMask = ~0u;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const RenderItem& item = items[i];
         if (!item.mesh) continue;
         
+        // Switch permutation; uniforms are per program, so re-set the camera
+        uint32_t mask = MaterialBinder::textureMask(item.material);
+        if (mask != currentMask) {
+            currentMask = mask;
+            geometryShader_->usePermutation(MaterialBinder::permutation(mask));
+            geometryShader_->setMat4("uView", ctx.camera->GetViewMatrix());
+            geometryShader_->setMat4("uProjection", ctx.camera->GetProjectionMatrix());
+        }
+        
         // Set model matrix
         geometryShader_->setMat4("uModel", item.modelMatrix);
         
         // Bind material
         MaterialBinder::bind(*geometryShader_, item.material);
         
-        // Draw mesh
-        item.mesh->draw();
+        // Draw mesh; culled items have an instance count of zero
+        if (indirect) {
+            item.mesh->drawIndirect(OcclusionCuller::commandOffset(i));
+        } else {
+            item.mesh->draw();
+        }
     }
     
-    // Unbind G-Buffer
-    gbuffer_->unbind();
+    if (indirect) {
+        culler_.bindCommands(false);
+    }
+}
+
+void GBufferPass::enableOcclusionCulling(bool enable) {
+    occlusionCulling_ = enable;
+    
+    // The pyramid of the last culled frame says nothing about the next one
+    culler_.invalidate();
 }
 
 void GBufferPass::resize(int width, int height) {
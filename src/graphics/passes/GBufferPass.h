@@ -2,15 +2,22 @@
 
 #include "../RenderPass.h"
 #include "../ShaderProgram.h"
+#include "../OcclusionCuller.h"
 #include <memory>
+#include <vector>
 
 namespace kcShaders {
 
 class GBuffer;
+struct RenderItem;
 
 /**
  * GBufferPass: Geometry pass for deferred rendering
  * Renders scene geometry into G-Buffer (albedo, normal, position, material)
+ *
+ * With occlusion culling the items are drawn indirectly in two phases, see
+ * OcclusionCuller; the first phase draws what was visible last frame, the
+ * second what the depth of the first phase does not hide.
  */
 class GBufferPass : public RenderPass {
 public:
@@ -19,11 +26,28 @@ public:
     
     void execute(RenderContext& ctx) override;
     void resize(int width, int height) override;
+    const char* getName() const override { return "GBuffer"; }
+    
+    /**
+     * @brief Set the Hi-Z / culling compute shader (occlusion.comp)
+     */
+    void setOcclusionShader(ShaderProgram* shader) { culler_.setShader(shader); }
+    
+    /**
+     * @brief Enable or disable two-phase Hi-Z occlusion culling
+     */
+    void enableOcclusionCulling(bool enable);
+    bool isOcclusionCullingEnabled() const { return occlusionCulling_; }
 
 private:
+    void drawItems(RenderContext& ctx, const std::vector<RenderItem>& items, bool indirect);
+    
     GBuffer* gbuffer_;
     ShaderProgram* geometryShader_;
     bool firstFrame_ = true;
+    
+    OcclusionCuller culler_;
+    bool occlusionCulling_ = false;
 };
 
 } // namespace kcShaders
@@ -0,0 +1,218 @@
+#include "GTAOPass.h"
+#include "../gbuffer.h"
+#include "../RenderContext.h"
+#include "../RenderTargetPool.h"
+#include "../../scene/camera.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace kcShaders {
+
+namespace {
+
+// Must match local_size in gtao.comp
+constexpr int kGroupSize = 8;
+
+GLuint createTexture(GLenum internalFormat, int width, int height, int levels)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return texture;
+}
+
+void deleteTexture(GLuint& texture)
+{
+    if (texture != 0) {
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
+
+} // namespace
+
+GTAOPass::GTAOPass(GBuffer* gbuffer, ShaderProgram* gtaoShader, int width, int height)
+    : gbuffer_(gbuffer)
+    , gtaoShader_(gtaoShader)
+    , width_(width)
+    , height_(height)
+    , previousViewProjection_(1.0f)
+{
+}
+
+GTAOPass::~GTAOPass()
+{
+    cleanup();
+}
+
+void GTAOPass::setup()
+{
+    createTextures();
+    initialized_ = true;
+}
+
+void GTAOPass::createTextures()
+{
+    deleteTextures();
+
+    // Small viewports get fewer levels than kPyramidLevels
+    pyramidLevels_ = 1;
+    while (pyramidLevels_ < kPyramidLevels && (std::max(width_, height_) >> pyramidLevels_) > 0) {
+        ++pyramidLevels_;
+    }
+
+    historyTextures_[0] = createTexture(GL_RG16F, width_, height_, 1);
+    historyTextures_[1] = createTexture(GL_RG16F, width_, height_, 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    historyValid_ = false;
+}
+
+void GTAOPass::deleteTextures()
+{
+    deleteTexture(historyTextures_[0]);
+    deleteTexture(historyTextures_[1]);
+}
+
+void GTAOPass::dispatch(int width, int height)
+{
+    GLint loc = gtaoShader_->uniformLocation("uResolution");
+    if (loc >= 0) {
+        glUniform2i(loc, width, height);
+    }
+    glDispatchCompute((width + kGroupSize - 1) / kGroupSize, (height + kGroupSize - 1) / kGroupSize, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void GTAOPass::execute(RenderContext& ctx)
+{
+    if (!ctx.isValid() || !gbuffer_ || !gtaoShader_) {
+        std::cerr << "[GTAOPass] Invalid context or shader\n";
+        return;
+    }
+
+    if (!ctx.targetPool) {
+        std::cerr << "[GTAOPass] No render target pool\n";
+        return;
+    }
+
+    if (!initialized_) {
+        setup();
+    }
+
+    // Only needed until the temporal step has run
+    RenderTargetPool& pool = *ctx.targetPool;
+    const GLuint pyramidTexture = pool.acquire({GL_R32F, width_, height_, pyramidLevels_});
+    const GLuint rawTexture = pool.acquire({GL_R8, width_, height_});
+
+    const glm::mat4 projection = ctx.camera->GetProjectionMatrix();
+    const glm::mat4 view = ctx.camera->GetViewMatrix();
+    const glm::mat4 invProjection = glm::inverse(projection);
+
+    // === Step 1: Depth pyramid ===
+    gtaoShader_->usePermutation({{"GTAO_HIZ_INIT", ""}});
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gbuffer_->getDepthTexture());
+    gtaoShader_->setInt("GDepth", 0);
+    gtaoShader_->setMat4("invProjection", invProjection);
+    glBindImageTexture(0, pyramidTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    dispatch(width_, height_);
+
+    gtaoShader_->usePermutation({{"GTAO_HIZ_DOWNSAMPLE", ""}});
+    for (int level = 1; level < pyramidLevels_; ++level) {
+        int w = std::max(width_ >> level, 1);
+        int h = std::max(height_ >> level, 1);
+        glBindImageTexture(0, pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glBindImageTexture(1, pyramidTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        dispatch(w, h);
+    }
+
+    // === Step 2: Horizon search ===
+    // R2 sequence offsets: successive frames fill the gaps of the previous ones
+    frameIndex_ = (frameIndex_ + 1) % 64;
+    glm::vec2 frameNoise(std::fmod(frameIndex_ * 0.7548776662f, 1.0f),
+                         std::fmod(frameIndex_ * 0.5698402910f, 1.0f));
+
+    gtaoShader_->usePermutation({});
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gbuffer_->getNormalTexture());
+    gtaoShader_->setInt("hizTexture", 0);
+    gtaoShader_->setInt("GNormal", 1);
+    gtaoShader_->setMat4("view", view);
+    gtaoShader_->setMat4("invProjection", invProjection);
+    gtaoShader_->setFloat("projScale", projection[1][1] * 0.5f * static_cast<float>(height_));
+    gtaoShader_->setFloat("radius", radius_);
+    gtaoShader_->setFloat("power", power_);
+    gtaoShader_->setInt("sliceCount", std::max(sliceCount_, 1));
+    gtaoShader_->setInt("stepsPerSlice", std::max(stepsPerSlice_, 1));
+    gtaoShader_->setInt("maxMip", pyramidLevels_ - 1);
+    gtaoShader_->setVec2("frameNoise", frameNoise);
+    glBindImageTexture(0, rawTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+    dispatch(width_, height_);
+
+    // === Step 3: Temporal accumulation ===
+    int readIndex = historyIndex_;
+    int writeIndex = 1 - historyIndex_;
+
+    gtaoShader_->usePermutation({{"GTAO_TEMPORAL", ""}});
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, rawTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, historyTextures_[readIndex]);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    gtaoShader_->setInt("rawAO", 0);
+    gtaoShader_->setInt("historyIn", 1);
+    gtaoShader_->setInt("hizTexture", 2);
+    gtaoShader_->setMat4("invProjection", invProjection);
+    gtaoShader_->setMat4("reprojection", previousViewProjection_ * glm::inverse(view));
+    gtaoShader_->setBool("historyValid", historyValid_);
+    gtaoShader_->setFloat("historyWeight", historyWeight_);
+    glBindImageTexture(0, historyTextures_[writeIndex], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+    dispatch(width_, height_);
+
+    historyIndex_ = writeIndex;
+    previousViewProjection_ = projection * view;
+    historyValid_ = true;
+
+    // Unbind textures and images before the pool gets the targets back, a
+    // bound texture keeps its storage after trim() deletes it
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+    glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+
+    pool.release(pyramidTexture);
+    pool.release(rawTexture);
+}
+
+void GTAOPass::resize(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+
+    if (initialized_) {
+        createTextures();
+    }
+}
+
+void GTAOPass::cleanup()
+{
+    deleteTextures();
+    historyValid_ = false;
+    initialized_ = false;
+}
+
+} // namespace kcShaders
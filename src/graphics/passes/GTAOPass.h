@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include "../ShaderProgram.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace kcShaders {
+
+class GBuffer;
+
+/**
+ * GTAOPass: Ground-truth ambient occlusion in compute
+ *
+ * Alternative to SSAOPass with the same output (a full resolution R texture,
+ * 1 = unoccluded). Instead of testing a 32-sample hemisphere kernel it
+ * searches the horizon along a few screen-space slices per pixel and
+ * integrates the visible arc analytically:
+ *   1. Depth pyramid: linear view depth, each level keeps the closest depth
+ *   2. Horizons: 2 slices x 2 x 4 steps, far steps read coarser levels
+ *   3. Temporal: 3x3 depth-aware filter blended with reprojected history
+ * Slice directions rotate per frame, so accumulation covers many directions
+ * for the price of a few. All steps are permutations of one compute shader.
+ * The pyramid and the raw AO only live during execute() and come from the
+ * frame's RenderTargetPool; the two history textures are owned by the pass.
+ */
+class GTAOPass : public RenderPass {
+public:
+    static constexpr int kPyramidLevels = 5;
+
+    GTAOPass(GBuffer* gbuffer, ShaderProgram* gtaoShader, int width, int height);
+    ~GTAOPass() override;
+
+    void setup() override;
+    void execute(RenderContext& ctx) override;
+    void resize(int width, int height) override;
+    void cleanup() override;
+    const char* getName() const override { return "GTAO"; }
+
+    /**
+     * @brief Get the final AO texture (temporally filtered, full resolution)
+     * @return AO texture ID, AO in the red channel
+     */
+    GLuint getSSAOTexture() const { return historyTextures_[historyIndex_]; }
+
+    /**
+     * @brief Set GTAO parameters
+     * @param radius Search radius in world units
+     * @param power Power curve for darkening effect
+     */
+    void setParameters(float radius, float power) {
+        radius_ = radius;
+        power_ = power;
+    }
+
+    /**
+     * @brief Set the slice and step counts traced per pixel and frame
+     */
+    void setQuality(int sliceCount, int stepsPerSlice) {
+        sliceCount_ = sliceCount;
+        stepsPerSlice_ = stepsPerSlice;
+    }
+
+    /**
+     * @brief Drop the accumulated history, e.g. after the pass was skipped
+     */
+    void resetHistory() { historyValid_ = false; }
+
+private:
+    void createTextures();
+    void deleteTextures();
+    void dispatch(int width, int height);
+
+    GBuffer* gbuffer_;
+    ShaderProgram* gtaoShader_;
+    int width_;
+    int height_;
+
+    // GTAO parameters
+    float radius_ = 0.5f;
+    float power_ = 1.5f;
+    int sliceCount_ = 2;
+    int stepsPerSlice_ = 4;
+    float historyWeight_ = 0.9f;
+
+    int pyramidLevels_ = 1;           // Of the pooled R32F view depth pyramid
+    GLuint historyTextures_[2] = {0, 0};  // RG16F AO + view depth, ping-pong
+    int historyIndex_ = 0;            // Texture written last frame
+
+    glm::mat4 previousViewProjection_;
+    bool historyValid_ = false;
+    unsigned frameIndex_ = 0;
+    bool initialized_ = false;
+};
+
+} // namespace kcShaders
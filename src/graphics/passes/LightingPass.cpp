@@ -4,6 +4,7 @@
 #include "../../scene/scene.h"
 #include "../../scene/camera.h"
 #include "../../scene/light.h"
+#include <algorithm>
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -38,8 +39,14 @@ void LightingPass::execute(RenderContext& ctx) {
     // Disable depth test for fullscreen quad
     glDisable(GL_DEPTH_TEST);
     
-    // Use lighting shader
-    lightingShader_->use();
+    // Use the lighting shader permutation matching the available inputs
+    ShaderDefines defines;
+    if (ssaoTexture_ != 0) defines.emplace_back("USE_SSAO", "");
+    if (shadows_.texture != 0) defines.emplace_back("USE_SHADOWS", "");
+    if (localShadows_ && localShadows_->texture != 0 && !localShadows_->firstViews.empty()) {
+        defines.emplace_back("USE_LOCAL_SHADOWS", "");
+    }
+    lightingShader_->usePermutation(defines);
     
     // Bind G-Buffer textures
     bindGBufferTextures();
@@ -47,6 +54,8 @@ void LightingPass::execute(RenderContext& ctx) {
     // Set camera uniforms
     lightingShader_->setVec3("viewPos", ctx.camera->GetPosition());
     lightingShader_->setMat4("uView", ctx.camera->GetViewMatrix());
+    lightingShader_->setMat4("uInvViewProj",
+        glm::inverse(ctx.camera->GetProjectionMatrix() * ctx.camera->GetViewMatrix()));
     
     // Set light uniforms
     setLightUniforms(ctx);
@@ -76,11 +85,13 @@ void LightingPass::execute(RenderContext& ctx) {
     // Re-enable depth test
     glEnable(GL_DEPTH_TEST);
     
-    // Unbind textures (including SSAO at unit 4 and shadow map at unit 5)
-    for (int i = 0; i < 6; i++) {
+    // Unbind textures (SSAO at unit 4, shadow map at unit 5, shadow atlas at unit 6)
+    for (int i = 0; i < 7; i++) {
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     glActiveTexture(GL_TEXTURE0);
     
     // Unbind framebuffer
@@ -98,8 +109,8 @@ void LightingPass::resize(int width, int height) {
 void LightingPass::bindGBufferTextures() {
     // Bind G-Buffer textures to texture units 0-3
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gbuffer_->getPositionTexture());
-    lightingShader_->setInt("GPosition", 0);
+    glBindTexture(GL_TEXTURE_2D, gbuffer_->getDepthTexture());
+    lightingShader_->setInt("GDepth", 0);
 
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, gbuffer_->getNormalTexture());
@@ -118,20 +129,16 @@ void LightingPass::bindGBufferTextures() {
         glActiveTexture(GL_TEXTURE4);
         glBindTexture(GL_TEXTURE_2D, ssaoTexture_);
         lightingShader_->setInt("GSSAO", 4);
-        lightingShader_->setInt("useSSAO", 1);
-    } else {
-        lightingShader_->setInt("useSSAO", 0);
     }
     
     // Bind shadow map texture if available
-    if (shadowMapTexture_ != 0) {
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, shadowMapTexture_);
-        lightingShader_->setInt("shadowMap", 5);
-        lightingShader_->setInt("useShadows", 1);
-        lightingShader_->setMat4("lightSpaceMatrix", lightSpaceMatrix_);
-    } else {
-        lightingShader_->setInt("useShadows", 0);
+    if (shadows_.texture != 0) {
+        shadows_.bind(lightingShader_, 5);
+    }
+    
+    // Bind the point and spot light shadow atlas if available
+    if (localShadows_ && localShadows_->texture != 0 && !localShadows_->firstViews.empty()) {
+        localShadows_->bind(lightingShader_, 6);
     }
 }
 
@@ -171,6 +178,10 @@ void LightingPass::setLightUniforms(RenderContext& ctx) {
                 lightingShader_->setFloat(base + ".constant", pointLight->constant);
                 lightingShader_->setFloat(base + ".linear", pointLight->linear);
                 lightingShader_->setFloat(base + ".quadratic", pointLight->quadratic);
+                lightingShader_->setFloat(base + ".range", ComputeLightRange(
+                    pointLight->color * pointLight->intensity, pointLight->constant, pointLight->linear,
+                    pointLight->quadratic, std::max(pointLight->radius, 0.0f)));
+                lightingShader_->setInt(base + ".shadowView", localShadows_ ? localShadows_->viewFor(light) : -1);
                 numPointLights++;
                 break;
             }
@@ -189,6 +200,10 @@ void LightingPass::setLightUniforms(RenderContext& ctx) {
                 lightingShader_->setFloat(base + ".constant", spotLight->constant);
                 lightingShader_->setFloat(base + ".linear", spotLight->linear);
                 lightingShader_->setFloat(base + ".quadratic", spotLight->quadratic);
+                lightingShader_->setFloat(base + ".range", ComputeLightRange(
+                    spotLight->color * spotLight->intensity, spotLight->constant, spotLight->linear,
+                    spotLight->quadratic, 0.0f));
+                lightingShader_->setInt(base + ".shadowView", localShadows_ ? localShadows_->viewFor(light) : -1);
                 numSpotLights++;
                 break;
             }
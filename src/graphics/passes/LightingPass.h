@@ -2,6 +2,8 @@
 
 #include "../RenderPass.h"
 #include "../ShaderProgram.h"
+#include "ShadowMapPass.h"
+#include "ShadowAtlasPass.h"
 #include <glm/glm.hpp>
 
 namespace kcShaders {
@@ -20,6 +22,7 @@ public:
     
     void execute(RenderContext& ctx) override;
     void resize(int width, int height) override;
+    const char* getName() const override { return "Lighting"; }
     
     // Update FBO reference (called when renderer resizes)
     void setFBO(GLuint fbo, int width, int height) {
@@ -33,10 +36,14 @@ public:
         ssaoTexture_ = texture;
     }
     
-    // Set shadow map texture (0 to disable) and light space matrix
-    void setShadowMap(GLuint texture, const glm::mat4& lightSpaceMatrix) {
-        shadowMapTexture_ = texture;
-        lightSpaceMatrix_ = lightSpaceMatrix;
+    // Set shadow cascades (texture 0 to disable)
+    void setShadowCascades(const ShadowCascades& cascades) {
+        shadows_ = cascades;
+    }
+    
+    // Set point and spot light shadows (nullptr to disable)
+    void setLocalShadows(const LocalShadows* shadows) {
+        localShadows_ = shadows;
     }
 
 private:
@@ -50,8 +57,8 @@ private:
     int fbWidth_;
     int fbHeight_;
     GLuint ssaoTexture_ = 0;  // SSAO texture (0 = disabled)
-    GLuint shadowMapTexture_ = 0;  // Shadow map texture (0 = disabled)
-    glm::mat4 lightSpaceMatrix_;   // Light space transform matrix
+    ShadowCascades shadows_;       // Cascaded shadow map (texture 0 = disabled)
+    const LocalShadows* localShadows_ = nullptr;  // Shadow atlas (nullptr = disabled)
     bool firstFrame_ = true;
 };
 
@@ -3,15 +3,26 @@
 #include "../RenderContext.h"
 #include "../../scene/camera.h"
 #include <glm/gtc/random.hpp>
+#include <algorithm>
 #include <iostream>
 
 namespace kcShaders {
 
-SSAOPass::SSAOPass(GBuffer* gbuffer, 
+namespace {
+
+// Size of the SSAOKernel block in ssao.frag
+constexpr int kMaxKernelSize = 64;
+
+// Uniform buffer binding point of the kernel
+constexpr GLuint kKernelBinding = 0;
+
+} // namespace
+
+SSAOPass::SSAOPass(GBuffer* gbuffer,
                    ShaderProgram* ssaoShader,
                    ShaderProgram* blurShader,
-                   GLuint quadVAO, 
-                   int width, 
+                   GLuint quadVAO,
+                   int width,
                    int height)
     : gbuffer_(gbuffer)
     , ssaoShader_(ssaoShader)
@@ -28,61 +39,41 @@ SSAOPass::~SSAOPass()
 }
 
 void SSAOPass::setup()
-{   
+{
+    sampleCount_ = std::min(std::max(sampleCount_, 1), kMaxKernelSize);
     generateSampleKernel();
     generateNoiseTexture();
-    createFramebuffers();
+    
+    if (fbo_ == 0) {
+        glGenFramebuffers(1, &fbo_);
+    }
     
     initialized_ = true;
 }
 
-void SSAOPass::createFramebuffers()
+void SSAOPass::setDownsample(int downsample)
 {
-    // Clean up existing framebuffers if any
-    if (ssaoFBO_ != 0) {
-        glDeleteFramebuffers(1, &ssaoFBO_);
-        glDeleteTextures(1, &ssaoTexture_);
-        glDeleteFramebuffers(1, &ssaoBlurFBO_);
-        glDeleteTextures(1, &ssaoBlurTexture_);
-    }
-    
-    // Create SSAO framebuffer and texture
-    glGenFramebuffers(1, &ssaoFBO_);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO_);
-    
-    glGenTextures(1, &ssaoTexture_);
-    glBindTexture(GL_TEXTURE_2D, ssaoTexture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width_, height_, 0, GL_RED, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoTexture_, 0);
-    
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "[SSAOPass] SSAO framebuffer not complete!\n";
+    downsample = downsample >= 4 ? 4 : (downsample >= 2 ? 2 : 1);
+    if (downsample == downsample_) {
+        return;
     }
     
-    // Create blur framebuffer and texture
-    glGenFramebuffers(1, &ssaoBlurFBO_);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO_);
-    
-    glGenTextures(1, &ssaoBlurTexture_);
-    glBindTexture(GL_TEXTURE_2D, ssaoBlurTexture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width_, height_, 0, GL_RED, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoBlurTexture_, 0);
-    
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "[SSAOPass] SSAO blur framebuffer not complete!\n";
+    // Intermediates are sized per execute; the full resolution output is unchanged
+    downsample_ = downsample;
+}
+
+void SSAOPass::releaseOutput()
+{
+    if (pool_ && outputTexture_ != 0) {
+        pool_->release(outputTexture_);
     }
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    
-    // std::cout << "[SSAOPass] Framebuffers created (" << width_ << "x" << height_ << ")\n";
+    outputTexture_ = 0;
+}
+
+void SSAOPass::bindTarget(GLuint texture)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
 }
 
 void SSAOPass::generateSampleKernel()
@@ -108,6 +99,20 @@ void SSAOPass::generateSampleKernel()
         
         ssaoKernel_.push_back(sample);
     }
+    
+    // Upload once; std140 pads each vec3 to a vec4
+    std::vector<glm::vec4> padded(kMaxKernelSize, glm::vec4(0.0f));
+    for (size_t i = 0; i < ssaoKernel_.size() && i < padded.size(); ++i) {
+        padded[i] = glm::vec4(ssaoKernel_[i], 0.0f);
+    }
+    
+    if (kernelUBO_ == 0) {
+        glGenBuffers(1, &kernelUBO_);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, kernelUBO_);
+    glBufferData(GL_UNIFORM_BUFFER, padded.size() * sizeof(glm::vec4), padded.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    kernelProgram_ = 0;
 }
 
 void SSAOPass::generateNoiseTexture()
@@ -138,13 +143,25 @@ void SSAOPass::generateNoiseTexture()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 }
 
-void SSAOPass::bindGBufferTextures()
+void SSAOPass::bindKernelBlock()
 {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gbuffer_->getPositionTexture());
-    
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gbuffer_->getNormalTexture());
+    // Block bindings are program state, so only redo them after a (re)load
+    GLuint program = ssaoShader_->id();
+    if (program != kernelProgram_) {
+        GLuint blockIndex = glGetUniformBlockIndex(program, "SSAOKernel");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, blockIndex, kKernelBinding);
+        }
+        kernelProgram_ = program;
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, kKernelBinding, kernelUBO_);
+}
+
+void SSAOPass::drawFullscreen()
+{
+    glBindVertexArray(quadVAO_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
 }
 
 void SSAOPass::execute(RenderContext& ctx)
@@ -154,78 +171,142 @@ void SSAOPass::execute(RenderContext& ctx)
         return;
     }
     
+    const GLuint depthTexture = gbuffer_ ? gbuffer_->getDepthTexture() : depthSource_;
+    if (depthTexture == 0) {
+        return;
+    }
+    
+    if (!ctx.targetPool) {
+        std::cerr << "[SSAOPass] No render target pool\n";
+        return;
+    }
+    
     if (!initialized_) {
         setup();
     }
     
-    // === Pass 1: Generate SSAO ===
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO_);
-    glViewport(0, 0, width_, height_);
-    glClear(GL_COLOR_BUFFER_BIT);
+    // The output is held until the size (or the pool) changes
+    const RenderTargetDesc outputDesc{GL_R8, width_, height_};
+    if (ctx.targetPool != pool_ || outputDesc != outputDesc_) {
+        releaseOutput();
+        pool_ = ctx.targetPool;
+        outputDesc_ = outputDesc;
+    }
+    if (outputTexture_ == 0) {
+        outputTexture_ = pool_->acquire(outputDesc_);
+    }
+    
+    const int w = scaledWidth();
+    const int h = scaledHeight();
+    const glm::mat4 projection = ctx.camera->GetProjectionMatrix();
+    const glm::mat4 invProjection = glm::inverse(projection);
     
-    // Disable depth test and blend for fullscreen quad
+    // Disable depth test and blend for fullscreen passes
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
     
-    ssaoShader_->use();
-    
-    // Bind G-Buffer textures
-    bindGBufferTextures();
-    
-    // Bind noise texture
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, noiseTexture_);
+    // Intermediates, back to the pool at the end of the pass
+    const GLuint prepareTexture = pool_->acquire({GL_RGBA16F, w, h});
+    const GLuint blurTempTexture = pool_->acquire({GL_R8, w, h});
+    const GLuint rawTexture = downsample_ == 1 ? outputTexture_ : pool_->acquire({GL_R8, w, h});
+    
+    // === Pass 1: Downsample depth/normal to view normal + view depth ===
+    bindTarget(prepareTexture);
+    glViewport(0, 0, w, h);
+    
+    if (gbuffer_) {
+        blurShader_->usePermutation({{"SSAO_PREPARE", ""}});
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gbuffer_->getNormalTexture());
+        blurShader_->setInt("gNormal", 1);
+    } else {
+        blurShader_->usePermutation({{"SSAO_PREPARE", ""}, {"NORMALS_FROM_DEPTH", ""}});
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    blurShader_->setInt("gDepth", 0);
+    blurShader_->setMat4("invProjection", invProjection);
+    blurShader_->setMat4("view", ctx.camera->GetViewMatrix());
+    blurShader_->setInt("downsample", downsample_);
+    drawFullscreen();
     
-    // Set uniforms
-    ssaoShader_->setInt("gPosition", 0);
-    ssaoShader_->setInt("gNormal", 1);
-    ssaoShader_->setInt("texNoise", 2);
+    // === Pass 2: Generate SSAO ===
+    bindTarget(rawTexture);
     
-    // Upload sample kernel
-    for (int i = 0; i < sampleCount_; ++i) {
-        std::string uniformName = "samples[" + std::to_string(i) + "]";
-        ssaoShader_->setVec3(uniformName, ssaoKernel_[i]);
-    }
+    ssaoShader_->use();
+    bindKernelBlock();
     
-    // Camera matrices
-    ssaoShader_->setMat4("projection", ctx.camera->GetProjectionMatrix());
-    ssaoShader_->setMat4("view", ctx.camera->GetViewMatrix());
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, prepareTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, noiseTexture_);
+    ssaoShader_->setInt("gDepthNormal", 0);
+    ssaoShader_->setInt("texNoise", 1);
     
-    // SSAO parameters
+    ssaoShader_->setMat4("projection", projection);
+    ssaoShader_->setMat4("invProjection", invProjection);
     ssaoShader_->setFloat("radius", radius_);
     ssaoShader_->setFloat("bias", bias_);
     ssaoShader_->setFloat("power", power_);
-    ssaoShader_->setInt("kernelSize", sampleCount_);
-    
-    // Set noise scale (no setVec2 method, use direct uniform)
-    GLint noiseScaleLoc = ssaoShader_->uniformLocation("noiseScale");
-    if (noiseScaleLoc >= 0) {
-        glUniform2f(noiseScaleLoc, 
-            static_cast<float>(width_) / 4.0f,
-            static_cast<float>(height_) / 4.0f);
-    }
+    ssaoShader_->setInt("kernelSize", static_cast<int>(ssaoKernel_.size()));
+    ssaoShader_->setVec2("noiseScale", glm::vec2(w / 4.0f, h / 4.0f));
+    drawFullscreen();
     
-    // Draw fullscreen quad
-    glBindVertexArray(quadVAO_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-    
-    // === Pass 2: Blur SSAO ===
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO_);
-    glClear(GL_COLOR_BUFFER_BIT);
-    
-    blurShader_->use();
-    
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, ssaoTexture_);
+    // === Pass 3: Separable depth-aware blur ===
+    blurShader_->usePermutation({});
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, prepareTexture);
     blurShader_->setInt("ssaoInput", 0);
+    blurShader_->setInt("gDepthNormal", 1);
     
-    // Render fullscreen quad
-    glBindVertexArray(quadVAO_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+    bindTarget(blurTempTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, rawTexture);
+    blurShader_->setVec2("blurDirection", glm::vec2(1.0f, 0.0f));
+    drawFullscreen();
+    
+    // The raw AO is dead after the horizontal pass; at full resolution it
+    // already is the output, so the vertical pass writes the final result
+    bindTarget(rawTexture);
+    glBindTexture(GL_TEXTURE_2D, blurTempTexture);
+    blurShader_->setVec2("blurDirection", glm::vec2(0.0f, 1.0f));
+    drawFullscreen();
+    
+    // === Pass 4: Joint bilateral upsample ===
+    if (downsample_ > 1) {
+        bindTarget(outputTexture_);
+        glViewport(0, 0, width_, height_);
+        
+        blurShader_->usePermutation({{"SSAO_UPSAMPLE", ""}});
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, rawTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, prepareTexture);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        blurShader_->setInt("ssaoInput", 0);
+        blurShader_->setInt("gDepthNormal", 1);
+        blurShader_->setInt("gDepth", 2);
+        blurShader_->setMat4("invProjection", invProjection);
+        drawFullscreen();
+    }
     
+    // Detach and unbind before the pool gets the targets back: a texture left
+    // attached to fbo_ keeps its storage after trim() deletes it
+    bindTarget(0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glViewport(0, 0, width_, height_);
+    
+    pool_->release(prepareTexture);
+    pool_->release(blurTempTexture);
+    if (rawTexture != outputTexture_) {
+        pool_->release(rawTexture);
+    }
 }
 
 void SSAOPass::resize(int width, int height)
@@ -233,25 +314,17 @@ void SSAOPass::resize(int width, int height)
     width_ = width;
     height_ = height;
     
-    if (initialized_) {
-        createFramebuffers();
-    }
+    // The old output goes back to the pool now rather than at the next execute
+    releaseOutput();
 }
 
 void SSAOPass::cleanup()
 {
-    if (ssaoFBO_ != 0) {
-        glDeleteFramebuffers(1, &ssaoFBO_);
-        glDeleteTextures(1, &ssaoTexture_);
-        ssaoFBO_ = 0;
-        ssaoTexture_ = 0;
-    }
+    releaseOutput();
     
-    if (ssaoBlurFBO_ != 0) {
-        glDeleteFramebuffers(1, &ssaoBlurFBO_);
-        glDeleteTextures(1, &ssaoBlurTexture_);
-        ssaoBlurFBO_ = 0;
-        ssaoBlurTexture_ = 0;
+    if (fbo_ != 0) {
+        glDeleteFramebuffers(1, &fbo_);
+        fbo_ = 0;
     }
     
     if (noiseTexture_ != 0) {
@@ -259,6 +332,12 @@ void SSAOPass::cleanup()
         noiseTexture_ = 0;
     }
     
+    if (kernelUBO_ != 0) {
+        glDeleteBuffers(1, &kernelUBO_);
+        kernelUBO_ = 0;
+    }
+    kernelProgram_ = 0;
+    
     ssaoKernel_.clear();
     initialized_ = false;
 }
@@ -2,6 +2,7 @@
 
 #include "../RenderPass.h"
 #include "../ShaderProgram.h"
+#include "../RenderTargetPool.h"
 #include <glad/glad.h>
 #include <vector>
 #include <glm/glm.hpp>
@@ -13,38 +14,58 @@ class GBuffer;
 /**
  * SSAOPass: Screen-Space Ambient Occlusion pass
  * Generates SSAO texture from G-Buffer depth and normal information
+ *
+ * AO is computed at full, half or quarter resolution:
+ *   1. Prepare: depth/normal downsampled to view normal + view depth
+ *   2. SSAO: hemisphere kernel (uniform block, uploaded once) at that resolution
+ *   3. Blur: separable depth-aware Gaussian, horizontal then vertical
+ *   4. Upsample: joint bilateral upsample to full resolution (skipped at full)
+ * The prepare, blur and upsample steps are permutations of the blur shader.
+ * The intermediate targets come from the frame's RenderTargetPool and go back
+ * to it at the end of the pass; only the full resolution output is held. At
+ * full resolution the raw AO target is that output: the vertical blur writes
+ * the result over it once the horizontal blur has read it.
+ * Without a G-Buffer (forward depth pre-pass) the pass reads only a depth
+ * texture and the prepare step reconstructs normals from it.
  */
 class SSAOPass : public RenderPass {
 public:
     /**
      * @brief Construct SSAO pass
-     * @param gbuffer G-Buffer containing position and normal data
+     * @param gbuffer G-Buffer containing depth and normal data (nullptr: see setDepthSource)
      * @param ssaoShader Shader for computing SSAO
-     * @param blurShader Shader for blurring SSAO result
+     * @param blurShader Shader for preparing, blurring and upsampling SSAO
      * @param quadVAO VAO for fullscreen quad
      * @param width Viewport width
      * @param height Viewport height
      */
-    SSAOPass(GBuffer* gbuffer, 
+    SSAOPass(GBuffer* gbuffer,
              ShaderProgram* ssaoShader,
              ShaderProgram* blurShader,
-             GLuint quadVAO, 
-             int width, 
+             GLuint quadVAO,
+             int width,
              int height);
-    
+
     ~SSAOPass() override;
-    
+
     void setup() override;
     void execute(RenderContext& ctx) override;
     void resize(int width, int height) override;
     void cleanup() override;
-    
+    const char* getName() const override { return "SSAO"; }
+
     /**
-     * @brief Get the final SSAO texture (after blur)
+     * @brief Get the final SSAO texture (after blur, full resolution)
      * @return SSAO texture ID
      */
-    GLuint getSSAOTexture() const { return ssaoBlurTexture_; }
-    
+    GLuint getSSAOTexture() const { return outputTexture_; }
+
+    /**
+     * @brief Set the depth texture read when the pass has no G-Buffer
+     * @param depthTexture Full resolution depth; normals are reconstructed from it
+     */
+    void setDepthSource(GLuint depthTexture) { depthSource_ = depthTexture; }
+
     /**
      * @brief Set SSAO parameters
      * @param radius Sampling radius in view space
@@ -56,7 +77,7 @@ public:
         bias_ = bias;
         power_ = power;
     }
-    
+
     /**
      * @brief Set sample count (must call setup() again after changing)
      * @param count Number of samples (recommended: 8-64)
@@ -65,38 +86,54 @@ public:
         sampleCount_ = count;
     }
 
+    /**
+     * @brief Set the AO resolution divisor
+     * @param downsample 1 = full, 2 = half (default), 4 = quarter resolution
+     */
+    void setDownsample(int downsample);
+    int getDownsample() const { return downsample_; }
+
 private:
-    void createFramebuffers();
+    void releaseOutput();
+    void bindTarget(GLuint texture);
     void generateSampleKernel();
     void generateNoiseTexture();
-    void bindGBufferTextures();
-    
+    void bindKernelBlock();
+    void drawFullscreen();
+
+    int scaledWidth() const { return (width_ + downsample_ - 1) / downsample_; }
+    int scaledHeight() const { return (height_ + downsample_ - 1) / downsample_; }
+
     GBuffer* gbuffer_;
+    GLuint depthSource_ = 0;         // Depth without normals, used when gbuffer_ is null
     ShaderProgram* ssaoShader_;
     ShaderProgram* blurShader_;
     GLuint quadVAO_;
     int width_;
     int height_;
-    
+
     // SSAO parameters
     float radius_ = 0.5f;
     float bias_ = 0.025f;
     float power_ = 2.0f;
     int sampleCount_ = 32;
-    
-    // SSAO textures and framebuffers
-    GLuint ssaoFBO_ = 0;
-    GLuint ssaoTexture_ = 0;         // Raw SSAO output
-    GLuint ssaoBlurFBO_ = 0;
-    GLuint ssaoBlurTexture_ = 0;     // Blurred SSAO output
-    
+    int downsample_ = 2;
+
+    // One framebuffer, each step attaches its target. The intermediates (view
+    // normal + depth, raw AO, horizontal blur) are pooled per execute
+    GLuint fbo_ = 0;
+    RenderTargetPool* pool_ = nullptr;   // Pool of the last execute, owns outputTexture_
+    GLuint outputTexture_ = 0;           // Final SSAO (full resolution), held across frames
+    RenderTargetDesc outputDesc_;
+
     // Noise texture for sample rotation
     GLuint noiseTexture_ = 0;
-    
-    // Sample kernel
+
+    // Sample kernel, kept in a uniform buffer bound to the SSAOKernel block
     std::vector<glm::vec3> ssaoKernel_;
-    
-    bool firstFrame_ = true;
+    GLuint kernelUBO_ = 0;
+    GLuint kernelProgram_ = 0;       // Program whose block binding was last set
+
     bool initialized_ = false;
 };
 
@@ -0,0 +1,551 @@
+#include "ShadowAtlasPass.h"
+#include "../Frustum.h"
+#include "../RenderContext.h"
+#include "../../scene/scene.h"
+#include "../../scene/camera.h"
+#include "../../scene/light.h"
+#include "../../scene/mesh.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace kcShaders {
+
+namespace {
+
+// Layout of the ShadowAtlasViews block in shadows.glsl (std140)
+struct GpuShadowViews {
+    glm::mat4 matrices[LocalShadows::kMaxViews];
+    glm::vec4 rects[LocalShadows::kMaxViews];   // Atlas uv offset xy, scale zw
+    glm::vec4 params[LocalShadows::kMaxViews];  // Texel scale, near, far
+};
+
+// Cube face directions and up vectors, in the order shadows.glsl selects them
+const glm::vec3 kFaceDirections[6] = {
+    { 1.0f,  0.0f,  0.0f}, {-1.0f,  0.0f,  0.0f},
+    { 0.0f,  1.0f,  0.0f}, { 0.0f, -1.0f,  0.0f},
+    { 0.0f,  0.0f,  1.0f}, { 0.0f,  0.0f, -1.0f}
+};
+const glm::vec3 kFaceUps[6] = {
+    {0.0f, -1.0f,  0.0f}, {0.0f, -1.0f,  0.0f},
+    {0.0f,  0.0f,  1.0f}, {0.0f,  0.0f, -1.0f},
+    {0.0f, -1.0f,  0.0f}, {0.0f, -1.0f,  0.0f}
+};
+
+// Whether an item's world bounds reach into a light's range
+bool itemInRange(const RenderItem& item, const glm::vec3& center, float radius)
+{
+    glm::vec3 boundsMin, boundsMax;
+    transformBounds(item.modelMatrix, item.mesh->GetBoundsMin(), item.mesh->GetBoundsMax(), boundsMin, boundsMax);
+    glm::vec3 d = center - glm::clamp(center, boundsMin, boundsMax);
+    return glm::dot(d, d) <= radius * radius;
+}
+
+// Whether the shadow a box casts from a point light can reach the camera
+// frustum. The shadow lies on rays from the light through the box, between
+// the box and the end of the range; the corners pushed out by range over
+// the box's distance span all of them, and the range sphere bounds them.
+bool shadowVisible(const Frustum& camera, const glm::vec3& lightPos, float range,
+                   const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    float nearest = glm::length(lightPos - glm::clamp(lightPos, boundsMin, boundsMax));
+    if (nearest <= 0.0f) {
+        return true;  // Light inside the box, shadows all around
+    }
+
+    float scale = std::max(range / nearest, 1.0f);
+    glm::vec3 volumeMin = boundsMin;
+    glm::vec3 volumeMax = boundsMax;
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x,
+                         (i & 2) ? boundsMax.y : boundsMin.y,
+                         (i & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec3 end = lightPos + (corner - lightPos) * scale;
+        volumeMin = glm::min(volumeMin, end);
+        volumeMax = glm::max(volumeMax, end);
+    }
+    volumeMin = glm::max(volumeMin, lightPos - glm::vec3(range));
+    volumeMax = glm::min(volumeMax, lightPos + glm::vec3(range));
+    return camera.intersectsBox(volumeMin, volumeMax);
+}
+
+int floorPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result * 2 <= value) {
+        result *= 2;
+    }
+    return result;
+}
+
+} // namespace
+
+int LocalShadows::viewFor(const Light* light) const
+{
+    auto it = firstViews.find(light);
+    return it != firstViews.end() ? it->second : -1;
+}
+
+void LocalShadows::bind(ShaderProgram* shader, int textureUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    shader->setInt("shadowAtlas", textureUnit);
+
+    // Every permutation is its own program with its own block binding
+    GLuint program = shader->id();
+    GLuint blockIndex = glGetUniformBlockIndex(program, "ShadowAtlasViews");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, blockIndex, kViewBinding);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, kViewBinding, viewBuffer);
+}
+
+ShadowAtlasPass::ShadowAtlasPass(ShaderProgram* atlasShader, int atlasSize)
+    : atlasShader_(atlasShader)
+    , atlasSize_(atlasSize)
+    , atlas_(atlasSize, 128)
+{
+}
+
+ShadowAtlasPass::~ShadowAtlasPass()
+{
+    cleanup();
+}
+
+void ShadowAtlasPass::setup()
+{
+    glGenTextures(1, &atlasTexture_);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, atlasSize_, atlasSize_, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &atlasFBO_);
+    glBindFramebuffer(GL_FRAMEBUFFER, atlasFBO_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlasTexture_, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[ShadowAtlasPass] Atlas framebuffer is not complete\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenBuffers(1, &viewBuffer_);
+    glBindBuffer(GL_UNIFORM_BUFFER, viewBuffer_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(GpuShadowViews), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    shadows_ = LocalShadows();
+    shadows_.texture = atlasTexture_;
+    shadows_.viewBuffer = viewBuffer_;
+}
+
+void ShadowAtlasPass::cleanup()
+{
+    if (atlasTexture_ != 0) {
+        glDeleteTextures(1, &atlasTexture_);
+        atlasTexture_ = 0;
+    }
+    if (atlasFBO_ != 0) {
+        glDeleteFramebuffers(1, &atlasFBO_);
+        atlasFBO_ = 0;
+    }
+    if (viewBuffer_ != 0) {
+        glDeleteBuffers(1, &viewBuffer_);
+        viewBuffer_ = 0;
+    }
+    batch_.release();
+    lights_.clear();
+    atlas_.clear();
+    cachedItems_.clear();
+    shadows_ = LocalShadows();
+}
+
+void ShadowAtlasPass::enableCaching(bool enable)
+{
+    cachingEnabled_ = enable;
+    invalidateCache();
+}
+
+void ShadowAtlasPass::invalidateCache()
+{
+    for (auto& entry : lights_) {
+        entry.second.dirty = true;
+        entry.second.drawnCasters.clear();
+    }
+    cachedItems_.clear();
+}
+
+bool ShadowAtlasPass::allocateTiles(LightShadow& shadow, int tileSize)
+{
+    for (int i = 0; i < shadow.viewCount; ++i) {
+        if (!atlas_.allocate(tileSize, shadow.views[i].tile)) {
+            releaseTiles(shadow);
+            return false;
+        }
+    }
+
+    // New tiles hold someone else's depth until drawn
+    shadow.rendered = false;
+    shadow.dirty = true;
+    return true;
+}
+
+void ShadowAtlasPass::releaseTiles(LightShadow& shadow)
+{
+    for (ShadowView& view : shadow.views) {
+        atlas_.release(view.tile);
+    }
+    shadow.rendered = false;
+}
+
+void ShadowAtlasPass::renderLight(const LightShadow& shadow, const std::vector<RenderItem>& items)
+{
+    // Clear the light's tiles; clears use the first scissor rectangle
+    glEnable(GL_SCISSOR_TEST);
+    for (int i = 0; i < shadow.viewCount; ++i) {
+        const ShadowAtlas::Tile& tile = shadow.views[i].tile;
+        glScissorIndexed(0, tile.x, tile.y, tile.size, tile.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // One viewport per view, selected by gl_ViewportIndex in shadow_atlas.geom
+    for (int i = 0; i < shadow.viewCount; ++i) {
+        const ShadowAtlas::Tile& tile = shadow.views[i].tile;
+        glViewportIndexedf(i, static_cast<float>(tile.x), static_cast<float>(tile.y),
+                           static_cast<float>(tile.size), static_cast<float>(tile.size));
+        glScissorIndexed(i, tile.x, tile.y, tile.size, tile.size);
+        atlasShader_->setMat4("viewMatrices[" + std::to_string(i) + "]", shadow.views[i].wanted.matrix);
+    }
+    atlasShader_->setInt("viewCount", shadow.viewCount);
+
+    batch_.clear();
+    for (uint32_t index : shadow.casters) {
+        batch_.add(items[index].mesh, items[index].modelMatrix);
+    }
+    batch_.draw(atlasShader_);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+void ShadowAtlasPass::uploadViews(const std::vector<LightShadow*>& lights)
+{
+    GpuShadowViews gpu = {};
+    shadows_.firstViews.clear();
+
+    int viewCount = 0;
+    float atlasScale = 1.0f / static_cast<float>(atlasSize_);
+    for (const LightShadow* shadow : lights) {
+        if (!shadow->rendered || viewCount + shadow->viewCount > LocalShadows::kMaxViews) {
+            continue;
+        }
+
+        shadows_.firstViews[shadow->light] = viewCount;
+        for (int i = 0; i < shadow->viewCount; ++i) {
+            const ShadowView& view = shadow->views[i];
+            gpu.matrices[viewCount] = view.drawn.matrix;
+            gpu.rects[viewCount] = glm::vec4(view.tile.x, view.tile.y, view.tile.size, view.tile.size) * atlasScale;
+            gpu.params[viewCount] = glm::vec4(view.drawn.texelScale, view.drawn.nearPlane, view.drawn.farPlane, 0.0f);
+            ++viewCount;
+        }
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, viewBuffer_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(GpuShadowViews), &gpu);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void ShadowAtlasPass::execute(RenderContext& ctx)
+{
+    if (!atlasShader_ || atlasFBO_ == 0) {
+        return;
+    }
+
+    Scene* scene = ctx.scene;
+    if (!scene || !ctx.camera) {
+        return;
+    }
+
+    const Camera& camera = *ctx.camera;
+    glm::mat4 projection = camera.GetProjectionMatrix();
+    glm::mat4 viewProjection = projection * camera.GetViewMatrix();
+    glm::vec3 cameraPos = camera.GetPosition();
+    Frustum cameraFrustum = Frustum::fromMatrix(viewProjection);
+
+    // === Step 1: Visible shadow casting lights and their importance ===
+    for (auto& entry : lights_) {
+        entry.second.seen = false;
+    }
+
+    std::vector<LightShadow*> candidates;
+    for (Light* light : scene->lights) {
+        if (!light || !light->enabled || !light->castShadows) continue;
+
+        glm::vec3 position;
+        glm::vec3 radiance = light->color * light->intensity;
+        float range = 0.0f;
+        if (light->GetType() == LightType::Point) {
+            const PointLight* pointLight = static_cast<const PointLight*>(light);
+            position = pointLight->position;
+            range = ComputeLightRange(radiance, pointLight->constant, pointLight->linear,
+                                      pointLight->quadratic, std::max(pointLight->radius, 0.0f));
+        } else if (light->GetType() == LightType::Spot) {
+            const SpotLight* spotLight = static_cast<const SpotLight*>(light);
+            position = spotLight->position;
+            range = ComputeLightRange(radiance, spotLight->constant, spotLight->linear,
+                                      spotLight->quadratic, std::max(spotLight->range, 0.0f));
+        } else {
+            continue;
+        }
+
+        // Lights without falloff shadow up to the far plane
+        if (range <= 0.0f) {
+            range = camera.GetFarPlane();
+        }
+        if (!cameraFrustum.intersectsSphere(position, range)) {
+            continue;
+        }
+
+        // Fraction of the screen height covered by the light's range
+        float distance = glm::length(position - cameraPos);
+        float coverage = 1.0f;
+        if (distance > range) {
+            coverage = std::min(1.0f, range * projection[1][1] / std::sqrt(distance * distance - range * range));
+        }
+
+        LightShadow& shadow = lights_[light];
+        shadow.light = light;
+        shadow.position = position;
+        shadow.range = range;
+        shadow.viewCount = light->GetType() == LightType::Point ? 6 : 1;
+        shadow.coverage = coverage;
+        shadow.importance = coverage * std::max(radiance.x, std::max(radiance.y, radiance.z));
+        shadow.seen = true;
+        candidates.push_back(&shadow);
+    }
+
+    // Lights that stopped casting (or left the view) give their tiles back
+    for (auto it = lights_.begin(); it != lights_.end();) {
+        if (!it->second.seen) {
+            releaseTiles(it->second);
+            it = lights_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(), [](const LightShadow* a, const LightShadow* b) {
+        return a->importance > b->importance;
+    });
+
+    // === Step 2: Tiles, most important lights first ===
+    // Tile edges follow screen coverage; lights much dimmer than the most
+    // important one get up to half that. Point light faces get half the
+    // size of a spot light tile, six of them cost more than one.
+    int minTile = atlas_.getMinTileSize();
+    float peakImportance = candidates.empty() ? 0.0f : std::max(candidates.front()->importance, 1e-6f);
+    int totalViews = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        LightShadow& shadow = *candidates[i];
+
+        // Views beyond what the lighting shaders can address get no tiles
+        if (totalViews + shadow.viewCount > LocalShadows::kMaxViews) {
+            releaseTiles(shadow);
+            continue;
+        }
+
+        int maxTile = atlasSize_ / (shadow.viewCount > 1 ? 8 : 4);
+        float scale = shadow.coverage * (0.5f + 0.5f * shadow.importance / peakImportance);
+        int desired = std::max(std::min(floorPowerOfTwo(static_cast<int>(maxTile * scale)), maxTile), minTile);
+
+        // Grow right away, shrink only when a whole level too large, so a
+        // light near a size boundary does not reallocate every frame
+        int current = shadow.views[0].tile.isValid() ? shadow.views[0].tile.size : 0;
+        if (current == desired || current == desired * 2) {
+            totalViews += shadow.viewCount;
+            continue;
+        }
+        releaseTiles(shadow);
+
+        // Evict the least important lights until the desired size fits,
+        // then fall back to smaller tiles
+        bool placed = allocateTiles(shadow, desired);
+        for (size_t victim = candidates.size(); !placed && victim-- > i + 1;) {
+            if (candidates[victim]->views[0].tile.isValid()) {
+                releaseTiles(*candidates[victim]);
+                placed = allocateTiles(shadow, desired);
+            }
+        }
+        for (int size = desired / 2; !placed && size >= minTile; size /= 2) {
+            placed = allocateTiles(shadow, size);
+        }
+
+        if (placed) {
+            totalViews += shadow.viewCount;
+        }
+    }
+
+    // === Step 3: Projections; changed ones and moved casters mark lights dirty ===
+    for (LightShadow* shadow : candidates) {
+        if (!shadow->views[0].tile.isValid()) continue;
+
+        int tileSize = shadow->views[0].tile.size;
+        float nearPlane = std::max(shadow->range * 0.005f, 0.01f);
+
+        // Fields of view are widened so the PCF footprint at a tile's edge
+        // still reads depth rendered for that tile
+        float margin = 1.0f + 4.0f / static_cast<float>(tileSize);
+        if (shadow->viewCount > 1) {
+            float tanHalf = margin;
+            glm::mat4 faceProjection = glm::perspective(2.0f * std::atan(tanHalf), 1.0f, nearPlane, shadow->range);
+            for (int face = 0; face < 6; ++face) {
+                ViewProjection& wanted = shadow->views[face].wanted;
+                wanted.matrix = faceProjection * glm::lookAt(shadow->position, shadow->position + kFaceDirections[face],
+                                                             kFaceUps[face]);
+                wanted.texelScale = 2.0f * tanHalf / static_cast<float>(tileSize);
+                wanted.nearPlane = nearPlane;
+                wanted.farPlane = shadow->range;
+            }
+        } else {
+            const SpotLight* spotLight = static_cast<const SpotLight*>(shadow->light);
+            float halfAngle = glm::radians(std::min(std::max(spotLight->outerConeAngle, 1.0f), 85.0f));
+            float tanHalf = std::tan(halfAngle) * margin;
+            glm::vec3 direction = glm::normalize(spotLight->direction);
+            glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+            ViewProjection& wanted = shadow->views[0].wanted;
+            wanted.matrix = glm::perspective(2.0f * std::atan(tanHalf), 1.0f, nearPlane, shadow->range) *
+                            glm::lookAt(shadow->position, shadow->position + direction, up);
+            wanted.texelScale = 2.0f * tanHalf / static_cast<float>(tileSize);
+            wanted.nearPlane = nearPlane;
+            wanted.farPlane = shadow->range;
+        }
+
+        for (int i = 0; i < shadow->viewCount; ++i) {
+            if (shadow->views[i].wanted.matrix != shadow->views[i].drawn.matrix) {
+                shadow->dirty = true;
+            }
+        }
+        if (!cachingEnabled_) {
+            shadow->dirty = true;
+        }
+    }
+
+    std::vector<RenderItem> items;
+    scene->collectRenderItems(items);
+
+    // A different item list (meshes added or removed) redraws everything,
+    // moved casters only the lights whose range they were or are in
+    bool sameItems = items.size() == cachedItems_.size();
+    for (size_t i = 0; sameItems && i < items.size(); ++i) {
+        if (items[i].mesh != cachedItems_[i].mesh) {
+            sameItems = false;
+        } else if (items[i].mesh && items[i].modelMatrix != cachedItems_[i].modelMatrix) {
+            for (LightShadow* shadow : candidates) {
+                if (itemInRange(cachedItems_[i], shadow->position, shadow->range) ||
+                    itemInRange(items[i], shadow->position, shadow->range)) {
+                    shadow->dirty = true;
+                }
+            }
+        }
+    }
+    if (!sameItems) {
+        invalidateCache();
+    }
+
+    // Casters: in the light's range (and spot cone), with a shadow the
+    // camera can see. One the tiles were drawn without makes the light dirty.
+    std::vector<glm::vec3> itemMin(items.size());
+    std::vector<glm::vec3> itemMax(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].mesh) {
+            transformBounds(items[i].modelMatrix, items[i].mesh->GetBoundsMin(), items[i].mesh->GetBoundsMax(),
+                            itemMin[i], itemMax[i]);
+        }
+    }
+    for (LightShadow* shadow : candidates) {
+        shadow->casters.clear();
+        if (!shadow->views[0].tile.isValid()) continue;
+
+        bool spot = shadow->viewCount == 1;
+        Frustum spotFrustum = Frustum::fromMatrix(shadow->views[0].wanted.matrix);
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (!items[i].mesh) continue;
+
+            glm::vec3 d = shadow->position - glm::clamp(shadow->position, itemMin[i], itemMax[i]);
+            if (glm::dot(d, d) > shadow->range * shadow->range ||
+                (spot && !spotFrustum.intersectsBox(itemMin[i], itemMax[i])) ||
+                !shadowVisible(cameraFrustum, shadow->position, shadow->range, itemMin[i], itemMax[i])) {
+                continue;
+            }
+            shadow->casters.push_back(static_cast<uint32_t>(i));
+        }
+
+        for (uint32_t index : shadow->casters) {
+            if (!std::binary_search(shadow->drawnCasters.begin(), shadow->drawnCasters.end(), index)) {
+                shadow->dirty = true;
+                break;
+            }
+        }
+    }
+
+    // === Step 4: Redraw dirty lights within the budget ===
+    // Lights without any shadow yet come first, then importance weighted by
+    // the frames spent waiting
+    std::vector<LightShadow*> pending;
+    for (LightShadow* shadow : candidates) {
+        if (shadow->dirty && shadow->views[0].tile.isValid()) {
+            ++shadow->framesWaiting;
+            pending.push_back(shadow);
+        }
+    }
+    std::stable_sort(pending.begin(), pending.end(), [](const LightShadow* a, const LightShadow* b) {
+        if (a->rendered != b->rendered) {
+            return !a->rendered;
+        }
+        return a->importance * a->framesWaiting > b->importance * b->framesWaiting;
+    });
+
+    redrawnViews_ = 0;
+    if (!pending.empty()) {
+        glBindFramebuffer(GL_FRAMEBUFFER, atlasFBO_);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glCullFace(GL_FRONT);
+        atlasShader_->usePermutation({{"SHADOW_ATLAS", ""}, {"DEPTH_INSTANCED", ""}});
+
+        int budget = updateBudget_ > 0 ? updateBudget_ : LocalShadows::kMaxViews;
+        for (LightShadow* shadow : pending) {
+            // The first light always fits, so a budget below six still
+            // makes progress on point lights
+            if (redrawnViews_ > 0 && redrawnViews_ + shadow->viewCount > budget) {
+                continue;
+            }
+
+            renderLight(*shadow, items);
+            for (int i = 0; i < shadow->viewCount; ++i) {
+                shadow->views[i].drawn = shadow->views[i].wanted;
+            }
+            shadow->drawnCasters = shadow->casters;
+            shadow->rendered = true;
+            shadow->dirty = false;
+            shadow->framesWaiting = 0;
+            redrawnViews_ += shadow->viewCount;
+        }
+
+        glCullFace(GL_BACK);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+    cachedItems_ = std::move(items);
+
+    uploadViews(candidates);
+}
+
+} // namespace kcShaders
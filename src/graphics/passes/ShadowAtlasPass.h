@@ -0,0 +1,173 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include "../ShaderProgram.h"
+#include "../ShadowAtlas.h"
+#include "../DepthBatch.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace kcShaders {
+
+class Light;
+struct RenderItem;
+
+/**
+ * @brief Point and spot light shadows in the atlas, as read by common/shadows.glsl
+ *
+ * A shadow view is one perspective projection into one atlas tile: spot
+ * lights have one, point lights six consecutive ones (cube faces +X, -X,
+ * +Y, -Y, +Z, -Z). Only lights whose views were all rendered are listed.
+ */
+struct LocalShadows {
+    static constexpr int kMaxViews = 64;
+    static constexpr GLuint kViewBinding = 1;  // Uniform buffer binding of the view block
+
+    GLuint texture = 0;     // Depth atlas (0 = no local shadows)
+    GLuint viewBuffer = 0;  // ShadowAtlasViews uniform block
+    std::unordered_map<const Light*, int> firstViews;
+
+    /**
+     * @brief First shadow view of a light, -1 if it has no shadow
+     */
+    int viewFor(const Light* light) const;
+
+    /**
+     * @brief Bind the atlas to a texture unit and the view block to the shader
+     */
+    void bind(ShaderProgram* shader, int textureUnit) const;
+};
+
+/**
+ * @brief Shadow Atlas Pass
+ * Renders the shadows of point and spot lights into tiles of one depth atlas
+ *
+ * Every visible light with castShadows gets tiles sized by how much of the
+ * screen its range covers; the most important lights (coverage times
+ * brightness) are placed first and evict less important ones when the
+ * quadtree runs out of space. Spot lights render one perspective tile,
+ * point lights six cube faces in a single draw per caster: a geometry
+ * shader sends each triangle to the faces' viewports. Casters are limited
+ * to the light's range (and cone) and to those whose shadow volume reaches
+ * into the camera frustum, and are drawn instanced per mesh.
+ *
+ * Tiles keep their content between frames. A light is redrawn when its
+ * tiles or projections change, a caster in its range moves or the camera
+ * culling adds a caster that was not drawn, and at most
+ * the update budget of views is redrawn per frame; lights waiting longer
+ * gain priority, so none of them starves.
+ */
+class ShadowAtlasPass : public RenderPass {
+public:
+    /**
+     * @brief Construct shadow atlas pass
+     * @param atlasShader Depth-only shader with the cube face geometry stage
+     * @param atlasSize Atlas resolution (default 4096x4096)
+     */
+    ShadowAtlasPass(ShaderProgram* atlasShader, int atlasSize = 4096);
+    ~ShadowAtlasPass() override;
+
+    void setup() override;
+    void execute(RenderContext& ctx) override;
+    void cleanup() override;
+    const char* getName() const override { return "ShadowAtlas"; }
+
+    /**
+     * @brief Get the shadows rendered so far (texture 0 before setup)
+     */
+    const LocalShadows& getLocalShadows() const { return shadows_; }
+
+    /**
+     * @brief Set how many shadow views may be redrawn per frame
+     * @param views Views per frame; a point light needs six, 0 = unlimited
+     */
+    void setUpdateBudget(int views) { updateBudget_ = views; }
+    int getUpdateBudget() const { return updateBudget_; }
+
+    /**
+     * @brief Keep tiles between frames and redraw only changed lights
+     * @param enable false redraws every shadow every frame (within the budget)
+     */
+    void enableCaching(bool enable);
+
+    /**
+     * @brief Force every light to be redrawn
+     */
+    void invalidateCache();
+
+    /**
+     * @brief Lights with a tile in the atlas, and views redrawn last frame
+     */
+    int getShadowedLightCount() const { return static_cast<int>(lights_.size()); }
+    int getRedrawnViewCount() const { return redrawnViews_; }
+
+private:
+    static constexpr int kMaxViewsPerLight = 6;
+
+    struct ViewProjection {
+        glm::mat4 matrix{1.0f};
+        float texelScale = 0.0f;    // World-space texel size per unit of depth
+        float nearPlane = 0.0f;
+        float farPlane = 0.0f;
+    };
+
+    struct ShadowView {
+        ShadowAtlas::Tile tile;
+        ViewProjection wanted;      // Projection for the light as it is this frame
+        ViewProjection drawn;       // Projection the tile content was drawn with
+    };
+
+    struct LightShadow {
+        const Light* light = nullptr;
+        glm::vec3 position{0.0f};
+        float range = 0.0f;
+        float coverage = 0.0f;      // Fraction of the screen height the range covers
+        float importance = 0.0f;    // Coverage times peak radiance
+        int viewCount = 0;
+        ShadowView views[kMaxViewsPerLight];
+        bool rendered = false;      // All views drawn at least once
+        bool dirty = true;          // Tiles out of date
+        int framesWaiting = 0;      // Frames spent dirty
+        bool seen = false;          // Still a shadow caster this frame
+        std::vector<uint32_t> casters;       // Item indices casting into the tiles this frame
+        std::vector<uint32_t> drawnCasters;  // Item indices the tiles were drawn with
+    };
+
+    /**
+     * @brief Allocate tiles of one size for all views of a light
+     */
+    bool allocateTiles(LightShadow& shadow, int tileSize);
+    void releaseTiles(LightShadow& shadow);
+
+    /**
+     * @brief Draw the light's casters into all of its tiles
+     */
+    void renderLight(const LightShadow& shadow, const std::vector<RenderItem>& items);
+
+    /**
+     * @brief Publish the views of all completely drawn lights
+     * @param lights Shadowed lights, most important first
+     */
+    void uploadViews(const std::vector<LightShadow*>& lights);
+
+    ShaderProgram* atlasShader_;
+    int atlasSize_;
+    int updateBudget_ = 12;
+    bool cachingEnabled_ = true;
+
+    GLuint atlasFBO_ = 0;
+    GLuint atlasTexture_ = 0;
+    GLuint viewBuffer_ = 0;
+
+    ShadowAtlas atlas_;
+    std::unordered_map<const Light*, LightShadow> lights_;
+    std::vector<RenderItem> cachedItems_;
+    LocalShadows shadows_;
+    int redrawnViews_ = 0;
+    DepthBatch batch_;
+};
+
+} // namespace kcShaders
@@ -1,19 +1,53 @@
 #include "ShadowMapPass.h"
 #include "../RenderContext.h"
 #include "../../scene/scene.h"
+#include "../../scene/camera.h"
 #include "../../scene/light.h"
 #include "../../scene/mesh.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <string>
 
 namespace kcShaders {
 
+namespace {
+
+// Texel rectangle an item covers in a shadow map layer; false if it lies
+// outside the layer or beyond its far plane
+bool texelBounds(const glm::mat4& lightSpaceMatrix, const RenderItem& item, int mapSize,
+                 glm::vec2& outMin, glm::vec2& outMax)
+{
+    glm::vec3 ndcMin, ndcMax;
+    transformBounds(lightSpaceMatrix * item.modelMatrix, item.mesh->GetBoundsMin(), item.mesh->GetBoundsMax(),
+                    ndcMin, ndcMax);
+    float scale = 0.5f * static_cast<float>(mapSize);
+    outMin = glm::vec2(ndcMin.x + 1.0f, ndcMin.y + 1.0f) * scale;
+    outMax = glm::vec2(ndcMax.x + 1.0f, ndcMax.y + 1.0f) * scale;
+    return ndcMax.x >= -1.0f && ndcMin.x <= 1.0f && ndcMax.y >= -1.0f && ndcMin.y <= 1.0f && ndcMin.z <= 1.0f;
+}
+
+} // namespace
+
+void ShadowCascades::bind(ShaderProgram* shader, int textureUnit) const
+{
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    shader->setInt("shadowMap", textureUnit);
+    shader->setInt("cascadeCount", count);
+    for (int i = 0; i < count; ++i) {
+        std::string index = "[" + std::to_string(i) + "]";
+        shader->setMat4("lightSpaceMatrices" + index, lightSpaceMatrices[i]);
+        shader->setFloat("cascadeTexelSizes" + index, texelSizes[i]);
+    }
+}
+
 ShadowMapPass::ShadowMapPass(ShaderProgram* shadowShader, int shadowMapSize)
     : shadowShader_(shadowShader)
     , shadowMapSize_(shadowMapSize)
     , shadowFBO_(0)
     , shadowMap_(0)
-    , lightSpaceMatrix_(1.0f)
 {
 }
 
@@ -25,23 +59,24 @@ void ShadowMapPass::setup() {
     // Create framebuffer for shadow map
     glGenFramebuffers(1, &shadowFBO_);
     
-    // Create depth texture for shadow map
+    // One depth layer per cascade; layers not in use stay allocated so the
+    // cascade count can change without reallocating
     glGenTextures(1, &shadowMap_);
-    glBindTexture(GL_TEXTURE_2D, shadowMap_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 
-                 shadowMapSize_, shadowMapSize_, 0, 
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap_);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F,
+                 shadowMapSize_, shadowMapSize_, ShadowCascades::kMaxCascades, 0,
                  GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     
-    // Attach depth texture to framebuffer
+    // Attach the first layer to check completeness; execute() switches layers
     glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO_);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, 
-                          GL_TEXTURE_2D, shadowMap_, 0);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap_, 0, 0);
     glDrawBuffer(GL_NONE);  // No color buffer
     glReadBuffer(GL_NONE);
     
@@ -64,32 +99,173 @@ void ShadowMapPass::cleanup() {
         glDeleteFramebuffers(1, &shadowFBO_);
         shadowFBO_ = 0;
     }
+    batch_.release();
+    cascades_ = ShadowCascades();
+    invalidateCache();
+}
+
+void ShadowMapPass::setCascadeCount(int count) {
+    cascadeCount_ = std::min(std::max(count, 1), ShadowCascades::kMaxCascades);
+}
+
+void ShadowMapPass::enableCaching(bool enable) {
+    cachingEnabled_ = enable;
+    invalidateCache();
+}
+
+void ShadowMapPass::invalidateCache() {
+    for (bool& valid : cacheValid_) {
+        valid = false;
+    }
+    for (auto& casters : cachedCasters_) {
+        casters.clear();
+    }
+    cachedItems_.clear();
 }
 
-glm::mat4 ShadowMapPass::calculateLightSpaceMatrix(
-    const glm::vec3& lightDir, 
-    const glm::vec3& sceneCenter,
-    float sceneRadius) 
+void ShadowMapPass::renderCascade(int cascade, const Camera& camera, const glm::mat4& lightView,
+                                  const Frustum& receivers, float sliceNear, float sliceFar, const std::vector<RenderItem>& items,
+                                  const std::vector<RenderItem>& moved)
 {
-    // Position camera at scene center + offset in light direction
-    glm::vec3 lightPos = sceneCenter - glm::normalize(lightDir) * sceneRadius * 2.0f;
-    
-    // Light view matrix (looking from light towards scene)
-    glm::mat4 lightView = glm::lookAt(
-        lightPos,
-        sceneCenter,
-        glm::vec3(0.0f, 1.0f, 0.0f)
-    );
+    // Corners of the camera frustum slice in world space
+    glm::mat4 invView = glm::inverse(camera.GetViewMatrix());
+    float tanHalfFov = std::tan(glm::radians(camera.GetFov()) * 0.5f);
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i) {
+        float d = (i & 4) ? sliceFar : sliceNear;
+        float x = ((i & 1) ? 1.0f : -1.0f) * tanHalfFov * camera.GetAspectRatio() * d;
+        float y = ((i & 2) ? 1.0f : -1.0f) * tanHalfFov * d;
+        corners[i] = glm::vec3(invView * glm::vec4(x, y, -d, 1.0f));
+    }
+    
+    // A bounding sphere keeps the cascade size constant while the camera
+    // rotates; rounding the radius keeps it constant under float noise
+    glm::vec3 center(0.0f);
+    for (const glm::vec3& corner : corners) {
+        center += corner;
+    }
+    center /= 8.0f;
+    float radius = 0.0f;
+    for (const glm::vec3& corner : corners) {
+        radius = std::max(radius, glm::length(corner - center));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+    
+    // Light view at the origin: translating the camera moves the cascade in
+    // light space, where it is snapped to whole texels
+    float texelSize = 2.0f * radius / static_cast<float>(shadowMapSize_);
+    glm::vec3 centerLS = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    centerLS.x = std::floor(centerLS.x / texelSize) * texelSize;
+    centerLS.y = std::floor(centerLS.y / texelSize) * texelSize;
+    
+    // Cull casters to the cascade's light-space box; the box reaches back
+    // towards the light as far as the casters do (light looks down -Z)
+    float farZ = centerLS.z - radius;
+    float nearZ = centerLS.z + radius;
+    std::vector<uint32_t> casters;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const RenderItem& item = items[i];
+        if (!item.mesh) continue;
+    
+        glm::vec3 boundsMin, boundsMax;
+        transformBounds(lightView * item.modelMatrix, item.mesh->GetBoundsMin(), item.mesh->GetBoundsMax(),
+                        boundsMin, boundsMax);
+        if (boundsMax.x < centerLS.x - radius || boundsMin.x > centerLS.x + radius ||
+            boundsMax.y < centerLS.y - radius || boundsMin.y > centerLS.y + radius ||
+            boundsMax.z < farZ) {
+            continue;
+        }
+    
+        // The depth range ignores the camera test below, so turning the
+        // camera does not change the matrix
+        nearZ = std::max(nearZ, boundsMax.z);
+    
+        // Shadow volume: the caster's box extruded away from the light to the
+        // cascade's far plane, which has to reach a receiver the camera sees
+        if (!receivers.intersectsBox(glm::vec3(boundsMin.x, boundsMin.y, farZ), boundsMax)) {
+            continue;
+        }
+        casters.push_back(static_cast<uint32_t>(i));
+    }
+    
+    // Depth range in whole radii, so casters moving a little do not change
+    // the matrix and invalidate the whole cascade
+    nearZ = farZ + std::ceil((nearZ - farZ) / radius) * radius;
     
-    // Orthographic projection for directional light
-    float orthoSize = sceneRadius * 1.5f;
     glm::mat4 lightProj = glm::ortho(
-        -orthoSize, orthoSize,
-        -orthoSize, orthoSize,
-        0.1f, sceneRadius * 4.0f
+        centerLS.x - radius, centerLS.x + radius,
+        centerLS.y - radius, centerLS.y + radius,
+        -nearZ - 0.1f, -farZ + 0.1f
     );
+    glm::mat4 lightSpaceMatrix = lightProj * lightView;
+    cascades_.lightSpaceMatrices[cascade] = lightSpaceMatrix;
+    cascades_.texelSizes[cascade] = texelSize;
+    
+    bool fullRedraw = !cachingEnabled_ || !cacheValid_[cascade] || cachedMatrices_[cascade] != lightSpaceMatrix;
     
-    return lightProj * lightView;
+    // Otherwise only the texels the moved casters covered, before or after
+    // moving, are redrawn (1 texel padding for rasterization)
+    glm::ivec2 dirtyMin(shadowMapSize_);
+    glm::ivec2 dirtyMax(0);
+    if (!fullRedraw) {
+        auto addDirty = [&](const RenderItem& item) {
+            glm::vec2 texelMin, texelMax;
+            if (texelBounds(lightSpaceMatrix, item, shadowMapSize_, texelMin, texelMax)) {
+                dirtyMin = glm::min(dirtyMin, glm::ivec2(glm::floor(texelMin)) - 1);
+                dirtyMax = glm::max(dirtyMax, glm::ivec2(glm::ceil(texelMax)) + 1);
+            }
+        };
+        for (const RenderItem& item : moved) {
+            addDirty(item);
+        }
+        
+        // Casters culled when the layer was drawn are missing from it
+        const std::vector<uint32_t>& drawn = cachedCasters_[cascade];
+        for (uint32_t index : casters) {
+            if (!std::binary_search(drawn.begin(), drawn.end(), index)) {
+                addDirty(items[index]);
+            }
+        }
+        dirtyMin = glm::max(dirtyMin, glm::ivec2(0));
+        dirtyMax = glm::min(dirtyMax, glm::ivec2(shadowMapSize_));
+        
+        if (dirtyMin.x >= dirtyMax.x || dirtyMin.y >= dirtyMax.y) {
+            return;  // Cached layer is still valid
+        }
+    }
+    
+    // Render the casters into this cascade's layer
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap_, 0, cascade);
+    if (!fullRedraw) {
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(dirtyMin.x, dirtyMin.y, dirtyMax.x - dirtyMin.x, dirtyMax.y - dirtyMin.y);
+    }
+    glClear(GL_DEPTH_BUFFER_BIT);
+    shadowShader_->setMat4("lightSpaceMatrix", lightSpaceMatrix);
+    batch_.clear();
+    for (uint32_t index : casters) {
+        const RenderItem& item = items[index];
+        if (!fullRedraw) {
+            // Skip casters outside the dirty rectangle
+            glm::vec2 texelMin, texelMax;
+            texelBounds(lightSpaceMatrix, item, shadowMapSize_, texelMin, texelMax);
+            if (texelMax.x < dirtyMin.x || texelMin.x > dirtyMax.x ||
+                texelMax.y < dirtyMin.y || texelMin.y > dirtyMax.y) {
+                continue;
+            }
+        }
+        
+        batch_.add(item.mesh, item.modelMatrix);
+    }
+    batch_.draw(shadowShader_);
+    glDisable(GL_SCISSOR_TEST);
+    
+    // Every current caster is in the layer now: unchanged ones were before,
+    // added and moved ones lie inside the redrawn rectangle
+    cachedCasters_[cascade] = std::move(casters);
+    cachedMatrices_[cascade] = lightSpaceMatrix;
+    cacheValid_[cascade] = true;
+    ++redrawnCascades_;
 }
 
 void ShadowMapPass::execute(RenderContext& ctx) {
@@ -98,15 +274,15 @@ void ShadowMapPass::execute(RenderContext& ctx) {
     }
     
     Scene* scene = ctx.scene;
-    if (!scene) {
+    if (!scene || !ctx.camera) {
         return;
     }
     
     // Find first directional light that casts shadows
     DirectionalLight* shadowLight = nullptr;
     for (Light* light : scene->lights) {
-        if (light->GetType() == LightType::Directional && 
-            light->castShadows && 
+        if (light->GetType() == LightType::Directional &&
+            light->castShadows &&
             light->enabled) {
             shadowLight = static_cast<DirectionalLight*>(light);
             break;
@@ -114,23 +290,48 @@ void ShadowMapPass::execute(RenderContext& ctx) {
     }
     
     if (!shadowLight) {
-        return;  // No shadow-casting directional light
+        cascades_ = ShadowCascades();  // No shadow-casting directional light
+        return;
     }
     
-    // Calculate light space matrix
-    // Use scene bounds (simplified: assume scene center at origin with radius 20)
-    glm::vec3 sceneCenter(0.0f, 0.0f, 0.0f);
-    float sceneRadius = 20.0f;
-    lightSpaceMatrix_ = calculateLightSpaceMatrix(
-        shadowLight->direction, 
-        sceneCenter, 
-        sceneRadius
-    );
+    // Cascade splits: practical split scheme, blending logarithmic (even
+    // texel density in depth) and uniform splits
+    const Camera& camera = *ctx.camera;
+    float nearPlane = camera.GetNearPlane();
+    float farPlane = std::min(camera.GetFarPlane(), std::max(shadowDistance_, nearPlane * 2.0f));
+    float splits[ShadowCascades::kMaxCascades + 1];
+    splits[0] = nearPlane;
+    for (int i = 1; i <= cascadeCount_; ++i) {
+        float t = static_cast<float>(i) / static_cast<float>(cascadeCount_);
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        splits[i] = splitLambda_ * logSplit + (1.0f - splitLambda_) * uniformSplit;
+    }
+    
+    // Collect render items
+    std::vector<RenderItem> items;
+    scene->collectRenderItems(items);
+    
+    // Casters whose transform changed since the cached layers were drawn,
+    // with their old and new matrix; a different item list (meshes added or
+    // removed) invalidates every layer
+    std::vector<RenderItem> moved;
+    bool sameItems = items.size() == cachedItems_.size();
+    for (size_t i = 0; sameItems && i < items.size(); ++i) {
+        if (items[i].mesh != cachedItems_[i].mesh) {
+            sameItems = false;
+        } else if (items[i].mesh && items[i].modelMatrix != cachedItems_[i].modelMatrix) {
+            moved.push_back(cachedItems_[i]);
+            moved.push_back(items[i]);
+        }
+    }
+    if (!sameItems) {
+        invalidateCache();
+    }
     
     // Render to shadow map
     glViewport(0, 0, shadowMapSize_, shadowMapSize_);
     glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO_);
-    glClear(GL_DEPTH_BUFFER_BIT);
     
     // Enable depth test, disable blending
     glEnable(GL_DEPTH_TEST);
@@ -139,22 +340,25 @@ void ShadowMapPass::execute(RenderContext& ctx) {
     // Optional: Enable front-face culling to reduce shadow acne
     glCullFace(GL_FRONT);
     
-    shadowShader_->use();
-    shadowShader_->setMat4("lightSpaceMatrix", lightSpaceMatrix_);
+    shadowShader_->usePermutation({{"DEPTH_INSTANCED", ""}});
     
-    // Collect render items
-    std::vector<RenderItem> items;
-    scene->collectRenderItems(items);
+    glm::vec3 lightDir = glm::normalize(shadowLight->direction);
+    glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
     
-    // Render all meshes from light's perspective
-    for (const auto& item : items) {
-        if (!item.mesh) continue;
-        
-        // Use the model matrix from render item
-        shadowShader_->setMat4("model", item.modelMatrix);
-        
-        item.mesh->draw();
+    // Receivers are the camera frustum up to the shadow distance as a whole,
+    // not one slice: shadows.glsl picks the first cascade covering a point
+    glm::mat4 shadowProjection = glm::perspective(glm::radians(camera.GetFov()), camera.GetAspectRatio(),
+                                                  nearPlane, farPlane);
+    Frustum receivers = Frustum::fromMatrix(shadowProjection * camera.GetViewMatrix() * glm::inverse(lightView));
+    
+    redrawnCascades_ = 0;
+    for (int i = 0; i < cascadeCount_; ++i) {
+        renderCascade(i, camera, lightView, receivers, splits[i], splits[i + 1], items, moved);
     }
+    cascades_.texture = shadowMap_;
+    cascades_.count = cascadeCount_;
+    cachedItems_ = std::move(items);
     
     // Restore culling
     glCullFace(GL_BACK);
@@ -2,37 +2,112 @@
 
 #include "../RenderPass.h"
 #include "../ShaderProgram.h"
+#include "../DepthBatch.h"
+#include "../Frustum.h"
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
 
 namespace kcShaders {
 
+class Camera;
+struct RenderItem;
+
+/**
+ * @brief Light-space data of the cascades, as read by common/shadows.glsl
+ */
+struct ShadowCascades {
+    static constexpr int kMaxCascades = 4;
+    
+    GLuint texture = 0;  // GL_TEXTURE_2D_ARRAY, one layer per cascade (0 = no shadows)
+    int count = 0;
+    glm::mat4 lightSpaceMatrices[kMaxCascades];
+    float texelSizes[kMaxCascades] = {};  // World-space size of one shadow texel
+    
+    /**
+     * @brief Bind the map to a texture unit and set the shadow uniforms
+     */
+    void bind(ShaderProgram* shader, int textureUnit) const;
+};
+
 /**
  * @brief Shadow Map Pass
  * Renders scene from light's perspective to generate shadow map
  * Currently supports directional light shadows
+ *
+ * The camera frustum up to the shadow distance is split into cascades
+ * (practical split scheme between the camera's near and far plane). Each
+ * cascade gets its own layer of a depth texture array, fitted to a bounding
+ * sphere of its frustum slice and snapped to whole texels so the map does
+ * not shimmer when the camera moves. Casters are culled per cascade: a
+ * caster is drawn only if its shadow, extruded away from the light, can
+ * reach a receiver the camera sees within the shadow distance. Casters are
+ * drawn from the meshes' position-only streams, instanced per mesh.
+ *
+ * Layers are cached between frames. A cascade is redrawn completely only
+ * when its light-space matrix changes (light direction, camera movement,
+ * casters reaching further towards the light). Casters whose transform
+ * changed only cause a scissored redraw of the texels they covered before
+ * and after the move, so a static view of a static scene costs nothing.
+ * Casters the camera culling adds back (the view turned towards their
+ * shadow) are redrawn the same way.
  */
 class ShadowMapPass : public RenderPass {
 public:
     /**
      * @brief Construct shadow map pass
      * @param shadowShader Depth-only shader for shadow mapping
-     * @param shadowMapSize Resolution of shadow map (default 2048x2048)
+     * @param shadowMapSize Resolution of each cascade (default 2048x2048)
      */
     ShadowMapPass(ShaderProgram* shadowShader, int shadowMapSize = 2048);
     ~ShadowMapPass() override;
     
     void execute(RenderContext& ctx) override;
     void resize(int width, int height) override;
+    const char* getName() const override { return "ShadowMap"; }
     
     /**
-     * @brief Get shadow map texture ID
+     * @brief Get shadow map texture array ID
      */
     GLuint getShadowMap() const { return shadowMap_; }
     
     /**
-     * @brief Get light space matrix (for transforming world pos to light space)
+     * @brief Get the cascades rendered last frame (count 0 if no light casts shadows)
+     */
+    const ShadowCascades& getCascades() const { return cascades_; }
+    
+    /**
+     * @brief Set the number of cascades (1 to ShadowCascades::kMaxCascades)
+     */
+    void setCascadeCount(int count);
+    
+    /**
+     * @brief Set how far from the camera shadows are rendered
+     * @param distance Shadow distance, clamped to the camera far plane
+     * @param splitLambda Blend between uniform (0) and logarithmic (1) splits
      */
-    glm::mat4 getLightSpaceMatrix() const { return lightSpaceMatrix_; }
+    void setShadowDistance(float distance, float splitLambda = 0.75f) {
+        shadowDistance_ = distance;
+        splitLambda_ = splitLambda;
+    }
+    
+    /**
+     * @brief Keep cascades between frames and redraw only what changed
+     * @param enable false redraws every cascade every frame
+     */
+    void enableCaching(bool enable);
+    bool isCachingEnabled() const { return cachingEnabled_; }
+    
+    /**
+     * @brief Force a full redraw, e.g. after mesh vertices were edited in place
+     */
+    void invalidateCache();
+    
+    /**
+     * @brief Number of cascades fully or partially redrawn last frame
+     */
+    int getRedrawnCascadeCount() const { return redrawnCascades_; }
     
     /**
      * @brief Setup shadow map framebuffer and textures
@@ -47,18 +122,34 @@ public:
 private:
     ShaderProgram* shadowShader_;
     int shadowMapSize_;
+    int cascadeCount_ = ShadowCascades::kMaxCascades;
+    float shadowDistance_ = 100.0f;
+    float splitLambda_ = 0.75f;
     
     GLuint shadowFBO_;
-    GLuint shadowMap_;  // Depth texture
+    GLuint shadowMap_;  // Depth texture array, one layer per cascade
+    
+    ShadowCascades cascades_;
+    
+    // Cache: the matrix each layer was drawn with and the casters at that time
+    bool cachingEnabled_ = true;
+    bool cacheValid_[ShadowCascades::kMaxCascades] = {};
+    glm::mat4 cachedMatrices_[ShadowCascades::kMaxCascades];
+    std::vector<uint32_t> cachedCasters_[ShadowCascades::kMaxCascades];  // Item indices drawn into each layer
+    std::vector<RenderItem> cachedItems_;
+    int redrawnCascades_ = 0;
     
-    glm::mat4 lightSpaceMatrix_;  // Light's view-projection matrix
+    DepthBatch batch_;
     
     /**
-     * @brief Calculate light space matrix from directional light
+     * @brief Fit one cascade to a camera frustum slice and render its casters
+     * @param lightView Light view matrix, shared by all cascades
+     * @param receivers Camera frustum up to the shadow distance, in light view space
+     * @param moved Casters that moved since the cached layer, before and after the move
      */
-    glm::mat4 calculateLightSpaceMatrix(const glm::vec3& lightDir, 
-                                         const glm::vec3& sceneCenter,
-                                         float sceneRadius);
+    void renderCascade(int cascade, const Camera& camera, const glm::mat4& lightView, const Frustum& receivers,
+                       float sliceNear, float sliceFar, const std::vector<RenderItem>& items,
+                       const std::vector<RenderItem>& moved);
 };
 
 } // namespace kcShaders
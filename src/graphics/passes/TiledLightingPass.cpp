@@ -0,0 +1,325 @@
+#include "TiledLightingPass.h"
+#include "../RenderContext.h"
+#include "../PerfCounters.h"
+#include "../gbuffer.h"
+#include "../../scene/scene.h"
+#include "../../scene/camera.h"
+#include "../../scene/light.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace kcShaders {
+
+namespace {
+
+// SSBO binding of the local light list, after the ray tracing buffers
+constexpr GLuint kLocalLightBinding = 14;
+constexpr GLuint kOverflowBinding = 18;
+
+} // namespace
+
+TiledLightingPass::TiledLightingPass(GBuffer* gbuffer, ShaderProgram* lightingShader,
+                                     GLuint fbo, int fbWidth, int fbHeight)
+    : gbuffer_(gbuffer)
+    , lightingShader_(lightingShader)
+    , fbo_(fbo)
+    , fbWidth_(fbWidth)
+    , fbHeight_(fbHeight)
+{
+}
+
+TiledLightingPass::~TiledLightingPass()
+{
+    cleanup();
+}
+
+void TiledLightingPass::execute(RenderContext& ctx)
+{
+    if (!ctx.isValid() || !gbuffer_ || !lightingShader_) {
+        return;
+    }
+
+    // The renderer may have recreated its color texture, so look it up per frame
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    GLint colorTexture = 0;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                          GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &colorTexture);
+
+    // Every pixel is written by the kernel, only depth needs clearing
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (colorTexture == 0) {
+        std::cerr << "[TiledLightingPass] Target FBO has no color texture\n";
+        return;
+    }
+
+    ShaderDefines defines;
+    if (ssaoTexture_ != 0) defines.emplace_back("USE_SSAO", "");
+    if (shadows_.texture != 0) defines.emplace_back("USE_SHADOWS", "");
+    if (localShadows_ && localShadows_->texture != 0 && !localShadows_->firstViews.empty()) {
+        defines.emplace_back("USE_LOCAL_SHADOWS", "");
+    }
+    lightingShader_->usePermutation(defines);
+
+    bindGBufferTextures();
+    glBindImageTexture(0, static_cast<GLuint>(colorTexture), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    // Camera uniforms
+    glm::mat4 projection = ctx.camera->GetProjectionMatrix();
+    glm::mat4 view = ctx.camera->GetViewMatrix();
+    lightingShader_->setVec3("viewPos", ctx.camera->GetPosition());
+    lightingShader_->setMat4("uView", view);
+    lightingShader_->setMat4("uInvProjection", glm::inverse(projection));
+    lightingShader_->setMat4("uInvViewProj", glm::inverse(projection * view));
+    GLint loc = lightingShader_->uniformLocation("uResolution");
+    if (loc >= 0) {
+        glUniform2i(loc, fbWidth_, fbHeight_);
+    }
+
+    setLightUniforms(ctx);
+    uploadLocalLights();
+
+    readOverflowCounts();
+    if (overflowBuffers_[0] == 0) {
+        const GLuint zero = 0;
+        glGenBuffers(kOverflowBufferCount, overflowBuffers_);
+        for (GLuint buffer : overflowBuffers_) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zero), &zero, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kOverflowBinding, overflowBuffers_[overflowCurrent_]);
+
+    GLuint groupsX = (fbWidth_ + kTileSize - 1) / kTileSize;
+    GLuint groupsY = (fbHeight_ + kTileSize - 1) / kTileSize;
+    glDispatchCompute(groupsX, groupsY, 1);
+    rotateOverflowCounts();
+
+    // The result is blitted or sampled by whoever consumes the framebuffer
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    // Unbind textures (SSAO at unit 4, shadow map at unit 5, shadow atlas at unit 6)
+    for (int i = 0; i < 7; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLocalLightBinding, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kOverflowBinding, 0);
+}
+
+void TiledLightingPass::resize(int width, int height)
+{
+    fbWidth_ = width;
+    fbHeight_ = height;
+}
+
+void TiledLightingPass::cleanup()
+{
+    if (lightBuffer_ != 0) {
+        glDeleteBuffers(1, &lightBuffer_);
+        lightBuffer_ = 0;
+    }
+    lightBufferCapacity_ = 0;
+
+    for (GLsync& fence : overflowFences_) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (overflowBuffers_[0] != 0) {
+        glDeleteBuffers(kOverflowBufferCount, overflowBuffers_);
+        for (GLuint& buffer : overflowBuffers_) {
+            buffer = 0;
+        }
+    }
+    overflowCurrent_ = 0;
+}
+
+void TiledLightingPass::readOverflowCounts()
+{
+    for (int i = 0; i < kOverflowBufferCount; ++i) {
+        if (!overflowFences_[i]) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(overflowFences_[i], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        glDeleteSync(overflowFences_[i]);
+        overflowFences_[i] = nullptr;
+
+        GLuint count = 0;
+        const GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, overflowBuffers_[i]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(count), &count);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        PerfCounters::add(PerfCounter::TileLightOverflows, count);
+        if (count > 0 && !overflowWarned_) {
+            std::cerr << "[TiledLightingPass] " << count << " tiles are touched by more than "
+                      << kMaxLightsPerTile << " lights, the extra lights are dropped\n";
+            overflowWarned_ = true;
+        }
+    }
+}
+
+void TiledLightingPass::rotateOverflowCounts()
+{
+    // The next buffer is still being read back: keep counting into this one
+    int next = (overflowCurrent_ + 1) % kOverflowBufferCount;
+    if (overflowFences_[next]) {
+        return;
+    }
+
+    overflowFences_[overflowCurrent_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    overflowCurrent_ = next;
+}
+
+void TiledLightingPass::bindGBufferTextures()
+{
+    // Same units as LightingPass
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gbuffer_->getDepthTexture());
+    lightingShader_->setInt("GDepth", 0);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gbuffer_->getNormalTexture());
+    lightingShader_->setInt("GNormal", 1);
+
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, gbuffer_->getAlbedoTexture());
+    lightingShader_->setInt("GAlbedo", 2);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, gbuffer_->getMaterialTexture());
+    lightingShader_->setInt("GMaterial", 3);
+
+    if (ssaoTexture_ != 0) {
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D, ssaoTexture_);
+        lightingShader_->setInt("GSSAO", 4);
+    }
+
+    if (shadows_.texture != 0) {
+        shadows_.bind(lightingShader_, 5);
+    }
+
+    if (localShadows_ && localShadows_->texture != 0 && !localShadows_->firstViews.empty()) {
+        localShadows_->bind(lightingShader_, 6);
+    }
+}
+
+void TiledLightingPass::setLightUniforms(RenderContext& ctx)
+{
+    int numDirLights = 0;
+    glm::vec3 ambientLight(0.0f);
+    localLights_.clear();
+
+    for (Light* light : ctx.scene->lights) {
+        if (!light || !light->enabled) continue;
+
+        switch (light->GetType()) {
+            case LightType::Directional: {
+                if (numDirLights >= 4) break;
+                DirectionalLight* dirLight = static_cast<DirectionalLight*>(light);
+                std::string base = "dirLights[" + std::to_string(numDirLights) + "]";
+
+                lightingShader_->setVec3(base + ".direction", dirLight->direction);
+                lightingShader_->setVec3(base + ".color", dirLight->color);
+                lightingShader_->setFloat(base + ".intensity", dirLight->intensity);
+                numDirLights++;
+                break;
+            }
+
+            case LightType::Point: {
+                PointLight* pointLight = static_cast<PointLight*>(light);
+                GpuLocalLight gpu = {};
+                gpu.position = pointLight->position;
+                gpu.radiance = pointLight->color * pointLight->intensity;
+                gpu.type = static_cast<uint32_t>(LocalLightType::Point);
+                gpu.constant = pointLight->constant;
+                gpu.linear = pointLight->linear;
+                gpu.quadratic = pointLight->quadratic;
+                gpu.range = ComputeLightRange(gpu.radiance, gpu.constant, gpu.linear, gpu.quadratic,
+                                              std::max(pointLight->radius, 0.0f));
+                gpu.shadowView = localShadows_ ? localShadows_->viewFor(light) : -1;
+                localLights_.push_back(gpu);
+                break;
+            }
+
+            case LightType::Spot: {
+                SpotLight* spotLight = static_cast<SpotLight*>(light);
+                GpuLocalLight gpu = {};
+                gpu.position = spotLight->position;
+                gpu.radiance = spotLight->color * spotLight->intensity;
+                gpu.type = static_cast<uint32_t>(LocalLightType::Spot);
+                gpu.direction = spotLight->direction;
+                gpu.cosInner = std::cos(glm::radians(spotLight->innerConeAngle));
+                gpu.cosOuter = std::cos(glm::radians(spotLight->outerConeAngle));
+                gpu.constant = spotLight->constant;
+                gpu.linear = spotLight->linear;
+                gpu.quadratic = spotLight->quadratic;
+                gpu.range = ComputeLightRange(gpu.radiance, gpu.constant, gpu.linear, gpu.quadratic, 0.0f);
+                gpu.shadowView = localShadows_ ? localShadows_->viewFor(light) : -1;
+                localLights_.push_back(gpu);
+                break;
+            }
+
+            case LightType::Ambient: {
+                AmbientLight* ambLight = static_cast<AmbientLight*>(light);
+                ambientLight = ambLight->color * ambLight->intensity;
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    lightingShader_->setInt("numDirLights", numDirLights);
+    lightingShader_->setVec3("ambientLight", ambientLight);
+
+    GLint loc = lightingShader_->uniformLocation("localLightCount");
+    if (loc >= 0) {
+        glUniform1ui(loc, static_cast<GLuint>(localLights_.size()));
+    }
+}
+
+void TiledLightingPass::uploadLocalLights()
+{
+    if (lightBuffer_ == 0) {
+        glGenBuffers(1, &lightBuffer_);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer_);
+
+    // Grow in powers of two; an empty list still gets a valid (one light) buffer
+    size_t needed = std::max<size_t>(localLights_.size(), 1);
+    if (needed > lightBufferCapacity_) {
+        size_t capacity = std::max<size_t>(lightBufferCapacity_, 16);
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GpuLocalLight), nullptr, GL_DYNAMIC_DRAW);
+        lightBufferCapacity_ = capacity;
+    }
+
+    if (!localLights_.empty()) {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, localLights_.size() * sizeof(GpuLocalLight), localLights_.data());
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kLocalLightBinding, lightBuffer_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+} // namespace kcShaders
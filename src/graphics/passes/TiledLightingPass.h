@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../RenderPass.h"
+#include "../ShaderProgram.h"
+#include "ShadowMapPass.h"
+#include "ShadowAtlasPass.h"
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace kcShaders {
+
+class GBuffer;
+
+// Local light types, must match tiled_lighting.comp
+enum class LocalLightType : uint32_t {
+    Point = 0,
+    Spot = 1
+};
+
+// One point or spot light as laid out in the tiled lighting SSBO (std430)
+struct GpuLocalLight {
+    glm::vec3 position;
+    float range;           // Culling radius and fade-out distance, 0 = unbounded
+    glm::vec3 radiance;    // color * intensity
+    uint32_t type;         // LocalLightType
+    glm::vec3 direction;   // Spot direction
+    float _pad0;
+    float cosInner;
+    float cosOuter;
+    float constant;
+    float linear;
+    float quadratic;
+    int32_t shadowView;    // First view in the shadow atlas, -1 = none
+    float _pad1;
+    float _pad2;
+};
+
+/**
+ * TiledLightingPass: Compute-shader deferred lighting
+ *
+ * Alternative to LightingPass for scenes with many local lights. The screen
+ * is split into 16x16 tiles; each work group culls the point and spot lights
+ * against its tile's depth range and shades its pixels from the survivors
+ * only, so cost follows the lights that actually touch a tile instead of
+ * the total count. Writes straight into the color texture of the target
+ * FBO, which must be RGBA8.
+ *
+ * A tile keeps at most kMaxLightsPerTile lights and drops the rest. Such
+ * tiles are counted on the GPU and reported as
+ * PerfCounter::TileLightOverflows, with a warning the first time.
+ */
+class TiledLightingPass : public RenderPass {
+public:
+    static constexpr int kTileSize = 16;
+    static constexpr int kMaxLightsPerTile = 256;  // MAX_LIGHTS_PER_TILE in tiled_lighting.comp
+
+    TiledLightingPass(GBuffer* gbuffer, ShaderProgram* lightingShader,
+                      GLuint fbo, int fbWidth, int fbHeight);
+    ~TiledLightingPass() override;
+
+    void execute(RenderContext& ctx) override;
+    void resize(int width, int height) override;
+    void cleanup() override;
+    const char* getName() const override { return "TiledLighting"; }
+
+    // Set SSAO texture (0 to disable)
+    void setSSAOTexture(GLuint texture) {
+        ssaoTexture_ = texture;
+    }
+
+    // Set shadow cascades (texture 0 to disable)
+    void setShadowCascades(const ShadowCascades& cascades) {
+        shadows_ = cascades;
+    }
+
+    // Set point and spot light shadows (nullptr to disable)
+    void setLocalShadows(const LocalShadows* shadows) {
+        localShadows_ = shadows;
+    }
+
+    // Local lights uploaded last frame
+    int getLocalLightCount() const { return static_cast<int>(localLights_.size()); }
+
+private:
+    void bindGBufferTextures();
+    void setLightUniforms(RenderContext& ctx);
+    void uploadLocalLights();
+    void readOverflowCounts();
+    void rotateOverflowCounts();
+
+    GBuffer* gbuffer_;
+    ShaderProgram* lightingShader_;
+    GLuint fbo_;
+    int fbWidth_;
+    int fbHeight_;
+    GLuint ssaoTexture_ = 0;       // SSAO texture (0 = disabled)
+    ShadowCascades shadows_;       // Cascaded shadow map (texture 0 = disabled)
+    const LocalShadows* localShadows_ = nullptr;  // Shadow atlas (nullptr = disabled)
+
+    std::vector<GpuLocalLight> localLights_;
+    GLuint lightBuffer_ = 0;
+    size_t lightBufferCapacity_ = 0;  // In lights
+
+    // Overflow counters (SSBO 18), one buffer written per frame while the
+    // others wait for their fence before being read back
+    static constexpr int kOverflowBufferCount = 3;
+    GLuint overflowBuffers_[kOverflowBufferCount] = {};
+    GLsync overflowFences_[kOverflowBufferCount] = {};
+    int overflowCurrent_ = 0;
+    bool overflowWarned_ = false;
+};
+
+} // namespace kcShaders
@@ -1,9 +1,14 @@
 #include "DeferredPipeline.h"
 #include "../ShaderProgram.h"
+#include "../ShaderCompileService.h"
+#include "../Profiler.h"
 #include "../passes/GBufferPass.h"
 #include "../passes/LightingPass.h"
 #include "../passes/SSAOPass.h"
+#include "../passes/GTAOPass.h"
 #include "../passes/ShadowMapPass.h"
+#include "../passes/ShadowAtlasPass.h"
+#include "../passes/TiledLightingPass.h"
 #include "../gbuffer.h"
 #include <iostream>
 
@@ -18,7 +23,10 @@ DeferredPipeline::DeferredPipeline(GBuffer* gbuffer, GLuint fbo, GLuint quadVAO,
     , gbufferPass_(nullptr)
     , lightingPass_(nullptr)
     , ssaoPass_(nullptr)
+    , gtaoPass_(nullptr)
     , shadowMapPass_(nullptr)
+    , shadowAtlasPass_(nullptr)
+    , tiledLightingPass_(nullptr)
 {
 }
 
@@ -48,7 +56,11 @@ bool DeferredPipeline::loadShaders(
     const std::string& ssaoBlurVert,
     const std::string& ssaoBlurFrag,
     const std::string& shadowVert,
-    const std::string& shadowFrag
+    const std::string& shadowFrag,
+    const std::string& tiledLightComp,
+    const std::string& gtaoComp,
+    const std::string& shadowAtlasGeom,
+    const std::string& occlusionComp
 )
 {
     std::cout << "[DeferredPipeline] Loading shaders...\n";
@@ -106,6 +118,62 @@ bool DeferredPipeline::loadShaders(
         }
     }
     
+    // The shadow atlas program adds the cube face geometry stage to the shadow shaders
+    std::unique_ptr<ShaderProgram> tempShadowAtlasShader;
+    bool hasShadowAtlas = hasShadow && !shadowAtlasGeom.empty();
+    
+    if (hasShadowAtlas) {
+        std::cout << "  Shadow Atlas: " << shadowVert << " + " << shadowAtlasGeom << " + " << shadowFrag << "\n";
+        
+        tempShadowAtlasShader = std::make_unique<ShaderProgram>();
+        if (!tempShadowAtlasShader->loadFromFiles(shadowVert, shadowFrag, shadowAtlasGeom)) {
+            std::cerr << "[DeferredPipeline] Failed to load shadow atlas shader\n";
+            return false;
+        }
+    }
+    
+    // Load the tiled (compute) lighting shader if provided
+    std::unique_ptr<ShaderProgram> tempTiledLightingShader;
+    bool hasTiledLighting = !tiledLightComp.empty();
+    
+    if (hasTiledLighting) {
+        std::cout << "  Tiled Lighting: " << tiledLightComp << "\n";
+        
+        tempTiledLightingShader = std::make_unique<ShaderProgram>();
+        if (!tempTiledLightingShader->loadComputeFromFile(tiledLightComp)) {
+            std::cerr << "[DeferredPipeline] Failed to load tiled lighting shader\n";
+            return false;
+        }
+    }
+    
+    // Load the GTAO (compute) shader if provided
+    std::unique_ptr<ShaderProgram> tempGtaoShader;
+    bool hasGTAO = !gtaoComp.empty();
+    
+    if (hasGTAO) {
+        std::cout << "  GTAO: " << gtaoComp << "\n";
+        
+        tempGtaoShader = std::make_unique<ShaderProgram>();
+        if (!tempGtaoShader->loadComputeFromFile(gtaoComp)) {
+            std::cerr << "[DeferredPipeline] Failed to load GTAO shader\n";
+            return false;
+        }
+    }
+    
+    // Load the Hi-Z occlusion culling (compute) shader if provided
+    std::unique_ptr<ShaderProgram> tempOcclusionShader;
+    bool hasOcclusion = !occlusionComp.empty();
+    
+    if (hasOcclusion) {
+        std::cout << "  Occlusion Culling: " << occlusionComp << "\n";
+        
+        tempOcclusionShader = std::make_unique<ShaderProgram>();
+        if (!tempOcclusionShader->loadComputeFromFile(occlusionComp)) {
+            std::cerr << "[DeferredPipeline] Failed to load occlusion culling shader\n";
+            return false;
+        }
+    }
+    
     // Only update if all required shaders loaded successfully
     geometryShader_ = std::move(tempGeometryShader);
     lightingShader_ = std::move(tempLightingShader);
@@ -119,19 +187,54 @@ bool DeferredPipeline::loadShaders(
         shadowShader_ = std::move(tempShadowShader);
     }
     
+    if (hasShadowAtlas) {
+        shadowAtlasShader_ = std::move(tempShadowAtlasShader);
+    }
+    
+    if (hasTiledLighting) {
+        tiledLightingShader_ = std::move(tempTiledLightingShader);
+    }
+    
+    if (hasGTAO) {
+        gtaoShader_ = std::move(tempGtaoShader);
+    }
+    
+    if (hasOcclusion) {
+        occlusionShader_ = std::move(tempOcclusionShader);
+    }
+    
     // Create passes with the new valid shaders
     auto gbufferPass = std::make_unique<GBufferPass>(gbuffer_, geometryShader_.get());
+    if (occlusionShader_) {
+        gbufferPass->setOcclusionShader(occlusionShader_.get());
+        gbufferPass->enableOcclusionCulling(occlusionCullingEnabled_);
+    } else {
+        occlusionCullingEnabled_ = false;
+    }
     
     // Create shadow map pass if shader is loaded
     std::unique_ptr<ShadowMapPass> shadowMapPass;
     if (hasShadow && shadowShader_) {
         shadowMapPass = std::make_unique<ShadowMapPass>(shadowShader_.get(), 2048);
         shadowMapPass->setup();
+        shadowMapPass->enableCaching(shadowCaching_);
         shadowMapPass_ = shadowMapPass.get();  // Set the pointer!
     } else {
         shadowMapPass_ = nullptr;
     }
     
+    // Create shadow atlas pass for point and spot lights if its shader is loaded
+    std::unique_ptr<ShadowAtlasPass> shadowAtlasPass;
+    if (hasShadowAtlas && shadowAtlasShader_ && shadowMapPass_) {
+        shadowAtlasPass = std::make_unique<ShadowAtlasPass>(shadowAtlasShader_.get(), 4096);
+        shadowAtlasPass->setup();
+        shadowAtlasPass->enableCaching(shadowCaching_);
+        shadowAtlasPass->setUpdateBudget(shadowAtlasBudget_);
+        shadowAtlasPass_ = shadowAtlasPass.get();
+    } else {
+        shadowAtlasPass_ = nullptr;
+    }
+    
     // Create SSAO pass if shaders are loaded
     std::unique_ptr<SSAOPass> ssaoPass;
     if (hasSSAO && ssaoShader_ && ssaoBlurShader_) {
@@ -143,11 +246,24 @@ bool DeferredPipeline::loadShaders(
             width_,
             height_
         );
+        ssaoPass->setDownsample(ssaoDownsample_);
         ssaoPass_ = ssaoPass.get();
     } else {
         ssaoPass_ = nullptr;
     }
     
+    // Create GTAO pass if shader is loaded
+    std::unique_ptr<GTAOPass> gtaoPass;
+    if (hasGTAO && gtaoShader_) {
+        gtaoPass = std::make_unique<GTAOPass>(gbuffer_, gtaoShader_.get(), width_, height_);
+        gtaoPass_ = gtaoPass.get();
+    } else {
+        gtaoPass_ = nullptr;
+    }
+    if (!gtaoPass_) {
+        ssaoTechnique_ = SSAOTechnique::Kernel;
+    }
+    
     auto lightingPass = std::make_unique<LightingPass>(
         gbuffer_,
         lightingShader_.get(),
@@ -157,6 +273,22 @@ bool DeferredPipeline::loadShaders(
         height_
     );
     
+    // Create tiled lighting pass if shader is loaded
+    std::unique_ptr<TiledLightingPass> tiledLightingPass;
+    if (hasTiledLighting && tiledLightingShader_) {
+        tiledLightingPass = std::make_unique<TiledLightingPass>(
+            gbuffer_,
+            tiledLightingShader_.get(),
+            fbo_,
+            width_,
+            height_
+        );
+        tiledLightingPass_ = tiledLightingPass.get();
+    } else {
+        tiledLightingPass_ = nullptr;
+        tiledLightingEnabled_ = false;
+    }
+    
     // Store non-owning pointers for direct access
     gbufferPass_ = gbufferPass.get();
     lightingPass_ = lightingPass.get();
@@ -164,26 +296,99 @@ bool DeferredPipeline::loadShaders(
     // Transfer ownership to passes_ vector
     passes_.clear();
     
-    // Shadow map pass runs first (before geometry)
+    // Shadow passes run first (before geometry)
     if (shadowMapPass) {
         passes_.push_back(std::move(shadowMapPass));
         shadowsEnabled_ = true;  // Enable shadows by default if shader is loaded
     }
     
+    if (shadowAtlasPass) {
+        passes_.push_back(std::move(shadowAtlasPass));
+    }
+    
     passes_.push_back(std::move(gbufferPass));
     
-    // Add SSAO pass if available (will be used based on ssaoEnabled_ flag)
+    // Add SSAO passes if available (will be used based on ssaoEnabled_ and ssaoTechnique_)
     if (ssaoPass) {
         passes_.push_back(std::move(ssaoPass));
         ssaoEnabled_ = true;  // Enable SSAO by default if shaders are loaded
     }
     
+    if (gtaoPass) {
+        passes_.push_back(std::move(gtaoPass));
+    }
+    if (!ssaoPass_ && !gtaoPass_) {
+        ssaoEnabled_ = false;
+    }
+    
     passes_.push_back(std::move(lightingPass));
     
+    // Only one of the two lighting passes runs, see execute()
+    if (tiledLightingPass) {
+        passes_.push_back(std::move(tiledLightingPass));
+    }
+    
     std::cout << "[DeferredPipeline] Shaders loaded successfully\n";
     return true;
 }
 
+void DeferredPipeline::watchShaders(
+    ShaderCompileService& service,
+    const std::string& geomVert,
+    const std::string& geomFrag,
+    const std::string& lightVert,
+    const std::string& lightFrag,
+    const std::string& ssaoVert,
+    const std::string& ssaoFrag,
+    const std::string& ssaoBlurVert,
+    const std::string& ssaoBlurFrag,
+    const std::string& shadowVert,
+    const std::string& shadowFrag,
+    const std::string& tiledLightComp,
+    const std::string& gtaoComp,
+    const std::string& shadowAtlasGeom,
+    const std::string& occlusionComp
+)
+{
+    // Passes hold raw pointers to the programs, so new code is adopted in place
+    auto watchProgram = [&](const char* key, const std::string& vert, const std::string& frag,
+                            std::unique_ptr<ShaderProgram>& target) {
+        if (vert.empty() || frag.empty()) {
+            service.unwatch(key);
+            return;
+        }
+        
+        service.watch(key, {{GL_VERTEX_SHADER, vert}, {GL_FRAGMENT_SHADER, frag}}, target);
+    };
+    
+    watchProgram("DeferredPipeline/geometry", geomVert, geomFrag, geometryShader_);
+    watchProgram("DeferredPipeline/lighting", lightVert, lightFrag, lightingShader_);
+    watchProgram("DeferredPipeline/ssao", ssaoVert, ssaoFrag, ssaoShader_);
+    watchProgram("DeferredPipeline/ssaoBlur", ssaoBlurVert, ssaoBlurFrag, ssaoBlurShader_);
+    watchProgram("DeferredPipeline/shadow", shadowVert, shadowFrag, shadowShader_);
+    
+    if (shadowVert.empty() || shadowFrag.empty() || shadowAtlasGeom.empty()) {
+        service.unwatch("DeferredPipeline/shadowAtlas");
+    } else {
+        service.watch("DeferredPipeline/shadowAtlas",
+                      {{GL_VERTEX_SHADER, shadowVert}, {GL_GEOMETRY_SHADER, shadowAtlasGeom}, {GL_FRAGMENT_SHADER, shadowFrag}},
+                      shadowAtlasShader_);
+    }
+    
+    auto watchCompute = [&](const char* key, const std::string& comp, std::unique_ptr<ShaderProgram>& target) {
+        if (comp.empty()) {
+            service.unwatch(key);
+            return;
+        }
+        
+        service.watch(key, {{GL_COMPUTE_SHADER, comp}}, target);
+    };
+    
+    watchCompute("DeferredPipeline/tiledLighting", tiledLightComp, tiledLightingShader_);
+    watchCompute("DeferredPipeline/gtao", gtaoComp, gtaoShader_);
+    watchCompute("DeferredPipeline/occlusion", occlusionComp, occlusionShader_);
+}
+
 void DeferredPipeline::execute(RenderContext& ctx)
 {
     if (!ctx.isValid()) {
@@ -203,45 +408,105 @@ void DeferredPipeline::execute(RenderContext& ctx)
         return;
     }
     
+    // Only one AO pass runs; disabled SSAO costs nothing, the lighting passes just get no texture
+    bool gtao = ssaoEnabled_ && ssaoTechnique_ == SSAOTechnique::GTAO && gtaoPass_;
+    bool kernelAO = ssaoEnabled_ && !gtao && ssaoPass_;
+    if (!gtao && !kernelAO) {
+        lightingPass_->setSSAOTexture(0);
+        if (tiledLightingPass_) {
+            tiledLightingPass_->setSSAOTexture(0);
+        }
+    }
+    
+    // Disabled shadows skip the shadow pass as well
+    if (!shadowsEnabled_) {
+        lightingPass_->setShadowCascades(ShadowCascades());
+        lightingPass_->setLocalShadows(nullptr);
+        if (tiledLightingPass_) {
+            tiledLightingPass_->setShadowCascades(ShadowCascades());
+            tiledLightingPass_->setLocalShadows(nullptr);
+        }
+    }
+    
     // Execute all passes in sequence
-    // Order: ShadowMap -> GBuffer -> (optional) SSAO -> Lighting
+    // Order: ShadowMap -> ShadowAtlas -> GBuffer -> (optional) SSAO or GTAO -> Lighting or TiledLighting
     for (auto& pass : passes_) {
         if (pass) {  // Check pass pointer is valid
-            pass->execute(ctx);
+            bool tiled = tiledLightingEnabled_ && tiledLightingPass_;
+            if ((pass.get() == lightingPass_ && tiled) ||
+                (pass.get() == tiledLightingPass_ && !tiled)) {
+                continue;
+            }
+            
+            if ((pass.get() == shadowMapPass_ || pass.get() == shadowAtlasPass_) && !shadowsEnabled_) {
+                continue;
+            }
+            
+            if ((pass.get() == ssaoPass_ && !kernelAO) ||
+                (pass.get() == gtaoPass_ && !gtao)) {
+                // Frames GTAO did not see make its history stale
+                if (pass.get() == gtaoPass_) {
+                    gtaoPass_->resetHistory();
+                }
+                continue;
+            }
+            
+            {
+                ProfileScope scope(ctx.profiler, pass->getName());
+                pass->execute(ctx);
+            }
             
             // After shadow map pass, set shadow data for lighting pass
             if (dynamic_cast<ShadowMapPass*>(pass.get()) && shadowMapPass_ && lightingPass_) {
-                if (shadowsEnabled_) {
-                    GLuint shadowMap = shadowMapPass_->getShadowMap();
-                    glm::mat4 lightSpaceMatrix = shadowMapPass_->getLightSpaceMatrix();
-                    lightingPass_->setShadowMap(shadowMap, lightSpaceMatrix);
-                } else {
-                    lightingPass_->setShadowMap(0, glm::mat4(1.0f));
+                lightingPass_->setShadowCascades(shadowMapPass_->getCascades());
+                if (tiledLightingPass_) {
+                    tiledLightingPass_->setShadowCascades(shadowMapPass_->getCascades());
                 }
             }
             
-            // After SSAO pass executes, set the SSAO texture for lighting pass
-            if (dynamic_cast<SSAOPass*>(pass.get()) && ssaoPass_ && lightingPass_) {
-                if (ssaoEnabled_) {
-                    GLuint ssaoTex = ssaoPass_->getSSAOTexture();
-                    lightingPass_->setSSAOTexture(ssaoTex);
-                } else {
-                    lightingPass_->setSSAOTexture(0);
+            if (pass.get() == shadowAtlasPass_ && lightingPass_) {
+                lightingPass_->setLocalShadows(&shadowAtlasPass_->getLocalShadows());
+                if (tiledLightingPass_) {
+                    tiledLightingPass_->setLocalShadows(&shadowAtlasPass_->getLocalShadows());
+                }
+            }
+            
+            // After an AO pass executes, set the SSAO texture for lighting pass
+            if ((pass.get() == ssaoPass_ || pass.get() == gtaoPass_) && lightingPass_) {
+                GLuint ssaoTex = gtao ? gtaoPass_->getSSAOTexture() : ssaoPass_->getSSAOTexture();
+                lightingPass_->setSSAOTexture(ssaoTex);
+                if (tiledLightingPass_) {
+                    tiledLightingPass_->setSSAOTexture(ssaoTex);
                 }
             }
         }
     }
 }
 
-void DeferredPipeline::enableSSAO(bool enable)
+void DeferredPipeline::enableSSAO(bool enable, SSAOTechnique technique)
 {
-    if (!ssaoPass_) {
+    if (technique == SSAOTechnique::GTAO && !gtaoPass_) {
+        std::cerr << "[DeferredPipeline] GTAO pass not available, using the SSAO kernel\n";
+        technique = SSAOTechnique::Kernel;
+    }
+    
+    if (technique == SSAOTechnique::Kernel && !ssaoPass_) {
         std::cerr << "[DeferredPipeline] SSAO pass not available\n";
         return;
     }
     
     ssaoEnabled_ = enable;
-    std::cout << "[DeferredPipeline] SSAO " << (enable ? "enabled" : "disabled") << "\n";
+    ssaoTechnique_ = technique;
+    std::cout << "[DeferredPipeline] SSAO " << (enable ? "enabled" : "disabled")
+              << (technique == SSAOTechnique::GTAO ? " (GTAO)" : "") << "\n";
+}
+
+void DeferredPipeline::setSSAODownsample(int downsample)
+{
+    ssaoDownsample_ = downsample;
+    if (ssaoPass_) {
+        ssaoPass_->setDownsample(downsample);
+    }
 }
 
 void DeferredPipeline::enableShadows(bool enable)
@@ -255,6 +520,48 @@ void DeferredPipeline::enableShadows(bool enable)
     std::cout << "[DeferredPipeline] Shadows " << (enable ? "enabled" : "disabled") << "\n";
 }
 
+void DeferredPipeline::enableShadowCaching(bool enable)
+{
+    shadowCaching_ = enable;
+    if (shadowMapPass_) {
+        shadowMapPass_->enableCaching(enable);
+    }
+    if (shadowAtlasPass_) {
+        shadowAtlasPass_->enableCaching(enable);
+    }
+}
+
+void DeferredPipeline::setShadowAtlasBudget(int views)
+{
+    shadowAtlasBudget_ = views;
+    if (shadowAtlasPass_) {
+        shadowAtlasPass_->setUpdateBudget(views);
+    }
+}
+
+void DeferredPipeline::enableTiledLighting(bool enable)
+{
+    if (!tiledLightingPass_) {
+        std::cerr << "[DeferredPipeline] Tiled lighting pass not available\n";
+        return;
+    }
+    
+    tiledLightingEnabled_ = enable;
+    std::cout << "[DeferredPipeline] Tiled lighting " << (enable ? "enabled" : "disabled") << "\n";
+}
+
+void DeferredPipeline::enableOcclusionCulling(bool enable)
+{
+    if (!occlusionShader_ || !gbufferPass_) {
+        std::cerr << "[DeferredPipeline] Occlusion culling not available\n";
+        return;
+    }
+    
+    occlusionCullingEnabled_ = enable;
+    gbufferPass_->enableOcclusionCulling(enable);
+    std::cout << "[DeferredPipeline] Occlusion culling " << (enable ? "enabled" : "disabled") << "\n";
+}
+
 void DeferredPipeline::resize(int width, int height)
 {
     width_ = width;
@@ -274,10 +581,17 @@ void DeferredPipeline::cleanup()
     ssaoShader_.reset();
     ssaoBlurShader_.reset();
     shadowShader_.reset();
+    shadowAtlasShader_.reset();
+    tiledLightingShader_.reset();
+    gtaoShader_.reset();
+    occlusionShader_.reset();
     gbufferPass_ = nullptr;
     lightingPass_ = nullptr;
     ssaoPass_ = nullptr;
+    gtaoPass_ = nullptr;
     shadowMapPass_ = nullptr;
+    shadowAtlasPass_ = nullptr;
+    tiledLightingPass_ = nullptr;
 }
 
 } // namespace kcShaders
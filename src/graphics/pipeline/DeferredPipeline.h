@@ -9,10 +9,20 @@ namespace kcShaders {
 
 class GBuffer;
 class ShaderProgram;
+class ShaderCompileService;
 class GBufferPass;
 class LightingPass;
+class TiledLightingPass;
 class SSAOPass;
+class GTAOPass;
 class ShadowMapPass;
+class ShadowAtlasPass;
+
+// Ambient occlusion implementations selectable through enableSSAO()
+enum class SSAOTechnique {
+    Kernel,     // SSAOPass: hemisphere kernel, fragment shaders
+    GTAO        // GTAOPass: horizon search in compute with temporal accumulation
+};
 
 /**
  * @brief Deferred rendering pipeline
@@ -52,14 +62,44 @@ public:
         const std::string& ssaoBlurVert = "",
         const std::string& ssaoBlurFrag = "",
         const std::string& shadowVert = "",
-        const std::string& shadowFrag = ""
+        const std::string& shadowFrag = "",
+        const std::string& tiledLightComp = "",
+        const std::string& gtaoComp = "",
+        const std::string& shadowAtlasGeom = "",
+        const std::string& occlusionComp = ""
+    );
+    
+    /**
+     * @brief Rebuild the shaders in the background whenever their files change
+     * @param service Compile service watching the files
+     *
+     * Each program is watched separately, so editing one pass only recompiles
+     * that pass. Empty paths are not watched.
+     */
+    void watchShaders(
+        ShaderCompileService& service,
+        const std::string& geomVert,
+        const std::string& geomFrag,
+        const std::string& lightVert,
+        const std::string& lightFrag,
+        const std::string& ssaoVert = "",
+        const std::string& ssaoFrag = "",
+        const std::string& ssaoBlurVert = "",
+        const std::string& ssaoBlurFrag = "",
+        const std::string& shadowVert = "",
+        const std::string& shadowFrag = "",
+        const std::string& tiledLightComp = "",
+        const std::string& gtaoComp = "",
+        const std::string& shadowAtlasGeom = "",
+        const std::string& occlusionComp = ""
     );
     
     /**
      * @brief Enable or disable SSAO
      * @param enable Whether to enable SSAO
+     * @param technique Which implementation produces the AO texture
      */
-    void enableSSAO(bool enable);
+    void enableSSAO(bool enable, SSAOTechnique technique = SSAOTechnique::Kernel);
     
     /**
      * @brief Check if SSAO is enabled
@@ -67,6 +107,17 @@ public:
      */
     bool isSSAOEnabled() const { return ssaoEnabled_; }
     
+    /**
+     * @brief Get the active SSAO implementation
+     */
+    SSAOTechnique getSSAOTechnique() const { return ssaoTechnique_; }
+    
+    /**
+     * @brief Set the SSAO resolution
+     * @param downsample 1 = full, 2 = half (default), 4 = quarter resolution
+     */
+    void setSSAODownsample(int downsample);
+    
     /**
      * @brief Enable or disable shadows
      * @param enable Whether to enable shadows
@@ -78,6 +129,44 @@ public:
      * @return true if shadows are enabled
      */
     bool isShadowsEnabled() const { return shadowsEnabled_; }
+    
+    /**
+     * @brief Keep shadow cascades and atlas tiles between frames, redrawing
+     * only what changed
+     * @param enable false redraws every cascade and tile every frame
+     */
+    void enableShadowCaching(bool enable);
+    
+    /**
+     * @brief Set how many point/spot light shadow views may be redrawn per frame
+     * @param views Views per frame (a point light has six), 0 = unlimited
+     */
+    void setShadowAtlasBudget(int views);
+    
+    /**
+     * @brief Shade with the compute-based tiled lighting pass instead of the
+     * fullscreen fragment pass
+     * @param enable Whether to use tiled lighting
+     */
+    void enableTiledLighting(bool enable);
+    
+    /**
+     * @brief Check if tiled lighting is enabled
+     * @return true if the compute lighting pass is used
+     */
+    bool isTiledLightingEnabled() const { return tiledLightingEnabled_; }
+    
+    /**
+     * @brief Cull the geometry pass on the GPU against a Hi-Z pyramid of the
+     * scene depth, in two phases (see OcclusionCuller)
+     * @param enable Whether to use occlusion culling
+     */
+    void enableOcclusionCulling(bool enable);
+    
+    /**
+     * @brief Check if occlusion culling is enabled
+     */
+    bool isOcclusionCullingEnabled() const { return occlusionCullingEnabled_; }
 
 private:
     GBuffer* gbuffer_;
@@ -91,14 +180,27 @@ private:
     std::unique_ptr<ShaderProgram> ssaoShader_;
     std::unique_ptr<ShaderProgram> ssaoBlurShader_;
     std::unique_ptr<ShaderProgram> shadowShader_;
+    std::unique_ptr<ShaderProgram> shadowAtlasShader_;
+    std::unique_ptr<ShaderProgram> tiledLightingShader_;
+    std::unique_ptr<ShaderProgram> gtaoShader_;
+    std::unique_ptr<ShaderProgram> occlusionShader_;
     
     GBufferPass* gbufferPass_;      // Non-owning pointer (owned by passes_)
     LightingPass* lightingPass_;    // Non-owning pointer (owned by passes_)
     SSAOPass* ssaoPass_;            // Non-owning pointer (owned by passes_)
+    GTAOPass* gtaoPass_;            // Non-owning pointer (owned by passes_)
     ShadowMapPass* shadowMapPass_;  // Non-owning pointer (owned by passes_)
+    ShadowAtlasPass* shadowAtlasPass_;  // Non-owning pointer (owned by passes_)
+    TiledLightingPass* tiledLightingPass_;  // Non-owning pointer (owned by passes_)
     
     bool ssaoEnabled_ = false;
+    SSAOTechnique ssaoTechnique_ = SSAOTechnique::Kernel;
     bool shadowsEnabled_ = false;
+    bool shadowCaching_ = true;
+    int shadowAtlasBudget_ = 12;
+    bool tiledLightingEnabled_ = false;
+    bool occlusionCullingEnabled_ = false;
+    int ssaoDownsample_ = 2;
 };
 
 } // namespace kcShaders
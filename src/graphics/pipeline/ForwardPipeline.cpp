@@ -1,17 +1,22 @@
 #include "ForwardPipeline.h"
 #include "../ShaderProgram.h"
+#include "../ShaderCompileService.h"
 #include "../MaterialBinder.h"
+#include "../Profiler.h"
+#include "../passes/SSAOPass.h"
 #include "../../scene/scene.h"
 #include "../../scene/camera.h"
 #include "../../scene/light.h"
 #include "../../scene/mesh.h"
+#include <algorithm>
 #include <iostream>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace kcShaders {
 
-ForwardPipeline::ForwardPipeline(GLuint fbo, int width, int height)
+ForwardPipeline::ForwardPipeline(GLuint fbo, GLuint quadVAO, int width, int height)
     : fbo_(fbo)
+    , quadVAO_(quadVAO)
     , width_(width)
     , height_(height)
 {
@@ -28,20 +33,105 @@ bool ForwardPipeline::initialize()
     return true;
 }
 
-bool ForwardPipeline::loadShaders(const std::string& vertPath, const std::string& fragPath)
+bool ForwardPipeline::loadShaders(const std::string& vertPath, const std::string& fragPath,
+                                  const std::string& depthVert, const std::string& depthFrag,
+                                  const std::string& ssaoVert, const std::string& ssaoFrag,
+                                  const std::string& ssaoBlurVert, const std::string& ssaoBlurFrag)
 {
     std::cout << "[ForwardPipeline] Loading shaders: " << vertPath << " + " << fragPath << "\n";
     
-    shader_ = std::make_unique<ShaderProgram>();
-    if (!shader_->loadFromFiles(vertPath, fragPath)) {
+    auto tempShader = std::make_unique<ShaderProgram>();
+    if (!tempShader->loadFromFiles(vertPath, fragPath)) {
         std::cerr << "[ForwardPipeline] Failed to load shaders\n";
         return false;
     }
     
+    // Load the depth pre-pass shader if provided
+    std::unique_ptr<ShaderProgram> tempDepthShader;
+    bool hasDepth = !depthVert.empty() && !depthFrag.empty();
+    
+    if (hasDepth) {
+        std::cout << "  Depth pre-pass: " << depthVert << " + " << depthFrag << "\n";
+        
+        tempDepthShader = std::make_unique<ShaderProgram>();
+        if (!tempDepthShader->loadFromFiles(depthVert, depthFrag)) {
+            std::cerr << "[ForwardPipeline] Failed to load depth pre-pass shaders\n";
+            return false;
+        }
+    }
+    
+    // Load SSAO shaders if provided; they need the pre-pass depth and the quad
+    std::unique_ptr<ShaderProgram> tempSsaoShader;
+    std::unique_ptr<ShaderProgram> tempSsaoBlurShader;
+    bool hasSSAO = hasDepth && quadVAO_ != 0 &&
+                   !ssaoVert.empty() && !ssaoFrag.empty() && !ssaoBlurVert.empty() && !ssaoBlurFrag.empty();
+    
+    if (hasSSAO) {
+        std::cout << "  SSAO: " << ssaoVert << " + " << ssaoFrag << "\n";
+        std::cout << "  SSAO Blur: " << ssaoBlurVert << " + " << ssaoBlurFrag << "\n";
+        
+        tempSsaoShader = std::make_unique<ShaderProgram>();
+        tempSsaoBlurShader = std::make_unique<ShaderProgram>();
+        if (!tempSsaoShader->loadFromFiles(ssaoVert, ssaoFrag) ||
+            !tempSsaoBlurShader->loadFromFiles(ssaoBlurVert, ssaoBlurFrag)) {
+            std::cerr << "[ForwardPipeline] Failed to load SSAO shaders\n";
+            return false;
+        }
+    }
+    
+    // Only update if all requested shaders loaded successfully
+    ssaoPass_.reset();
+    shader_ = std::move(tempShader);
+    depthShader_ = std::move(tempDepthShader);
+    ssaoShader_ = std::move(tempSsaoShader);
+    ssaoBlurShader_ = std::move(tempSsaoBlurShader);
+    
+    // No G-Buffer: the pass reads the copied pre-pass depth
+    if (hasSSAO) {
+        ssaoPass_ = std::make_unique<SSAOPass>(
+            nullptr,
+            ssaoShader_.get(),
+            ssaoBlurShader_.get(),
+            quadVAO_,
+            width_,
+            height_
+        );
+    }
+    
     std::cout << "[ForwardPipeline] Shaders loaded successfully\n";
     return true;
 }
 
+void ForwardPipeline::watchShaders(ShaderCompileService& service, const std::string& vertPath, const std::string& fragPath,
+                                   const std::string& depthVert, const std::string& depthFrag,
+                                   const std::string& ssaoVert, const std::string& ssaoFrag,
+                                   const std::string& ssaoBlurVert, const std::string& ssaoBlurFrag)
+{
+    auto watchProgram = [&](const char* key, const std::string& vert, const std::string& frag,
+                            std::unique_ptr<ShaderProgram>& target) {
+        if (vert.empty() || frag.empty()) {
+            service.unwatch(key);
+            return;
+        }
+        
+        service.watch(key, {{GL_VERTEX_SHADER, vert}, {GL_FRAGMENT_SHADER, frag}}, target);
+    };
+    
+    watchProgram("ForwardPipeline/main", vertPath, fragPath, shader_);
+    watchProgram("ForwardPipeline/depth", depthVert, depthFrag, depthShader_);
+    watchProgram("ForwardPipeline/ssao", ssaoVert, ssaoFrag, ssaoShader_);
+    watchProgram("ForwardPipeline/ssaoBlur", ssaoBlurVert, ssaoBlurFrag, ssaoBlurShader_);
+}
+
+void ForwardPipeline::enableSSAO(bool enable)
+{
+    if (enable && !ssaoPass_) {
+        std::cerr << "[ForwardPipeline] SSAO not available (needs the depth pre-pass and SSAO shaders)\n";
+        return;
+    }
+    ssaoEnabled_ = enable;
+}
+
 void ForwardPipeline::execute(RenderContext& ctx)
 {
     if (!ctx.isValid() || !shader_) {
@@ -49,6 +139,16 @@ void ForwardPipeline::execute(RenderContext& ctx)
         return;
     }
     
+    // Collect all render items from the scene, grouped by material permutation
+    std::vector<RenderItem> items;
+    ctx.scene->collectRenderItems(items);
+    std::stable_sort(items.begin(), items.end(), [](const RenderItem& a, const RenderItem& b) {
+        return MaterialBinder::textureMask(a.material) < MaterialBinder::textureMask(b.material);
+    });
+    
+    bool ssao = ssaoEnabled_ && ssaoPass_ && depthShader_;
+    bool prepass = (depthPrepassEnabled_ || ssao) && depthShader_;
+    
     // Bind framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
     glViewport(0, 0, width_, height_);
@@ -57,40 +157,163 @@ void ForwardPipeline::execute(RenderContext& ctx)
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // Enable depth test
+    // Enable depth test, disable blending: the pre-pass and the color pass
+    // draw opaque surfaces only
     glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
     
-    // Use shader
-    shader_->use();
+    if (prepass) {
+        {
+            ProfileScope scope(ctx.profiler, "DepthPrepass");
+            renderDepthPrepass(ctx, items);
+        }
+        
+        if (ssao) {
+            copyDepth();
+            ssaoPass_->setDepthSource(depthCopyTexture_);
+            {
+                ProfileScope scope(ctx.profiler, ssaoPass_->getName());
+                ssaoPass_->execute(ctx);
+            }
+            
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+            glViewport(0, 0, width_, height_);
+            glEnable(GL_DEPTH_TEST);
+            glDisable(GL_BLEND);
+        }
+        
+        // Only the front-most fragment of each pixel passes
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
     
-    // Set camera uniforms
-    glm::mat4 view = ctx.camera->GetViewMatrix();
-    glm::mat4 proj = ctx.camera->GetProjectionMatrix();
-    glm::vec3 camPos = ctx.camera->GetPosition();
+    // Render scene (selects the shader permutations and sets their uniforms)
+    renderScene(ctx, items, ssao ? ssaoPass_->getSSAOTexture() : 0);
+    
+    if (prepass) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
     
-    shader_->setMat4("uView", view);
-    shader_->setMat4("uProjection", proj);
-    shader_->setVec3("viewPos", camPos);
+    // Unbind framebuffer
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ForwardPipeline::renderDepthPrepass(RenderContext& ctx, const std::vector<RenderItem>& items)
+{
+    glm::mat4 view = ctx.camera->GetViewMatrix();
     
-    // Set lighting uniforms
-    setLightUniforms(ctx);
+    // Front to back, so the pre-pass itself rejects hidden fragments early
+    std::vector<std::pair<float, const RenderItem*>> order;
+    order.reserve(items.size());
+    for (const auto& item : items) {
+        if (item.mesh && item.mesh->isUploaded()) {
+            glm::vec3 center = (item.mesh->GetBoundsMin() + item.mesh->GetBoundsMax()) * 0.5f;
+            float viewDepth = -(view * item.modelMatrix * glm::vec4(center, 1.0f)).z;
+            order.emplace_back(viewDepth, &item);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
     
-    // Render scene
-    renderScene(ctx);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    depthShader_->use();
+    depthShader_->setMat4("uView", view);
+    depthShader_->setMat4("uProjection", ctx.camera->GetProjectionMatrix());
+    for (const auto& entry : order) {
+        depthShader_->setMat4("uModel", entry.second->modelMatrix);
+        entry.second->mesh->drawDepth();
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void ForwardPipeline::copyDepth()
+{
+    if (depthCopyFBO_ == 0 || depthCopyWidth_ != width_ || depthCopyHeight_ != height_) {
+        deleteDepthCopy();
+        
+        // Must stay GL_DEPTH24_STENCIL8 like the renderer's pooled depth
+        // texture (Renderer::create_framebuffer): the blit below requires
+        // matching depth formats
+        glGenTextures(1, &depthCopyTexture_);
+        glBindTexture(GL_TEXTURE_2D, depthCopyTexture_);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width_, height_, 0,
+                     GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        
+        glGenFramebuffers(1, &depthCopyFBO_);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthCopyFBO_);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthCopyTexture_, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "[ForwardPipeline] Depth copy framebuffer not complete!\n";
+        }
+        
+        depthCopyWidth_ = width_;
+        depthCopyHeight_ = height_;
+    }
     
-    // Unbind framebuffer
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthCopyFBO_);
+    glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void ForwardPipeline::renderScene(RenderContext& ctx)
+void ForwardPipeline::deleteDepthCopy()
 {
-    // Collect all render items from the scene
-    std::vector<RenderItem> items;
-    ctx.scene->collectRenderItems(items);
+    if (depthCopyFBO_ != 0) {
+        glDeleteFramebuffers(1, &depthCopyFBO_);
+        depthCopyFBO_ = 0;
+    }
+    if (depthCopyTexture_ != 0) {
+        glDeleteTextures(1, &depthCopyTexture_);
+        depthCopyTexture_ = 0;
+    }
+    depthCopyWidth_ = 0;
+    depthCopyHeight_ = 0;
+}
+
+void ForwardPipeline::renderScene(RenderContext& ctx, const std::vector<RenderItem>& items, GLuint ssaoTexture)
+{
+    // Camera uniforms
+    glm::mat4 view = ctx.camera->GetViewMatrix();
+    glm::mat4 proj = ctx.camera->GetProjectionMatrix();
+    glm::vec3 camPos = ctx.camera->GetPosition();
+    
+    // SSAO sits after the material texture units
+    if (ssaoTexture != 0) {
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, ssaoTexture);
+    }
     
     // Render each item
+    uint32_t currentMask = ~0u;
     for (const auto& item : items) {
         if (item.mesh && item.mesh->isUploaded()) {
+            // Switch permutation; uniforms are per program, so set the frame state again
+            uint32_t mask = MaterialBinder::textureMask(item.material);
+            if (mask != currentMask) {
+                currentMask = mask;
+                ShaderDefines defines = MaterialBinder::permutation(mask);
+                if (ssaoTexture != 0) {
+                    defines.push_back({"USE_SSAO", ""});
+                }
+                shader_->usePermutation(defines);
+                shader_->setMat4("uView", view);
+                shader_->setMat4("uProjection", proj);
+                shader_->setVec3("viewPos", camPos);
+                if (ssaoTexture != 0) {
+                    shader_->setInt("ssaoTexture", 6);
+                }
+                setLightUniforms(ctx);
+            }
+            
             // Set model matrix
             shader_->setMat4("uModel", item.modelMatrix);
             
@@ -103,6 +326,12 @@ void ForwardPipeline::renderScene(RenderContext& ctx)
             item.mesh->draw();
         }
     }
+    
+    if (ssaoTexture != 0) {
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
 }
 
 void ForwardPipeline::setLightUniforms(RenderContext& ctx)
@@ -189,11 +418,21 @@ void ForwardPipeline::resize(int width, int height)
 {
     width_ = width;
     height_ = height;
+    
+    // The depth copy follows on its next use
+    if (ssaoPass_) {
+        ssaoPass_->resize(width, height);
+    }
 }
 
 void ForwardPipeline::cleanup()
 {
+    ssaoPass_.reset();
+    deleteDepthCopy();
     shader_.reset();
+    depthShader_.reset();
+    ssaoShader_.reset();
+    ssaoBlurShader_.reset();
 }
 
 } // namespace kcShaders
@@ -4,25 +4,36 @@
 #include "RenderPipeline.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace kcShaders {
 
 class ShaderProgram;
+class ShaderCompileService;
+class SSAOPass;
+struct RenderItem;
 
 /**
  * @brief Forward rendering pipeline
  * 
  * Traditional single-pass rendering with direct lighting calculations.
+ *
+ * With the depth pre-pass enabled every mesh is first drawn depth only
+ * (front to back, position-only vertex stream), then shaded with a
+ * GL_EQUAL depth test and depth writes off, so each pixel runs the full
+ * lighting loop about once regardless of overdraw. The pre-pass depth also
+ * feeds SSAO, which reconstructs normals from it (no G-Buffer here).
  */
 class ForwardPipeline : public RenderPipeline {
 public:
     /**
      * @brief Construct forward pipeline
      * @param fbo Framebuffer to render to
+     * @param quadVAO VAO for fullscreen quad (SSAO)
      * @param width Initial viewport width
      * @param height Initial viewport height
      */
-    ForwardPipeline(GLuint fbo, int width, int height);
+    ForwardPipeline(GLuint fbo, GLuint quadVAO, int width, int height);
     ~ForwardPipeline() override;
     
     bool initialize() override;
@@ -33,19 +44,66 @@ public:
     
     /**
      * @brief Load shaders for the pipeline
+     * Empty optional paths leave out the depth pre-pass or SSAO.
      * @return true if shaders loaded successfully
      */
-    bool loadShaders(const std::string& vertPath, const std::string& fragPath);
+    bool loadShaders(const std::string& vertPath, const std::string& fragPath,
+                     const std::string& depthVert = "", const std::string& depthFrag = "",
+                     const std::string& ssaoVert = "", const std::string& ssaoFrag = "",
+                     const std::string& ssaoBlurVert = "", const std::string& ssaoBlurFrag = "");
+    
+    /**
+     * @brief Rebuild the shaders in the background whenever their files change
+     * @param service Compile service watching the files
+     */
+    void watchShaders(ShaderCompileService& service, const std::string& vertPath, const std::string& fragPath,
+                      const std::string& depthVert = "", const std::string& depthFrag = "",
+                      const std::string& ssaoVert = "", const std::string& ssaoFrag = "",
+                      const std::string& ssaoBlurVert = "", const std::string& ssaoBlurFrag = "");
+    
+    /**
+     * @brief Draw depth first and shade with an equal depth test
+     */
+    void enableDepthPrepass(bool enable) { depthPrepassEnabled_ = enable; }
+    bool isDepthPrepassEnabled() const { return depthPrepassEnabled_; }
+    
+    /**
+     * @brief Enable SSAO from the pre-pass depth (runs the pre-pass even if it is disabled)
+     */
+    void enableSSAO(bool enable);
+    bool isSSAOEnabled() const { return ssaoEnabled_; }
 
 private:
-    void renderScene(RenderContext& ctx);
+    void renderDepthPrepass(RenderContext& ctx, const std::vector<RenderItem>& items);
+    void renderScene(RenderContext& ctx, const std::vector<RenderItem>& items, GLuint ssaoTexture);
     void setLightUniforms(RenderContext& ctx);
     
+    /**
+     * @brief Copy the framebuffer's depth into a texture SSAO can sample
+     */
+    void copyDepth();
+    void deleteDepthCopy();
+    
     GLuint fbo_;
+    GLuint quadVAO_;
     int width_;
     int height_;
     
     std::unique_ptr<ShaderProgram> shader_;
+    std::unique_ptr<ShaderProgram> depthShader_;
+    std::unique_ptr<ShaderProgram> ssaoShader_;
+    std::unique_ptr<ShaderProgram> ssaoBlurShader_;
+    std::unique_ptr<SSAOPass> ssaoPass_;
+    
+    bool depthPrepassEnabled_ = false;
+    bool ssaoEnabled_ = false;
+    
+    // Exact-size copy of the pre-pass depth for SSAO; the renderer's pooled
+    // depth texture is bucketed, larger than the viewport
+    GLuint depthCopyFBO_ = 0;
+    GLuint depthCopyTexture_ = 0;
+    int depthCopyWidth_ = 0;
+    int depthCopyHeight_ = 0;
 };
 
 } // namespace kcShaders
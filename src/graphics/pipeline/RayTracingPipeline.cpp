@@ -1,13 +1,20 @@
 #include "RayTracingPipeline.h"
 #include "../ShaderProgram.h"
+#include "../ShaderCompileService.h"
+#include "../Profiler.h"
+#include "../PerfCounters.h"
+#include "../WavefrontTracer.h"
+#include "../passes/DenoisePass.h"
 #include "../BVH.h"
+#include "../LightSampler.h"
+#include "../SamplerTables.h"
 #include "../../scene/camera.h"
 #include "../../scene/scene.h"
 #include "../../scene/mesh.h"
 #include "../../scene/material.h"
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <cmath>
 #include <map>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -27,20 +34,55 @@ RayTracingPipeline::RayTracingPipeline(GLuint fbo, GLuint vao, int width, int he
     , vao_(vao)
     , width_(width)
     , height_(height)
+    , viewportWidth_(width)
+    , viewportHeight_(height)
+    , renderScale_(1.0f)
+    , outputFormat_(GL_RGBA32F)
+    , accumulationFormat_(GL_RGBA32F)
+    , pool_(nullptr)
     , outputTexture_(0)
     , accumulationTexture_(0)
-    , lastCameraPosition_(0.0f)
-    , lastCameraFront_(0.0f, 1.0f, 0.0f)
+    , momentTexture_(0)
+    , densityTexture_(0)
+    , surfaceTexture_(0)
+    , reprojectShaderProgram_(0)
+    , densityShaderProgram_(0)
+    , adaptiveThreshold_(0.0f)
+    , adaptiveMinPasses_(16)
+    , densityPasses_(-1)
+    , wavefront_(std::make_unique<WavefrontTracer>())
+    , wavefrontEnabled_(false)
+    , denoiser_(std::make_unique<DenoisePass>(width, height))
+    , denoiseEnabled_(false)
+    , lastCamera_()
     , cameraMovedThisFrame_(false)
     , computeShaderProgram_(0)
     , vertexBuffer_(0)
     , triangleBuffer_(0)
     , bvhBuffer_(0)
     , materialBuffer_(0)
+    , lightBuffer_(0)
+    , lightAliasBuffer_(0)
+    , lightCount_(0)
+    , lightWeightTotal_(0.0f)
+    , samplerBuffer_(0)
     , sceneUploaded_(false)
     , maxBounces_(4)
     , samplesPerPixel_(1)
     , frameCount_(0)
+    , frameBudgetMs_(12.0f)
+    , msPerPixel_(0.0)
+    , tileCursor_(0)
+    , passStartTile_(0)
+    , completedPasses_(0)
+    , timerQueries_{}
+    , timerPixels_{}
+    , timerPending_{}
+    , timerNext_(0)
+    , traversalStats_(false)
+    , statsBuffers_{}
+    , statsFences_{}
+    , statsCurrent_(0)
 {
 }
 
@@ -51,69 +93,96 @@ RayTracingPipeline::~RayTracingPipeline()
 
 bool RayTracingPipeline::initialize()
 {   
-    // Create output texture for compute shader
-    createOutputTexture();
+    // Images (and the denoiser's) come from the render target pool on the
+    // first execute()
+    denoiser_->setup();
     
     // Create scene buffers
     createSceneBuffers();
     
+    // Timer queries for the tile scheduler
+    glGenQueries(kTimerQueryCount, timerQueries_);
+    resetAccumulation();
+    
     std::cout << "[RayTracingPipeline] Initialized\n";
     return true;
 }
 
-void RayTracingPipeline::createOutputTexture()
+void RayTracingPipeline::acquireTargets(RenderTargetPool* pool)
 {
-    if (outputTexture_ != 0) {
-        deleteOutputTexture();
+    const RenderTargetDesc outputDesc{outputFormat_, width_, height_, 1, GL_LINEAR};
+    const RenderTargetDesc accumulationDesc{accumulationFormat_, width_, height_};
+    if (pool == pool_ && outputTexture_ != 0 && outputDesc == outputDesc_ && accumulationDesc == accumulationDesc_) {
+        return;
     }
     
-    // Create output texture
-    glGenTextures(1, &outputTexture_);
-    CheckGLError("glGenTextures output");
-    
-    glBindTexture(GL_TEXTURE_2D, outputTexture_);
-    CheckGLError("glBindTexture output");
-    
-    // RGBA32F for HDR rendering
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width_, height_, 0, GL_RGBA, GL_FLOAT, nullptr);
-    CheckGLError("glTexImage2D output");
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    CheckGLError("glTexParameteri output");
-    
-    glBindTexture(GL_TEXTURE_2D, 0);
-    
-    // Create accumulation texture
-    glGenTextures(1, &accumulationTexture_);
-    CheckGLError("glGenTextures accumulation");
-    
-    glBindTexture(GL_TEXTURE_2D, accumulationTexture_);
-    CheckGLError("glBindTexture accumulation");
+    // Keep the old accumulation alive to resample it into the new size
+    RenderTargetPool* previousPool = pool_;
+    GLuint previous[3] = {accumulationTexture_, momentTexture_, surfaceTexture_};
+    int previousWidth = accumulationDesc_.width;
+    int previousHeight = accumulationDesc_.height;
+    accumulationTexture_ = 0;
+    momentTexture_ = 0;
+    surfaceTexture_ = 0;
+    releaseTargets();
+    
+    pool_ = pool;
+    outputDesc_ = outputDesc;
+    accumulationDesc_ = accumulationDesc;
+    
+    // Display-ready color, precision from setRenderTargets
+    outputTexture_ = pool_->acquire(outputDesc_);
+    acquireAccumulation();
+    
+    // Density map, one texel per 16x16 compute block
+    densityTexture_ = pool_->acquire({GL_R32F, (width_ + 15) / 16, (height_ + 15) / 16});
+    CheckGLError("acquire render targets");
+    
+    denoiser_->resize(width_, height_);
+    denoiser_->acquireTargets(pool_);
+    denoiser_->setTargets(accumulationTexture_, momentTexture_, outputTexture_, outputFormat_);
+    
+    // Tile layout changed, restart progressive rendering
+    tileCursor_ = 0;
+    if (reprojectShaderProgram_ != 0 && previous[0] != 0) {
+        reprojectAccumulation(previous[0], previous[1], previous[2],
+                              previousWidth, previousHeight, lastCamera_, lastCamera_);
+    } else {
+        resetAccumulation();
+    }
     
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width_, height_, 0, GL_RGBA, GL_FLOAT, nullptr);
-    CheckGLError("glTexImage2D accumulation");
+    if (previousPool) {
+        for (GLuint texture : previous) {
+            previousPool->release(texture);
+        }
+    }
+}
+
+void RayTracingPipeline::acquireAccumulation()
+{
+    accumulationTexture_ = pool_->acquire(accumulationDesc_);
     
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    CheckGLError("glTexParameteri accumulation");
+    // Second moment for the adaptive sampling variance estimate
+    momentTexture_ = pool_->acquire({GL_R32F, width_, height_});
     
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // Primary hit distance and surface id, checked after reprojection
+    surfaceTexture_ = pool_->acquire({GL_RG32UI, width_, height_});
 }
 
-void RayTracingPipeline::deleteOutputTexture()
+void RayTracingPipeline::releaseTargets()
 {
-    if (outputTexture_ != 0) {
-        glDeleteTextures(1, &outputTexture_);
-        outputTexture_ = 0;
+    // Nothing may still reference the images once the pool hands them out again
+    for (GLuint unit = 0; unit <= 6; ++unit) {
+        glBindImageTexture(unit, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
     }
-    if (accumulationTexture_ != 0) {
-        glDeleteTextures(1, &accumulationTexture_);
-        accumulationTexture_ = 0;
+    
+    GLuint* textures[5] = {&outputTexture_, &accumulationTexture_, &momentTexture_,
+                           &densityTexture_, &surfaceTexture_};
+    for (GLuint* texture : textures) {
+        if (pool_) {
+            pool_->release(*texture);
+        }
+        *texture = 0;
     }
 }
 
@@ -121,64 +190,154 @@ bool RayTracingPipeline::loadComputeShader(const std::string& computePath)
 {
     std::cout << "[RayTracingPipeline] Loading compute shader: " << computePath << "\n";
     
-    // Read compute shader source
-    std::ifstream file(computePath);
-    if (!file.is_open()) {
-        std::cerr << "[RayTracingPipeline] Failed to open compute shader: " << computePath << "\n";
+    computePath_ = computePath;
+    GLuint program = ShaderProgram::loadComputeProgram(computePath, kernelDefines());
+    if (program == 0) {
         return false;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string source = buffer.str();
-    file.close();
-    
-    // Compile compute shader
-    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
-    const char* sourcePtr = source.c_str();
-    glShaderSource(shader, 1, &sourcePtr, nullptr);
-    glCompileShader(shader);
-    
-    // Check compilation
-    GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << "[RayTracingPipeline] Compute shader compilation failed:\n" << infoLog << "\n";
-        glDeleteShader(shader);
+    // ShaderProgram wraps graphics programs only, keep the raw compute program ID
+    if (computeShaderProgram_ != 0) {
+        glDeleteProgram(computeShaderProgram_);
+    }
+    computeShaderProgram_ = program;
+    
+    std::cout << "[RayTracingPipeline] Compute shader loaded successfully\n";
+    return true;
+}
+
+bool RayTracingPipeline::loadDensityShader(const std::string& densityPath)
+{
+    densityPath_ = densityPath;
+    GLuint program = ShaderProgram::loadComputeProgram(densityPath, kernelDefines());
+    if (program == 0) {
+        std::cerr << "[RayTracingPipeline] Adaptive sampling disabled, density shader not loaded\n";
         return false;
     }
     
-    // Create program
-    GLuint program = glCreateProgram();
-    glAttachShader(program, shader);
-    glLinkProgram(program);
+    if (densityShaderProgram_ != 0) {
+        glDeleteProgram(densityShaderProgram_);
+    }
+    densityShaderProgram_ = program;
+    return true;
+}
+
+bool RayTracingPipeline::loadReprojectShader(const std::string& reprojectPath)
+{
+    GLuint program = ShaderProgram::loadComputeProgram(reprojectPath);
+    if (program == 0) {
+        std::cerr << "[RayTracingPipeline] Reprojection disabled, camera motion resets accumulation\n";
+        return false;
+    }
     
-    // Check linking
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(program, 512, nullptr, infoLog);
-        std::cerr << "[RayTracingPipeline] Compute shader program linking failed:\n" << infoLog << "\n";
-        glDeleteShader(shader);
-        glDeleteProgram(program);
+    if (reprojectShaderProgram_ != 0) {
+        glDeleteProgram(reprojectShaderProgram_);
+    }
+    reprojectShaderProgram_ = program;
+    return true;
+}
+
+bool RayTracingPipeline::loadWavefrontShaders(const std::string& directory)
+{
+    wavefrontDirectory_ = directory;
+    wavefront_->setDefines(kernelDefines());
+    if (!wavefront_->loadShaders(directory)) {
+        std::cerr << "[RayTracingPipeline] Wavefront mode unavailable, kernels not loaded\n";
         return false;
     }
+    return true;
+}
+
+bool RayTracingPipeline::loadDenoiseShaders(const std::string& directory)
+{
+    if (!denoiser_->loadShaders(directory)) {
+        std::cerr << "[RayTracingPipeline] Denoiser unavailable, kernels not loaded\n";
+        return false;
+    }
+    return true;
+}
+
+void RayTracingPipeline::watchShaders(ShaderCompileService& service,
+                                      const std::string& computePath,
+                                      const std::string& vertPath,
+                                      const std::string& fragPath,
+                                      const std::string& densityPath,
+                                      const std::string& wavefrontDirectory,
+                                      const std::string& denoiseDirectory,
+                                      const std::string& reprojectPath)
+{
+    if (!reprojectPath.empty()) {
+        service.watch(
+            "RayTracingPipeline/reproject",
+            {{GL_COMPUTE_SHADER, reprojectPath}},
+            [this](GLuint program, const std::string&, const ShaderSources&) {
+                if (reprojectShaderProgram_ != 0) {
+                    glDeleteProgram(reprojectShaderProgram_);
+                }
+                reprojectShaderProgram_ = program;
+            }
+        );
+    }
     
-    glDeleteShader(shader);
+    if (!denoiseDirectory.empty()) {
+        denoiser_->watchShaders(service, denoiseDirectory);
+    }
     
-    // Create a simple wrapper for compute shader program
-    // Store the program ID separately since ShaderProgram doesn't support compute shaders
-    if (computeShaderProgram_ != 0) {
-        glDeleteProgram(computeShaderProgram_);
+    if (!wavefrontDirectory.empty()) {
+        wavefront_->watchShaders(service, wavefrontDirectory, [this]() {
+            if (wavefrontEnabled_) {
+                resetAccumulation();
+            }
+        });
     }
     
-    // We'll use the raw program ID directly for compute shader
-    computeShaderProgram_ = program;
+    service.watch(
+        "RayTracingPipeline/compute",
+        {{GL_COMPUTE_SHADER, computePath}},
+        [this](GLuint program, const std::string& permutation, const ShaderSources&) {
+            // Built for an accumulation format that changed while it compiled
+            if (permutation != kernelDefines()) {
+                glDeleteProgram(program);
+                return;
+            }
+            if (computeShaderProgram_ != 0) {
+                glDeleteProgram(computeShaderProgram_);
+            }
+            computeShaderProgram_ = program;
+            resetAccumulation();
+        },
+        nullptr,
+        [this]() { return std::vector<std::string>{kernelDefines()}; }
+    );
+    
+    service.watch(
+        "RayTracingPipeline/display",
+        {{GL_VERTEX_SHADER, vertPath}, {GL_FRAGMENT_SHADER, fragPath}},
+        displayShader_
+    );
+    
+    if (densityPath.empty()) {
+        service.unwatch("RayTracingPipeline/density");
+        return;
+    }
     
-    std::cout << "[RayTracingPipeline] Compute shader loaded successfully\n";
-    return true;
+    service.watch(
+        "RayTracingPipeline/density",
+        {{GL_COMPUTE_SHADER, densityPath}},
+        [this](GLuint program, const std::string& permutation, const ShaderSources&) {
+            if (permutation != kernelDefines()) {
+                glDeleteProgram(program);
+                return;
+            }
+            if (densityShaderProgram_ != 0) {
+                glDeleteProgram(densityShaderProgram_);
+            }
+            densityShaderProgram_ = program;
+            clearDensityMap();  // Rebuilt with the new code after the next pass
+        },
+        nullptr,
+        [this]() { return std::vector<std::string>{kernelDefines()}; }
+    );
 }
 
 bool RayTracingPipeline::loadDisplayShader(const std::string& vertPath, const std::string& fragPath)
@@ -197,6 +356,11 @@ bool RayTracingPipeline::loadDisplayShader(const std::string& vertPath, const st
 
 void RayTracingPipeline::execute(RenderContext& ctx)
 {
+    if (!ctx.targetPool) {
+        std::cerr << "[RayTracingPipeline] No render target pool\n";
+        return;
+    }
+    
     if (computeShaderProgram_ == 0) {
         std::cerr << "[RayTracingPipeline] Compute shader not loaded\n";
         return;
@@ -207,6 +371,7 @@ void RayTracingPipeline::execute(RenderContext& ctx)
         return;
     }
     
+    acquireTargets(ctx.targetPool);
     if (outputTexture_ == 0) {
         std::cerr << "[RayTracingPipeline] Output texture not created\n";
         return;
@@ -215,120 +380,135 @@ void RayTracingPipeline::execute(RenderContext& ctx)
     // Detect camera movement
     cameraMovedThisFrame_ = false;
     if (ctx.camera) {
-        glm::vec3 camPos = ctx.camera->GetPosition();
-        glm::vec3 camFront = ctx.camera->GetFront();
-        
-        float posDelta = glm::length(camPos - lastCameraPosition_);
-        float frontDelta = glm::length(camFront - lastCameraFront_);
+        float posDelta = glm::length(ctx.camera->GetPosition() - lastCamera_.GetPosition());
+        float frontDelta = glm::length(ctx.camera->GetFront() - lastCamera_.GetFront());
+        float fovDelta = std::abs(ctx.camera->GetFov() - lastCamera_.GetFov());
         
-        if (posDelta > 0.0001f || frontDelta > 0.0001f) {
+        if (posDelta > 0.0001f || frontDelta > 0.0001f || fovDelta > 0.0001f) {
             cameraMovedThisFrame_ = true;
-            frameCount_ = 0;  // Reset accumulation
-            lastCameraPosition_ = camPos;
-            lastCameraFront_ = camFront;
+            
+            // Keep the samples that are still visible from the new view, the
+            // old images go back to the pool once they are resampled
+            if (reprojectShaderProgram_ != 0) {
+                ProfileScope scope(ctx.profiler, "Reproject");
+                GLuint previous[3] = {accumulationTexture_, momentTexture_, surfaceTexture_};
+                acquireAccumulation();
+                denoiser_->setTargets(accumulationTexture_, momentTexture_, outputTexture_, outputFormat_);
+                reprojectAccumulation(previous[0], previous[1], previous[2],
+                                      width_, height_, lastCamera_, *ctx.camera);
+                for (GLuint texture : previous) {
+                    pool_->release(texture);
+                }
+            } else {
+                resetAccumulation();
+            }
+            lastCamera_ = *ctx.camera;
         }
     }
     
-    // === Step 1: Run compute shader for ray tracing ===
-    glUseProgram(computeShaderProgram_);
-    CheckGLError("glUseProgram(compute)");
+    // Adaptive sampling: refresh the density map once per completed pass
+    bool adaptive = adaptiveThreshold_ > 0.0f && densityShaderProgram_ != 0;
+    if (adaptive && completedPasses_ >= adaptiveMinPasses_ && completedPasses_ != densityPasses_) {
+        ProfileScope scope(ctx.profiler, "Adaptive Density");
+        updateDensityMap();
+    } else if (!adaptive && densityPasses_ >= 0) {
+        clearDensityMap();
+    }
     
+    // === Step 1: Run compute shader for ray tracing ===
     // Bind output texture as image for compute shader write
-    glBindImageTexture(0, outputTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(0, outputTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, outputFormat_);
     CheckGLError("glBindImageTexture output");
     
     // Bind accumulation texture for read/write
-    glBindImageTexture(1, accumulationTexture_, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glBindImageTexture(1, accumulationTexture_, 0, GL_FALSE, 0, GL_READ_WRITE, accumulationFormat_);
     CheckGLError("glBindImageTexture accumulation");
     
-    // Set uniforms manually for compute shader
-    GLint loc;
+    // Variance moment and adaptive density map
+    glBindImageTexture(2, momentTexture_, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+    glBindImageTexture(3, densityTexture_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    CheckGLError("glBindImageTexture adaptive");
     
-    loc = glGetUniformLocation(computeShaderProgram_, "iResolution");
-    if (loc >= 0) {
-        glUniform3f(loc, (float)width_, (float)height_, 0.0f);
-        CheckGLError("iResolution");
-    }
+    // Primary surface for validating reprojected pixels
+    glBindImageTexture(6, surfaceTexture_, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RG32UI);
     
-    loc = glGetUniformLocation(computeShaderProgram_, "iTime");
-    if (loc >= 0) {
-        glUniform1f(loc, ctx.totalTime);
-        CheckGLError("iTime");
-    }
+    // Primary-hit features for the denoiser (denoise_features.glsl)
+    denoiser_->bindFeatureImages();
     
-    loc = glGetUniformLocation(computeShaderProgram_, "iFrame");
-    if (loc >= 0) {
-        glUniform1i(loc, frameCount_);
-        CheckGLError("iFrame");
-    }
+    // Sampler tables (sampler.glsl)
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12, samplerBuffer_);
     
-    // Increment frame count after setting uniform
-    frameCount_++;
+    // Traversal counters (bvh.glsl)
+    if (traversalStats_) {
+        readTraversalStats(false);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, statsBuffers_[statsCurrent_]);
+    }
     
-    loc = glGetUniformLocation(computeShaderProgram_, "maxBounces");
-    if (loc >= 0) {
-        glUniform1i(loc, maxBounces_);
-        CheckGLError("maxBounces");
+    // Frame uniforms (iFrame and tileOffset are set per tile)
+    applyFrameUniforms(computeShaderProgram_, ctx);
+    if (isWavefrontActive()) {
+        for (int i = 0; i < WavefrontTracer::KernelCount; ++i) {
+            applyFrameUniforms(wavefront_->program(static_cast<WavefrontTracer::Kernel>(i)), ctx);
+        }
     }
+    if (isDenoiserActive()) {
+        applyFrameUniforms(denoiser_->program(DenoisePass::Temporal), ctx);
+    }
+    
+    // Pick how many pixels to trace this frame from the measured cost
+    readTimerQueries();
     
-    loc = glGetUniformLocation(computeShaderProgram_, "samplesPerPixel");
-    if (loc >= 0) {
-        glUniform1i(loc, samplesPerPixel_);
-        CheckGLError("samplesPerPixel");
+    long long imagePixels = (long long)width_ * height_;
+    long long budgetPixels = imagePixels;  // No budget: one full pass per frame
+    if (frameBudgetMs_ > 0.0f) {
+        budgetPixels = msPerPixel_ > 0.0
+            ? (long long)(frameBudgetMs_ / msPerPixel_)
+            : (long long)kTileSize * kTileSize;  // Unmeasured: start with a single tile
+        budgetPixels = std::min(budgetPixels, imagePixels * kMaxPassesPerFrame);
     }
     
-    // Camera uniforms (if camera exists)
-    if (ctx.camera) {
-        glm::vec3 camPos = ctx.camera->GetPosition();
-        glm::vec3 camFront = ctx.camera->GetFront();
-        glm::vec3 camRight = ctx.camera->GetRight();
-        glm::vec3 camUp = glm::cross(camRight, camFront);
-        float camFov = ctx.camera->GetFov();
-        
-        loc = glGetUniformLocation(computeShaderProgram_, "cameraPosition");
-        if (loc >= 0) glUniform3fv(loc, 1, glm::value_ptr(camPos));
-        
-        loc = glGetUniformLocation(computeShaderProgram_, "cameraFront");
-        if (loc >= 0) glUniform3fv(loc, 1, glm::value_ptr(camFront));
-        
-        loc = glGetUniformLocation(computeShaderProgram_, "cameraUp");
-        if (loc >= 0) glUniform3fv(loc, 1, glm::value_ptr(camUp));
-        
-        loc = glGetUniformLocation(computeShaderProgram_, "cameraRight");
-        if (loc >= 0) glUniform3fv(loc, 1, glm::value_ptr(camRight));
+    // Time this frame's dispatches unless every query is still in flight
+    bool timed = timerQueries_[timerNext_] != 0 && !timerPending_[timerNext_];
+    {
+        ProfileScope scope(ctx.profiler, isWavefrontActive() ? "Trace (Wavefront)" : "Trace");
+        if (timed) {
+            glBeginQuery(GL_TIME_ELAPSED, timerQueries_[timerNext_]);
+        }
         
-        loc = glGetUniformLocation(computeShaderProgram_, "cameraFov");
-        if (loc >= 0) glUniform1f(loc, camFov);
+        long long tracedPixels = dispatchTiles(budgetPixels);
+        PerfCounters::add(PerfCounter::RaySamples, (uint64_t)tracedPixels * samplesPerPixel_);
         
-        CheckGLError("camera uniforms");
+        if (timed) {
+            glEndQuery(GL_TIME_ELAPSED);
+            timerPixels_[timerNext_] = tracedPixels;
+            timerPending_[timerNext_] = true;
+            timerNext_ = (timerNext_ + 1) % kTimerQueryCount;
+        }
     }
     
-    // Dispatch compute shader (one thread per pixel, organized in 16x16 local groups)
-    GLuint numGroupsX = (width_ + 15) / 16;
-    GLuint numGroupsY = (height_ + 15) / 16;
-    
-    // Only log first frame to avoid spam
-    // static bool firstFrame = true;
-    // if (firstFrame) {
-    //     std::cout << "[RayTracingPipeline] Dispatching compute: " << numGroupsX << "x" << numGroupsY 
-    //               << " groups for " << width_ << "x" << height_ << " pixels\n";
-    //     firstFrame = false;
-    // }
-    
-    glDispatchCompute(numGroupsX, numGroupsY, 1);
-    CheckGLError("glDispatchCompute");
-    
     // Wait for compute shader to finish
     glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
     CheckGLError("glMemoryBarrier");
     
+    if (traversalStats_) {
+        rotateTraversalStats();
+    }
+    
+    // Filter the accumulated color into the output image
+    if (isDenoiserActive()) {
+        ProfileScope scope(ctx.profiler, denoiser_->getName());
+        denoiser_->execute(ctx);
+        CheckGLError("denoiser");
+    }
+    
     // === Step 2: Display the ray traced image on fullscreen quad ===
+    ProfileScope displayScope(ctx.profiler, "Display");
     
     // Bind framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
     CheckGLError("glBindFramebuffer");
     
-    glViewport(0, 0, width_, height_);
+    glViewport(0, 0, viewportWidth_, viewportHeight_);
     CheckGLError("glViewport");
     
     // Clear
@@ -351,6 +531,10 @@ void RayTracingPipeline::execute(RenderContext& ctx)
     displayShader_->setInt("screenTexture", 0);
     CheckGLError("setInt(screenTexture)");
     
+    // Traced below viewport resolution: bicubic upsampling
+    displayShader_->setVec2("sourceSize", glm::vec2((float)width_, (float)height_));
+    displayShader_->setBool("upsample", width_ != viewportWidth_ || height_ != viewportHeight_);
+    
     // Draw fullscreen triangle
     glBindVertexArray(vao_);
     CheckGLError("glBindVertexArray");
@@ -367,21 +551,72 @@ void RayTracingPipeline::execute(RenderContext& ctx)
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void RayTracingPipeline::resize(int width, int height)
+void RayTracingPipeline::applyFrameUniforms(GLuint program, const RenderContext& ctx)
 {
-    width_ = width;
-    height_ = height;
+    GLint loc;
     
-    // Recreate output texture with new size
-    createOutputTexture();
+    loc = glGetUniformLocation(program, "iResolution");
+    if (loc >= 0) glProgramUniform3f(program, loc, (float)width_, (float)height_, 0.0f);
     
-    // Reset frame count for progressive rendering
-    frameCount_ = 0;
+    loc = glGetUniformLocation(program, "iTime");
+    if (loc >= 0) glProgramUniform1f(program, loc, ctx.totalTime);
+    
+    loc = glGetUniformLocation(program, "maxBounces");
+    if (loc >= 0) glProgramUniform1i(program, loc, maxBounces_);
+    
+    loc = glGetUniformLocation(program, "samplesPerPixel");
+    if (loc >= 0) glProgramUniform1i(program, loc, samplesPerPixel_);
+    
+    loc = glGetUniformLocation(program, "lightCount");
+    if (loc >= 0) glProgramUniform1ui(program, loc, lightCount_);
+    
+    loc = glGetUniformLocation(program, "lightWeightTotal");
+    if (loc >= 0) glProgramUniform1f(program, loc, lightWeightTotal_);
+    
+    // Camera uniforms (if camera exists)
+    if (ctx.camera) {
+        glm::vec3 camPos = ctx.camera->GetPosition();
+        glm::vec3 camFront = ctx.camera->GetFront();
+        glm::vec3 camRight = ctx.camera->GetRight();
+        glm::vec3 camUp = glm::cross(camRight, camFront);
+        float camFov = ctx.camera->GetFov();
+        
+        loc = glGetUniformLocation(program, "cameraPosition");
+        if (loc >= 0) glProgramUniform3fv(program, loc, 1, glm::value_ptr(camPos));
+        
+        loc = glGetUniformLocation(program, "cameraFront");
+        if (loc >= 0) glProgramUniform3fv(program, loc, 1, glm::value_ptr(camFront));
+        
+        loc = glGetUniformLocation(program, "cameraUp");
+        if (loc >= 0) glProgramUniform3fv(program, loc, 1, glm::value_ptr(camUp));
+        
+        loc = glGetUniformLocation(program, "cameraRight");
+        if (loc >= 0) glProgramUniform3fv(program, loc, 1, glm::value_ptr(camRight));
+        
+        loc = glGetUniformLocation(program, "cameraFov");
+        if (loc >= 0) glProgramUniform1f(program, loc, camFov);
+    }
+    
+    CheckGLError("frame uniforms");
+}
+
+void RayTracingPipeline::resize(int width, int height)
+{
+    viewportWidth_ = width;
+    viewportHeight_ = height;
+    width_ = std::max(1, (int)std::lround(width * renderScale_));
+    height_ = std::max(1, (int)std::lround(height * renderScale_));
+    
+    // Resample right away once the pool is known, so the old images are free
+    // for the renderer's trim after the resize; otherwise on the next execute()
+    if (pool_) {
+        acquireTargets(pool_);
+    }
 }
 
 void RayTracingPipeline::cleanup()
 {
-    deleteOutputTexture();
+    releaseTargets();
     deleteSceneBuffers();
     
     if (computeShaderProgram_ != 0) {
@@ -389,15 +624,435 @@ void RayTracingPipeline::cleanup()
         computeShaderProgram_ = 0;
     }
     
+    if (densityShaderProgram_ != 0) {
+        glDeleteProgram(densityShaderProgram_);
+        densityShaderProgram_ = 0;
+    }
+    
+    if (reprojectShaderProgram_ != 0) {
+        glDeleteProgram(reprojectShaderProgram_);
+        reprojectShaderProgram_ = 0;
+    }
+    
+    if (wavefront_) {
+        wavefront_->cleanup();
+    }
+    
+    if (denoiser_) {
+        denoiser_->cleanup();
+    }
+    
+    if (timerQueries_[0] != 0) {
+        glDeleteQueries(kTimerQueryCount, timerQueries_);
+        for (int i = 0; i < kTimerQueryCount; ++i) {
+            timerQueries_[i] = 0;
+            timerPending_[i] = false;
+        }
+    }
+    
+    for (int i = 0; i < kStatsBufferCount; ++i) {
+        if (statsFences_[i]) {
+            glDeleteSync(statsFences_[i]);
+            statsFences_[i] = nullptr;
+        }
+    }
+    if (statsBuffers_[0] != 0) {
+        glDeleteBuffers(kStatsBufferCount, statsBuffers_);
+        for (GLuint& buffer : statsBuffers_) {
+            buffer = 0;
+        }
+    }
+    
     displayShader_.reset();
 }
 
+void RayTracingPipeline::resetAccumulation()
+{
+    // The accumulation alpha holds each pixel's sample count, so clearing it
+    // restarts every tile independently. Tiles not traced yet keep showing the
+    // previous output until the scheduler reaches them.
+    restartPasses();
+    
+    if (accumulationTexture_ != 0) {
+        const float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const GLuint zeroId[2] = {0, 0};
+        glClearTexImage(accumulationTexture_, 0, GL_RGBA, GL_FLOAT, zero);
+        glClearTexImage(momentTexture_, 0, GL_RED, GL_FLOAT, zero);
+        glClearTexImage(surfaceTexture_, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, zeroId);
+        CheckGLError("glClearTexImage accumulation");
+    }
+}
+
+void RayTracingPipeline::restartPasses()
+{
+    frameCount_ = 0;
+    passStartTile_ = tileCursor_;
+    completedPasses_ = 0;
+    clearDensityMap();
+}
+
+void RayTracingPipeline::reprojectAccumulation(GLuint sourceAccumulation, GLuint sourceMoment, GLuint sourceSurface,
+                                               int sourceWidth, int sourceHeight,
+                                               const Camera& previous, const Camera& current)
+{
+    // Pixels nothing lands on start over, per-pixel pass counts make that free
+    resetAccumulation();
+    
+    const GLuint depthTexture = pool_->acquire({GL_R32UI, width_, height_});
+    const GLuint farthest = 0xffffffffu;
+    glClearTexImage(depthTexture, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &farthest);
+    
+    // Source images were last written by the tracing kernels
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    
+    GLuint program = reprojectShaderProgram_;
+    glUseProgram(program);
+    
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sourceAccumulation);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, sourceMoment);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, sourceSurface);
+    glActiveTexture(GL_TEXTURE0);
+    
+    glBindImageTexture(0, outputTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, outputFormat_);
+    glBindImageTexture(1, accumulationTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, accumulationFormat_);
+    glBindImageTexture(2, momentTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindImageTexture(3, surfaceTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32UI);
+    glBindImageTexture(4, depthTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    
+    glm::vec3 previousUp = glm::cross(previous.GetRight(), previous.GetFront());
+    glm::mat4 viewProjection = DenoisePass::viewProjection(current, (float)width_ / (float)height_);
+    
+    glUniform1i(glGetUniformLocation(program, "sourceAccumulation"), 0);
+    glUniform1i(glGetUniformLocation(program, "sourceMoment"), 1);
+    glUniform1i(glGetUniformLocation(program, "sourceSurface"), 2);
+    glUniform2f(glGetUniformLocation(program, "sourceResolution"), (float)sourceWidth, (float)sourceHeight);
+    glUniform3fv(glGetUniformLocation(program, "previousCameraPosition"), 1, glm::value_ptr(previous.GetPosition()));
+    glUniform3fv(glGetUniformLocation(program, "previousCameraFront"), 1, glm::value_ptr(previous.GetFront()));
+    glUniform3fv(glGetUniformLocation(program, "previousCameraUp"), 1, glm::value_ptr(previousUp));
+    glUniform3fv(glGetUniformLocation(program, "previousCameraRight"), 1, glm::value_ptr(previous.GetRight()));
+    glUniform1f(glGetUniformLocation(program, "previousCameraFov"), previous.GetFov());
+    glUniform3f(glGetUniformLocation(program, "iResolution"), (float)width_, (float)height_, 0.0f);
+    glUniform3fv(glGetUniformLocation(program, "cameraPosition"), 1, glm::value_ptr(current.GetPosition()));
+    glUniformMatrix4fv(glGetUniformLocation(program, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+    glUniform1f(glGetUniformLocation(program, "maxReprojectedPasses"), kMaxReprojectedPasses);
+    
+    GLuint groupsX = (sourceWidth + 15) / 16;
+    GLuint groupsY = (sourceHeight + 15) / 16;
+    
+    // Depth test first, then the nearest source per target pixel copies its samples
+    glUniform1i(glGetUniformLocation(program, "resolvePass"), 0);
+    glDispatchCompute(groupsX, groupsY, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    
+    glUniform1i(glGetUniformLocation(program, "resolvePass"), 1);
+    glDispatchCompute(groupsX, groupsY, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    CheckGLError("reprojectAccumulation");
+    
+    // The sources and the depth buffer go back to the pool after this
+    for (int unit = 2; unit >= 0; --unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glBindImageTexture(4, 0, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+    pool_->release(depthTexture);
+}
+
+void RayTracingPipeline::setAdaptiveSampling(float threshold, int minPasses)
+{
+    // A looser threshold may have stopped blocks a tighter one still wants
+    if (threshold < adaptiveThreshold_ || minPasses != adaptiveMinPasses_) {
+        clearDensityMap();
+    }
+    adaptiveThreshold_ = threshold;
+    adaptiveMinPasses_ = std::max(minPasses, 1);
+}
+
+void RayTracingPipeline::setRenderTargets(float renderScale, GLenum outputFormat, GLenum accumulationFormat)
+{
+    renderScale = std::clamp(renderScale, 0.25f, 1.0f);
+    if (renderScale == renderScale_ && outputFormat == outputFormat_ && accumulationFormat == accumulationFormat_) {
+        return;
+    }
+    
+    bool accumulationChanged = accumulationFormat != accumulationFormat_;
+    renderScale_ = renderScale;
+    outputFormat_ = outputFormat;
+    accumulationFormat_ = accumulationFormat;
+    
+    if (accumulationChanged) {
+        reloadKernels();
+    }
+    
+    // Reallocate and resample the accumulation into the new images
+    if (outputTexture_ != 0) {
+        msPerPixel_ = 0.0;
+        resize(viewportWidth_, viewportHeight_);
+    }
+}
+
+std::string RayTracingPipeline::kernelDefines() const
+{
+    std::string defines;
+    
+    // Half floats count passes exactly up to 2048, see accumulation.glsl
+    if (accumulationFormat_ == GL_RGBA16F) {
+        defines += "#define RT_ACCUMULATION_FORMAT rgba16f\n#define RT_MAX_PASSES 2048.0\n";
+    }
+    if (traversalStats_) {
+        defines += "#define RT_TRAVERSAL_STATS\n";
+    }
+    return defines;
+}
+
+void RayTracingPipeline::reloadKernels()
+{
+    if (!computePath_.empty()) {
+        loadComputeShader(computePath_);
+    }
+    if (!densityPath_.empty()) {
+        loadDensityShader(densityPath_);
+    }
+    if (!wavefrontDirectory_.empty()) {
+        loadWavefrontShaders(wavefrontDirectory_);
+    }
+}
+
+void RayTracingPipeline::setTraversalStats(bool enable)
+{
+    if (enable == traversalStats_) {
+        return;
+    }
+    
+    if (enable && statsBuffers_[0] == 0) {
+        const GLuint zero[4] = {0, 0, 0, 0};
+        glGenBuffers(kStatsBufferCount, statsBuffers_);
+        for (GLuint buffer : statsBuffers_) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zero), zero, GL_DYNAMIC_READ);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    if (!enable) {
+        readTraversalStats(true);  // Keep the counts still in flight
+    }
+    
+    traversalStats_ = enable;
+    reloadKernels();
+}
+
+void RayTracingPipeline::readTraversalStats(bool wait)
+{
+    for (int i = 0; i < kStatsBufferCount; ++i) {
+        if (!statsFences_[i]) {
+            continue;
+        }
+        
+        GLenum status = glClientWaitSync(statsFences_[i], 0, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        glDeleteSync(statsFences_[i]);
+        statsFences_[i] = nullptr;
+        
+        // rays lo/hi, nodes lo/hi
+        GLuint counts[4] = {};
+        const GLuint zero[4] = {0, 0, 0, 0};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsBuffers_[i]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        
+        PerfCounters::add(PerfCounter::RaysTraced, ((uint64_t)counts[1] << 32) | counts[0]);
+        PerfCounters::add(PerfCounter::BvhNodesVisited, ((uint64_t)counts[3] << 32) | counts[2]);
+    }
+}
+
+void RayTracingPipeline::rotateTraversalStats()
+{
+    // The next buffer is still being read back: keep counting into this one
+    int next = (statsCurrent_ + 1) % kStatsBufferCount;
+    if (statsFences_[next]) {
+        return;
+    }
+    
+    statsFences_[statsCurrent_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    statsCurrent_ = next;
+}
+
+void RayTracingPipeline::setWavefront(bool enable, bool sortByOctant)
+{
+    wavefront_->setSortByOctant(sortByOctant);
+    if (enable == wavefrontEnabled_) {
+        return;
+    }
+    
+    // Different sampling patterns and cost per pixel: start over
+    wavefrontEnabled_ = enable;
+    msPerPixel_ = 0.0;
+    resetAccumulation();
+}
+
+void RayTracingPipeline::setDenoiser(bool enable, const DenoiseSettings& settings)
+{
+    denoiser_->setSettings(settings);
+    if (enable && !denoiseEnabled_) {
+        // History from before it was switched off no longer matches the camera
+        denoiser_->resetHistory();
+    }
+    denoiseEnabled_ = enable;
+}
+
+bool RayTracingPipeline::isDenoiserActive() const
+{
+    return denoiseEnabled_ && denoiser_->isReady();
+}
+
+bool RayTracingPipeline::isWavefrontActive() const
+{
+    return wavefrontEnabled_ && wavefront_->isReady();
+}
+
+void RayTracingPipeline::clearDensityMap()
+{
+    densityPasses_ = -1;
+    if (densityTexture_ != 0) {
+        const float one[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glClearTexImage(densityTexture_, 0, GL_RED, GL_FLOAT, one);
+        CheckGLError("glClearTexImage density");
+    }
+}
+
+void RayTracingPipeline::updateDensityMap()
+{
+    glUseProgram(densityShaderProgram_);
+    
+    // Pick up the last pass's accumulation writes
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    
+    glBindImageTexture(1, accumulationTexture_, 0, GL_FALSE, 0, GL_READ_ONLY, accumulationFormat_);
+    glBindImageTexture(2, momentTexture_, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glBindImageTexture(3, densityTexture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    
+    GLint loc = glGetUniformLocation(densityShaderProgram_, "iResolution");
+    if (loc >= 0) glUniform3f(loc, (float)width_, (float)height_, 0.0f);
+    loc = glGetUniformLocation(densityShaderProgram_, "errorThreshold");
+    if (loc >= 0) glUniform1f(loc, adaptiveThreshold_);
+    loc = glGetUniformLocation(densityShaderProgram_, "minPasses");
+    if (loc >= 0) glUniform1i(loc, adaptiveMinPasses_);
+    
+    // One work group per density texel
+    glDispatchCompute((width_ + 15) / 16, (height_ + 15) / 16, 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    CheckGLError("updateDensityMap");
+    
+    densityPasses_ = completedPasses_;
+}
+
+void RayTracingPipeline::readTimerQueries()
+{
+    for (int i = 0; i < kTimerQueryCount; ++i) {
+        if (!timerPending_[i]) {
+            continue;
+        }
+        
+        // Never block: unfinished queries are checked again next frame
+        GLint available = 0;
+        glGetQueryObjectiv(timerQueries_[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(timerQueries_[i], GL_QUERY_RESULT, &elapsedNs);
+        timerPending_[i] = false;
+        
+        if (timerPixels_[i] > 0) {
+            double sample = (double)elapsedNs / 1.0e6 / (double)timerPixels_[i];
+            msPerPixel_ = msPerPixel_ > 0.0 ? msPerPixel_ + (sample - msPerPixel_) * 0.25 : sample;
+        }
+    }
+}
+
+long long RayTracingPipeline::dispatchTiles(long long budgetPixels)
+{
+    int tilesX = (width_ + kTileSize - 1) / kTileSize;
+    int tilesY = (height_ + kTileSize - 1) / kTileSize;
+    int tileCount = tilesX * tilesY;
+    if (tileCount == 0) {
+        return 0;
+    }
+    
+    bool wavefront = isWavefrontActive();
+    if (!wavefront) {
+        glUseProgram(computeShaderProgram_);
+    }
+    GLint tileOffsetLoc = glGetUniformLocation(computeShaderProgram_, "tileOffset");
+    GLint frameLoc = glGetUniformLocation(computeShaderProgram_, "iFrame");
+    
+    auto tilePixels = [&](int tile, int& x, int& y) {
+        x = (tile % tilesX) * kTileSize;
+        y = (tile / tilesX) * kTileSize;
+        return (long long)std::min(kTileSize, width_ - x) * std::min(kTileSize, height_ - y);
+    };
+    
+    long long traced = 0;
+    int dispatched = 0;
+    int x = 0;
+    int y = 0;
+    long long pixels = tilePixels(tileCursor_, x, y);
+    
+    // At least one tile per frame so accumulation always progresses
+    do {
+        // A second visit to the same tile within a frame must see the first one's writes
+        if (dispatched > 0 && dispatched % tileCount == 0) {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        
+        int w = std::min(kTileSize, width_ - x);
+        int h = std::min(kTileSize, height_ - y);
+        if (wavefront) {
+            wavefront_->traceTile(x, y, w, h, samplesPerPixel_, maxBounces_);
+        } else {
+            if (tileOffsetLoc >= 0) glUniform2i(tileOffsetLoc, x, y);
+            if (frameLoc >= 0) glUniform1i(frameLoc, frameCount_);
+            glDispatchCompute((w + 15) / 16, (h + 15) / 16, 1);
+        }
+        frameCount_++;
+        CheckGLError("glDispatchCompute");
+        
+        traced += pixels;
+        dispatched++;
+        tileCursor_ = (tileCursor_ + 1) % tileCount;
+        if (tileCursor_ == passStartTile_) {
+            completedPasses_++;
+        }
+        
+        pixels = tilePixels(tileCursor_, x, y);
+    } while (traced + pixels <= budgetPixels);
+    
+    return traced;
+}
+
 void RayTracingPipeline::createSceneBuffers()
 {   
     glGenBuffers(1, &vertexBuffer_);
     glGenBuffers(1, &triangleBuffer_);
     glGenBuffers(1, &bvhBuffer_);
     glGenBuffers(1, &materialBuffer_);
+    glGenBuffers(1, &lightBuffer_);
+    glGenBuffers(1, &lightAliasBuffer_);
+    
+    // Sobol matrices and blue noise never change, upload them once
+    std::vector<uint32_t> samplerTables = SamplerTables::pack();
+    glGenBuffers(1, &samplerBuffer_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, samplerBuffer_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, samplerTables.size() * sizeof(uint32_t), 
+                 samplerTables.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     
     CheckGLError("createSceneBuffers");
 }
@@ -420,30 +1075,28 @@ void RayTracingPipeline::deleteSceneBuffers()
         glDeleteBuffers(1, &materialBuffer_);
         materialBuffer_ = 0;
     }
+    if (lightBuffer_ != 0) {
+        glDeleteBuffers(1, &lightBuffer_);
+        lightBuffer_ = 0;
+    }
+    if (lightAliasBuffer_ != 0) {
+        glDeleteBuffers(1, &lightAliasBuffer_);
+        lightAliasBuffer_ = 0;
+    }
+    if (samplerBuffer_ != 0) {
+        glDeleteBuffers(1, &samplerBuffer_);
+        samplerBuffer_ = 0;
+    }
 }
 
-void RayTracingPipeline::uploadScene(Scene* scene)
+void RayTracingPipeline::flattenRenderItems(const std::vector<RenderItem>& items,
+                                            std::vector<GpuVertex>& vertices,
+                                            std::vector<GpuTriangle>& triangles,
+                                            std::vector<GpuMaterial>& materials)
 {
-    if (!scene) {
-        std::cerr << "[RayTracingPipeline] Cannot upload null scene\n";
-        return;
-    }
-    
-    // std::cout << "[RayTracingPipeline] Uploading scene to GPU...\n";
-    
-    // Collect all render items (mesh + transform)
-    std::vector<RenderItem> renderItems;
-    scene->collectRenderItems(renderItems);
-    
-    if (renderItems.empty()) {
-        std::cout << "[RayTracingPipeline] Scene has no meshes to render\n";
-        return;
-    }
-    
-    // Temporary storage for all triangles
-    std::vector<GpuVertex> allVertices;
-    std::vector<GpuTriangle> allTriangles;
-    std::vector<GpuMaterial> allMaterials;
+    vertices.clear();
+    triangles.clear();
+    materials.clear();
     
     // Material index map (Material* -> GPU index)
     std::map<Material*, uint32_t> materialIndexMap;
@@ -458,10 +1111,10 @@ void RayTracingPipeline::uploadScene(Scene* scene)
     defaultMat.emissive = glm::vec3(0.0f);
     defaultMat.emissiveStrength = 0.0f;
     defaultMat._pad0 = 0.0f;
-    allMaterials.push_back(defaultMat);
+    materials.push_back(defaultMat);
     
     // Process each render item
-    for (const auto& item : renderItems) {
+    for (const auto& item : items) {
         if (!item.mesh) continue;
         
         Mesh* mesh = item.mesh;
@@ -477,7 +1130,7 @@ void RayTracingPipeline::uploadScene(Scene* scene)
                 materialIndex = it->second;
             } else {
                 // Add new material
-                materialIndex = static_cast<uint32_t>(allMaterials.size());
+                materialIndex = static_cast<uint32_t>(materials.size());
                 materialIndexMap[material] = materialIndex;
                 
                 GpuMaterial gpuMat;
@@ -489,11 +1142,11 @@ void RayTracingPipeline::uploadScene(Scene* scene)
                 gpuMat.emissive = material->emissive;
                 gpuMat.emissiveStrength = material->emissiveStrength;
                 gpuMat._pad0 = 0.0f;
-                allMaterials.push_back(gpuMat);
+                materials.push_back(gpuMat);
             }
         }
         
-        uint32_t baseVertex = static_cast<uint32_t>(allVertices.size());
+        uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
         
         // Add vertices (transformed to world space)
         for (size_t i = 0; i < mesh->GetVertexCount(); i++) {
@@ -528,7 +1181,7 @@ void RayTracingPipeline::uploadScene(Scene* scene)
             gpuVert._pad2[0] = 0.0f;
             gpuVert._pad2[1] = 0.0f;
             
-            allVertices.push_back(gpuVert);
+            vertices.push_back(gpuVert);
         }
         
         // Add triangles
@@ -546,9 +1199,34 @@ void RayTracingPipeline::uploadScene(Scene* scene)
             tri.v2 = i2;
             tri.materialId = materialIndex;  // Use actual material index
             
-            allTriangles.push_back(tri);
+            triangles.push_back(tri);
         }
     }
+}
+
+void RayTracingPipeline::uploadScene(Scene* scene)
+{
+    if (!scene) {
+        std::cerr << "[RayTracingPipeline] Cannot upload null scene\n";
+        return;
+    }
+    
+    // std::cout << "[RayTracingPipeline] Uploading scene to GPU...\n";
+    
+    // Collect all render items (mesh + transform)
+    std::vector<RenderItem> renderItems;
+    scene->collectRenderItems(renderItems);
+    
+    if (renderItems.empty()) {
+        std::cout << "[RayTracingPipeline] Scene has no meshes to render\n";
+        return;
+    }
+    
+    // Temporary storage for all triangles
+    std::vector<GpuVertex> allVertices;
+    std::vector<GpuTriangle> allTriangles;
+    std::vector<GpuMaterial> allMaterials;
+    flattenRenderItems(renderItems, allVertices, allTriangles, allMaterials);
     
     if (allTriangles.empty()) {
         std::cout << "[RayTracingPipeline] No triangles to render\n";
@@ -599,6 +1277,32 @@ void RayTracingPipeline::uploadScene(Scene* scene)
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, materialBuffer_);
     CheckGLError("upload materials");
     
+    // Lights for next-event estimation, indices refer to the reordered triangles
+    LightSampler lightSampler;
+    lightSampler.build(scene->lights, allVertices, reorderedTriangles, allMaterials);
+    
+    std::vector<GpuLight> lights = lightSampler.getLights();
+    std::vector<GpuAliasEntry> aliasTable = lightSampler.getAliasTable();
+    lightCount_ = static_cast<GLuint>(lights.size());
+    lightWeightTotal_ = lightSampler.getTotalWeight();
+    if (lights.empty()) {
+        // Keep the bindings valid, lightCount = 0 disables sampling
+        lights.push_back(GpuLight{});
+        aliasTable.push_back(GpuAliasEntry{});
+    }
+    
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightBuffer_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, lights.size() * sizeof(GpuLight), 
+                 lights.data(), GL_STATIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, lightBuffer_);
+    
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightAliasBuffer_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, aliasTable.size() * sizeof(GpuAliasEntry), 
+                 aliasTable.data(), GL_STATIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, lightAliasBuffer_);
+    CheckGLError("upload lights");
+    std::cout << "[RayTracingPipeline] " << lightCount_ << " lights for next-event estimation\n";
+    
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     
     sceneUploaded_ = true;
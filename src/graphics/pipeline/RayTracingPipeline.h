@@ -2,19 +2,61 @@
 
 #include <glad/glad.h>
 #include "RenderPipeline.h"
+#include "../RenderTargetPool.h"
+#include "../../scene/camera.h"
+#include "../BVH.h"
 #include <memory>
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace kcShaders {
 
+struct RenderItem;
 class ShaderProgram;
+class ShaderCompileService;
+class WavefrontTracer;
+class DenoisePass;
+struct DenoiseSettings;
 
 /**
  * @brief Ray Tracing Pipeline using OpenGL Compute Shaders
  * 
  * Renders scenes using ray tracing in a compute shader, outputs to a texture
  * which is then displayed on a fullscreen quad.
+ *
+ * The image is traced progressively in tiles. Each frame dispatches as many
+ * tiles as fit in a GPU time budget, estimated from GL_TIME_ELAPSED queries
+ * of earlier frames, so a heavy scene never stalls the UI (or trips the
+ * driver watchdog) and accumulation simply spreads over more frames.
+ *
+ * Adaptive sampling tracks the second moment of each pixel's luminance. After
+ * every full pass a small compute pass turns the relative error into a
+ * density map with one texel per 16x16 block, and blocks below the error
+ * threshold stop receiving rays until the accumulation is reset.
+ *
+ * Scene lights and emissive triangles are uploaded with a power-weighted
+ * alias table (LightSampler) for next-event estimation, combined with BSDF
+ * sampling through multiple importance sampling.
+ *
+ * In wavefront mode each tile is traced by WavefrontTracer, one compute
+ * kernel per path tracing stage over compacted ray queues, instead of the
+ * single megakernel; both accumulate into the same images.
+ *
+ * Camera motion and resizing do not throw the accumulation away: every
+ * traced pixel's primary hit is forward-projected into the new view
+ * (reproject.comp), the nearest one per target pixel keeps its samples, and
+ * the next sample traced there checks that it still sees the same surface.
+ *
+ * The traced images can use reduced precision formats and a render scale
+ * below 1; the display pass then upsamples with a Catmull-Rom filter. They
+ * come from the renderer's RenderTargetPool and are held until the size or
+ * format changes; camera motion reprojects into freshly acquired images and
+ * returns the old ones, so the pool doubles as the history buffer.
+ *
+ * With the denoiser on, DenoisePass filters the accumulated color after the
+ * dispatches (temporal reprojection + a-trous wavelet filter), so moving the
+ * camera at 1 spp shows a clean image instead of raw noise.
  */
 class RayTracingPipeline : public RenderPipeline {
 public:
@@ -41,6 +83,34 @@ public:
      */
     bool loadComputeShader(const std::string& computePath);
     
+    /**
+     * @brief Load the compute shader that builds the adaptive sampling density map
+     * @param densityPath Path to compute shader
+     * @return true if shader loaded successfully (without it every pixel is always traced)
+     */
+    bool loadDensityShader(const std::string& densityPath);
+    
+    /**
+     * @brief Load the compute shader that carries the accumulation over to a new view
+     * @param reprojectPath Path to compute shader
+     * @return true if shader loaded successfully (without it camera motion resets accumulation)
+     */
+    bool loadReprojectShader(const std::string& reprojectPath);
+    
+    /**
+     * @brief Load the wavefront path tracing kernels
+     * @param directory Directory holding generate.comp, extend.comp, ...
+     * @return true if all kernels loaded (otherwise wavefront mode is unavailable)
+     */
+    bool loadWavefrontShaders(const std::string& directory);
+    
+    /**
+     * @brief Load the denoiser kernels
+     * @param directory Directory holding temporal.comp and atrous.comp
+     * @return true if both loaded (otherwise the denoiser is unavailable)
+     */
+    bool loadDenoiseShaders(const std::string& directory);
+    
     /**
      * @brief Load display shader (vertex + fragment) for showing the ray traced image
      * @param vertPath Vertex shader path
@@ -49,28 +119,139 @@ public:
      */
     bool loadDisplayShader(const std::string& vertPath, const std::string& fragPath);
     
+    /**
+     * @brief Rebuild the shaders in the background whenever their files change
+     * @param service Compile service watching the files
+     *
+     * A new compute program restarts accumulation, since the old samples were
+     * produced by different code.
+     */
+    void watchShaders(ShaderCompileService& service,
+                      const std::string& computePath,
+                      const std::string& vertPath,
+                      const std::string& fragPath,
+                      const std::string& densityPath = "",
+                      const std::string& wavefrontDirectory = "",
+                      const std::string& denoiseDirectory = "",
+                      const std::string& reprojectPath = "");
+    
     /**
      * @brief Set ray tracing parameters
      */
     void setMaxBounces(int bounces) { maxBounces_ = bounces; }
     void setSamplesPerPixel(int samples) { samplesPerPixel_ = samples; }
     
+    /**
+     * @brief Set the GPU time budget for tracing per frame
+     * @param milliseconds Target time, 0 traces the whole image once per frame
+     */
+    void setFrameBudget(float milliseconds) { frameBudgetMs_ = milliseconds; }
+    float getFrameBudget() const { return frameBudgetMs_; }
+    
+    /**
+     * @brief Configure the resolution and precision of the traced images
+     * @param renderScale Traced resolution relative to the viewport (0.25 - 1)
+     * @param outputFormat GL_RGBA32F, GL_RGBA16F or GL_R11F_G11F_B10F
+     * @param accumulationFormat GL_RGBA32F or GL_RGBA16F (pixels stop at 2048 passes)
+     *
+     * Images are reallocated and the accumulation resampled into them; a new
+     * accumulation format recompiles the kernels that access it.
+     */
+    void setRenderTargets(float renderScale, GLenum outputFormat, GLenum accumulationFormat);
+    float getRenderScale() const { return renderScale_; }
+    
+    /**
+     * @brief Switch between the megakernel and the wavefront path tracer
+     * @param sortByOctant Sort wavefront rays by direction octant before traversal
+     */
+    void setWavefront(bool enable, bool sortByOctant);
+    bool isWavefrontActive() const;
+    
+    /**
+     * @brief Enable the spatiotemporal denoiser and set its parameters
+     */
+    void setDenoiser(bool enable, const DenoiseSettings& settings);
+    bool isDenoiserActive() const;
+    
+    /**
+     * @brief Configure adaptive sampling
+     * @param threshold Relative standard error at which a block stops, 0 disables
+     * @param minPasses Passes every pixel receives before its error is trusted
+     */
+    void setAdaptiveSampling(float threshold, int minPasses);
+    
+    /**
+     * @brief Count rays and BVH nodes visited on the GPU (PerfCounters)
+     *
+     * Recompiles the kernels with RT_TRAVERSAL_STATS. Counts are read back
+     * without stalling and reach PerfCounters a few frames late.
+     */
+    void setTraversalStats(bool enable);
+    bool getTraversalStats() const { return traversalStats_; }
+    
+    /**
+     * @brief Samples per pixel accumulated over all completed passes
+     *        (blocks that converged early hold fewer)
+     */
+    int getAccumulatedSamples() const { return completedPasses_ * samplesPerPixel_; }
+    
     /**
      * @brief Upload scene data to GPU
      * @param scene Scene to upload
      */
     void uploadScene(class Scene* scene);
     
+    /**
+     * @brief Flatten render items into world space vertices, triangles and
+     *        materials (index 0 is the default material); the CPU part of
+     *        uploadScene(), needs no GL context
+     */
+    static void flattenRenderItems(const std::vector<RenderItem>& items,
+                                   std::vector<GpuVertex>& vertices,
+                                   std::vector<GpuTriangle>& triangles,
+                                   std::vector<GpuMaterial>& materials);
+    
 private:
-    void createOutputTexture();
-    void deleteOutputTexture();
+    void acquireTargets(RenderTargetPool* pool);
+    void acquireAccumulation();
+    void releaseTargets();
+    void updateDensityMap();
+    void clearDensityMap();
     void createSceneBuffers();
     void deleteSceneBuffers();
+    void applyFrameUniforms(GLuint program, const RenderContext& ctx);
+    std::string kernelDefines() const;
+    void reloadKernels();
+    void readTraversalStats(bool wait);
+    void rotateTraversalStats();
+    
+    // Progressive tile scheduling
+    void resetAccumulation();
+    void restartPasses();
+    
+    // Accumulation reprojection, writes the current images from a source set
+    void reprojectAccumulation(GLuint sourceAccumulation, GLuint sourceMoment, GLuint sourceSurface,
+                               int sourceWidth, int sourceHeight,
+                               const Camera& previous, const Camera& current);
+    void readTimerQueries();
+    long long dispatchTiles(long long budgetPixels);
     
     GLuint fbo_;
     GLuint vao_;
-    int width_;
+    int width_;               // Traced resolution (viewport * renderScale_)
     int height_;
+    int viewportWidth_;
+    int viewportHeight_;
+    
+    // Render target configuration
+    float renderScale_;
+    GLenum outputFormat_;
+    GLenum accumulationFormat_;
+    
+    // Kept to rebuild the kernels for another accumulation format
+    std::string computePath_;
+    std::string densityPath_;
+    std::string wavefrontDirectory_;
     
     // Compute shader program ID (raw OpenGL handle)
     GLuint computeShaderProgram_;
@@ -78,13 +259,35 @@ private:
     // Display shader for showing the ray traced result
     std::unique_ptr<ShaderProgram> displayShader_;
     
-    // Output texture from compute shader
+    // Images from pool_, held at outputDesc_ / accumulationDesc_
+    RenderTargetPool* pool_;
+    RenderTargetDesc outputDesc_;
+    RenderTargetDesc accumulationDesc_;
     GLuint outputTexture_;
-    GLuint accumulationTexture_;  // Temporal accumulation texture
+    GLuint accumulationTexture_;  // Temporal accumulation texture (A: passes per pixel)
+    GLuint momentTexture_;        // Mean of squared luminance per pixel
+    GLuint densityTexture_;       // One texel per 16x16 block, 0 = converged
+    GLuint surfaceTexture_;       // Primary hit distance + surface id (RG32UI)
+    
+    // Reprojection, its nearest-distance buffer is a pool transient
+    GLuint reprojectShaderProgram_;
     
-    // Camera state for detecting changes
-    glm::vec3 lastCameraPosition_;
-    glm::vec3 lastCameraFront_;
+    // Adaptive sampling
+    GLuint densityShaderProgram_;
+    float adaptiveThreshold_;
+    int adaptiveMinPasses_;
+    int densityPasses_;           // completedPasses_ when the map was last built, -1 if all active
+    
+    // Wavefront path tracing
+    std::unique_ptr<WavefrontTracer> wavefront_;
+    bool wavefrontEnabled_;
+    
+    // Denoiser, owns the feature images the kernels write (units 4 and 5)
+    std::unique_ptr<DenoisePass> denoiser_;
+    bool denoiseEnabled_;
+    
+    // Camera the accumulation was traced with
+    Camera lastCamera_;
     bool cameraMovedThisFrame_;
     
     // Scene data SSBOs
@@ -92,12 +295,42 @@ private:
     GLuint triangleBuffer_;
     GLuint bvhBuffer_;
     GLuint materialBuffer_;
+    GLuint lightBuffer_;
+    GLuint lightAliasBuffer_;
+    GLuint samplerBuffer_;        // Sobol matrices + blue noise (SamplerTables)
+    GLuint lightCount_;
+    float lightWeightTotal_;
     bool sceneUploaded_;
     
     // Ray tracing parameters
     int maxBounces_;
     int samplesPerPixel_;
-    int frameCount_;
+    int frameCount_;  // Tile passes dispatched since the last reset (iFrame)
+    
+    // Tile scheduler state
+    static constexpr int kTileSize = 128;
+    static constexpr float kMaxReprojectedPasses = 32.0f;
+    static constexpr int kMaxPassesPerFrame = 4;
+    static constexpr int kTimerQueryCount = 4;
+    float frameBudgetMs_;
+    double msPerPixel_;       // Smoothed GPU cost estimate, 0 until measured
+    int tileCursor_;          // Next tile to trace
+    int passStartTile_;       // Tile the current pass started at
+    int completedPasses_;     // Full passes over the image since the last reset
+    
+    // GL_TIME_ELAPSED queries in flight, read back frames later without stalling
+    GLuint timerQueries_[kTimerQueryCount];
+    long long timerPixels_[kTimerQueryCount];
+    bool timerPending_[kTimerQueryCount];
+    int timerNext_;
+    
+    // Traversal counters (SSBO 13), one buffer written per frame while the
+    // others wait for their fence before being read back
+    static constexpr int kStatsBufferCount = 3;
+    bool traversalStats_;
+    GLuint statsBuffers_[kStatsBufferCount];
+    GLsync statsFences_[kStatsBufferCount];
+    int statsCurrent_;
 };
 
 } // namespace kcShaders
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "ShadertoyPipeline.h"
 #include "../ShaderProgram.h"
+#include "../ShaderCompileService.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -52,10 +53,25 @@ bool ShadertoyPipeline::loadShaders(const std::string& vertPath, const std::stri
     std::string fragSource = fragStream.str();
     fragFile.close();
     
+    std::string wrappedFragSource = wrapFragmentSource(fragSource);
+    
+    // Create shader program
+    shader_ = std::make_unique<ShaderProgram>();
+    if (!shader_->loadFromSource(vertSource, wrappedFragSource)) {
+        std::cerr << "[ShadertoyPipeline] Failed to compile shaders\n";
+        return false;
+    }
+    
+    std::cout << "[ShadertoyPipeline] Shaders loaded successfully\n";
+    return true;
+}
+
+std::string ShadertoyPipeline::wrapFragmentSource(const std::string& fragSource)
+{
     // Wrap Shadertoy fragment shader code
     // Standard Shadertoy shaders use mainImage(out vec4 fragColor, in vec2 fragCoord)
     // We need to wrap it with a main() function that calls mainImage
-    std::string wrappedFragSource = R"(
+    std::string wrappedSource = R"(
 #version 330 core
 
 out vec4 FragColor;
@@ -71,10 +87,10 @@ uniform vec4 iMouse;
 )";
     
     // Add the user's Shadertoy code (which contains mainImage function)
-    wrappedFragSource += fragSource;
+    wrappedSource += fragSource;
     
     // Add the main function that calls mainImage
-    wrappedFragSource += R"(
+    wrappedSource += R"(
 
 void main()
 {
@@ -84,15 +100,19 @@ void main()
 }
 )";
     
-    // Create shader program
-    shader_ = std::make_unique<ShaderProgram>();
-    if (!shader_->loadFromSource(vertSource, wrappedFragSource)) {
-        std::cerr << "[ShadertoyPipeline] Failed to compile shaders\n";
-        return false;
-    }
-    
-    std::cout << "[ShadertoyPipeline] Shaders loaded successfully\n";
-    return true;
+    return wrappedSource;
+}
+
+void ShadertoyPipeline::watchShaders(ShaderCompileService& service, const std::string& vertPath, const std::string& fragPath)
+{
+    service.watch(
+        "ShadertoyPipeline/main",
+        {{GL_VERTEX_SHADER, vertPath}, {GL_FRAGMENT_SHADER, fragPath}},
+        shader_,
+        [](GLenum type, const std::string& source) {
+            return type == GL_FRAGMENT_SHADER ? wrapFragmentSource(source) : source;
+        }
+    );
 }
 
 void ShadertoyPipeline::execute(RenderContext& ctx)
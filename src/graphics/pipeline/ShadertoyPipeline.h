@@ -8,6 +8,7 @@
 namespace kcShaders {
 
 class ShaderProgram;
+class ShaderCompileService;
 
 /**
  * @brief Shadertoy-style rendering pipeline
@@ -39,8 +40,17 @@ public:
      * @return true if shaders loaded successfully
      */
     bool loadShaders(const std::string& vertPath, const std::string& fragPath);
+    
+    /**
+     * @brief Rebuild the shaders in the background whenever their files change
+     * @param service Compile service watching the files
+     */
+    void watchShaders(ShaderCompileService& service, const std::string& vertPath, const std::string& fragPath);
 
 private:
+    // Wrap user code providing mainImage() into a complete fragment shader
+    static std::string wrapFragmentSource(const std::string& fragSource);
+    
     GLuint fbo_;
     GLuint vao_;
     int width_;
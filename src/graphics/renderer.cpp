@@ -5,12 +5,17 @@
 #include "scene/material.h"
 #include "scene/light.h"
 #include "gbuffer.h"
+#include "ShaderCompileService.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
 #include "RenderContext.h"
+#include "RenderTargetPool.h"
 #include "pipeline/RenderPipeline.h"
 #include "pipeline/ForwardPipeline.h"
 #include "pipeline/DeferredPipeline.h"
 #include "pipeline/ShadertoyPipeline.h"
 #include "pipeline/RayTracingPipeline.h"
+#include "DenoiseFilter.h"
 
 #include <fstream>
 #include <sstream>
@@ -37,9 +42,14 @@ Renderer::Renderer(GLFWwindow* window, int width, int height)
     , vbo_(0)
     , fbo_(0)
     , fbo_texture_(0)
-    , rbo_(0)
+    , fbo_depth_(0)
     , fb_width_(800)
     , fb_height_(600)
+    , fb_texture_width_(0)
+    , fb_texture_height_(0)
+    , pending_width_(0)
+    , pending_height_(0)
+    , pending_frames_(0)
     , vertex_count_(0)
     , gbuffer_(nullptr)
     , activePipeline_(nullptr)
@@ -79,15 +89,29 @@ bool Renderer::initialize()
     // Calculate vertex count (number of vertices = total floats / components per vertex)
     vertex_count_ = static_cast<int>(sizeof(vertices) / (3 * sizeof(float)));
     
-    // Create framebuffer
+    // Create framebuffer, its textures come from the shared pool
+    targetPool_ = std::make_unique<RenderTargetPool>();
     create_framebuffer();
 
     // Setup fullscreen quad (used by both deferred and shadertoy)
     setupFullscreenQuad();
 
+    // Start the shader watcher
+    shaderCompileService_ = std::make_unique<ShaderCompileService>();
+    if (!shaderCompileService_->initialize()) {
+        std::cerr << "Failed to start shader compile service, hot-reload disabled\n";
+        shaderCompileService_.reset();
+    }
+
+    // GPU timer queries for the profiler
+    profiler_ = std::make_unique<Profiler>();
+    if (!profiler_->initialize()) {
+        std::cerr << "Failed to initialize profiler\n";
+    }
+
     // Create rendering pipelines
     forwardPipeline_ = std::make_unique<ForwardPipeline>(
-        fbo_, fb_width_, fb_height_
+        fbo_, quad_vao_, fb_width_, fb_height_
     );
     
     shadertoyPipeline_ = std::make_unique<ShadertoyPipeline>(
@@ -100,10 +124,11 @@ bool Renderer::initialize()
     if (!raytracingPipeline_->initialize()) {
         std::cerr << "Failed to initialize ray tracing pipeline\n";
     }
+    forwardSize_ = shadertoySize_ = raytracingSize_ = {fb_width_, fb_height_};
     
     // Initialize G-Buffer for deferred rendering
     gbuffer_ = new GBuffer();
-    if (!gbuffer_->initialize(fb_width_, fb_height_)) {
+    if (!gbuffer_->initialize(fb_width_, fb_height_, targetPool_.get())) {
         std::cerr << "Failed to initialize G-Buffer\n";
         delete gbuffer_;
         gbuffer_ = nullptr;
@@ -111,6 +136,7 @@ bool Renderer::initialize()
         deferredPipeline_ = std::make_unique<DeferredPipeline>(
             gbuffer_, fbo_, quad_vao_, fb_width_, fb_height_
         );
+        deferredSize_ = {fb_width_, fb_height_};
         
         if (!deferredPipeline_->initialize()) {
             std::cerr << "Failed to initialize deferred pipeline\n";
@@ -138,12 +164,16 @@ void Renderer::shutdown()
 {
     delete_framebuffer();
     
+    // Stop hot-reload before the pipelines its callbacks refer to go away
+    shaderCompileService_.reset();
+    
     // Clean up pipelines
     activePipeline_ = nullptr;
     forwardPipeline_.reset();
     deferredPipeline_.reset();
     shadertoyPipeline_.reset();
     raytracingPipeline_.reset();
+    profiler_.reset();
     
     // Clean up deferred rendering resources
     if (gbuffer_) {
@@ -151,6 +181,9 @@ void Renderer::shutdown()
         gbuffer_ = nullptr;
     }
     
+    // Last, the passes above released their targets into it
+    targetPool_.reset();
+    
     cleanupFullscreenQuad();
     
     if (vbo_ > 0) 
@@ -171,6 +204,24 @@ void Renderer::clear(float r, float g, float b, float a)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
+void Renderer::begin_frame()
+{
+    if (profiler_) {
+        profiler_->beginFrame();
+    }
+}
+
+void Renderer::end_frame()
+{
+    if (profiler_) {
+        profiler_->endFrame();
+    }
+    if (targetPool_) {
+        targetPool_->endFrame();
+    }
+    PerfCounters::endFrame();
+}
+
 void Renderer::render_shadertoy()
 {
     if (!shadertoyPipeline_) {
@@ -191,7 +242,11 @@ void Renderer::render_shadertoy()
     ctx.totalTime = currentTime - startTime;
     ctx.deltaTime = currentTime - lastTime;
     lastTime = currentTime;
+    ctx.profiler = profiler_.get();
+    ctx.targetPool = targetPool_.get();
     
+    sync_pipeline_size(shadertoyPipeline_.get(), shadertoySize_);
+    ProfileScope scope(ctx.profiler, shadertoyPipeline_->getName());
     shadertoyPipeline_->execute(ctx);
 }
 
@@ -216,7 +271,11 @@ void Renderer::render_forward(Scene* scene, Camera* camera)
     ctx.gbuffer = nullptr;
     ctx.deltaTime = 0.0f;
     ctx.totalTime = 0.0f;
+    ctx.profiler = profiler_.get();
+    ctx.targetPool = targetPool_.get();
     
+    sync_pipeline_size(forwardPipeline_.get(), forwardSize_);
+    ProfileScope scope(ctx.profiler, forwardPipeline_->getName());
     forwardPipeline_->execute(ctx);
 }
 
@@ -241,7 +300,16 @@ void Renderer::render_deferred(Scene* scene, Camera* camera)
     ctx.gbuffer = gbuffer_;
     ctx.deltaTime = 0.0f;
     ctx.totalTime = 0.0f;
+    ctx.profiler = profiler_.get();
+    ctx.targetPool = targetPool_.get();
     
+    // G-Buffer first, it does not resize before shaders create the geometry
+    // pass (no-op at the same size)
+    if (gbuffer_) {
+        gbuffer_->resize(fb_width_, fb_height_);
+    }
+    sync_pipeline_size(deferredPipeline_.get(), deferredSize_);
+    ProfileScope scope(ctx.profiler, deferredPipeline_->getName());
     deferredPipeline_->execute(ctx);
 }
 
@@ -273,42 +341,60 @@ void Renderer::render_raytracing(Scene* scene, Camera* camera)
     ctx.totalTime = currentTime - startTime;
     ctx.deltaTime = currentTime - lastTime;
     lastTime = currentTime;
+    ctx.profiler = profiler_.get();
+    ctx.targetPool = targetPool_.get();
     
+    sync_pipeline_size(raytracingPipeline_.get(), raytracingSize_);
+    ProfileScope scope(ctx.profiler, raytracingPipeline_->getName());
     raytracingPipeline_->execute(ctx);
 }
 
-bool Renderer::loadForwardShaders(const std::string& vertex_path, const std::string& fragment_path)
+bool Renderer::loadForwardShaders(
+    const std::string& vertex_path,
+    const std::string& fragment_path,
+    const std::string& depth_vert,
+    const std::string& depth_frag,
+    const std::string& ssao_vert,
+    const std::string& ssao_frag,
+    const std::string& ssao_blur_vert,
+    const std::string& ssao_blur_frag)
 {
     if (!forwardPipeline_) {
         std::cerr << "[Renderer] Forward pipeline not initialized\n";
         return false;
     }
     
-    return forwardPipeline_->loadShaders(vertex_path, fragment_path);
+    return forwardPipeline_->loadShaders(vertex_path, fragment_path, depth_vert, depth_frag,
+                                         ssao_vert, ssao_frag, ssao_blur_vert, ssao_blur_frag);
 }
 
 void Renderer::create_framebuffer()
 {
-    // Delete existing framebuffer if any
-    delete_framebuffer();
+    // The framebuffer object survives resizes, the pipelines keep its name
+    if (fbo_ == 0) {
+        glGenFramebuffers(1, &fbo_);
+    }
     
-    // Create framebuffer
-    glGenFramebuffers(1, &fbo_);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    // Textures grow and shrink in buckets; sizes within the same bucket only
+    // change the viewport the pipelines render to
+    int texture_width = RenderTargetPool::bucketed(fb_width_);
+    int texture_height = RenderTargetPool::bucketed(fb_height_);
+    if (fbo_texture_ != 0 && texture_width == fb_texture_width_ && texture_height == fb_texture_height_) {
+        return;
+    }
     
-    // Create color texture
-    glGenTextures(1, &fbo_texture_);
-    glBindTexture(GL_TEXTURE_2D, fbo_texture_);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, fb_width_, fb_height_, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fbo_texture_, 0);
+    targetPool_->release(fbo_texture_);
+    targetPool_->release(fbo_depth_);
+    fb_texture_width_ = texture_width;
+    fb_texture_height_ = texture_height;
+    
+    // RGBA8 so compute passes (tiled lighting) can write it as an image
+    fbo_texture_ = targetPool_->acquire({GL_RGBA8, texture_width, texture_height, 1, GL_LINEAR});
+    fbo_depth_ = targetPool_->acquire({GL_DEPTH24_STENCIL8, texture_width, texture_height});
     
-    // Create renderbuffer for depth and stencil
-    glGenRenderbuffers(1, &rbo_);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo_);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, fb_width_, fb_height_);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fbo_texture_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, fbo_depth_, 0);
     
     // Check framebuffer completeness
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
@@ -324,14 +410,14 @@ void Renderer::delete_framebuffer()
         glDeleteFramebuffers(1, &fbo_);
         fbo_ = 0;
     }
-    if (fbo_texture_ > 0) {
-        glDeleteTextures(1, &fbo_texture_);
-        fbo_texture_ = 0;
-    }
-    if (rbo_ > 0) {
-        glDeleteRenderbuffers(1, &rbo_);
-        rbo_ = 0;
+    if (targetPool_) {
+        targetPool_->release(fbo_texture_);
+        targetPool_->release(fbo_depth_);
     }
+    fbo_texture_ = 0;
+    fbo_depth_ = 0;
+    fb_texture_width_ = 0;
+    fb_texture_height_ = 0;
 }
 
 void Renderer::resize_framebuffer(int width, int height)
@@ -340,27 +426,47 @@ void Renderer::resize_framebuffer(int width, int height)
     
     fb_width_ = width;
     fb_height_ = height;
+    pending_frames_ = 0;
     
     create_framebuffer();
     
-    // Resize G-Buffer if deferred rendering is enabled
-    if (gbuffer_) {
-        gbuffer_->resize(width, height);
-    }
+    // Pipelines (and the G-Buffer) follow in sync_pipeline_size when they
+    // next render, so inactive ones keep their targets untouched
+}
+
+void Renderer::request_framebuffer_size(int width, int height)
+{
+    if (width <= 0 || height <= 0) return;
     
-    // Notify pipelines about resize
-    if (forwardPipeline_) {
-        forwardPipeline_->resize(width, height);
+    if (width == fb_width_ && height == fb_height_) {
+        pending_frames_ = 0;
+        return;
     }
-    if (deferredPipeline_) {
-        deferredPipeline_->resize(width, height);
+    
+    // Restart the count whenever the wanted size moves
+    if (width != pending_width_ || height != pending_height_) {
+        pending_width_ = width;
+        pending_height_ = height;
+        pending_frames_ = 0;
     }
-    if (shadertoyPipeline_) {
-        shadertoyPipeline_->resize(width, height);
+    
+    if (++pending_frames_ >= kResizeSettleFrames) {
+        resize_framebuffer(width, height);
     }
-    if (raytracingPipeline_) {
-        raytracingPipeline_->resize(width, height);
+}
+
+void Renderer::sync_pipeline_size(RenderPipeline* pipeline, PipelineSize& size)
+{
+    if (size.width == fb_width_ && size.height == fb_height_) {
+        return;
     }
+    
+    pipeline->resize(fb_width_, fb_height_);
+    size = {fb_width_, fb_height_};
+    
+    // Targets of the old size went back to the pool, free them now rather
+    // than after the idle timeout
+    targetPool_->trim();
 }
 
 bool Renderer::take_screenshot(const std::string& filename)
@@ -474,7 +580,11 @@ bool Renderer::loadDeferredShaders(
     const std::string& ssao_blur_vert,
     const std::string& ssao_blur_frag,
     const std::string& shadow_vert,
-    const std::string& shadow_frag
+    const std::string& shadow_frag,
+    const std::string& tiled_light_comp,
+    const std::string& gtao_comp,
+    const std::string& shadow_atlas_geom,
+    const std::string& occlusion_comp
 )
 {   
     if (!deferredPipeline_) {
@@ -487,7 +597,11 @@ bool Renderer::loadDeferredShaders(
         light_vert, light_frag,
         ssao_vert, ssao_frag,
         ssao_blur_vert, ssao_blur_frag,
-        shadow_vert, shadow_frag
+        shadow_vert, shadow_frag,
+        tiled_light_comp,
+        gtao_comp,
+        shadow_atlas_geom,
+        occlusion_comp
     );
 }
 
@@ -501,7 +615,9 @@ bool Renderer::loadShadertoyShaders(const std::string& vertex_path, const std::s
     return shadertoyPipeline_->loadShaders(vertex_path, fragment_path);
 }
 
-bool Renderer::loadRayTracingShaders(const std::string& compute_path, const std::string& display_vert, const std::string& display_frag)
+bool Renderer::loadRayTracingShaders(const std::string& compute_path, const std::string& display_vert, const std::string& display_frag,
+                                     const std::string& density_path, const std::string& wavefront_dir,
+                                     const std::string& denoise_dir, const std::string& reproject_path)
 {
     if (!raytracingPipeline_) {
         std::cerr << "[Renderer] Ray tracing pipeline not initialized\n";
@@ -513,9 +629,103 @@ bool Renderer::loadRayTracingShaders(const std::string& compute_path, const std:
         success = raytracingPipeline_->loadDisplayShader(display_vert, display_frag);
     }
     
+    // Optional: without them adaptive sampling / wavefront mode / denoising /
+    // reprojection are simply off
+    if (success) {
+        raytracingPipeline_->loadDensityShader(density_path);
+        raytracingPipeline_->loadWavefrontShaders(wavefront_dir);
+        raytracingPipeline_->loadDenoiseShaders(denoise_dir);
+        raytracingPipeline_->loadReprojectShader(reproject_path);
+    }
+    
     return success;
 }
 
+void Renderer::watchForwardShaders(
+    const std::string& vertex_path,
+    const std::string& fragment_path,
+    const std::string& depth_vert,
+    const std::string& depth_frag,
+    const std::string& ssao_vert,
+    const std::string& ssao_frag,
+    const std::string& ssao_blur_vert,
+    const std::string& ssao_blur_frag)
+{
+    if (!shaderCompileService_ || !forwardPipeline_) {
+        return;
+    }
+    
+    shaderCompileService_->clear();
+    forwardPipeline_->watchShaders(*shaderCompileService_, vertex_path, fragment_path, depth_vert, depth_frag,
+                                   ssao_vert, ssao_frag, ssao_blur_vert, ssao_blur_frag);
+}
+
+void Renderer::watchDeferredShaders(
+    const std::string& geom_vert,
+    const std::string& geom_frag,
+    const std::string& light_vert,
+    const std::string& light_frag,
+    const std::string& ssao_vert,
+    const std::string& ssao_frag,
+    const std::string& ssao_blur_vert,
+    const std::string& ssao_blur_frag,
+    const std::string& shadow_vert,
+    const std::string& shadow_frag,
+    const std::string& tiled_light_comp,
+    const std::string& gtao_comp,
+    const std::string& shadow_atlas_geom,
+    const std::string& occlusion_comp
+)
+{
+    if (!shaderCompileService_ || !deferredPipeline_) {
+        return;
+    }
+    
+    shaderCompileService_->clear();
+    deferredPipeline_->watchShaders(
+        *shaderCompileService_,
+        geom_vert, geom_frag,
+        light_vert, light_frag,
+        ssao_vert, ssao_frag,
+        ssao_blur_vert, ssao_blur_frag,
+        shadow_vert, shadow_frag,
+        tiled_light_comp,
+        gtao_comp,
+        shadow_atlas_geom,
+        occlusion_comp
+    );
+}
+
+void Renderer::watchShadertoyShaders(const std::string& vertex_path, const std::string& fragment_path)
+{
+    if (!shaderCompileService_ || !shadertoyPipeline_) {
+        return;
+    }
+    
+    shaderCompileService_->clear();
+    shadertoyPipeline_->watchShaders(*shaderCompileService_, vertex_path, fragment_path);
+}
+
+void Renderer::watchRayTracingShaders(const std::string& compute_path, const std::string& display_vert, const std::string& display_frag,
+                                      const std::string& density_path, const std::string& wavefront_dir,
+                                      const std::string& denoise_dir, const std::string& reproject_path)
+{
+    if (!shaderCompileService_ || !raytracingPipeline_) {
+        return;
+    }
+    
+    shaderCompileService_->clear();
+    raytracingPipeline_->watchShaders(*shaderCompileService_, compute_path, display_vert, display_frag,
+                                      density_path, wavefront_dir, denoise_dir, reproject_path);
+}
+
+void Renderer::processShaderReloads()
+{
+    if (shaderCompileService_) {
+        shaderCompileService_->update();
+    }
+}
+
 void Renderer::uploadRayTracingScene(Scene* scene)
 {
     if (!raytracingPipeline_) {
@@ -526,7 +736,7 @@ void Renderer::uploadRayTracingScene(Scene* scene)
     raytracingPipeline_->uploadScene(scene);
 }
 
-void Renderer::setRayTracingParameters(int max_bounces, int samples_per_pixel)
+void Renderer::setRayTracingParameters(int max_bounces, int samples_per_pixel, RayTracingPreset preset)
 {
     if (!raytracingPipeline_) {
         std::cerr << "[Renderer] Ray tracing pipeline not initialized\n";
@@ -535,16 +745,115 @@ void Renderer::setRayTracingParameters(int max_bounces, int samples_per_pixel)
     
     raytracingPipeline_->setMaxBounces(max_bounces);
     raytracingPipeline_->setSamplesPerPixel(samples_per_pixel);
+    
+    switch (preset) {
+        case RayTracingPreset::Quality:
+            raytracingPipeline_->setRenderTargets(1.0f, GL_RGBA32F, GL_RGBA32F);
+            break;
+        case RayTracingPreset::Balanced:
+            raytracingPipeline_->setRenderTargets(1.0f, GL_RGBA16F, GL_RGBA16F);
+            break;
+        case RayTracingPreset::Performance:
+            raytracingPipeline_->setRenderTargets(0.5f, GL_R11F_G11F_B10F, GL_RGBA16F);
+            break;
+    }
 }
 
-void Renderer::enableDeferredSSAO(bool enable)
+void Renderer::setRayTracingTraversalStats(bool enable)
+{
+    if (!raytracingPipeline_) {
+        std::cerr << "[Renderer] Ray tracing pipeline not initialized\n";
+        return;
+    }
+    
+    raytracingPipeline_->setTraversalStats(enable);
+}
+
+void Renderer::setRayTracingFrameBudget(float milliseconds)
+{
+    if (!raytracingPipeline_) {
+        std::cerr << "[Renderer] Ray tracing pipeline not initialized\n";
+        return;
+    }
+    
+    raytracingPipeline_->setFrameBudget(milliseconds);
+}
+
+void Renderer::setRayTracingAdaptiveSampling(float threshold, int min_passes)
+{
+    if (!raytracingPipeline_) {
+        std::cerr << "[Renderer] Ray tracing pipeline not initialized\n";
+        return;
+    }
+    
+    raytracingPipeline_->setAdaptiveSampling(threshold, min_passes);
+}
+
+void Renderer::setRayTracingWavefront(bool enable, bool sort_by_octant)
+{
+    if (!raytracingPipeline_) {
+        std::cerr << "[Renderer] Ray tracing pipeline not initialized\n";
+        return;
+    }
+    
+    raytracingPipeline_->setWavefront(enable, sort_by_octant);
+}
+
+void Renderer::setRayTracingDenoiser(bool enable, int iterations)
+{
+    if (!raytracingPipeline_) {
+        std::cerr << "[Renderer] Ray tracing pipeline not initialized\n";
+        return;
+    }
+    
+    DenoiseSettings settings;
+    settings.iterations = iterations;
+    raytracingPipeline_->setDenoiser(enable, settings);
+}
+
+int Renderer::getRayTracingAccumulatedSamples() const
+{
+    return raytracingPipeline_ ? raytracingPipeline_->getAccumulatedSamples() : 0;
+}
+
+void Renderer::enableForwardDepthPrepass(bool enable)
+{
+    if (!forwardPipeline_) {
+        std::cerr << "[Renderer] Forward pipeline not initialized\n";
+        return;
+    }
+    
+    forwardPipeline_->enableDepthPrepass(enable);
+}
+
+void Renderer::enableForwardSSAO(bool enable)
+{
+    if (!forwardPipeline_) {
+        std::cerr << "[Renderer] Forward pipeline not initialized\n";
+        return;
+    }
+    
+    forwardPipeline_->enableSSAO(enable);
+}
+
+void Renderer::enableDeferredSSAO(bool enable, bool use_gtao)
+{
+    if (!deferredPipeline_) {
+        std::cerr << "[Renderer] Deferred pipeline not initialized\n";
+        return;
+    }
+    
+    deferredPipeline_->enableSSAO(enable, use_gtao ? SSAOTechnique::GTAO : SSAOTechnique::Kernel);
+}
+
+void Renderer::setDeferredSSAODownsample(int downsample)
 {
     if (!deferredPipeline_) {
         std::cerr << "[Renderer] Deferred pipeline not initialized\n";
         return;
     }
     
-    deferredPipeline_->enableSSAO(enable);
+    deferredPipeline_->setSSAODownsample(downsample);
 }
 
 void Renderer::enableDeferredShadows(bool enable)
@@ -557,4 +866,44 @@ void Renderer::enableDeferredShadows(bool enable)
     deferredPipeline_->enableShadows(enable);
 }
 
+void Renderer::enableDeferredShadowCaching(bool enable)
+{
+    if (!deferredPipeline_) {
+        std::cerr << "[Renderer] Deferred pipeline not initialized\n";
+        return;
+    }
+    
+    deferredPipeline_->enableShadowCaching(enable);
+}
+
+void Renderer::setDeferredShadowAtlasBudget(int views)
+{
+    if (!deferredPipeline_) {
+        std::cerr << "[Renderer] Deferred pipeline not initialized\n";
+        return;
+    }
+    
+    deferredPipeline_->setShadowAtlasBudget(views);
+}
+
+void Renderer::enableDeferredTiledLighting(bool enable)
+{
+    if (!deferredPipeline_) {
+        std::cerr << "[Renderer] Deferred pipeline not initialized\n";
+        return;
+    }
+    
+    deferredPipeline_->enableTiledLighting(enable);
+}
+
+void Renderer::enableDeferredOcclusionCulling(bool enable)
+{
+    if (!deferredPipeline_) {
+        std::cerr << "[Renderer] Deferred pipeline not initialized\n";
+        return;
+    }
+    
+    deferredPipeline_->enableOcclusionCulling(enable);
+}
+
 } // namespace kcShaders
\ No newline at end of file
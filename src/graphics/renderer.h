@@ -16,6 +16,16 @@ class ForwardPipeline;
 class DeferredPipeline;
 class ShadertoyPipeline;
 class RayTracingPipeline;
+class ShaderCompileService;
+class Profiler;
+class RenderTargetPool;
+
+// Ray tracing render target presets, from full precision to bandwidth saving
+enum class RayTracingPreset {
+    Quality,      // Native resolution, RGBA32F output and accumulation
+    Balanced,     // Native resolution, RGBA16F output and accumulation
+    Performance   // Half resolution upsampled, R11G11B10F output, RGBA16F accumulation
+};
 
 class Renderer {
   public:
@@ -27,8 +37,17 @@ class Renderer {
 
     void clear(float r, float g, float b, float a);
     
+    // Frame boundaries for the profiler and PerfCounters, everything in between is one frame
+    void begin_frame();
+    void end_frame();
+    Profiler* get_profiler() const { return profiler_.get(); }
+    
     // Framebuffer methods
-    void resize_framebuffer(int width, int height);
+    void resize_framebuffer(int width, int height);  // Immediate; pipelines resize when they next render
+    // Size wanted by a UI panel, called every frame; applied once it has not
+    // changed for kResizeSettleFrames calls, so dragging a splitter does not
+    // reallocate render targets every frame
+    void request_framebuffer_size(int width, int height);
     void render_shadertoy();
     void render_forward(kcShaders::Scene* scene, kcShaders::Camera* camera);
     void render_deferred(kcShaders::Scene* scene, kcShaders::Camera* camera);
@@ -37,15 +56,30 @@ class Renderer {
     // Ray tracing scene management
     void uploadRayTracingScene(kcShaders::Scene* scene);
     
+    GLuint get_framebuffer() const { return fbo_; }
     GLuint get_framebuffer_texture() const { return fbo_texture_; }
     int get_fb_width() const { return fb_width_; }
     int get_fb_height() const { return fb_height_; }
+    // Allocated size of the framebuffer texture (bucketed); the image is its
+    // bottom-left get_fb_width() x get_fb_height() pixels
+    int get_fb_texture_width() const { return fb_texture_width_; }
+    int get_fb_texture_height() const { return fb_texture_height_; }
+    RenderTargetPool* get_target_pool() const { return targetPool_.get(); }
     
     // Screenshot
     bool take_screenshot(const std::string& filename);
 
     // Unified shader loading interface
-    bool loadForwardShaders(const std::string& vertex_path, const std::string& fragment_path);
+    bool loadForwardShaders(
+        const std::string& vertex_path,
+        const std::string& fragment_path,
+        const std::string& depth_vert = "../../src/shaders/forward/depth.vert",
+        const std::string& depth_frag = "../../src/shaders/forward/depth.frag",
+        const std::string& ssao_vert = "../../src/shaders/deferred/ssao.vert",
+        const std::string& ssao_frag = "../../src/shaders/deferred/ssao.frag",
+        const std::string& ssao_blur_vert = "../../src/shaders/deferred/ssao_blur.vert",
+        const std::string& ssao_blur_frag = "../../src/shaders/deferred/ssao_blur.frag"
+    );
     bool loadDeferredShaders(
         const std::string& geom_vert = "../../src/shaders/deferred/geometry.vert",
         const std::string& geom_frag = "../../src/shaders/deferred/geometry.frag",
@@ -56,19 +90,89 @@ class Renderer {
         const std::string& ssao_blur_vert = "../../src/shaders/deferred/ssao_blur.vert",
         const std::string& ssao_blur_frag = "../../src/shaders/deferred/ssao_blur.frag",
         const std::string& shadow_vert = "../../src/shaders/deferred/shadow_map.vert",
-        const std::string& shadow_frag = "../../src/shaders/deferred/shadow_map.frag"
+        const std::string& shadow_frag = "../../src/shaders/deferred/shadow_map.frag",
+        const std::string& tiled_light_comp = "../../src/shaders/deferred/tiled_lighting.comp",
+        const std::string& gtao_comp = "../../src/shaders/deferred/gtao.comp",
+        const std::string& shadow_atlas_geom = "../../src/shaders/deferred/shadow_atlas.geom",
+        const std::string& occlusion_comp = "../../src/shaders/deferred/occlusion.comp"
     );
     bool loadShadertoyShaders(const std::string& vertex_path, const std::string& fragment_path);
-    bool loadRayTracingShaders(const std::string& compute_path, const std::string& display_vert, const std::string& display_frag);
+    bool loadRayTracingShaders(const std::string& compute_path, const std::string& display_vert, const std::string& display_frag,
+                               const std::string& density_path = "../../src/shaders/raytracing/adaptive_density.comp",
+                               const std::string& wavefront_dir = "../../src/shaders/raytracing/wavefront/",
+                               const std::string& denoise_dir = "../../src/shaders/raytracing/denoise/",
+                               const std::string& reproject_path = "../../src/shaders/raytracing/reproject.comp");
+
+    // Shader hot-reload: only the files of the most recently watched pipeline
+    // are monitored, changes are compiled in the background
+    void watchForwardShaders(
+        const std::string& vertex_path,
+        const std::string& fragment_path,
+        const std::string& depth_vert = "../../src/shaders/forward/depth.vert",
+        const std::string& depth_frag = "../../src/shaders/forward/depth.frag",
+        const std::string& ssao_vert = "../../src/shaders/deferred/ssao.vert",
+        const std::string& ssao_frag = "../../src/shaders/deferred/ssao.frag",
+        const std::string& ssao_blur_vert = "../../src/shaders/deferred/ssao_blur.vert",
+        const std::string& ssao_blur_frag = "../../src/shaders/deferred/ssao_blur.frag"
+    );
+    void watchDeferredShaders(
+        const std::string& geom_vert = "../../src/shaders/deferred/geometry.vert",
+        const std::string& geom_frag = "../../src/shaders/deferred/geometry.frag",
+        const std::string& light_vert = "../../src/shaders/deferred/lighting.vert",
+        const std::string& light_frag = "../../src/shaders/deferred/lighting.frag",
+        const std::string& ssao_vert = "../../src/shaders/deferred/ssao.vert",
+        const std::string& ssao_frag = "../../src/shaders/deferred/ssao.frag",
+        const std::string& ssao_blur_vert = "../../src/shaders/deferred/ssao_blur.vert",
+        const std::string& ssao_blur_frag = "../../src/shaders/deferred/ssao_blur.frag",
+        const std::string& shadow_vert = "../../src/shaders/deferred/shadow_map.vert",
+        const std::string& shadow_frag = "../../src/shaders/deferred/shadow_map.frag",
+        const std::string& tiled_light_comp = "../../src/shaders/deferred/tiled_lighting.comp",
+        const std::string& gtao_comp = "../../src/shaders/deferred/gtao.comp",
+        const std::string& shadow_atlas_geom = "../../src/shaders/deferred/shadow_atlas.geom",
+        const std::string& occlusion_comp = "../../src/shaders/deferred/occlusion.comp"
+    );
+    void watchShadertoyShaders(const std::string& vertex_path, const std::string& fragment_path);
+    void watchRayTracingShaders(const std::string& compute_path, const std::string& display_vert, const std::string& display_frag,
+                                const std::string& density_path = "../../src/shaders/raytracing/adaptive_density.comp",
+                                const std::string& wavefront_dir = "../../src/shaders/raytracing/wavefront/",
+                                const std::string& denoise_dir = "../../src/shaders/raytracing/denoise/",
+                                const std::string& reproject_path = "../../src/shaders/raytracing/reproject.comp");
+
+    // Swap in shaders that finished compiling, call once per frame
+    void processShaderReloads();
 
     // API for setting parameters of rendering pipelines
-    void setRayTracingParameters(int max_bounces, int samples_per_pixel);
-    void enableDeferredSSAO(bool enable);
+    void setRayTracingParameters(int max_bounces, int samples_per_pixel,
+                                 RayTracingPreset preset = RayTracingPreset::Quality);
+    void setRayTracingFrameBudget(float milliseconds);  // 0 = full frame every frame
+    void setRayTracingAdaptiveSampling(float threshold, int min_passes);  // threshold 0 = off
+    void setRayTracingWavefront(bool enable, bool sort_by_octant);
+    void setRayTracingDenoiser(bool enable, int iterations);
+    void setRayTracingTraversalStats(bool enable);  // GPU ray/BVH node counters
+    int getRayTracingAccumulatedSamples() const;
+    void enableForwardDepthPrepass(bool enable);  // Depth-only pass first, shading with an equal depth test
+    void enableForwardSSAO(bool enable);          // SSAO from the forward pre-pass depth
+    void enableDeferredSSAO(bool enable, bool use_gtao = false);  // GTAO: compute horizon-based AO
+    void setDeferredSSAODownsample(int downsample);  // 1 = full, 2 = half, 4 = quarter resolution
     void enableDeferredShadows(bool enable);
+    void enableDeferredShadowCaching(bool enable);  // Redraw shadow cascades/atlas tiles only when they change
+    void setDeferredShadowAtlasBudget(int views);   // Point/spot shadow views redrawn per frame, 0 = unlimited
+    void enableDeferredTiledLighting(bool enable);  // Compute lighting with per-tile light culling
+    void enableDeferredOcclusionCulling(bool enable);  // Two-phase Hi-Z culling of the geometry pass
 
   private:
+    static constexpr int kResizeSettleFrames = 10;
+    
+    // Size a pipeline was last resized to; pipelines that are not rendered
+    // keep their targets until they are
+    struct PipelineSize {
+        int width = 0;
+        int height = 0;
+    };
+    
     void create_framebuffer();
     void delete_framebuffer();
+    void sync_pipeline_size(RenderPipeline* pipeline, PipelineSize& size);
     
     // Pipeline setup
     void setupFullscreenQuad();
@@ -85,12 +189,24 @@ class Renderer {
     GLuint vbo_;
     int vertex_count_;
     
-    // Framebuffer objects (for final output)
+    // Framebuffer objects (for final output); the textures come from
+    // targetPool_ at bucketed sizes, the FBO itself is kept across resizes
     GLuint fbo_;
     GLuint fbo_texture_;
-    GLuint rbo_;
+    GLuint fbo_depth_;
     int fb_width_;
     int fb_height_;
+    int fb_texture_width_;
+    int fb_texture_height_;
+    
+    // request_framebuffer_size hysteresis
+    int pending_width_;
+    int pending_height_;
+    int pending_frames_;
+    
+    // Render targets shared by the pipelines; declared before them so it is
+    // destroyed after the passes that release into it
+    std::unique_ptr<RenderTargetPool> targetPool_;
     
     // Deferred rendering resources
     GBuffer* gbuffer_;
@@ -101,6 +217,16 @@ class Renderer {
     std::unique_ptr<ShadertoyPipeline> shadertoyPipeline_;
     std::unique_ptr<RayTracingPipeline> raytracingPipeline_;
     RenderPipeline* activePipeline_;  // Non-owning pointer to active pipeline
+    PipelineSize forwardSize_;
+    PipelineSize deferredSize_;
+    PipelineSize shadertoySize_;
+    PipelineSize raytracingSize_;
+    
+    // Background shader compilation (callbacks point into the pipelines)
+    std::unique_ptr<ShaderCompileService> shaderCompileService_;
+    
+    // CPU/GPU timing of pipelines and passes
+    std::unique_ptr<Profiler> profiler_;
     
     // Fullscreen quad for deferred rendering
     GLuint quad_vao_;
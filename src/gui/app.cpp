@@ -4,9 +4,13 @@
 #include <GLFW/glfw3.h>
 
 #include "graphics/renderer.h"
+#include "graphics/Profiler.h"
+#include "graphics/PerfCounters.h"
+#include "graphics/RenderTargetPool.h"
 #include "scene/scene.h"
 #include "scene/demo_scene.h"
 #include "scene/camera.h"
+#include "scene/camera_path.h"
 #include "scene/light.h"
 #include "gui/glfw_callbacks.h"
 
@@ -22,9 +26,10 @@
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
+#include <algorithm>
+#include <vector>
 #include <cstring>
 #include <ctime>
-#include <sys/stat.h>
 #include <filesystem>
 
 #ifdef _WIN32
@@ -46,21 +51,10 @@ App::App(const std::string& title)
     , delta_time_(0.0f)
     , show_demo_(false)
     , show_metrics_window_(false)
+    , show_profiler_(false)
     , clear_color_{0.1f, 0.1f, 0.12f, 1.0f}
     , ui_scale_(1.0f)
     , render_mode_(RenderMode::DeferredRendering)
-    , last_vertex_mod_time_(0)
-    , last_fragment_mod_time_(0)
-    , last_geom_vert_mod_time_(0)
-    , last_geom_frag_mod_time_(0)
-    , last_light_vert_mod_time_(0)
-    , last_light_frag_mod_time_(0)
-    , last_shadertoy_vert_mod_time_(0)
-    , last_shadertoy_frag_mod_time_(0)
-    , last_raytracing_compute_mod_time_(0)
-    , last_raytracing_display_vert_mod_time_(0)
-    , last_raytracing_display_frag_mod_time_(0)
-    , shader_check_timer_(0.0f)
     , regular_font_(nullptr)
     , mono_font_(nullptr)
     , current_scene_(nullptr)
@@ -225,6 +219,7 @@ bool App::Initialize(const std::string& title)
         std::cerr << "Failed to initialize renderer\n";
         return false;
     }
+    WatchActiveShaders();
 
     // Load demo scene by default
     LoadDemoScene();
@@ -252,6 +247,10 @@ void App::Shutdown()
     ClearScene();
     
     // Clean up camera
+    if (recorded_path_) {
+        delete recorded_path_;
+        recorded_path_ = nullptr;
+    }
     if (camera_) {
         delete camera_;
         camera_ = nullptr;
@@ -391,9 +390,11 @@ void App::Run()
         delta_time_ = current_frame - last_frame_time_;
         last_frame_time_ = current_frame;
 
+        renderer_->begin_frame();
         ProcessEvents();
         Update(delta_time_);
         Render();
+        renderer_->end_frame();
     }
 }
 
@@ -453,14 +454,15 @@ void App::Update(float delta_time)
 {
     ProcessKeyboardInput();
     
-    // Check shader file changes every 0.5 seconds
-    shader_check_timer_ += delta_time;
-    if (shader_check_timer_ >= 0.5f) {
-        shader_check_timer_ = 0.0f;
-        CheckShaderFileChanges();
+    // Swap in shaders recompiled in the background
+    renderer_->processShaderReloads();
+    
+    if (recorded_path_) {
+        RecordCameraKeyframe();
     }
     
     // Start the Dear ImGui frame
+    ProfileScope scope(renderer_->get_profiler(), "UI");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -510,6 +512,7 @@ void App::Render()
     }
 
     // Render ImGui
+    ProfileScope uiScope(renderer_->get_profiler(), "ImGui");
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     // Update and Render additional Platform Windows
@@ -557,6 +560,10 @@ void App::RenderUI()
     if (show_metrics_window_) {
         ImGui::ShowMetricsWindow(&show_metrics_window_);
     }
+    
+    if (show_profiler_) {
+        RenderProfilerPanel();
+    }
 
     // Render UI panels
     RenderControlPanel();
@@ -593,6 +600,7 @@ void App::RenderMenuBar()
         
         if (ImGui::BeginMenu("View")) {
             ImGui::MenuItem("Metrics", nullptr, &show_metrics_window_);
+            ImGui::MenuItem("Profiler", nullptr, &show_profiler_);
             ImGui::EndMenu();
         }
         
@@ -635,6 +643,7 @@ void App::RenderControlPanel()
                 if (!renderer_->loadForwardShaders(forward_vert_shader_path, forward_frag_shader_path_)) {
                     std::cerr << "Failed to load forward shaders\n";
                 }
+                WatchActiveShaders();
                 break;
                 
             case RenderMode::DeferredRendering:
@@ -644,6 +653,7 @@ void App::RenderControlPanel()
                     light_vert_shader_path_, light_frag_shader_path_)) {
                     std::cerr << "Failed to load deferred shaders\n";
                 }
+                WatchActiveShaders();
                 break;
                 
             case RenderMode::Shadertoy:
@@ -653,6 +663,7 @@ void App::RenderControlPanel()
                 } else {
                     std::cout << "Shadertoy shaders loaded successfully\n";
                 }
+                WatchActiveShaders();
                 break;
                 
             case RenderMode::RayTracing:
@@ -665,6 +676,7 @@ void App::RenderControlPanel()
                     // Upload scene data to GPU for BVH traversal
                     renderer_->uploadRayTracingScene(current_scene_);
                 }
+                WatchActiveShaders();
                 break;
         }
     }
@@ -676,7 +688,42 @@ void App::RenderControlPanel()
         // Set ray tracing specific parameters here
         ImGui::SliderInt("Max Bounces", &raytracing_params.max_bounces, 1, 8);
         ImGui::SliderInt("Samples per Pixel", &raytracing_params.samples_per_pixel, 1, 32);
-        renderer_->setRayTracingParameters(raytracing_params.max_bounces, raytracing_params.samples_per_pixel);
+        const char* presets[] = { "Quality", "Balanced (FP16)", "Performance (1/2 res)" };
+        ImGui::Combo("Preset", &raytracing_params.preset, presets, IM_ARRAYSIZE(presets));
+        renderer_->setRayTracingParameters(raytracing_params.max_bounces, raytracing_params.samples_per_pixel,
+                                           static_cast<RayTracingPreset>(raytracing_params.preset));
+        ImGui::SliderFloat("Frame Budget (ms)", &raytracing_params.frame_budget_ms, 0.0f, 50.0f, "%.1f");
+        renderer_->setRayTracingFrameBudget(raytracing_params.frame_budget_ms);
+        ImGui::SliderFloat("Adaptive Threshold", &raytracing_params.adaptive_threshold, 0.0f, 0.1f, "%.3f");
+        ImGui::SliderInt("Adaptive Min Passes", &raytracing_params.adaptive_min_passes, 1, 64);
+        renderer_->setRayTracingAdaptiveSampling(raytracing_params.adaptive_threshold, raytracing_params.adaptive_min_passes);
+        ImGui::Checkbox("Wavefront", &raytracing_params.wavefront);
+        if (raytracing_params.wavefront) {
+            ImGui::SameLine();
+            ImGui::Checkbox("Sort Rays by Octant", &raytracing_params.sort_rays);
+        }
+        renderer_->setRayTracingWavefront(raytracing_params.wavefront, raytracing_params.sort_rays);
+        ImGui::Checkbox("Denoise", &raytracing_params.denoise);
+        if (raytracing_params.denoise) {
+            ImGui::SliderInt("Denoise Iterations", &raytracing_params.denoise_iterations, 1, 5);
+        }
+        renderer_->setRayTracingDenoiser(raytracing_params.denoise, raytracing_params.denoise_iterations);
+        ImGui::Text("Accumulated Samples: %d", renderer_->getRayTracingAccumulatedSamples());
+    }
+    
+    // Forward rendering options; SSAO reads the pre-pass depth, so it runs the pre-pass too
+    if (render_mode_ == RenderMode::ForwardRendering) {
+        ImGui::Spacing();
+        ImGui::Text("Forward Options");
+        ImGui::Separator();
+        
+        if (ImGui::Checkbox("Depth Pre-Pass", &forward_depth_prepass_)) {
+            renderer_->enableForwardDepthPrepass(forward_depth_prepass_);
+        }
+        
+        if (ImGui::Checkbox("Enable SSAO##forward", &forward_ssao_enabled_)) {
+            renderer_->enableForwardSSAO(forward_ssao_enabled_);
+        }
     }
     
     // Deferred rendering post-processing options
@@ -686,12 +733,44 @@ void App::RenderControlPanel()
         ImGui::Separator();
         
         if (ImGui::Checkbox("Enable SSAO", &ssao_enabled_)) {
-            renderer_->enableDeferredSSAO(ssao_enabled_);
+            renderer_->enableDeferredSSAO(ssao_enabled_, ssao_technique_ == 1);
+        }
+        
+        if (ssao_enabled_) {
+            const char* ssao_techniques[] = { "Hemisphere Kernel", "GTAO (Compute)" };
+            if (ImGui::Combo("SSAO Technique", &ssao_technique_, ssao_techniques, IM_ARRAYSIZE(ssao_techniques))) {
+                renderer_->enableDeferredSSAO(ssao_enabled_, ssao_technique_ == 1);
+            }
+            
+            // GTAO always runs at full resolution
+            if (ssao_technique_ == 0) {
+                const char* ssao_resolutions[] = { "Full", "Half", "Quarter" };
+                if (ImGui::Combo("SSAO Resolution", &ssao_resolution_, ssao_resolutions, IM_ARRAYSIZE(ssao_resolutions))) {
+                    renderer_->setDeferredSSAODownsample(1 << ssao_resolution_);
+                }
+            }
         }
         
         if (ImGui::Checkbox("Enable Shadows", &shadows_enabled_)) {
             renderer_->enableDeferredShadows(shadows_enabled_);
         }
+        
+        if (shadows_enabled_ && ImGui::Checkbox("Cache Shadow Maps", &shadow_caching_)) {
+            renderer_->enableDeferredShadowCaching(shadow_caching_);
+        }
+        
+        // Point lights cost six views, spot lights one
+        if (shadows_enabled_ && ImGui::SliderInt("Shadow Views per Frame", &shadow_atlas_budget_, 0, 64)) {
+            renderer_->setDeferredShadowAtlasBudget(shadow_atlas_budget_);
+        }
+        
+        if (ImGui::Checkbox("Tiled Lighting (Compute)", &tiled_lighting_enabled_)) {
+            renderer_->enableDeferredTiledLighting(tiled_lighting_enabled_);
+        }
+        
+        if (ImGui::Checkbox("Occlusion Culling (Hi-Z)", &occlusion_culling_enabled_)) {
+            renderer_->enableDeferredOcclusionCulling(occlusion_culling_enabled_);
+        }
     }
 
     // Camera info and controls
@@ -735,6 +814,155 @@ void App::RenderControlPanel()
     ImGui::End();
 }
 
+void App::RenderProfilerPanel()
+{
+    ImGui::Begin("Profiler", &show_profiler_);
+    
+    Profiler* profiler = renderer_->get_profiler();
+    if (!profiler) {
+        ImGui::Text("Profiler not available");
+        ImGui::End();
+        return;
+    }
+    
+    bool enabled = profiler->isEnabled();
+    if (ImGui::Checkbox("Enabled", &enabled)) {
+        profiler->setEnabled(enabled);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset")) {
+        profiler->clearHistory();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome Trace")) {
+        std::time_t now = std::time(nullptr);
+        std::ostringstream filename;
+        filename << "trace_" << std::put_time(std::localtime(&now), "%Y%m%d_%H%M%S") << ".json";
+        profiler_status_ = profiler->exportChromeTrace(filename.str())
+            ? "Wrote " + filename.str()
+            : "Failed to write " + filename.str();
+    }
+    if (!profiler_status_.empty()) {
+        ImGui::TextDisabled("%s", profiler_status_.c_str());
+    }
+    
+    // Frame time history, GPU where measured
+    const auto& frames = profiler->getFrames();
+    std::vector<float> cpuTimes;
+    std::vector<float> gpuTimes;
+    for (const auto& frame : frames) {
+        cpuTimes.push_back(static_cast<float>(frame.cpuMs));
+        gpuTimes.push_back(static_cast<float>(std::max(frame.gpuMs, 0.0)));
+    }
+    if (!cpuTimes.empty()) {
+        ImGui::PlotLines("CPU (ms)", cpuTimes.data(), static_cast<int>(cpuTimes.size()), 0, nullptr, 0.0f, 33.3f, ImVec2(0, 60));
+        ImGui::PlotLines("GPU (ms)", gpuTimes.data(), static_cast<int>(gpuTimes.size()), 0, nullptr, 0.0f, 33.3f, ImVec2(0, 60));
+    }
+    
+    ImGui::Text("Last %d frames", static_cast<int>(frames.size()));
+    
+    if (RenderTargetPool* pool = renderer_->get_target_pool()) {
+        ImGui::Text("Pooled render targets: %d (%.1f MB)", static_cast<int>(pool->textureCount()),
+                    static_cast<double>(pool->allocatedBytes()) / (1024.0 * 1024.0));
+    }
+    
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("ProfilerScopes", 7, flags)) {
+        ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("CPU avg");
+        ImGui::TableSetupColumn("CPU p99");
+        ImGui::TableSetupColumn("GPU min");
+        ImGui::TableSetupColumn("GPU avg");
+        ImGui::TableSetupColumn("GPU p99");
+        ImGui::TableSetupColumn("GPU %");
+        ImGui::TableHeadersRow();
+        
+        auto stats = profiler->computeStatistics();
+        double frameGpu = stats.empty() ? 0.0 : stats.front().gpuAvg;
+        for (const auto& scope : stats) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            // Indent(0) would use the default spacing, so pad the text instead
+            ImGui::Text("%*s%s", (scope.depth + 1) * 2, "", scope.name.c_str());
+            
+            double values[] = { scope.cpuAvg, scope.cpuP99, scope.gpuMin, scope.gpuAvg, scope.gpuP99 };
+            for (double value : values) {
+                ImGui::TableNextColumn();
+                if (value >= 0.0) {
+                    ImGui::Text("%.3f", value);
+                } else {
+                    ImGui::TextDisabled("-");
+                }
+            }
+            
+            ImGui::TableNextColumn();
+            if (frameGpu > 0.0 && scope.gpuAvg >= 0.0) {
+                ImGui::Text("%.1f", 100.0 * scope.gpuAvg / frameGpu);
+            } else {
+                ImGui::TextDisabled("-");
+            }
+        }
+        ImGui::EndTable();
+    }
+    
+    // Event counters, averaged over the last second of frames
+    if (ImGui::CollapsingHeader("Counters", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (ImGui::Checkbox("GPU Traversal Stats", &traversal_stats_)) {
+            renderer_->setRayTracingTraversalStats(traversal_stats_);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export Counters")) {
+            profiler_status_ = PerfCounters::exportHistory("counters.csv")
+                ? "Wrote counters.csv"
+                : "Failed to write counters.csv";
+        }
+        
+        PerfCounters::Snapshot counters = PerfCounters::aggregate(60);
+        for (int i = 0; i < PerfCounters::kCount; i++) {
+            PerfCounter counter = static_cast<PerfCounter>(i);
+            ImGui::Text("%-18s %12.0f / frame", PerfCounters::name(counter), counters.perFrame(counter));
+        }
+        ImGui::Text("%-18s %12.2f M", "rays_per_second", counters.raysPerSecond() / 1.0e6);
+    }
+    
+    // Camera motion for kcShaders_bench --camera
+    if (ImGui::CollapsingHeader("Camera Path")) {
+        if (!recorded_path_) {
+            if (ImGui::Button("Record") && camera_) {
+                recorded_path_ = new CameraPath();
+                record_start_time_ = static_cast<float>(glfwGetTime());
+                RecordCameraKeyframe();
+            }
+        } else {
+            if (ImGui::Button("Stop & Save")) {
+                profiler_status_ = recorded_path_->SaveToFile("camera_path.txt")
+                    ? "Wrote camera_path.txt"
+                    : "Failed to write camera_path.txt";
+                delete recorded_path_;
+                recorded_path_ = nullptr;
+            } else {
+                ImGui::SameLine();
+                ImGui::Text("%zu keyframes, %.1f s", recorded_path_->GetKeyframeCount(), recorded_path_->GetDuration());
+            }
+        }
+    }
+    
+    ImGui::End();
+}
+
+void App::RecordCameraKeyframe()
+{
+    // A keyframe every quarter second, the spline fills in between
+    const float interval = 0.25f;
+    float time = static_cast<float>(glfwGetTime()) - record_start_time_;
+    if (!camera_ || (!recorded_path_->IsEmpty() && time < recorded_path_->GetDuration() + interval)) {
+        return;
+    }
+    
+    glm::vec3 position = camera_->GetPosition();
+    recorded_path_->AddKeyframe(time, position, position + camera_->GetFront());
+}
+
 void App::RenderShaderEditorPanel()
 {
     ImGui::Begin("Shader Editor");
@@ -747,11 +975,13 @@ void App::RenderShaderEditorPanel()
     ImGui::Text("Vertex Shader:");
     ImGui::SameLine();
     ImGui::InputText("##VertexShader", forward_vert_shader_path, sizeof(forward_vert_shader_path));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     
     // Fragment shader path input
     ImGui::Text("Fragment Shader:");
     ImGui::SameLine();
     ImGui::InputText("##FragmentShader", forward_frag_shader_path_, sizeof(forward_frag_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     
     ImGui::Spacing();
     ImGui::Spacing();
@@ -766,10 +996,12 @@ void App::RenderShaderEditorPanel()
     ImGui::Text("Vertex:");
     ImGui::SameLine();
     ImGui::InputText("##GeomVert", geom_vert_shader_path_, sizeof(geom_vert_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     
     ImGui::Text("Fragment:");
     ImGui::SameLine();
     ImGui::InputText("##GeomFrag", geom_frag_shader_path_, sizeof(geom_frag_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     ImGui::Unindent();
     
     ImGui::Spacing();
@@ -780,10 +1012,12 @@ void App::RenderShaderEditorPanel()
     ImGui::Text("Vertex:");
     ImGui::SameLine();
     ImGui::InputText("##LightVert", light_vert_shader_path_, sizeof(light_vert_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     
     ImGui::Text("Fragment:");
     ImGui::SameLine();
     ImGui::InputText("##LightFrag", light_frag_shader_path_, sizeof(light_frag_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     ImGui::Unindent();
     
     ImGui::Spacing();
@@ -797,11 +1031,13 @@ void App::RenderShaderEditorPanel()
     ImGui::Text("Vertex Shader:");
     ImGui::SameLine();
     ImGui::InputText("##ShadertoyVert", shadertoy_vert_shader_path_, sizeof(shadertoy_vert_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     
     // Fragment shader path input
     ImGui::Text("Fragment Shader:");
     ImGui::SameLine();
     ImGui::InputText("##ShadertoyFrag", shadertoy_frag_shader_path_, sizeof(shadertoy_frag_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
 
     ImGui::Spacing();
     ImGui::Spacing();
@@ -813,6 +1049,7 @@ void App::RenderShaderEditorPanel()
     ImGui::Text("Compute Shader:");
     ImGui::SameLine();
     ImGui::InputText("##RayTracingCompute", raytracing_compute_shader_path_, sizeof(raytracing_compute_shader_path_));
+    if (ImGui::IsItemDeactivatedAfterEdit()) WatchActiveShaders();
     
     ImGui::End();
 }
@@ -824,19 +1061,17 @@ void App::RenderViewportPanel()
     // Get available content region
     ImVec2 viewport_size = ImGui::GetContentRegionAvail();
     
-    // Resize framebuffer if needed
+    // Resize framebuffer once the panel size has settled; while a splitter
+    // is dragged the last image is stretched to the panel instead
     if (viewport_size.x > 0 && viewport_size.y > 0) {
-        int fb_w = renderer_->get_fb_width();
-        int fb_h = renderer_->get_fb_height();
+        renderer_->request_framebuffer_size((int)viewport_size.x, (int)viewport_size.y);
         
-        if (fb_w != (int)viewport_size.x || fb_h != (int)viewport_size.y) {
-            renderer_->resize_framebuffer((int)viewport_size.x, (int)viewport_size.y);
-        }
-        
-        // Display the framebuffer texture
+        // Display the rendered part of the (bucketed) framebuffer texture
         GLuint texture_id = renderer_->get_framebuffer_texture();
+        float u = static_cast<float>(renderer_->get_fb_width()) / static_cast<float>(renderer_->get_fb_texture_width());
+        float v = static_cast<float>(renderer_->get_fb_height()) / static_cast<float>(renderer_->get_fb_texture_height());
         
-        ImGui::Image((void*)(intptr_t)texture_id, viewport_size, ImVec2(0, 1), ImVec2(1, 0));
+        ImGui::Image((void*)(intptr_t)texture_id, viewport_size, ImVec2(0, v), ImVec2(u, 0));
     }
     
     ImGui::End();
@@ -1096,169 +1331,31 @@ void App::SaveConfig()
     }
 }
 
-std::time_t App::GetFileModTime(const std::string& path)
-{
-    struct stat file_stat;
-    if (stat(path.c_str(), &file_stat) == 0) {
-        return file_stat.st_mtime;
-    }
-    return 0;
-}
-
-void App::CheckShaderFileChanges()
+void App::WatchActiveShaders()
 {
     if (!renderer_) return;
     
+    // Only the active mode's files are watched, edits are compiled in the background
     switch (render_mode_) {
-        case RenderMode::ForwardRendering: {
-            std::string vertex_path(forward_vert_shader_path);
-            std::string fragment_path(forward_frag_shader_path_);
-            
-            if (vertex_path.empty() && fragment_path.empty()) {
-                return;
-            }
-
-            std::time_t vertex_mod = vertex_path.empty() ? 0 : GetFileModTime(vertex_path);
-            std::time_t fragment_mod = fragment_path.empty() ? 0 : GetFileModTime(fragment_path);
-
-            bool vertex_changed = (!vertex_path.empty() && vertex_mod != 0 && vertex_mod != last_vertex_mod_time_);
-            bool fragment_changed = (!fragment_path.empty() && fragment_mod != 0 && fragment_mod != last_fragment_mod_time_);
-
-            // Initialize on first check
-            if ((!vertex_path.empty() && last_vertex_mod_time_ == 0) || (!fragment_path.empty() && last_fragment_mod_time_ == 0)) {
-                if (!vertex_path.empty()) last_vertex_mod_time_ = vertex_mod;
-                if (!fragment_path.empty()) last_fragment_mod_time_ = fragment_mod;
-                return;
-            }
-
-            if (vertex_changed || fragment_changed) {
-                std::cout << "[Forward] Shader file changed, reloading...\n";
-                if (renderer_->loadForwardShaders(vertex_path, fragment_path)) {
-                    std::cout << "[Forward] Shader reloaded successfully\n";
-                    if (vertex_changed) last_vertex_mod_time_ = vertex_mod;
-                    if (fragment_changed) last_fragment_mod_time_ = fragment_mod;
-                }
-            }
+        case RenderMode::ForwardRendering:
+            renderer_->watchForwardShaders(forward_vert_shader_path, forward_frag_shader_path_);
             break;
-        }
-        
-        case RenderMode::DeferredRendering: {
-            std::string geom_vert_path(geom_vert_shader_path_);
-            std::string geom_frag_path(geom_frag_shader_path_);
-            std::string light_vert_path(light_vert_shader_path_);
-            std::string light_frag_path(light_frag_shader_path_);
             
-            if (geom_vert_path.empty() && geom_frag_path.empty() && 
-                light_vert_path.empty() && light_frag_path.empty()) {
-                return;
-            }
-
-            std::time_t geom_vert_mod = geom_vert_path.empty() ? 0 : GetFileModTime(geom_vert_path);
-            std::time_t geom_frag_mod = geom_frag_path.empty() ? 0 : GetFileModTime(geom_frag_path);
-            std::time_t light_vert_mod = light_vert_path.empty() ? 0 : GetFileModTime(light_vert_path);
-            std::time_t light_frag_mod = light_frag_path.empty() ? 0 : GetFileModTime(light_frag_path);
-
-            bool geom_vert_changed = (!geom_vert_path.empty() && geom_vert_mod != 0 && geom_vert_mod != last_geom_vert_mod_time_);
-            bool geom_frag_changed = (!geom_frag_path.empty() && geom_frag_mod != 0 && geom_frag_mod != last_geom_frag_mod_time_);
-            bool light_vert_changed = (!light_vert_path.empty() && light_vert_mod != 0 && light_vert_mod != last_light_vert_mod_time_);
-            bool light_frag_changed = (!light_frag_path.empty() && light_frag_mod != 0 && light_frag_mod != last_light_frag_mod_time_);
-
-            // Initialize on first check
-            if ((!geom_vert_path.empty() && last_geom_vert_mod_time_ == 0) ||
-                (!geom_frag_path.empty() && last_geom_frag_mod_time_ == 0) ||
-                (!light_vert_path.empty() && last_light_vert_mod_time_ == 0) ||
-                (!light_frag_path.empty() && last_light_frag_mod_time_ == 0)) {
-                if (!geom_vert_path.empty()) last_geom_vert_mod_time_ = geom_vert_mod;
-                if (!geom_frag_path.empty()) last_geom_frag_mod_time_ = geom_frag_mod;
-                if (!light_vert_path.empty()) last_light_vert_mod_time_ = light_vert_mod;
-                if (!light_frag_path.empty()) last_light_frag_mod_time_ = light_frag_mod;
-                return;
-            }
-
-            if (geom_vert_changed || geom_frag_changed || light_vert_changed || light_frag_changed) {
-                std::cout << "[Deferred] Shader file changed, reloading...\n";
-                if (renderer_->loadDeferredShaders(geom_vert_path, geom_frag_path, light_vert_path, light_frag_path)) {
-                    std::cout << "[Deferred] Shaders reloaded successfully\n";
-                    if (geom_vert_changed) last_geom_vert_mod_time_ = geom_vert_mod;
-                    if (geom_frag_changed) last_geom_frag_mod_time_ = geom_frag_mod;
-                    if (light_vert_changed) last_light_vert_mod_time_ = light_vert_mod;
-                    if (light_frag_changed) last_light_frag_mod_time_ = light_frag_mod;
-                }
-            }
+        case RenderMode::DeferredRendering:
+            renderer_->watchDeferredShaders(
+                geom_vert_shader_path_, geom_frag_shader_path_,
+                light_vert_shader_path_, light_frag_shader_path_);
             break;
-        }
-        
-        case RenderMode::Shadertoy: {
-            std::string vert_path(shadertoy_vert_shader_path_);
-            std::string frag_path(shadertoy_frag_shader_path_);
             
-            if (vert_path.empty() && frag_path.empty()) {
-                return;
-            }
-
-            std::time_t vert_mod = vert_path.empty() ? 0 : GetFileModTime(vert_path);
-            std::time_t frag_mod = frag_path.empty() ? 0 : GetFileModTime(frag_path);
-
-            bool vert_changed = (!vert_path.empty() && vert_mod != 0 && vert_mod != last_shadertoy_vert_mod_time_);
-            bool frag_changed = (!frag_path.empty() && frag_mod != 0 && frag_mod != last_shadertoy_frag_mod_time_);
-
-            // Initialize on first check
-            if ((!vert_path.empty() && last_shadertoy_vert_mod_time_ == 0) || 
-                (!frag_path.empty() && last_shadertoy_frag_mod_time_ == 0)) {
-                if (!vert_path.empty()) last_shadertoy_vert_mod_time_ = vert_mod;
-                if (!frag_path.empty()) last_shadertoy_frag_mod_time_ = frag_mod;
-                return;
-            }
-
-            if (vert_changed || frag_changed) {
-                std::cout << "[Shadertoy] Shader file changed, reloading...\n";
-                if (renderer_->loadShadertoyShaders(vert_path, frag_path)) {
-                    std::cout << "[Shadertoy] Shaders reloaded successfully\n";
-                    if (vert_changed) last_shadertoy_vert_mod_time_ = vert_mod;
-                    if (frag_changed) last_shadertoy_frag_mod_time_ = frag_mod;
-                }
-            }
+        case RenderMode::Shadertoy:
+            renderer_->watchShadertoyShaders(shadertoy_vert_shader_path_, shadertoy_frag_shader_path_);
             break;
-        }
-        
-        case RenderMode::RayTracing: {
-            std::string compute_path(raytracing_compute_shader_path_);
-            std::string vert_path(raytracing_display_vert_path_);
-            std::string frag_path(raytracing_display_frag_path_);
             
-            if (compute_path.empty() && vert_path.empty() && frag_path.empty()) {
-                return;
-            }
-
-            std::time_t compute_mod = compute_path.empty() ? 0 : GetFileModTime(compute_path);
-            std::time_t vert_mod = vert_path.empty() ? 0 : GetFileModTime(vert_path);
-            std::time_t frag_mod = frag_path.empty() ? 0 : GetFileModTime(frag_path);
-
-            bool compute_changed = (!compute_path.empty() && compute_mod != 0 && compute_mod != last_raytracing_compute_mod_time_);
-            bool vert_changed = (!vert_path.empty() && vert_mod != 0 && vert_mod != last_raytracing_display_vert_mod_time_);
-            bool frag_changed = (!frag_path.empty() && frag_mod != 0 && frag_mod != last_raytracing_display_frag_mod_time_);
-
-            // Initialize on first check
-            if ((!compute_path.empty() && last_raytracing_compute_mod_time_ == 0) ||
-                (!vert_path.empty() && last_raytracing_display_vert_mod_time_ == 0) ||
-                (!frag_path.empty() && last_raytracing_display_frag_mod_time_ == 0)) {
-                if (!compute_path.empty()) last_raytracing_compute_mod_time_ = compute_mod;
-                if (!vert_path.empty()) last_raytracing_display_vert_mod_time_ = vert_mod;
-                if (!frag_path.empty()) last_raytracing_display_frag_mod_time_ = frag_mod;
-                return;
-            }
-
-            if (compute_changed || vert_changed || frag_changed) {
-                std::cout << "[RayTracing] Shader file changed, reloading...\n";
-                if (renderer_->loadRayTracingShaders(compute_path, vert_path, frag_path)) {
-                    std::cout << "[RayTracing] Shaders reloaded successfully\n";
-                    if (compute_changed) last_raytracing_compute_mod_time_ = compute_mod;
-                    if (vert_changed) last_raytracing_display_vert_mod_time_ = vert_mod;
-                    if (frag_changed) last_raytracing_display_frag_mod_time_ = frag_mod;
-                }
-            }
+        case RenderMode::RayTracing:
+            renderer_->watchRayTracingShaders(raytracing_compute_shader_path_,
+                                              raytracing_display_vert_path_,
+                                              raytracing_display_frag_path_);
             break;
-        }
     }
 }
 
@@ -2,24 +2,17 @@
 
 #include <string>
 #include "imgui.h"
-#include <ctime>
+#include "graphics/RenderMode.h"
 
 // Forward declarations
 struct GLFWwindow;
 
 namespace kcShaders {
 
-// Rendering mode enumeration
-enum class RenderMode {
-    ForwardRendering,
-    DeferredRendering,
-    Shadertoy,
-    RayTracing  // Not yet implemented
-};
-
 class Scene;
 class Renderer;
 class Camera;
+class CameraPath;
 class SceneNode;
 enum class LightType;
 
@@ -51,8 +44,7 @@ private:
     void PrepareImGuiFonts();
     void LoadConfig();
     void SaveConfig();
-    void CheckShaderFileChanges();
-    time_t GetFileModTime(const std::string& path);
+    void WatchActiveShaders();
     
     // Scene management
     void LoadDemoScene();
@@ -76,6 +68,8 @@ private:
     void RenderViewportPanel();
     void RenderScenePanel();
     void RenderLightsSection();
+    void RenderProfilerPanel();
+    void RecordCameraKeyframe();
     
     // Helper method for rendering scene node tree
     void DisplaySceneNodeTree(SceneNode* node, int nodeIndex);
@@ -102,6 +96,11 @@ private:
     // UI state
     bool show_demo_;
     bool show_metrics_window_;
+    bool show_profiler_;
+    std::string profiler_status_;  // Result of the last trace export
+    bool traversal_stats_ = false;  // GPU ray/BVH node counters (recompiles the RT kernels)
+    CameraPath* recorded_path_ = nullptr;  // Non-null while recording a benchmark camera path
+    float record_start_time_ = 0.0f;
     float clear_color_[4];
     float ui_scale_;
     RenderMode render_mode_;
@@ -125,35 +124,30 @@ private:
     char raytracing_display_vert_path_[256];
     char raytracing_display_frag_path_[256];
     
-    // Shader file watch
-    time_t last_vertex_mod_time_;
-    time_t last_fragment_mod_time_;
-    
-    // Deferred shader file watch
-    time_t last_geom_vert_mod_time_;
-    time_t last_geom_frag_mod_time_;
-    time_t last_light_vert_mod_time_;
-    time_t last_light_frag_mod_time_;
-    
-    // Shadertoy shader file watch
-    time_t last_shadertoy_vert_mod_time_;
-    time_t last_shadertoy_frag_mod_time_;
-    
-    // Ray tracing shader file watch
-    time_t last_raytracing_compute_mod_time_;
-    time_t last_raytracing_display_vert_mod_time_;
-    time_t last_raytracing_display_frag_mod_time_;
-
     // Rendering parameters
     struct {
         int max_bounces = 4;
         int samples_per_pixel = 1;
+        int preset = 0;  // RayTracingPreset: Quality, Balanced, Performance
+        float frame_budget_ms = 12.0f;  // GPU time per frame for progressive tiles, 0 = off
+        float adaptive_threshold = 0.01f;  // Relative error where a block stops sampling, 0 = off
+        int adaptive_min_passes = 16;
+        bool wavefront = false;  // One kernel per path tracing stage instead of the megakernel
+        bool sort_rays = false;  // Sort wavefront rays by direction octant
+        bool denoise = false;  // Spatiotemporal denoiser on the accumulated image
+        int denoise_iterations = 4;
     } raytracing_params;
     
+    bool forward_depth_prepass_ = false;  // Forward depth pre-pass + equal depth test
+    bool forward_ssao_enabled_ = false;  // Forward SSAO from the pre-pass depth
     bool ssao_enabled_ = true;  // SSAO toggle
+    int ssao_resolution_ = 1;  // 0 = full, 1 = half, 2 = quarter
+    int ssao_technique_ = 0;  // 0 = hemisphere kernel, 1 = GTAO
     bool shadows_enabled_ = true;  // Shadows toggle
-    
-    float shader_check_timer_;
+    bool shadow_caching_ = true;  // Redraw shadow cascades/atlas tiles only when they change
+    int shadow_atlas_budget_ = 12;  // Point/spot shadow views redrawn per frame, 0 = unlimited
+    bool tiled_lighting_enabled_ = false;  // Compute tiled lighting toggle
+    bool occlusion_culling_enabled_ = false;  // Two-phase Hi-Z culling of the geometry pass
     
     // Fonts
     ImFont* regular_font_;
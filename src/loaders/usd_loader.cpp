@@ -4,6 +4,7 @@
 
 #include "scene/scene.h"
 #include "scene/mesh.h"
+#include "scene/geometry.h"
 #include "scene/material.h"
 #include "scene/light.h"
 #include "scene/texture.h"
@@ -406,7 +407,6 @@ bool UsdLoader::ProcessMesh(void* meshPtr, SceneNode* node) {
             int vertCount = faceVertexCounts[faceIdx];
             
             // For each vertex in this face, create a new vertex with correct UV
-            std::vector<uint32_t> faceIndices;
             for (int i = 0; i < vertCount; i++) {
                 int posIdx = faceVertexIndices[faceStart + i];
                 
@@ -429,68 +429,19 @@ bool UsdLoader::ProcessMesh(void* meshPtr, SceneNode* node) {
                 }
                 
                 vertices.push_back(v);
-                faceIndices.push_back(static_cast<uint32_t>(vertices.size() - 1));
                 uvIndex++;
             }
             
-            // Triangulate this face
-            if (vertCount == 3) {
-                indices.push_back(faceIndices[0]);
-                indices.push_back(faceIndices[1]);
-                indices.push_back(faceIndices[2]);
-            } else if (vertCount == 4) {
-                indices.push_back(faceIndices[0]);
-                indices.push_back(faceIndices[1]);
-                indices.push_back(faceIndices[2]);
-                
-                indices.push_back(faceIndices[0]);
-                indices.push_back(faceIndices[2]);
-                indices.push_back(faceIndices[3]);
-            } else {
-                // N-gon fan triangulation
-                for (int i = 1; i < vertCount - 1; i++) {
-                    indices.push_back(faceIndices[0]);
-                    indices.push_back(faceIndices[i]);
-                    indices.push_back(faceIndices[i + 1]);
-                }
-            }
-            
             faceStart += vertCount;
         }
+        
+        // One vertex per face corner, in corner order
+        triangulate_polygons(faceVertexCounts.cdata(), faceVertexCounts.size(),
+                             nullptr, vertices.size(), indices);
     } else {
         // Vertex-varying or no UVs: use original vertex indexing
-        for (size_t faceIdx = 0; faceIdx < faceVertexCounts.size(); faceIdx++) {
-            int vertCount = faceVertexCounts[faceIdx];
-            
-            if (vertCount == 3) {
-                // Triangle - add directly
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 0]));
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 1]));
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 2]));
-            } else if (vertCount == 4) {
-                // Quad - triangulate into 2 triangles
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 0]));
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 1]));
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 2]));
-                
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 0]));
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 2]));
-                indices.push_back(static_cast<uint32_t>(faceVertexIndices[faceStart + 3]));
-            } else {
-                // N-gon - fan triangulation
-                uint32_t idx0 = static_cast<uint32_t>(faceVertexIndices[faceStart + 0]);
-                for (int i = 1; i < vertCount - 1; i++) {
-                    uint32_t idx1 = static_cast<uint32_t>(faceVertexIndices[faceStart + i]);
-                    uint32_t idx2 = static_cast<uint32_t>(faceVertexIndices[faceStart + i + 1]);
-                    
-                    indices.push_back(idx0);
-                    indices.push_back(idx1);
-                    indices.push_back(idx2);
-                }
-            }
-            
-            faceStart += vertCount;
-        }
+        triangulate_polygons(faceVertexCounts.cdata(), faceVertexCounts.size(),
+                             faceVertexIndices.cdata(), faceVertexIndices.size(), indices);
     }
 
     // Check if we have valid indices
@@ -21,6 +21,9 @@ public:
     glm::vec3 GetRight() const { return right_; }
     glm::vec3 GetUp() const { return up_; }
     float GetFov() const { return fov_; }
+    float GetAspectRatio() const { return aspect_ratio_; }
+    float GetNearPlane() const { return near_plane_; }
+    float GetFarPlane() const { return far_plane_; }
 
     glm::mat4 GetViewMatrix() const;
     glm::mat4 GetProjectionMatrix() const;
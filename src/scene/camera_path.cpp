@@ -0,0 +1,150 @@
+#include "camera_path.h"
+#include "camera.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace kcShaders {
+
+namespace {
+
+glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) +
+                   (-p0 + p2) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+
+} // namespace
+
+void CameraPath::AddKeyframe(float time, const glm::vec3& position, const glm::vec3& target)
+{
+    if (!keyframes_.empty() && time <= keyframes_.back().time) {
+        std::cerr << "[CameraPath] Keyframe at " << time << "s is not after the previous one, ignored\n";
+        return;
+    }
+    keyframes_.push_back({time, position, target});
+}
+
+CameraPath::Keyframe CameraPath::Evaluate(float time) const
+{
+    if (keyframes_.empty()) {
+        return {time, glm::vec3(5.0f), glm::vec3(0.0f)};
+    }
+    if (keyframes_.size() == 1 || time <= keyframes_.front().time) {
+        Keyframe key = keyframes_.front();
+        key.time = time;
+        return key;
+    }
+    if (time >= keyframes_.back().time) {
+        Keyframe key = keyframes_.back();
+        key.time = time;
+        return key;
+    }
+
+    // Segment [i, i + 1] containing time, end points repeated for the outer tangents
+    auto next = std::upper_bound(keyframes_.begin(), keyframes_.end(), time,
+                                 [](float t, const Keyframe& key) { return t < key.time; });
+    size_t i = static_cast<size_t>(next - keyframes_.begin()) - 1;
+    const Keyframe& k0 = keyframes_[i > 0 ? i - 1 : i];
+    const Keyframe& k1 = keyframes_[i];
+    const Keyframe& k2 = keyframes_[i + 1];
+    const Keyframe& k3 = keyframes_[std::min(i + 2, keyframes_.size() - 1)];
+
+    float u = (time - k1.time) / (k2.time - k1.time);
+    Keyframe key;
+    key.time = time;
+    key.position = catmullRom(k0.position, k1.position, k2.position, k3.position, u);
+    key.target = catmullRom(k0.target, k1.target, k2.target, k3.target, u);
+    return key;
+}
+
+void CameraPath::Apply(Camera& camera, float time) const
+{
+    Keyframe key = Evaluate(time);
+    camera.SetPosition(key.position);
+    camera.SetTarget(key.target);
+}
+
+bool CameraPath::LoadFromFile(const std::string& filepath)
+{
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "[CameraPath] Failed to open " << filepath << "\n";
+        return false;
+    }
+
+    std::vector<Keyframe> loaded;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        std::istringstream in(line);
+        Keyframe key;
+        if (!(in >> key.time >> key.position.x >> key.position.y >> key.position.z
+                 >> key.target.x >> key.target.y >> key.target.z)) {
+            std::cerr << "[CameraPath] " << filepath << ":" << lineNumber << ": expected 7 numbers\n";
+            return false;
+        }
+        if (!loaded.empty() && key.time <= loaded.back().time) {
+            std::cerr << "[CameraPath] " << filepath << ":" << lineNumber << ": time must increase\n";
+            return false;
+        }
+        loaded.push_back(key);
+    }
+
+    if (loaded.empty()) {
+        std::cerr << "[CameraPath] No keyframes in " << filepath << "\n";
+        return false;
+    }
+    keyframes_ = std::move(loaded);
+    return true;
+}
+
+bool CameraPath::SaveToFile(const std::string& filepath) const
+{
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "[CameraPath] Failed to write " << filepath << "\n";
+        return false;
+    }
+
+    file << "# time px py pz tx ty tz\n";
+    file << std::fixed << std::setprecision(4);
+    for (const Keyframe& key : keyframes_) {
+        file << key.time << " "
+             << key.position.x << " " << key.position.y << " " << key.position.z << " "
+             << key.target.x << " " << key.target.y << " " << key.target.z << "\n";
+    }
+    return true;
+}
+
+CameraPath CameraPath::CreateOrbit(const glm::vec3& center, float radius, float height,
+                                   float duration, int keyframes)
+{
+    CameraPath path;
+    keyframes = std::max(keyframes, 4);
+    for (int i = 0; i <= keyframes; i++) {
+        float angle = 6.2831853f * static_cast<float>(i) / keyframes;
+        glm::vec3 position = center + glm::vec3(radius * std::cos(angle), radius * std::sin(angle), height);
+        path.AddKeyframe(duration * static_cast<float>(i) / keyframes, position, center);
+    }
+    return path;
+}
+
+} // namespace kcShaders
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace kcShaders {
+
+class Camera;
+
+/**
+ * @brief Timed camera keyframes interpolated with a Catmull-Rom spline
+ *
+ * Used to replay the same camera motion in benchmarks. The text format has
+ * one keyframe per line, "time px py pz tx ty tz" (seconds, position, look
+ * at target), '#' starts a comment.
+ */
+class CameraPath {
+public:
+    struct Keyframe {
+        float time;
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    CameraPath() = default;
+
+    /** Keyframes must be added in increasing time */
+    void AddKeyframe(float time, const glm::vec3& position, const glm::vec3& target);
+    void Clear() { keyframes_.clear(); }
+
+    bool IsEmpty() const { return keyframes_.empty(); }
+    size_t GetKeyframeCount() const { return keyframes_.size(); }
+    float GetDuration() const { return keyframes_.empty() ? 0.0f : keyframes_.back().time; }
+
+    /** Interpolated keyframe at `time`, clamped to the path */
+    Keyframe Evaluate(float time) const;
+
+    /** Move the camera to the path position at `time` */
+    void Apply(Camera& camera, float time) const;
+
+    bool LoadFromFile(const std::string& filepath);
+    bool SaveToFile(const std::string& filepath) const;
+
+    /**
+     * Closed orbit around `center` in the XY plane (Z is up)
+     * @param keyframes Keyframes on the circle, the first is repeated at the end
+     */
+    static CameraPath CreateOrbit(const glm::vec3& center, float radius, float height,
+                                  float duration, int keyframes = 16);
+
+private:
+    std::vector<Keyframe> keyframes_;
+};
+
+} // namespace kcShaders
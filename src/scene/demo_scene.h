@@ -51,4 +51,64 @@ inline Scene* create_demo_scene()
     return scene;
 }
 
+// Create stress scene: grid x grid alternating spheres and cubes on a plane
+inline Scene* create_primitive_scene(int grid)
+{
+    Scene* scene = new Scene();
+    grid = grid < 1 ? 1 : grid;
+    const float spacing = 2.5f;
+    const float extent = spacing * grid;
+
+    SceneNode* ground = scene->createRoot();
+    ground->mesh = create_plane(extent + spacing, extent + spacing, 1, 1);
+    ground->transform.position = glm::vec3(0.0f, 0.0f, -1.0f);
+    ground->material = Material::CreatePlastic(glm::vec3(0.6f, 0.6f, 0.6f), 0.8f);
+    ground->material->name = "Ground";
+
+    for (int y = 0; y < grid; y++) {
+        for (int x = 0; x < grid; x++) {
+            // Every node owns its mesh and material
+            SceneNode* node = scene->createRoot();
+            bool sphere = (x + y) % 2 == 0;
+            node->mesh = sphere ? create_sphere(1.0f, 24, 32) : create_cube(1.6f);
+            node->transform.position = glm::vec3((x - 0.5f * (grid - 1)) * spacing,
+                                                 (y - 0.5f * (grid - 1)) * spacing, 0.0f);
+            glm::vec3 color(0.2f + 0.8f * x / grid, 0.3f, 0.2f + 0.8f * y / grid);
+            node->material = sphere ? Material::CreateMetal(color, 0.3f) : Material::CreatePlastic(color, 0.5f);
+            node->name = sphere ? "Sphere" : "Cube";
+        }
+    }
+
+    DirectionalLight* sunlight = DirectionalLight::CreateSunlight(glm::vec3(-0.3f, -0.5f, -1.0f));
+    sunlight->intensity = 0.8f;
+    scene->addLight(sunlight);
+
+    AmbientLight* ambient = AmbientLight::CreateDefault(glm::vec3(0.15f, 0.15f, 0.2f), 0.3f);
+    scene->addLight(ambient);
+
+    return scene;
+}
+
+// Add count small point lights on a grid spanning extent x extent above the
+// ground plane of the demo / primitive scenes (many-light stress test)
+inline void add_point_light_grid(Scene* scene, int count, float extent)
+{
+    if (count <= 0) return;
+    int side = 1;
+    while (side * side < count) side++;
+    const float spacing = extent / side;
+
+    for (int i = 0; i < count; i++) {
+        int x = i % side;
+        int y = i / side;
+        glm::vec3 position((x + 0.5f) * spacing - 0.5f * extent,
+                           (y + 0.5f) * spacing - 0.5f * extent, 0.5f);
+        // Cycle through a few saturated colors so overlaps stay visible
+        glm::vec3 color(0.3f + 0.7f * ((i % 3) == 0), 0.3f + 0.7f * ((i % 3) == 1), 0.3f + 0.7f * ((i % 3) == 2));
+        PointLight* light = PointLight::CreateBulb(position, color, 1.5f * spacing, 2.0f);
+        light->name = "Grid Light";
+        scene->addLight(light);
+    }
+}
+
 } // namespace kcShaders
\ No newline at end of file
@@ -43,6 +43,34 @@ void compute_normals(std::vector<Vertex>& vertices, const std::vector<uint32_t>&
     }
 }
 
+// ================= triangulate polygons =================
+void triangulate_polygons(const int* face_vertex_counts, size_t face_count,
+                          const int* corner_vertices, size_t corner_count,
+                          std::vector<uint32_t>& indices)
+{
+    size_t face_start = 0;
+    for (size_t face = 0; face < face_count; face++) 
+    {
+        int vert_count = face_vertex_counts[face];
+        if (vert_count < 0 || face_start + vert_count > corner_count) {
+            break;
+        }
+
+        // Triangles and quads are fans too: (0,1,2) and (0,2,3)
+        auto corner = [&](int i) {
+            size_t c = face_start + i;
+            return static_cast<uint32_t>(corner_vertices ? corner_vertices[c] : c);
+        };
+        for (int i = 1; i < vert_count - 1; i++) {
+            indices.push_back(corner(0));
+            indices.push_back(corner(i));
+            indices.push_back(corner(i + 1));
+        }
+
+        face_start += vert_count;
+    }
+}
+
 // ================= Plane =================
 Mesh* create_plane(float width, float height, int segments_w, int segments_h) 
 {
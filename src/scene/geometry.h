@@ -3,6 +3,7 @@
 #pragma once 
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace kcShaders {
@@ -13,6 +14,13 @@ struct Vertex;
 // auto compute normals
 void compute_normals(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
 
+// Fan-triangulate polygons laid out like USD faceVertexCounts/faceVertexIndices.
+// Corner c becomes vertex corner_vertices[c], or c itself when corner_vertices
+// is null (one vertex per corner). Faces past corner_count are dropped.
+void triangulate_polygons(const int* face_vertex_counts, size_t face_count,
+                          const int* corner_vertices, size_t corner_count,
+                          std::vector<uint32_t>& indices);
+
 kcShaders::Mesh* create_plane(float width, float height, int segments_w, int segments_h);
 kcShaders::Mesh* create_cube(float size);
 kcShaders::Mesh* create_sphere(float radius, int segments_lat, int segments_lon);
@@ -1,9 +1,34 @@
 #include "light.h"
 #include <glm/gtc/constants.hpp>
 #include <algorithm>
+#include <cmath>
 
 namespace kcShaders {
 
+float ComputeLightRange(const glm::vec3& radiance, float constant, float linear,
+                        float quadratic, float radius)
+{
+    // Solve constant + linear * d + quadratic * d^2 = peak / cutoff
+    float peak = std::max(radiance.x, std::max(radiance.y, radiance.z));
+    float c = std::max(constant, 0.0001f) - peak / kLightCutoff;
+    float l = std::max(linear, 0.0f);
+    float q = std::max(quadratic, 0.0f);
+
+    float range = 0.0f;
+    if (c >= 0.0f) {
+        range = 1e-4f;  // Never brighter than the cutoff
+    } else if (q > 0.0f) {
+        range = (-l + std::sqrt(l * l - 4.0f * q * c)) / (2.0f * q);
+    } else if (l > 0.0f) {
+        range = -c / l;
+    }
+
+    if (radius > 0.0f) {
+        range = range > 0.0f ? std::min(range, radius) : radius;
+    }
+    return range;
+}
+
 // ================= Base Light =================
 
 Light::Light(LightType type)
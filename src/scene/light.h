@@ -14,6 +14,20 @@ enum class LightType {
     Ambient
 };
 
+// A light whose contribution stays below this is culled
+constexpr float kLightCutoff = 1.0f / 256.0f;
+
+/**
+ * Distance beyond which a light with 1 / (constant + linear * d + quadratic * d^2)
+ * falloff adds less than kLightCutoff to any channel; the lighting passes
+ * cull the light there and fade it out towards it
+ * @param radiance Color times intensity
+ * @param radius Hard cutoff radius (0 = none)
+ * @return Culling radius, 0 if the light never falls off
+ */
+float ComputeLightRange(const glm::vec3& radiance, float constant, float linear,
+                        float quadratic, float radius);
+
 // Base light class
 class Light {
 public:
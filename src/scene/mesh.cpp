@@ -1,4 +1,5 @@
 #include "mesh.h"
+#include "../graphics/PerfCounters.h"
 
 #include <cassert>
 
@@ -8,6 +9,7 @@ namespace kcShaders {
 Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
     : vertices(vertices), indices(indices)
 {
+    updateBounds();
 }
 
 // ================= destructor =================
@@ -30,13 +32,18 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
         indices  = std::move(other.indices);
         name_ = std::move(other.name_);
         face_count_ = other.face_count_;
+        bounds_min_ = other.bounds_min_;
+        bounds_max_ = other.bounds_max_;
 
         vao = other.vao;
         vbo = other.vbo;
         ebo = other.ebo;
+        depth_vao = other.depth_vao;
+        position_vbo = other.position_vbo;
         uploaded = other.uploaded;
 
         other.vao = other.vbo = other.ebo = 0;
+        other.depth_vao = other.position_vbo = 0;
         other.uploaded = false;
         other.face_count_ = 0;
     }
@@ -46,6 +53,21 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
 // ================= data setup =================
 void Mesh::setVertices(const std::vector<Vertex>& v) {
     vertices = v;
+    updateBounds();
+}
+
+void Mesh::updateBounds()
+{
+    if (vertices.empty()) {
+        bounds_min_ = bounds_max_ = glm::vec3(0.0f);
+        return;
+    }
+
+    bounds_min_ = bounds_max_ = vertices[0].position;
+    for (const Vertex& v : vertices) {
+        bounds_min_ = glm::min(bounds_min_, v.position);
+        bounds_max_ = glm::max(bounds_max_, v.position);
+    }
 }
 
 void Mesh::setIndices(const std::vector<uint32_t>& i) {
@@ -169,6 +191,32 @@ void Mesh::upload()
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE,
                           sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
 
+    // Depth passes only read positions: a separate packed stream keeps
+    // their vertex fetch at 12 instead of 56 bytes per vertex
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex& v : vertices) {
+        positions.push_back(v.position);
+    }
+
+    glGenVertexArrays(1, &depth_vao);
+    glGenBuffers(1, &position_vbo);
+    glBindVertexArray(depth_vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, position_vbo);
+    glBufferData(GL_ARRAY_BUFFER,
+                 positions.size() * sizeof(glm::vec3),
+                 positions.data(),
+                 GL_STATIC_DRAW);
+
+    if (ebo) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    }
+
+    // layout(location = 0) position
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
     glBindVertexArray(0);
     uploaded = true;
 }
@@ -190,6 +238,51 @@ void Mesh::draw() const
                      static_cast<GLsizei>(vertices.size()));
     }
     glBindVertexArray(0);
+    
+    PerfCounters::add(PerfCounter::DrawCalls);
+    PerfCounters::add(PerfCounter::Triangles, (indices.empty() ? vertices.size() : indices.size()) / 3);
+    PerfCounters::add(PerfCounter::StateChanges);  // VAO bind
+}
+
+void Mesh::drawDepth(int instanceCount) const
+{
+    assert(uploaded);
+    glBindVertexArray(depth_vao);
+    if (!indices.empty())
+    {
+        glDrawElementsInstanced(GL_TRIANGLES,
+                                static_cast<GLsizei>(indices.size()),
+                                GL_UNSIGNED_INT,
+                                nullptr,
+                                instanceCount);
+    } else {
+        glDrawArraysInstanced(GL_TRIANGLES,
+                              0,
+                              static_cast<GLsizei>(vertices.size()),
+                              instanceCount);
+    }
+    glBindVertexArray(0);
+
+    PerfCounters::add(PerfCounter::DrawCalls);
+    PerfCounters::add(PerfCounter::Triangles,
+                      (indices.empty() ? vertices.size() : indices.size()) / 3 * static_cast<size_t>(instanceCount));
+    PerfCounters::add(PerfCounter::StateChanges);  // VAO bind
+}
+
+void Mesh::drawIndirect(GLintptr offset) const
+{
+    assert(uploaded);
+    glBindVertexArray(vao);
+    if (!indices.empty())
+    {
+        glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(offset));
+    } else {
+        glDrawArraysIndirect(GL_TRIANGLES, reinterpret_cast<const void*>(offset));
+    }
+    glBindVertexArray(0);
+
+    PerfCounters::add(PerfCounter::DrawCalls);
+    PerfCounters::add(PerfCounter::StateChanges);  // VAO bind
 }
 
 // ================= cleanup =================
@@ -198,7 +291,10 @@ void Mesh::releaseGPU()
     if (ebo) glDeleteBuffers(1, &ebo);
     if (vbo) glDeleteBuffers(1, &vbo);
     if (vao) glDeleteVertexArrays(1, &vao);
+    if (position_vbo) glDeleteBuffers(1, &position_vbo);
+    if (depth_vao) glDeleteVertexArrays(1, &depth_vao);
     ebo = vbo = vao = 0;
+    position_vbo = depth_vao = 0;
     uploaded = false;
 }
 
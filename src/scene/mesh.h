@@ -51,6 +51,15 @@ public:
     // draw call
     void draw() const;
 
+    // Depth-only draw from the position-only stream (location 0), for
+    // shadow and depth pre-passes; instanceCount > 1 draws instances
+    void drawDepth(int instanceCount = 1) const;
+
+    // Draw with the command at offset in the bound GL_DRAW_INDIRECT_BUFFER
+    // (DrawElementsIndirectCommand, or DrawArraysIndirectCommand without
+    // indices); the GPU decides the instance count, so no triangles are counted
+    void drawIndirect(GLintptr offset) const;
+
     // query
     bool isUploaded() const { return uploaded; }
     const std::vector<Vertex>& GetVertices() const { return vertices; }
@@ -60,10 +69,14 @@ public:
     uint32_t GetIndexCount() const { return indexCount(); }
     uint32_t GetVertexCount() const { return static_cast<uint32_t>(vertices.size()); }
     uint32_t GetFaceCount() const { return face_count_; }
+    // Object-space bounding box of the vertices (empty mesh: both zero)
+    const glm::vec3& GetBoundsMin() const { return bounds_min_; }
+    const glm::vec3& GetBoundsMax() const { return bounds_max_; }
     std::string name() const { return this->name_; };
 
 private:
     void releaseGPU();
+    void updateBounds();
 
 private:
     // CPU-side data
@@ -72,11 +85,15 @@ private:
 
     std::string name_ = "Unnamed Mesh";
     uint32_t face_count_ = 0;  // Original face count before triangulation
+    glm::vec3 bounds_min_{0.0f};
+    glm::vec3 bounds_max_{0.0f};
 
     // GPU-side objects
     GLuint vao = 0;
     GLuint vbo = 0;
     GLuint ebo = 0;
+    GLuint depth_vao = 0;     // Position stream + shared index buffer
+    GLuint position_vbo = 0;  // Tightly packed positions (12 bytes per vertex)
 
     bool uploaded = false;
 };
@@ -0,0 +1,72 @@
+// Progressive accumulation shared by the ray tracing kernels
+//
+// Bindings match RayTracingPipeline: the accumulation alpha counts the passes
+// a pixel has received, the moment image keeps the running mean of squared
+// luminance for the variance estimate, and the density map (one texel per
+// 16x16 block, written by adaptive_density.comp) marks converged blocks.
+// The primary surface image holds each pixel's primary hit distance and
+// surface id (triangle + 1, 0 = sky) for reprojection (reproject.comp).
+//
+// RayTracingPipeline compiles the kernels with the accumulation format it
+// allocated. Half floats hold pass counts exactly only up to 2048, so a
+// pixel stops accumulating at RT_MAX_PASSES.
+
+#ifndef RT_ACCUMULATION_FORMAT
+#define RT_ACCUMULATION_FORMAT rgba32f
+#endif
+#ifndef RT_MAX_PASSES
+#define RT_MAX_PASSES 16777216.0
+#endif
+
+layout(RT_ACCUMULATION_FORMAT, binding = 1) uniform image2D accumulationImage;
+layout(r32f, binding = 2) uniform image2D momentImage;
+layout(r32f, binding = 3) uniform readonly image2D densityImage;
+layout(rg32ui, binding = 6) uniform uimage2D primarySurfaceImage;
+
+// Set by reproject.comp on history carried over from another view
+const uint kReprojectedFlag = 0x80000000u;
+
+// Whether the 16x16 block containing this pixel still needs samples; with
+// 16x16 work groups aligned to tiles the answer is uniform per group, so a
+// converged block costs a single image load
+bool blockActive(ivec2 pixelCoords)
+{
+    return imageLoad(densityImage, pixelCoords / 16).r > 0.0;
+}
+
+// Record the primary hit of a pixel's first sample. Reprojected history is
+// kept only if this sample sees the same triangle or the distance the
+// reprojection predicted; otherwise it belonged to a surface that is now
+// hidden (or was never visible) and the pixel starts over.
+void validatePrimarySurface(ivec2 pixelCoords, float hitDistance, uint surfaceId)
+{
+    uvec2 stored = imageLoad(primarySurfaceImage, pixelCoords).xy;
+    if ((stored.y & kReprojectedFlag) != 0u) {
+        float expected = uintBitsToFloat(stored.x);
+        bool sameSurface = (stored.y & ~kReprojectedFlag) == surfaceId && surfaceId != 0u;
+        bool sameDistance = surfaceId != 0u && abs(hitDistance - expected) < 0.01 * expected;
+        if (!sameSurface && !sameDistance) {
+            imageStore(accumulationImage, pixelCoords, vec4(0.0));
+            imageStore(momentImage, pixelCoords, vec4(0.0));
+        }
+    }
+    imageStore(primarySurfaceImage, pixelCoords, uvec4(floatBitsToUint(hitDistance), surfaceId, 0u, 0u));
+}
+
+// Add one pass to the running mean and second moment, returns the new mean
+vec3 accumulate(ivec2 pixelCoords, vec3 color)
+{
+    vec4 prevAccum = imageLoad(accumulationImage, pixelCoords);
+    if (prevAccum.a >= RT_MAX_PASSES) {
+        return prevAccum.rgb;
+    }
+    float weight = 1.0 / (prevAccum.a + 1.0);
+    vec3 accumColor = mix(prevAccum.rgb, color, weight);
+
+    float lum = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    float moment = mix(imageLoad(momentImage, pixelCoords).r, lum * lum, weight);
+
+    imageStore(accumulationImage, pixelCoords, vec4(accumColor, prevAccum.a + 1.0));
+    imageStore(momentImage, pixelCoords, vec4(moment));
+    return accumColor;
+}
@@ -0,0 +1,181 @@
+// Ray / BVH intersection over the scene buffers (include gpu_scene.glsl first)
+
+// Traversal statistics (RT_TRAVERSAL_STATS, see RayTracingPipeline::setTraversalStats).
+// Each invocation counts privately and flushes once, 64-bit counters as lo/hi pairs.
+#ifdef RT_TRAVERSAL_STATS
+layout(std430, binding = 13) buffer TraversalStats {
+    uint statRaysLo;
+    uint statRaysHi;
+    uint statNodesLo;
+    uint statNodesHi;
+};
+
+uint traversalRays = 0u;
+uint traversalNodes = 0u;
+
+#define COUNT_TRAVERSAL_RAY() traversalRays++
+#define COUNT_TRAVERSAL_NODE() traversalNodes++
+
+void flushTraversalStats() {
+    if (traversalRays == 0u) {
+        return;
+    }
+    uint previous = atomicAdd(statRaysLo, traversalRays);
+    if (previous + traversalRays < previous) atomicAdd(statRaysHi, 1u);
+    previous = atomicAdd(statNodesLo, traversalNodes);
+    if (previous + traversalNodes < previous) atomicAdd(statNodesHi, 1u);
+    traversalRays = 0u;
+    traversalNodes = 0u;
+}
+#else
+#define COUNT_TRAVERSAL_RAY()
+#define COUNT_TRAVERSAL_NODE()
+void flushTraversalStats() {}
+#endif
+
+// Ray structure
+struct Ray {
+    vec3 origin;
+    vec3 direction;
+};
+
+// AABB intersection
+bool intersectAABB(Ray ray, vec3 boundsMin, vec3 boundsMax) {
+    vec3 invDir = 1.0 / ray.direction;
+    vec3 t0 = (boundsMin - ray.origin) * invDir;
+    vec3 t1 = (boundsMax - ray.origin) * invDir;
+    vec3 tmin = min(t0, t1);
+    vec3 tmax = max(t0, t1);
+    float tenter = max(max(tmin.x, tmin.y), tmin.z);
+    float texit = min(min(tmax.x, tmax.y), tmax.z);
+    return tenter <= texit && texit > 0.001;
+}
+
+// Helper: Interpolate and fix normal orientation
+vec3 interpolateNormal(vec3 n0, vec3 n1, vec3 n2, float u, float v, vec3 rayDir) {
+    float w = 1.0 - u - v;
+    vec3 normal = w * n0 + u * n1 + v * n2;
+    
+    // Normalize (important for interpolated normals)
+    float len = length(normal);
+    if (len > 0.001) {
+        normal = normal / len;
+    } else {
+        // Fallback to geometric normal if interpolation failed
+        return normalize(cross(n1 - n0, n2 - n0));
+    }
+    
+    // Ensure normal faces the ray (flip if back-facing)
+    if (dot(normal, rayDir) > 0.0) {
+        normal = -normal;
+    }
+    
+    return normal;
+}
+
+// Ray-Triangle intersection (Möller–Trumbore)
+// Returns barycentric coordinates for normal interpolation
+bool intersectTriangle(Ray ray, vec3 v0, vec3 v1, vec3 v2, out float t, out float u, out float v) {
+    vec3 e1 = v1 - v0;
+    vec3 e2 = v2 - v0;
+    vec3 p = cross(ray.direction, e2);
+    float det = dot(e1, p);
+    
+    if (abs(det) < 1e-6) return false;
+    
+    float invDet = 1.0 / det;
+    vec3 s = ray.origin - v0;
+    u = dot(s, p) * invDet;
+    if (u < 0.0 || u > 1.0) return false;
+    
+    vec3 q = cross(s, e1);
+    v = dot(ray.direction, q) * invDet;
+    if (v < 0.0 || u + v > 1.0) return false;
+    
+    t = dot(e2, q) * invDet;
+    if (t < 0.001) return false;
+    
+    return true;
+}
+
+// Closest hit BVH traversal, returns the triangle index and barycentrics
+bool traceClosest(Ray ray, out float tHit, out uint triIndex, out vec2 bary) {
+    tHit = 1e30;
+    triIndex = 0u;
+    bary = vec2(0.0);
+    bool found = false;
+    COUNT_TRAVERSAL_RAY();
+    
+    // Stack for traversal (no recursion on GPU)
+    int stack[64];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0;  // Start with root
+    
+    while (stackPtr > 0) {
+        int nodeIdx = stack[--stackPtr];
+        BVHNode node = nodes[nodeIdx];
+        COUNT_TRAVERSAL_NODE();
+        
+        // Test AABB
+        if (!intersectAABB(ray, node.boundsMin, node.boundsMax)) {
+            continue;
+        }
+        
+        if (node.triCount > 0) {
+            // Leaf node - test triangles
+            for (uint i = 0; i < node.triCount; i++) {
+                uint index = node.leftFirst + i;
+                GpuTriangle tri = triangles[index];
+                
+                float t, u, v;
+                if (intersectTriangle(ray, vertices[tri.v0].position, vertices[tri.v1].position,
+                                      vertices[tri.v2].position, t, u, v) && t < tHit) {
+                    found = true;
+                    tHit = t;
+                    triIndex = index;
+                    bary = vec2(u, v);
+                }
+            }
+        } else {
+            // Internal node - push children
+            if (stackPtr < 62) {  // Leave room for 2 children
+                stack[stackPtr++] = int(node.leftFirst);
+                stack[stackPtr++] = int(node.leftFirst) + 1;
+            }
+        }
+    }
+    
+    return found;
+}
+
+// Any hit closer than tMax (shadow rays), stops at the first one found
+bool traceAny(Ray ray, float tMax) {
+    COUNT_TRAVERSAL_RAY();
+    int stack[64];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0;
+    
+    while (stackPtr > 0) {
+        BVHNode node = nodes[stack[--stackPtr]];
+        COUNT_TRAVERSAL_NODE();
+        if (!intersectAABB(ray, node.boundsMin, node.boundsMax)) {
+            continue;
+        }
+        
+        if (node.triCount > 0) {
+            for (uint i = 0; i < node.triCount; i++) {
+                GpuTriangle tri = triangles[node.leftFirst + i];
+                float t, u, v;
+                if (intersectTriangle(ray, vertices[tri.v0].position, vertices[tri.v1].position,
+                                      vertices[tri.v2].position, t, u, v) && t < tMax) {
+                    return true;
+                }
+            }
+        } else if (stackPtr < 62) {
+            stack[stackPtr++] = int(node.leftFirst);
+            stack[stackPtr++] = int(node.leftFirst) + 1;
+        }
+    }
+    
+    return false;
+}
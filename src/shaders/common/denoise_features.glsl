@@ -0,0 +1,17 @@
+// Primary-hit feature buffers for the ray tracing denoiser (DenoisePass)
+//
+// Written by the ray tracing kernels for the first sample of a pixel:
+// world-space normal and hit distance from the camera (0 = sky), plus the
+// surface albedo the denoiser demodulates by.
+
+layout(rgba16f, binding = 4) uniform writeonly image2D featureNormalDepth;
+layout(rgba8, binding = 5) uniform writeonly image2D featureAlbedo;
+
+void writeFeatures(ivec2 pixelCoords, vec3 normal, float hitDistance, vec3 albedo) {
+    imageStore(featureNormalDepth, pixelCoords, vec4(normal, hitDistance));
+    imageStore(featureAlbedo, pixelCoords, vec4(albedo, 1.0));
+}
+
+void writeSkyFeatures(ivec2 pixelCoords) {
+    writeFeatures(pixelCoords, vec3(0.0), 0.0, vec3(1.0));
+}
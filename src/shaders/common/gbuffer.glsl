@@ -0,0 +1,48 @@
+// Thin G-Buffer packing shared by geometry.frag and the passes reading it
+//
+// Layout written by GBufferPass:
+//   GAlbedo   (RGBA8)  : albedo.rgb, AO
+//   GNormal   (RG16)   : world-space normal, octahedral encoded into [0, 1]
+//   GMaterial (RG8)    : metallic, roughness
+//   depth     (D32F)   : window-space depth, position is rebuilt from it
+//
+// Pixels the geometry pass did not touch keep the cleared depth of 1.0.
+
+// sign() that maps 0 to +1, so the octahedron folds stay continuous
+vec2 signNotZero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeNormalOct(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return e * 0.5 + 0.5;
+}
+
+vec3 decodeNormalOct(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    }
+    return normalize(n);
+}
+
+bool isBackground(float depth) {
+    return depth >= 1.0;
+}
+
+// Rebuild a position from screen uv and depth. With the inverse projection
+// the result is in view space, with the inverse view-projection in world space.
+vec3 reconstructPosition(vec2 uv, float depth, mat4 invMatrix) {
+    vec4 clip = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 p = invMatrix * clip;
+    return p.xyz / p.w;
+}
+
+// View-space position on the camera ray through uv at a positive view depth
+// (distance along -Z), for buffers that store linear depth
+vec3 reconstructFromViewDepth(vec2 uv, float viewDepth, mat4 invProjection) {
+    vec3 ray = reconstructPosition(uv, 1.0, invProjection);
+    return ray * (viewDepth / -ray.z);
+}
@@ -0,0 +1,57 @@
+// Scene buffers uploaded by RayTracingPipeline::uploadScene
+
+// Scene data structures (std430 layout)
+struct GpuVertex {
+    vec3 position;
+    float _pad0;
+    vec3 normal;
+    float _pad1;
+    vec2 uv;
+    vec2 _pad2;
+};
+
+struct GpuTriangle {
+    uint v0, v1, v2;
+    uint materialId;
+};
+
+struct BVHNode {
+    vec3 boundsMin;
+    uint leftFirst;
+    vec3 boundsMax;
+    uint triCount;
+};
+
+struct GpuMaterial {
+    vec3 albedo;
+    float metallic;
+    vec3 emissive;
+    float roughness;
+    float ao;
+    float opacity;
+    float emissiveStrength;
+    float _pad0;
+};
+
+// SSBOs
+layout(std430, binding = 1) buffer Vertices {
+    GpuVertex vertices[];
+};
+
+layout(std430, binding = 2) buffer Triangles {
+    GpuTriangle triangles[];
+};
+
+layout(std430, binding = 3) buffer BVHNodes {
+    BVHNode nodes[];
+};
+
+layout(std430, binding = 4) buffer Materials {
+    GpuMaterial materials[];
+};
+
+// Environment seen by rays that leave the scene
+vec3 skyColor(vec3 direction) {
+    float t = 0.5 * (2*direction.z + 2.0);
+    return (1.0 - t) * vec3(1.0, 1.0, 1.0) + t * vec3(0.5, 0.7, 1.0);
+}
@@ -0,0 +1,175 @@
+// Next-event estimation for the path tracers (lights built by LightSampler)
+//
+// Include after gpu_scene.glsl and sampler.glsl. Lights are picked through a
+// power-weighted alias table. Emissive triangles can also be hit by BSDF
+// rays, so both strategies are combined with the power heuristic; point,
+// spot, directional and rect lights are not part of the geometry and are
+// only reached through light sampling.
+
+// Light types, must match LightSampler.h
+#define LIGHT_DIRECTIONAL 0u
+#define LIGHT_POINT       1u
+#define LIGHT_SPOT        2u
+#define LIGHT_AREA        3u
+#define LIGHT_TRIANGLE    4u
+
+const float INV_PI = 0.31830988618;
+
+struct GpuLight {
+    vec3 position;
+    uint type;
+    vec3 direction;
+    uint index;         // Triangle index, or two-sided flag for area lights
+    vec3 radiance;
+    float cosInner;
+    vec3 tangent;
+    float cosOuter;
+    vec3 bitangent;
+    float area;
+};
+
+struct AliasEntry {
+    float probability;
+    uint alias;
+    float pdf;
+    uint _pad0;
+};
+
+layout(std430, binding = 10) buffer Lights {
+    GpuLight lights[];
+};
+
+layout(std430, binding = 11) buffer LightAliasTable {
+    AliasEntry lightAlias[];
+};
+
+uniform uint lightCount;
+uniform float lightWeightTotal;
+
+// Result of sampling one light from a shading point
+struct LightSample {
+    vec3 direction;
+    float distance;     // tMax for the shadow ray
+    vec3 radiance;      // Le * cos / pdf, MIS weight applied; times the BRDF gives the contribution
+};
+
+float powerHeuristic(float pdfA, float pdfB) {
+    float a = pdfA * pdfA;
+    return a / (a + pdfB * pdfB);
+}
+
+// Must match LightSampler::triangleWeight
+float triangleLightWeight(GpuMaterial mat, float area) {
+    return dot(mat.emissive * mat.emissiveStrength, vec3(0.2126, 0.7152, 0.0722)) * area;
+}
+
+// Solid angle pdf of light sampling reaching `point` on an emissive triangle from `origin`
+float triangleLightPdf(uint triIndex, vec3 origin, vec3 point) {
+    GpuTriangle tri = triangles[triIndex];
+    vec3 p0 = vertices[tri.v0].position;
+    vec3 cr = cross(vertices[tri.v1].position - p0, vertices[tri.v2].position - p0);
+    float area = 0.5 * length(cr);
+    
+    vec3 toPoint = point - origin;
+    float dist2 = dot(toPoint, toPoint);
+    float cosLight = abs(dot(normalize(cr), normalize(toPoint)));
+    if (area <= 0.0 || cosLight <= 0.0 || lightWeightTotal <= 0.0) {
+        return 0.0;
+    }
+    
+    float selectPdf = triangleLightWeight(materials[tri.materialId], area) / lightWeightTotal;
+    return selectPdf * dist2 / (cosLight * area);
+}
+
+// MIS weight for emission found by a BSDF ray; bsdfPdf 0 marks camera rays
+// and specular bounces, which light sampling cannot produce
+float emissionMisWeight(uint triIndex, vec3 origin, vec3 point, float bsdfPdf) {
+    if (bsdfPdf <= 0.0 || lightCount == 0u) {
+        return 1.0;
+    }
+    return powerHeuristic(bsdfPdf, triangleLightPdf(triIndex, origin, point));
+}
+
+// Pick a light and a point on it for a diffuse surface. The BSDF pdf of the
+// returned direction is cos/pi, used for the MIS weight of triangle lights.
+bool sampleLight(vec3 point, vec3 normal, out LightSample ls) {
+    ls.direction = vec3(0.0);
+    ls.distance = 0.0;
+    ls.radiance = vec3(0.0);
+    if (lightCount == 0u) {
+        return false;
+    }
+    
+    // Alias table lookup
+    float u = sample1D() * float(lightCount);
+    uint slot = min(uint(u), lightCount - 1u);
+    uint index = (u - float(slot)) < lightAlias[slot].probability ? slot : lightAlias[slot].alias;
+    float selectPdf = lightAlias[index].pdf;
+    GpuLight light = lights[index];
+    
+    vec3 radiance = light.radiance;
+    float pdf = selectPdf;      // Solid angle pdf, delta lights only the selection
+    bool area = false;
+    
+    if (light.type == LIGHT_DIRECTIONAL) {
+        ls.direction = -light.direction;
+        ls.distance = 1e30;
+    } else if (light.type == LIGHT_POINT || light.type == LIGHT_SPOT) {
+        vec3 toLight = light.position - point;
+        float dist2 = dot(toLight, toLight);
+        ls.distance = sqrt(dist2);
+        ls.direction = toLight / ls.distance;
+        radiance /= dist2;
+        if (light.type == LIGHT_SPOT) {
+            float cosAngle = dot(-ls.direction, light.direction);
+            radiance *= smoothstep(light.cosOuter, light.cosInner, cosAngle);
+        }
+    } else {
+        vec2 u2 = sample2D();
+        vec3 lightPoint;
+        vec3 lightNormal;
+        if (light.type == LIGHT_AREA) {
+            lightPoint = light.position + (u2.x - 0.5) * light.tangent + (u2.y - 0.5) * light.bitangent;
+            lightNormal = light.direction;
+        } else {
+            // Uniform point on the triangle
+            GpuTriangle tri = triangles[light.index];
+            vec3 p0 = vertices[tri.v0].position;
+            vec3 p1 = vertices[tri.v1].position;
+            vec3 p2 = vertices[tri.v2].position;
+            float su = sqrt(u2.x);
+            float b1 = u2.y * su;
+            lightPoint = (1.0 - su) * p0 + b1 * p1 + (su - b1) * p2;
+            lightNormal = normalize(cross(p1 - p0, p2 - p0));
+            GpuMaterial mat = materials[tri.materialId];
+            radiance = mat.emissive * mat.emissiveStrength;
+        }
+        
+        vec3 toLight = lightPoint - point;
+        float dist2 = dot(toLight, toLight);
+        float dist = sqrt(dist2);
+        ls.direction = toLight / dist;
+        ls.distance = dist * 0.999;     // Stop short of the emitter itself
+        
+        float cosLight = dot(lightNormal, -ls.direction);
+        if (light.type == LIGHT_TRIANGLE || light.index != 0u) {
+            cosLight = abs(cosLight);
+        }
+        if (cosLight <= 0.0) {
+            return false;
+        }
+        pdf = selectPdf * dist2 / (cosLight * light.area);
+        area = light.type == LIGHT_TRIANGLE;
+    }
+    
+    float cosSurface = dot(normal, ls.direction);
+    if (cosSurface <= 0.0 || pdf <= 0.0) {
+        return false;
+    }
+    
+    ls.radiance = radiance * cosSurface / pdf;
+    if (area) {
+        ls.radiance *= powerHeuristic(pdf, cosSurface * INV_PI);
+    }
+    return any(greaterThan(ls.radiance, vec3(0.0)));
+}
@@ -0,0 +1,48 @@
+// Light structures and uniforms, uploaded by ForwardPipeline and LightingPass
+
+struct DirectionalLight {
+    vec3 direction;
+    vec3 color;
+    float intensity;
+};
+
+struct PointLight {
+    vec3 position;
+    vec3 color;
+    float intensity;
+    float constant;
+    float linear;
+    float quadratic;
+    float radius;
+    float range;        // Fade-out distance of the deferred passes, includes radius, 0 = none
+    int shadowView;     // First view in the shadow atlas, -1 = none (USE_LOCAL_SHADOWS)
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+    float intensity;
+    float innerConeAngle;
+    float outerConeAngle;
+    float constant;
+    float linear;
+    float quadratic;
+    float range;        // Fade-out distance of the deferred passes, 0 = none
+    int shadowView;     // View in the shadow atlas, -1 = none (USE_LOCAL_SHADOWS)
+};
+
+// Light arrays
+#define MAX_DIR_LIGHTS 4
+#define MAX_POINT_LIGHTS 8
+#define MAX_SPOT_LIGHTS 4
+
+uniform int numDirLights;
+uniform int numPointLights;
+uniform int numSpotLights;
+
+uniform DirectionalLight dirLights[MAX_DIR_LIGHTS];
+uniform PointLight pointLights[MAX_POINT_LIGHTS];
+uniform SpotLight spotLights[MAX_SPOT_LIGHTS];
+
+uniform vec3 ambientLight;
@@ -0,0 +1,25 @@
+// Material uniforms, matching MaterialBinder
+//
+// Texture maps are compile-time permutations: MaterialBinder::permutation()
+// defines HAS_ALBEDO_MAP etc. for the maps a material actually has, so the
+// unused sampling paths are compiled out instead of branched over.
+
+struct Material {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+    vec3 emissive;
+    float emissiveStrength;
+    float opacity;
+};
+
+uniform Material material;
+
+// Texture samplers (units 0-5)
+uniform sampler2D albedoMap;
+uniform sampler2D metallicMap;
+uniform sampler2D roughnessMap;
+uniform sampler2D normalMap;
+uniform sampler2D aoMap;
+uniform sampler2D emissiveMap;
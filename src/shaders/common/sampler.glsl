@@ -0,0 +1,132 @@
+// Low-discrepancy sampling for the path tracers (tables from SamplerTables)
+//
+// Every call draws one "dimension set" from a 2D Sobol (0,2)-sequence with
+// hash-based Owen scrambling (Burley 2020). Each set shuffles the sample
+// index with its own seed, so padding sets stay decorrelated. All pixels
+// share the sequence and are offset by a toroidal shift taken from a blue
+// noise tile, which spreads the remaining error as blue noise on screen.
+// Mappings to directions are closed-form, no rejection loops.
+
+#define SOBOL_DIMENSIONS 2
+#define BLUE_NOISE_SIZE 64
+
+// Dimension sets reserved per bounce, set 0 is the camera jitter
+#define SAMPLER_BOUNCE_DIMENSIONS 8u
+
+layout(std430, binding = 12) readonly buffer SamplerTables {
+    uint sobolMatrices[SOBOL_DIMENSIONS * 32];
+    float blueNoise[BLUE_NOISE_SIZE * BLUE_NOISE_SIZE];
+};
+
+const float PI = 3.14159265359;
+
+// Sampler state of the current invocation
+uint samplerIndex;      // Sample number within the pixel's sequence
+ivec2 samplerPixel;
+uint samplerDimension;  // Next dimension set
+
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+void samplerInit(ivec2 pixel, uint sampleIndex) {
+    samplerPixel = pixel;
+    samplerIndex = sampleIndex;
+    samplerDimension = 0u;
+}
+
+// Paths always use the same sets for the same bounce, whichever kernel traces them
+void samplerBeginBounce(uint bounce) {
+    samplerDimension = 1u + bounce * SAMPLER_BOUNCE_DIMENSIONS;
+}
+
+uint sobol(uint index, uint dimension) {
+    uint result = 0u;
+    for (uint bit = 0u; index != 0u; index >>= 1u, bit++) {
+        if ((index & 1u) != 0u) {
+            result ^= sobolMatrices[dimension * 32u + bit];
+        }
+    }
+    return result;
+}
+
+uint laineKarrasPermutation(uint x, uint seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint nestedUniformScramble(uint x, uint seed) {
+    return bitfieldReverse(laineKarrasPermutation(bitfieldReverse(x), seed));
+}
+
+float blueNoiseAt(ivec2 p) {
+    p &= ivec2(BLUE_NOISE_SIZE - 1);
+    return blueNoise[p.y * BLUE_NOISE_SIZE + p.x];
+}
+
+// Each dimension reads the tile at its own R2-sequence offset
+float blueNoiseShift(uint dimension) {
+    vec2 offset = fract(vec2(0.7548776662, 0.5698402910) * float(dimension + 1u));
+    return blueNoiseAt(samplerPixel + ivec2(offset * float(BLUE_NOISE_SIZE)));
+}
+
+// 24 bits keep the result strictly below 1
+float toUnitFloat(uint x) {
+    return float(x >> 8u) * (1.0 / 16777216.0);
+}
+
+vec2 sample2D() {
+    uint set = samplerDimension++;
+    uint seed = hash(set);
+    uint index = nestedUniformScramble(samplerIndex, seed);
+    
+    vec2 u = vec2(toUnitFloat(nestedUniformScramble(sobol(index, 0u), hash(seed ^ 0x5bd1e995u))),
+                  toUnitFloat(nestedUniformScramble(sobol(index, 1u), hash(seed ^ 0x27d4eb2du))));
+    return fract(u + vec2(blueNoiseShift(2u * set), blueNoiseShift(2u * set + 1u)));
+}
+
+float sample1D() {
+    uint set = samplerDimension++;
+    uint seed = hash(set);
+    uint index = nestedUniformScramble(samplerIndex, seed);
+    
+    float u = toUnitFloat(nestedUniformScramble(sobol(index, 0u), hash(seed ^ 0x5bd1e995u)));
+    return fract(u + blueNoiseShift(2u * set));
+}
+
+// Uniform point inside the unit sphere
+vec3 sampleInUnitSphere() {
+    vec2 u = sample2D();
+    float z = 1.0 - 2.0 * u.x;
+    float r = sqrt(max(0.0, 1.0 - z * z));
+    float phi = 2.0 * PI * u.y;
+    return vec3(r * cos(phi), r * sin(phi), z) * pow(sample1D(), 1.0 / 3.0);
+}
+
+vec3 sampleHemisphereCosine(vec3 N) {
+    vec2 u = sample2D();
+
+    float phi = 2.0 * PI * u.x;
+    float r = sqrt(u.y);
+
+    vec3 local = vec3(
+        r * cos(phi),
+        r * sin(phi),
+        sqrt(1.0 - u.y)
+    );
+
+    // transform to world space (TBN)
+    vec3 T = normalize(cross(abs(N.y) < 0.99 ? vec3(0,1,0) : vec3(1,0,0), N));
+    vec3 B = cross(N, T);
+
+    return normalize(local.x * T + local.y * B + local.z * N);
+}
@@ -0,0 +1,134 @@
+// Shadow lookups shared by the deferred lighting shaders
+//
+// Cascaded directional shadows are only compiled in the USE_SHADOWS
+// permutation; the passes bind the texture array written by ShadowMapPass to
+// texture unit 5 (ShadowCascades::bind). Point and spot light shadows from
+// ShadowAtlasPass are the USE_LOCAL_SHADOWS permutation, atlas on unit 6
+// (LocalShadows::bind).
+
+#ifdef USE_SHADOWS
+#define MAX_CASCADES 4              // ShadowCascades::kMaxCascades
+
+uniform sampler2DArray shadowMap;   // One layer per cascade
+uniform mat4 lightSpaceMatrices[MAX_CASCADES];
+uniform float cascadeTexelSizes[MAX_CASCADES];  // World-space texel size per cascade
+uniform int cascadeCount;
+
+// Shadow calculation with PCF (Percentage Closer Filtering)
+float calculateShadow(vec3 worldPos, vec3 normal, vec3 lightDir)
+{
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+
+    // Cascades are ordered near to far, the first one covering the point
+    // (including the PCF footprint) has the finest texels
+    for (int i = 0; i < cascadeCount && i < MAX_CASCADES; ++i) {
+        // Offset along the normal by the cascade's texel size against acne
+        vec3 offsetPos = worldPos + normal * cascadeTexelSizes[i] * 1.5;
+        vec4 fragPosLightSpace = lightSpaceMatrices[i] * vec4(offsetPos, 1.0);
+        vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w * 0.5 + 0.5;
+
+        if (projCoords.z > 1.0 ||
+            any(lessThan(projCoords.xy, texelSize * 1.5)) ||
+            any(greaterThan(projCoords.xy, 1.0 - texelSize * 1.5))) {
+            continue;
+        }
+
+        // Slope-scaled bias on top of the normal offset
+        float bias = max(0.002 * (1.0 - dot(normal, lightDir)), 0.0005);
+        float currentDepth = projCoords.z;
+
+        float shadow = 0.0;
+        for (int x = -1; x <= 1; ++x)
+        {
+            for (int y = -1; y <= 1; ++y)
+            {
+                float pcfDepth = texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, float(i))).r;
+                shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+            }
+        }
+        return shadow / 9.0;
+    }
+
+    // Beyond the shadow distance
+    return 0.0;
+}
+#endif
+
+#ifdef USE_LOCAL_SHADOWS
+#define MAX_SHADOW_VIEWS 64         // LocalShadows::kMaxViews
+
+uniform sampler2D shadowAtlas;      // Depth tiles of all shadow views
+
+// One perspective view per spot light, six (cube faces +X, -X, +Y, -Y, +Z,
+// -Z) per point light; the light's shadowView indexes the first one
+layout(std140) uniform ShadowAtlasViews {
+    mat4 shadowViewMatrices[MAX_SHADOW_VIEWS];
+    vec4 shadowViewRects[MAX_SHADOW_VIEWS];     // Atlas uv offset xy, scale zw
+    vec4 shadowViewParams[MAX_SHADOW_VIEWS];    // Texel size per unit depth, near, far
+};
+
+// Shadow of one view with 3x3 PCF, 0 outside its frustum
+float calculateViewShadow(int view, vec3 worldPos, vec3 normal)
+{
+    vec4 params = shadowViewParams[view];
+
+    // Texels grow with distance from the light, so does the normal offset
+    float texelWorld = params.x * (shadowViewMatrices[view] * vec4(worldPos, 1.0)).w;
+    vec4 clip = shadowViewMatrices[view] * vec4(worldPos + normal * texelWorld * 1.5, 1.0);
+    if (clip.w <= params.y || clip.w >= params.z) {
+        return 0.0;
+    }
+
+    vec2 ndc = clip.xy / clip.w;
+    if (any(greaterThan(abs(ndc), vec2(1.0)))) {
+        return 0.0;
+    }
+
+    // Keep the PCF footprint inside the view's tile
+    vec4 rect = shadowViewRects[view];
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 uv = clamp(rect.xy + (ndc * 0.5 + 0.5) * rect.zw, rect.xy + texelSize * 1.5, rect.xy + rect.zw - texelSize * 1.5);
+
+    // Compare linear depths, the stored perspective depth is far from uniform
+    float nearZ = params.y;
+    float farZ = params.z;
+    float currentDepth = clip.w - texelWorld;
+
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; ++x)
+    {
+        for (int y = -1; y <= 1; ++y)
+        {
+            float depth = texture(shadowAtlas, uv + vec2(x, y) * texelSize).r;
+            float occluderDepth = nearZ * farZ / (farZ - depth * (farZ - nearZ));
+            shadow += currentDepth > occluderDepth ? 1.0 : 0.0;
+        }
+    }
+    return shadow / 9.0;
+}
+
+float calculateSpotShadow(int view, vec3 worldPos, vec3 normal)
+{
+    return view >= 0 ? calculateViewShadow(view, worldPos, normal) : 0.0;
+}
+
+// Picks the cube face by the major axis of the light-to-point vector
+float calculatePointShadow(int firstView, vec3 lightPos, vec3 worldPos, vec3 normal)
+{
+    if (firstView < 0) {
+        return 0.0;
+    }
+
+    vec3 d = worldPos - lightPos;
+    vec3 a = abs(d);
+    int face;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = d.x >= 0.0 ? 0 : 1;
+    } else if (a.y >= a.z) {
+        face = d.y >= 0.0 ? 2 : 3;
+    } else {
+        face = d.z >= 0.0 ? 4 : 5;
+    }
+    return calculateViewShadow(firstView + face, worldPos, normal);
+}
+#endif
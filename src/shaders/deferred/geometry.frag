@@ -7,49 +7,23 @@ in vec3 Tangent;
 in vec3 Bitangent;
 
 // G-Buffer outputs
-layout(location = 0) out vec4 GAlbedo;      // RGB: albedo, A: unused
-layout(location = 1) out vec4 GNormal;      // RGB: normal (world space), A: unused
-layout(location = 2) out vec4 GPosition;    // RGB: position (world space), A: unused
-layout(location = 3) out vec4 GMaterial;    // R: metallic, G: roughness, B: AO, A: unused
+layout(location = 0) out vec4 GAlbedo;      // RGB: albedo, A: AO
+layout(location = 1) out vec2 GNormal;      // RG: octahedral normal (world space)
+layout(location = 2) out vec2 GMaterial;    // R: metallic, G: roughness
 
-// Material properties
-struct Material {
-    vec3 albedo;
-    float metallic;
-    float roughness;
-    float ao;
-    vec3 emissive;
-    float emissiveStrength;
-    float opacity;
-};
+#include "../common/material.glsl"
+#include "../common/gbuffer.glsl"
 
-uniform Material material;
 uniform vec3 viewPos;
-
-// Texture samplers
-uniform sampler2D albedoMap;
-uniform sampler2D metallicMap;
-uniform sampler2D roughnessMap;
-uniform sampler2D normalMap;
-uniform sampler2D aoMap;
-uniform sampler2D emissiveMap;
-
-// Flags to indicate if textures are bound
-uniform bool hasAlbedoMap;
-uniform bool hasMetallicMap;
-uniform bool hasRoughnessMap;
-uniform bool hasNormalMap;
-uniform bool hasAOMap;
-uniform bool hasEmissiveMap;
-
 uniform mat4 uView;
 
 // Proper normal mapping using TBN
 vec3 getNormal()
 {
     vec3 n = normalize(Normal);
-    if (!hasNormalMap) return n;
-    
+#ifndef HAS_NORMAL_MAP
+    return n;
+#else
     vec3 t = normalize(Tangent);
     vec3 b = normalize(Bitangent);
     mat3 TBN = mat3(t, b, n);
@@ -57,40 +31,40 @@ vec3 getNormal()
     vec3 sampleN = texture(normalMap, TexCoord).rgb;
     sampleN = normalize(sampleN * 2.0 - 1.0);
     return normalize(TBN * sampleN);
+#endif
 }
 
 void main()
 {
     // Sample albedo
     vec3 albedo = material.albedo;
-    if (hasAlbedoMap) {
-        albedo = texture(albedoMap, TexCoord).rgb;
-    }
+#ifdef HAS_ALBEDO_MAP
+    albedo = texture(albedoMap, TexCoord).rgb;
+#endif
     
     // Sample metallic
     float metallic = material.metallic;
-    if (hasMetallicMap) {
-        metallic = texture(metallicMap, TexCoord).g;
-    }
+#ifdef HAS_METALLIC_MAP
+    metallic = texture(metallicMap, TexCoord).g;
+#endif
     
     // Sample roughness
     float roughness = material.roughness;
-    if (hasRoughnessMap) {
-        roughness = texture(roughnessMap, TexCoord).g;
-    }
+#ifdef HAS_ROUGHNESS_MAP
+    roughness = texture(roughnessMap, TexCoord).g;
+#endif
     
     // Sample AO
     float ao = material.ao;
-    if (hasAOMap) {
-        ao = texture(aoMap, TexCoord).r;
-    }
+#ifdef HAS_AO_MAP
+    ao = texture(aoMap, TexCoord).r;
+#endif
     
     // Get normal with normal mapping support
     vec3 normal = getNormal();
     
-    // Store in G-Buffer (world space normal)
-    GAlbedo = vec4(albedo, 1.0);
-    GNormal = vec4(normalize(normal), 1.0);
-    GPosition = vec4(FragPos, 1.0);
-    GMaterial = vec4(metallic, roughness, ao, 1.0);
+    // Store in G-Buffer (world space normal, position comes from depth)
+    GAlbedo = vec4(albedo, ao);
+    GNormal = encodeNormalOct(normalize(normal));
+    GMaterial = vec2(metallic, roughness);
 }
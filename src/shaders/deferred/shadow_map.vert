@@ -3,9 +3,35 @@
 layout(location = 0) in vec3 aPos;
 
 uniform mat4 lightSpaceMatrix;
+
+#ifdef DEPTH_INSTANCED
+// Model matrices of a DepthBatch, four texels (columns) per instance
+uniform samplerBuffer instanceTransforms;
+uniform int instanceOffset;
+
+mat4 modelMatrix()
+{
+    int base = (instanceOffset + gl_InstanceID) * 4;
+    return mat4(texelFetch(instanceTransforms, base),
+                texelFetch(instanceTransforms, base + 1),
+                texelFetch(instanceTransforms, base + 2),
+                texelFetch(instanceTransforms, base + 3));
+}
+#else
 uniform mat4 model;
 
+mat4 modelMatrix()
+{
+    return model;
+}
+#endif
+
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+#ifdef SHADOW_ATLAS
+    // World position, shadow_atlas.geom projects it once per shadow view
+    gl_Position = modelMatrix() * vec4(aPos, 1.0);
+#else
+    gl_Position = lightSpaceMatrix * modelMatrix() * vec4(aPos, 1.0);
+#endif
 }
@@ -1,24 +1,168 @@
 #version 330 core
 
-in vec2 TexCoord;
+// SSAO filtering, one permutation per step of SSAOPass:
+//   SSAO_PREPARE  : G-Buffer depth/normal -> view normal + view depth at the
+//                   SSAO resolution (closest texel of each footprint); with
+//                   NORMALS_FROM_DEPTH (forward depth pre-pass, no G-Buffer)
+//                   the normal is reconstructed from neighbouring depths
+//   (default)     : separable depth-aware blur, one axis per draw
+//   SSAO_UPSAMPLE : joint bilateral upsample to full resolution, guided by
+//                   the full resolution depth
+
+#include "../common/gbuffer.glsl"
+
+uniform sampler2D gDepthNormal;     // Prepared view normal + view depth (SSAO resolution)
+
+#if defined(SSAO_PREPARE)
+
+out vec4 FragColor;
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform mat4 invProjection;
+uniform mat4 view;
+uniform int downsample;             // Full resolution texels per SSAO texel, per axis
+
+#ifdef NORMALS_FROM_DEPTH
+vec3 viewPositionAt(ivec2 p, ivec2 fullSize)
+{
+    p = clamp(p, ivec2(0), fullSize - 1);
+    vec2 uv = (vec2(p) + 0.5) / vec2(fullSize);
+    return reconstructPosition(uv, texelFetch(gDepth, p, 0).r, invProjection);
+}
+
+// Per axis the neighbour with the smaller depth step is taken, so normals
+// at silhouettes come from the surface the pixel belongs to
+vec3 reconstructNormal(ivec2 p, ivec2 fullSize)
+{
+    vec3 center = viewPositionAt(p, fullSize);
+    vec3 right = viewPositionAt(p + ivec2(1, 0), fullSize) - center;
+    vec3 left = center - viewPositionAt(p - ivec2(1, 0), fullSize);
+    vec3 up = viewPositionAt(p + ivec2(0, 1), fullSize) - center;
+    vec3 down = center - viewPositionAt(p - ivec2(0, 1), fullSize);
+    vec3 dx = abs(right.z) < abs(left.z) ? right : left;
+    vec3 dy = abs(up.z) < abs(down.z) ? up : down;
+    return normalize(cross(dx, dy));
+}
+#endif
+
+void main()
+{
+    ivec2 fullSize = textureSize(gDepth, 0);
+    ivec2 base = ivec2(gl_FragCoord.xy) * downsample;
+
+    // Keep the closest surface of the footprint so thin foreground stays occluded
+    float bestDepth = 1.0;
+    ivec2 best = min(base, fullSize - 1);
+    for (int y = 0; y < downsample; ++y) {
+        for (int x = 0; x < downsample; ++x) {
+            ivec2 p = min(base + ivec2(x, y), fullSize - 1);
+            float d = texelFetch(gDepth, p, 0).r;
+            if (d < bestDepth) {
+                bestDepth = d;
+                best = p;
+            }
+        }
+    }
+
+    if (isBackground(bestDepth)) {
+        FragColor = vec4(0.0);
+        return;
+    }
+
+    vec2 uv = (vec2(best) + 0.5) / vec2(fullSize);
+    float viewDepth = -reconstructPosition(uv, bestDepth, invProjection).z;
+#ifdef NORMALS_FROM_DEPTH
+    vec3 normal = reconstructNormal(best, fullSize);
+#else
+    vec3 normal = normalize(mat3(view) * decodeNormalOct(texelFetch(gNormal, best, 0).rg));
+#endif
+    FragColor = vec4(normal, viewDepth);
+}
+
+#elif defined(SSAO_UPSAMPLE)
+
 out float FragColor;
 
-uniform sampler2D ssaoInput;
+uniform sampler2D ssaoInput;        // Blurred AO at the SSAO resolution
+uniform sampler2D gDepth;           // Full resolution depth
+uniform mat4 invProjection;
 
-void main() 
+void main()
 {
-    vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 fullSize = textureSize(gDepth, 0);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (isBackground(depth)) {
+        FragColor = 1.0;
+        return;
+    }
+
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(fullSize);
+    float viewDepth = -reconstructPosition(uv, depth, invProjection).z;
+
+    // Bilinear weights of the four surrounding low resolution texels, scaled
+    // down where their depth differs from this pixel
+    ivec2 lowSize = textureSize(ssaoInput, 0);
+    vec2 lowPos = uv * vec2(lowSize) - 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = lowPos - vec2(base);
+
     float result = 0.0;
-    
-    // Simple 4x4 box blur
-    for (int x = -2; x < 2; ++x) 
-    {
-        for (int y = -2; y < 2; ++y) 
-        {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(ssaoInput, TexCoord + offset).r;
+    float weightSum = 0.0;
+    float nearestDiff = 1e30;
+    float nearestAO = 1.0;
+    for (int i = 0; i < 4; ++i) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 q = clamp(base + offset, ivec2(0), lowSize - 1);
+        float bilinear = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+
+        float lowDepth = texelFetch(gDepthNormal, q, 0).a;
+        float ao = texelFetch(ssaoInput, q, 0).r;
+        float diff = lowDepth > 0.0 ? abs(lowDepth - viewDepth) / viewDepth : 1e30;
+        float weight = bilinear * exp(-diff * 50.0);
+
+        result += ao * weight;
+        weightSum += weight;
+        if (diff < nearestDiff) {
+            nearestDiff = diff;
+            nearestAO = ao;
         }
     }
-    
-    FragColor = result / 16.0;
+
+    // No neighbour on this surface (silhouettes): take the closest match
+    FragColor = weightSum > 1e-4 ? result / weightSum : nearestAO;
+}
+
+#else
+
+out float FragColor;
+
+uniform sampler2D ssaoInput;
+uniform vec2 blurDirection;         // (1, 0) or (0, 1)
+
+void main()
+{
+    // 7-tap Gaussian (sigma 2), weighted down across depth discontinuities
+    const float kernel[4] = float[](1.0, 0.8825, 0.6065, 0.3247);
+
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(ssaoInput, 0);
+    ivec2 stepDir = ivec2(blurDirection);
+    float centerDepth = texelFetch(gDepthNormal, pixel, 0).a;
+
+    float result = 0.0;
+    float weightSum = 0.0;
+    for (int i = -3; i <= 3; ++i) {
+        ivec2 q = clamp(pixel + stepDir * i, ivec2(0), size - 1);
+        float sampleDepth = texelFetch(gDepthNormal, q, 0).a;
+        float diff = abs(sampleDepth - centerDepth) / max(centerDepth, 1e-3);
+        float weight = kernel[abs(i)] * exp(-diff * 50.0);
+        result += texelFetch(ssaoInput, q, 0).r * weight;
+        weightSum += weight;
+    }
+
+    FragColor = result / max(weightSum, 1e-4);
 }
+
+#endif
@@ -8,147 +8,16 @@ in vec3 Bitangent;
 
 out vec4 FragColor;
 
-// Material properties
-struct Material {
-    vec3 albedo;
-    float metallic;
-    float roughness;
-    float ao;
-    vec3 emissive;
-    float emissiveStrength;
-    float opacity;
-};
+#include "../common/material.glsl"
+#include "../common/lights.glsl"
+#include "../common/pbr.glsl"
 
-// Light structure definitions
-struct DirectionalLight {
-    vec3 direction;
-    vec3 color;
-    float intensity;
-};
-
-struct PointLight {
-    vec3 position;
-    vec3 color;
-    float intensity;
-    float constant;
-    float linear;
-    float quadratic;
-    float radius;
-};
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    vec3 color;
-    float intensity;
-    float innerConeAngle;
-    float outerConeAngle;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-uniform Material material;
 uniform vec3 viewPos;
 
-// Texture samplers (0 = no texture)
-uniform sampler2D albedoMap;
-uniform sampler2D metallicMap;
-uniform sampler2D roughnessMap;
-uniform sampler2D normalMap;
-uniform sampler2D aoMap;
-uniform sampler2D emissiveMap;
-
-// Flags to indicate if textures are bound
-uniform bool hasAlbedoMap;
-uniform bool hasMetallicMap;
-uniform bool hasRoughnessMap;
-uniform bool hasNormalMap;
-uniform bool hasAOMap;
-uniform bool hasEmissiveMap;
-
-// Light arrays
-#define MAX_DIR_LIGHTS 4
-#define MAX_POINT_LIGHTS 8
-#define MAX_SPOT_LIGHTS 4
-
-uniform int numDirLights;
-uniform int numPointLights;
-uniform int numSpotLights;
-
-uniform DirectionalLight dirLights[MAX_DIR_LIGHTS];
-uniform PointLight pointLights[MAX_POINT_LIGHTS];
-uniform SpotLight spotLights[MAX_SPOT_LIGHTS];
-
-uniform vec3 ambientLight;
-
-const float PI = 3.14159265359;
-
-// Fresnel-Schlick approximation
-vec3 fresnelSchlick(float cosTheta, vec3 F0)
-{
-    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-}
-
-// Normal Distribution Function (GGX/Trowbridge-Reitz)
-float distributionGGX(vec3 N, vec3 H, float roughness)
-{
-    float a = roughness * roughness;
-    float a2 = a * a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH * NdotH;
-    
-    float nom = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
-    
-    return nom / max(denom, 0.0001);
-}
-
-// Geometry function (Smith's method)
-float geometrySchlickGGX(float NdotV, float roughness)
-{
-    float r = (roughness + 1.0);
-    float k = (r * r) / 8.0;
-    
-    float nom = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-    
-    return nom / max(denom, 0.0001);
-}
-
-float geometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
-{
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-    float ggx2 = geometrySchlickGGX(NdotV, roughness);
-    float ggx1 = geometrySchlickGGX(NdotL, roughness);
-    
-    return ggx1 * ggx2;
-}
-
-// Calculate lighting contribution for a single light
-vec3 calculateLighting(vec3 L, vec3 radiance, vec3 N, vec3 V, vec3 F0, float roughness, float metallic, vec3 albedo)
-{
-    vec3 H = normalize(V + L);
-    
-    // Cook-Torrance BRDF
-    float NDF = distributionGGX(N, H, roughness);
-    float G = geometrySmith(N, V, L, roughness);
-    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
-    
-    vec3 numerator = NDF * G * F;
-    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
-    vec3 specular = numerator / denominator;
-    
-    // Energy conservation
-    vec3 kS = F;
-    vec3 kD = vec3(1.0) - kS;
-    kD *= 1.0 - metallic;
-    
-    float NdotL = max(dot(N, L), 0.0);
-    return (kD * albedo / PI + specular) * radiance * NdotL;
-}
+// Screen-space AO from the depth pre-pass (USE_SSAO permutation, unit 6)
+#ifdef USE_SSAO
+uniform sampler2D ssaoTexture;
+#endif
 
 // Calculate directional light contribution
 vec3 calcDirectionalLight(DirectionalLight light, vec3 N, vec3 V, vec3 F0, float roughness, float metallic, vec3 albedo)
@@ -226,10 +95,10 @@ void main()
     vec3 V = normalize(viewPos - FragPos);
     
     // Apply normal mapping if available
-    if (hasNormalMap) {
-        vec3 normalSample = texture(normalMap, TexCoord).rgb;
-        N = applyNormalMapping(N, normalSample);
-    }
+#ifdef HAS_NORMAL_MAP
+    vec3 normalSample = texture(normalMap, TexCoord).rgb;
+    N = applyNormalMapping(N, normalSample);
+#endif
     
     // Sample textures and override material properties
     vec3 albedo = material.albedo;
@@ -240,34 +109,34 @@ void main()
     float emissiveStrength = material.emissiveStrength;
     
     // Albedo texture (RGB)
-    if (hasAlbedoMap) {
-        vec4 albedoSample = texture(albedoMap, TexCoord);
-        albedo = albedoSample.rgb;
-    }
+#ifdef HAS_ALBEDO_MAP
+    vec4 albedoSample = texture(albedoMap, TexCoord);
+    albedo = albedoSample.rgb;
+#endif
     
     // Metallic texture (R channel, grayscale)
-    if (hasMetallicMap) {
-        vec4 metallicSample = texture(metallicMap, TexCoord);
-        metallic = metallicSample.b;
-    }
+#ifdef HAS_METALLIC_MAP
+    vec4 metallicSample = texture(metallicMap, TexCoord);
+    metallic = metallicSample.b;
+#endif
     
     // Roughness texture (R channel, grayscale)
-    if (hasRoughnessMap) {
-        vec4 roughnessSample = texture(roughnessMap, TexCoord);
-        roughness = roughnessSample.g;
-    }
+#ifdef HAS_ROUGHNESS_MAP
+    vec4 roughnessSample = texture(roughnessMap, TexCoord);
+    roughness = roughnessSample.g;
+#endif
     
     // AO texture (R channel, grayscale)
-    if (hasAOMap) {
-        vec4 aoSample = texture(aoMap, TexCoord);
-        ao = aoSample.r;
-    }
+#ifdef HAS_AO_MAP
+    vec4 aoSample = texture(aoMap, TexCoord);
+    ao = aoSample.r;
+#endif
     
     // Emissive texture (RGB)
-    if (hasEmissiveMap) {
-        vec4 emissiveSample = texture(emissiveMap, TexCoord);
-        emissive = emissiveSample.rgb;
-    }
+#ifdef HAS_EMISSIVE_MAP
+    vec4 emissiveSample = texture(emissiveMap, TexCoord);
+    emissive = emissiveSample.rgb;
+#endif
     
     // Calculate reflectance at normal incidence
     vec3 F0 = vec3(0.04); 
@@ -292,6 +161,9 @@ void main()
     }
     
     // Ambient lighting
+#ifdef USE_SSAO
+    ao *= texelFetch(ssaoTexture, ivec2(gl_FragCoord.xy), 0).r;
+#endif
     vec3 ambient = ambientLight * albedo * ao;
     
     // Emissive is already sampled above
@@ -16,6 +16,9 @@ out vec2 TexCoord;
 out vec3 Tangent;
 out vec3 Bitangent;
 
+// Must match depth.vert bit for bit, the depth pre-pass is tested with GL_EQUAL
+invariant gl_Position;
+
 void main()
 {
     FragPos = vec3(uModel * vec4(aPos, 1.0));
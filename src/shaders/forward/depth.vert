@@ -0,0 +1,19 @@
+#version 330 core
+
+// Depth pre-pass of ForwardPipeline. The color pass tests GL_EQUAL against
+// this depth, so gl_Position is computed exactly as in default.vert and is
+// invariant in both.
+
+layout(location = 0) in vec3 aPos;
+
+uniform mat4 uModel;
+uniform mat4 uView;
+uniform mat4 uProjection;
+
+invariant gl_Position;
+
+void main()
+{
+    vec3 fragPos = vec3(uModel * vec4(aPos, 1.0));
+    gl_Position = uProjection * uView * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,16 @@
+// Shared by the denoiser kernels, see DenoiseFilter for the CPU version
+
+const float kAlbedoEpsilon = 0.01;
+
+float luminance(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Illumination is filtered without surface texture, which is multiplied back at the end
+vec3 demodulate(vec3 color, vec3 albedo) {
+    return color / max(albedo, vec3(kAlbedoEpsilon));
+}
+
+vec3 remodulate(vec3 illumination, vec3 albedo) {
+    return illumination * max(albedo, vec3(kAlbedoEpsilon));
+}
@@ -0,0 +1,87 @@
+// Path state and ray queues shared by the wavefront kernels (WavefrontTracer)
+//
+// Every queue is a segment of queueItems holding path indices; its length
+// lives in queueCount and queue_args.comp turns the counts into indirect
+// dispatch arguments. Kernels run one invocation per queue entry.
+
+#define WAVEFRONT_GROUP_SIZE 256
+
+// Queue ids, must match WavefrontTracer.cpp
+#define QUEUE_RAYS_A   0u   // Ray queues ping-pong between bounces
+#define QUEUE_RAYS_B   1u
+#define QUEUE_SORTED   2u   // Rays reordered by direction octant
+#define QUEUE_DIFFUSE  3u   // Hits binned by material class
+#define QUEUE_METAL    4u
+#define QUEUE_SHADOW   5u   // Entries live in shadowRays, not queueItems
+#define QUEUE_COUNT    6
+
+struct PathState {
+    vec3 origin;
+    uint pixel;         // Pixel index within the tile
+    vec3 direction;
+    uint sampleIndex;   // Position in the pixel's sample sequence
+    vec3 throughput;
+    uint bounce;
+    vec3 radiance;
+    float hitT;
+    uint triangle;      // Closest hit from extend
+    float baryU;
+    float baryV;
+    float bsdfPdf;      // Of the current ray, 0 for camera rays and specular bounces (MIS)
+};
+
+// Occlusion test; the contribution is added to the path if nothing blocks it.
+// A path pushes at most one shadow ray per bounce, so no atomics are needed.
+struct ShadowRay {
+    vec3 origin;
+    float tMax;
+    vec3 direction;
+    uint path;
+    vec3 contribution;
+    float _pad0;
+};
+
+layout(std430, binding = 5) buffer Paths {
+    PathState paths[];
+};
+
+layout(std430, binding = 6) buffer Queues {
+    uint queueItems[];
+};
+
+layout(std430, binding = 7) buffer QueueCounters {
+    uint queueCount[QUEUE_COUNT];
+    uint octantCount[8];
+    uint octantOffset[8];
+};
+
+layout(std430, binding = 9) buffer ShadowRays {
+    ShadowRay shadowRays[];
+};
+
+uniform uint queueCapacity;     // Entries per queue segment
+uniform ivec2 tileOffset;       // Tile being traced
+uniform ivec2 tileSize;
+
+uint queueBase(uint queue) {
+    return queue * queueCapacity;
+}
+
+ivec2 tilePixelCoords(uint pixel) {
+    return tileOffset + ivec2(int(pixel) % tileSize.x, int(pixel) / tileSize.x);
+}
+
+// generate.comp lays paths out sample-major, so the first tilePixels paths
+// are sample 0 of each pixel; those write the denoiser features
+bool firstSampleOfPixel(uint path) {
+    return path < uint(tileSize.x * tileSize.y);
+}
+
+void pushShadowRay(uint path, vec3 origin, vec3 direction, float tMax, vec3 contribution) {
+    uint slot = atomicAdd(queueCount[QUEUE_SHADOW], 1u);
+    shadowRays[slot].origin = origin;
+    shadowRays[slot].tMax = tMax;
+    shadowRays[slot].direction = direction;
+    shadowRays[slot].path = path;
+    shadowRays[slot].contribution = contribution;
+}